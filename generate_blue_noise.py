@@ -0,0 +1,106 @@
+import numpy as np
+
+# Void-and-cluster blue-noise threshold map (Ulichney 1993).
+# Output: main/blue_noise_64.h, a 64x64 tile of per-pixel thresholds.
+
+SIZE = 64
+SIGMA = 1.5
+SEED = 1
+
+
+def gaussian_kernel(size, sigma):
+    # Toroidal distances so the tile repeats without seams
+    d = np.minimum(np.arange(size), size - np.arange(size))
+    d2 = d[:, None] ** 2 + d[None, :] ** 2
+    return np.exp(-d2 / (2 * sigma * sigma))
+
+
+def energy(pattern, kernel_fft):
+    return np.real(np.fft.ifft2(np.fft.fft2(pattern) * kernel_fft))
+
+
+def tightest_cluster(pattern, kernel_fft):
+    e = energy(pattern, kernel_fft)
+    e[pattern == 0] = -np.inf
+    return np.unravel_index(np.argmax(e), e.shape)
+
+
+def largest_void(pattern, kernel_fft):
+    e = energy(pattern, kernel_fft)
+    e[pattern == 1] = np.inf
+    return np.unravel_index(np.argmin(e), e.shape)
+
+
+def void_and_cluster(size, sigma, seed):
+    rng = np.random.default_rng(seed)
+    kernel_fft = np.fft.fft2(gaussian_kernel(size, sigma))
+    n = size * size
+    ones = n // 10
+
+    # Initial binary pattern: random points relaxed until stable
+    pattern = np.zeros((size, size))
+    pattern.flat[rng.choice(n, ones, replace=False)] = 1
+    while True:
+        c = tightest_cluster(pattern, kernel_fft)
+        pattern[c] = 0
+        v = largest_void(pattern, kernel_fft)
+        if v == c:
+            pattern[c] = 1
+            break
+        pattern[v] = 1
+
+    rank = np.zeros((size, size), dtype=np.int32)
+    initial = pattern.copy()
+
+    # Phase 1: remove points from the initial pattern, tightest cluster first
+    p = initial.copy()
+    for r in range(ones - 1, -1, -1):
+        c = tightest_cluster(p, kernel_fft)
+        p[c] = 0
+        rank[c] = r
+
+    # Phase 2 and 3: fill the largest voids until the tile is full
+    p = initial.copy()
+    for r in range(ones, n):
+        v = largest_void(p, kernel_fft)
+        p[v] = 1
+        rank[v] = r
+
+    return rank
+
+
+def generate(output_file):
+    rank = void_and_cluster(SIZE, SIGMA, SEED)
+    n = SIZE * SIZE
+
+    # Rank -> threshold in 1..255: black stays black, white stays white and
+    # a flat gray g lights about g/255 of the pixels (pixel on if g >= t)
+    thresholds = 1 + rank * 255 // n
+
+    c_code = []
+    c_code.append("#ifndef BLUE_NOISE_64_H")
+    c_code.append("#define BLUE_NOISE_64_H")
+    c_code.append("")
+    c_code.append("#include <stdint.h>")
+    c_code.append("")
+    c_code.append(f"// Blue-noise threshold map, void-and-cluster, sigma {SIGMA}")
+    c_code.append(f"// Size: {SIZE}x{SIZE}, generated by generate_blue_noise.py")
+    c_code.append("")
+    c_code.append(f"#define BLUE_NOISE_SIZE {SIZE}")
+    c_code.append("")
+    c_code.append(f"static const uint8_t blue_noise_64[{SIZE} * {SIZE}] = {{")
+    for y in range(SIZE):
+        row = ", ".join(f"{v:3d}" for v in thresholds[y])
+        c_code.append(f"    {row},")
+    c_code.append("};")
+    c_code.append("")
+    c_code.append("#endif // BLUE_NOISE_64_H")
+
+    with open(output_file, "w", encoding="utf-8") as f:
+        f.write("\n".join(c_code) + "\n")
+
+    print(f"Generated {output_file}")
+
+
+if __name__ == "__main__":
+    generate("main/blue_noise_64.h")
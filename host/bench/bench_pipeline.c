@@ -0,0 +1,494 @@
+/*
+ * Pipeline Benchmark - Times the image pipeline on the host
+ *
+ * Every image of the corpus goes through the stages the frame runs:
+ *   process  - img_process_file, file to packed frame (decode, scale, dither)
+ *   thumb    - img_process_file_ex producing only the gallery thumbnail
+ *   tjpgd    - full-size decode alone (baseline JPEGs)
+ *   scale    - img_scale_gray, full-size gray to the panel size
+ *   dither   - img_gray_to_1bpp on the scaled image
+ * Each stage reports the median time of its runs, its peak memory and a
+ * CRC32 of its output, as JSON. The peak of process and thumb is that of
+ * their arena job (PSRAM, and internal SRAM as fast_peak); the others
+ * report the heap they allocate above the start of the stage.
+ *
+ * Usage: bench_pipeline [-r runs] [-b bpp] [-s] [-m psram_mb] [-o report.json] [-v]
+ *                       file-or-directory...
+ */
+
+#include "image_processor.h"
+#include "img_arena.h"
+#include "host_heap.h"
+#include "host_util.h"
+#include "esp_log.h"
+#include "tjpgd.h"
+#include "stb_image.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#define MAX_RUNS        15
+#define MAX_FILES       256
+#define TJPGD_WORK      4096
+#define THUMB_DIV       5       // Gallery thumbnails are 1/5 of the panel
+
+typedef struct {
+    bool ran;
+    esp_err_t status;
+    double ms;
+    size_t peak;                // Arena peak for arena jobs, else heap peak
+    size_t fast_peak;           // Internal SRAM peak of arena jobs
+    uint32_t crc;
+} stage_t;
+
+enum { ST_PROCESS, ST_THUMB, ST_TJPGD, ST_SCALE, ST_DITHER, ST_COUNT };
+
+static const char *stage_names[ST_COUNT] = { "process", "thumb", "tjpgd", "scale", "dither" };
+
+typedef struct {
+    char path[512];
+    const char *format;         // "jpeg", "jpeg-progressive", "png", "bmp"
+    int width;
+    int height;
+    long bytes;
+    stage_t stages[ST_COUNT];
+
+    // Stage buffers, allocated outside the timed sections
+    uint8_t *frame;
+    size_t frame_size;
+    uint8_t *thumb;
+    uint8_t *gray;              // Full-size gray (tjpgd output or reference decode)
+    uint8_t *scaled;            // Panel-size gray
+    uint8_t *packed;
+} bench_image_t;
+
+typedef esp_err_t (*stage_fn)(bench_image_t *img, const uint8_t **out, size_t *out_len);
+
+static int s_runs = 3;
+static img_process_opts_t s_opts;
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Run a stage s_runs times; a failed run ends it. Stages that run as an
+// arena job report the job's own peak: the heap peak would only show the
+// arena reservation, and that is sized from the previous job, so such a
+// stage first runs once untimed to reserve for itself.
+static void run_stage(bench_image_t *img, int id, stage_fn fn, bool arena_job) {
+    stage_t *st = &img->stages[id];
+    double times[MAX_RUNS];
+    int runs = 0;
+
+    st->ran = true;
+    st->peak = 0;
+    st->fast_peak = 0;
+    if (arena_job) {
+        const uint8_t *out = NULL;
+        size_t out_len = 0;
+        fn(img, &out, &out_len);
+    }
+    while (runs < s_runs) {
+        const uint8_t *out = NULL;
+        size_t out_len = 0;
+        size_t base = host_heap_in_use();
+        host_heap_reset_peak();
+        double t0 = host_now_ms();
+        st->status = fn(img, &out, &out_len);
+        times[runs++] = host_now_ms() - t0;
+
+        size_t peak = host_heap_peak() - base;
+        size_t fast_peak = 0;
+        if (arena_job) {
+            img_arena_stats_t stats;
+            img_arena_get_stats(&stats);
+            peak = stats.peak;
+            fast_peak = stats.fast_peak;
+        }
+        st->peak = peak > st->peak ? peak : st->peak;
+        st->fast_peak = fast_peak > st->fast_peak ? fast_peak : st->fast_peak;
+        st->crc = out ? host_crc32(out, out_len) : 0;
+        if (st->status != ESP_OK) {
+            break;
+        }
+    }
+    qsort(times, runs, sizeof(double), cmp_double);
+    st->ms = times[runs / 2];
+}
+
+/* ---- Stages ---- */
+
+static esp_err_t stage_process(bench_image_t *img, const uint8_t **out, size_t *out_len) {
+    *out = img->frame;
+    *out_len = img->frame_size;
+    return img_process_file(img->path, img->frame, img->frame_size, &s_opts);
+}
+
+static esp_err_t stage_thumb(bench_image_t *img, const uint8_t **out, size_t *out_len) {
+    img_extra_outputs_t extra = {
+        .thumb = img->thumb,
+        .thumb_w = s_opts.target_width / THUMB_DIV,
+        .thumb_h = s_opts.target_height / THUMB_DIV,
+    };
+    *out = img->thumb;
+    *out_len = (size_t)extra.thumb_w * extra.thumb_h;
+    return img_process_file_ex(img->path, NULL, 0, &s_opts, &extra);
+}
+
+typedef struct {
+    FILE *f;
+    uint8_t *gray;
+    int width;
+} tjpgd_ctx_t;
+
+static size_t tjpgd_in(JDEC *jd, uint8_t *buf, size_t len) {
+    tjpgd_ctx_t *ctx = jd->device;
+    if (!buf) {
+        return fseek(ctx->f, (long)len, SEEK_CUR) == 0 ? len : 0;
+    }
+    return fread(buf, 1, len, ctx->f);
+}
+
+static int tjpgd_out(JDEC *jd, void *bitmap, JRECT *rect) {
+    tjpgd_ctx_t *ctx = jd->device;
+    const uint8_t *src = bitmap;
+    int w = rect->right - rect->left + 1;
+    for (int y = rect->top; y <= rect->bottom; y++) {
+        memcpy(ctx->gray + (size_t)y * ctx->width + rect->left, src, w);
+        src += w;
+    }
+    return 1;
+}
+
+static esp_err_t stage_tjpgd(bench_image_t *img, const uint8_t **out, size_t *out_len) {
+    static uint8_t work[TJPGD_WORK];
+    tjpgd_ctx_t ctx = { .f = fopen(img->path, "rb"), .gray = img->gray, .width = img->width };
+    if (!ctx.f) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    JDEC jd;
+    JRESULT res = jd_prepare(&jd, tjpgd_in, work, sizeof(work), &ctx);
+    if (res == JDR_OK) {
+        res = jd_decomp(&jd, tjpgd_out, 0);
+    }
+    fclose(ctx.f);
+    *out = img->gray;
+    *out_len = (size_t)img->width * img->height;
+    return res == JDR_OK ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t stage_scale(bench_image_t *img, const uint8_t **out, size_t *out_len) {
+    img_scale_gray(img->gray, img->width, img->height, img->scaled,
+                   s_opts.target_width, s_opts.target_height, s_opts.fit_mode);
+    *out = img->scaled;
+    *out_len = (size_t)s_opts.target_width * s_opts.target_height;
+    return ESP_OK;
+}
+
+static esp_err_t stage_dither(bench_image_t *img, const uint8_t **out, size_t *out_len) {
+    img_gray_to_1bpp(img->scaled, s_opts.target_width, s_opts.target_height, img->packed, &s_opts);
+    *out = img->packed;
+    *out_len = img->frame_size;
+    return ESP_OK;
+}
+
+/* ---- Corpus ---- */
+
+static uint32_t get_be16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+static uint32_t get_be32(const uint8_t *p) { return ((uint32_t)get_be16(p) << 16) | get_be16(p + 2); }
+static int32_t get_le32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+// Walk the JPEG markers to the frame header
+static bool probe_jpeg(FILE *f, bench_image_t *img) {
+    uint8_t b[8];
+    if (fread(b, 1, 2, f) != 2 || b[0] != 0xFF || b[1] != 0xD8) {
+        return false;
+    }
+    while (fread(b, 1, 4, f) == 4 && b[0] == 0xFF) {
+        uint8_t marker = b[1];
+        long len = get_be16(b + 2);
+        bool sof = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+        if (sof) {
+            if (fread(b, 1, 5, f) != 5) {
+                return false;
+            }
+            img->height = get_be16(b + 1);
+            img->width = get_be16(b + 3);
+            img->format = (marker == 0xC2 || marker == 0xC6) ? "jpeg-progressive" : "jpeg";
+            return true;
+        }
+        if (fseek(f, len - 2, SEEK_CUR) != 0) {
+            return false;
+        }
+    }
+    return false;
+}
+
+static bool probe(bench_image_t *img) {
+    FILE *f = fopen(img->path, "rb");
+    if (!f) {
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    img->bytes = ftell(f);
+    rewind(f);
+
+    uint8_t hdr[26];
+    bool ok = false;
+    const char *ext = strrchr(img->path, '.');
+    if (ext && (strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0)) {
+        ok = probe_jpeg(f, img);
+    } else if (fread(hdr, 1, sizeof(hdr), f) == sizeof(hdr)) {
+        if (memcmp(hdr, "\x89PNG", 4) == 0) {
+            img->format = "png";
+            img->width = get_be32(hdr + 16);
+            img->height = get_be32(hdr + 20);
+            ok = true;
+        } else if (hdr[0] == 'B' && hdr[1] == 'M') {
+            img->format = "bmp";
+            img->width = get_le32(hdr + 18);
+            img->height = abs(get_le32(hdr + 22));
+            ok = true;
+        }
+    }
+    fclose(f);
+    return ok && img->width > 0 && img->height > 0;
+}
+
+static uint8_t *read_file(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    rewind(f);
+    uint8_t *data = malloc(*size);
+    if (data && fread(data, 1, *size, f) != *size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+// Full-size gray for the scale stage where tjpgd did not provide it
+static bool reference_gray(bench_image_t *img) {
+    size_t pixels = (size_t)img->width * img->height;
+    if (strcmp(img->format, "bmp") == 0) {
+        size_t size;
+        uint8_t *data = read_file(img->path, &size);
+        uint8_t *rgb = NULL;
+        uint16_t w, h;
+        bool ok = data && img_decode_bmp(data, size, &rgb, &w, &h) == ESP_OK;
+        if (ok) {
+            for (size_t i = 0; i < pixels; i++) {
+                const uint8_t *p = rgb + i * 3;
+                img->gray[i] = (p[0] * 77 + p[1] * 150 + p[2] * 29) >> 8;
+            }
+        }
+        free(rgb);
+        free(data);
+        return ok;
+    }
+    int w, h, comp;
+    uint8_t *gray = stbi_load(img->path, &w, &h, &comp, 1);
+    if (!gray || w != img->width || h != img->height) {
+        stbi_image_free(gray);
+        return false;
+    }
+    memcpy(img->gray, gray, pixels);
+    stbi_image_free(gray);
+    return true;
+}
+
+static void bench_image(bench_image_t *img) {
+    int tw = s_opts.target_width;
+    int th = s_opts.target_height;
+    img->frame_size = img_frame_size(s_opts.format, tw, th);
+    img->frame = calloc(1, img->frame_size);
+    img->packed = calloc(1, img->frame_size);
+    img->thumb = calloc(1, (size_t)(tw / THUMB_DIV) * (th / THUMB_DIV));
+    img->scaled = calloc(1, (size_t)tw * th);
+
+    fprintf(stderr, "%s: %s %dx%d\n", img->path, img->format, img->width, img->height);
+    run_stage(img, ST_PROCESS, stage_process, true);
+    run_stage(img, ST_THUMB, stage_thumb, true);
+
+    // img_scale_gray takes 16-bit sizes
+    bool gray_ok = false;
+    if (img->width <= UINT16_MAX && img->height <= UINT16_MAX) {
+        img->gray = malloc((size_t)img->width * img->height);
+    }
+    if (img->gray && strcmp(img->format, "jpeg") == 0) {
+        run_stage(img, ST_TJPGD, stage_tjpgd, false);
+        gray_ok = img->stages[ST_TJPGD].status == ESP_OK;
+    }
+    if (img->gray && !gray_ok) {
+        gray_ok = reference_gray(img);
+    }
+    if (gray_ok) {
+        run_stage(img, ST_SCALE, stage_scale, false);
+        run_stage(img, ST_DITHER, stage_dither, false);
+    }
+
+    free(img->gray);
+    free(img->scaled);
+    free(img->thumb);
+    free(img->packed);
+    free(img->frame);
+}
+
+static int cmp_path(const void *a, const void *b) {
+    return strcmp(((const bench_image_t *)a)->path, ((const bench_image_t *)b)->path);
+}
+
+static void add_path(bench_image_t *images, int *count, const char *path) {
+    DIR *dir = opendir(path);
+    if (!dir) {
+        if (*count < MAX_FILES) {
+            snprintf(images[*count].path, sizeof(images[0].path), "%s", path);
+            (*count)++;
+        }
+        return;
+    }
+    int first = *count;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL && *count < MAX_FILES) {
+        const char *ext = strrchr(de->d_name, '.');
+        if (de->d_name[0] == '.' || !ext ||
+            !(strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0 ||
+              strcasecmp(ext, ".png") == 0 || strcasecmp(ext, ".bmp") == 0)) {
+            continue;
+        }
+        snprintf(images[*count].path, sizeof(images[0].path), "%s/%s", path, de->d_name);
+        (*count)++;
+    }
+    closedir(dir);
+    qsort(images + first, *count - first, sizeof(bench_image_t), cmp_path);
+}
+
+/* ---- Report ---- */
+
+static void json_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', f);
+        }
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static void write_report(FILE *f, const bench_image_t *images, int count, size_t psram) {
+    fprintf(f, "{\n  \"runs\": %d,\n  \"psram_kb\": %zu,\n", s_runs, psram / 1024);
+    fprintf(f, "  \"opts\": {\"width\": %d, \"height\": %d, \"bpp\": %d, \"dither\": %d, "
+               "\"fit\": %s, \"streaming\": %s},\n",
+            s_opts.target_width, s_opts.target_height, img_format_bpp(s_opts.format), s_opts.dither,
+            s_opts.fit_mode ? "true" : "false", s_opts.streaming ? "true" : "false");
+    fprintf(f, "  \"images\": [");
+    for (int i = 0; i < count; i++) {
+        const bench_image_t *img = &images[i];
+        fprintf(f, "%s\n    {\"file\": ", i ? "," : "");
+        json_string(f, img->path);
+        fprintf(f, ", \"format\": \"%s\", \"width\": %d, \"height\": %d, \"bytes\": %ld,\n"
+                   "     \"stages\": {",
+                img->format ? img->format : "unknown", img->width, img->height, img->bytes);
+        bool first = true;
+        for (int s = 0; s < ST_COUNT; s++) {
+            const stage_t *st = &img->stages[s];
+            if (!st->ran) {
+                continue;
+            }
+            fprintf(f, "%s\n       \"%s\": {\"status\": \"%s\", \"ms\": %.2f, \"peak_kb\": %zu, "
+                       "\"fast_peak\": %zu, \"crc32\": \"%08x\"}",
+                    first ? "" : ",", stage_names[s], esp_err_to_name(st->status), st->ms,
+                    st->peak / 1024, st->fast_peak, (unsigned)st->crc);
+            first = false;
+        }
+        fprintf(f, "}}");
+    }
+    fprintf(f, "\n  ]\n}\n");
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-r runs] [-b bpp] [-s] [-m psram_mb] [-o report.json] [-v] "
+                    "file-or-directory...\n", prog);
+}
+
+int main(int argc, char **argv) {
+    const char *report = NULL;
+    size_t psram = HOST_PSRAM_SIZE;
+    img_get_default_opts(&s_opts);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:b:sm:o:v")) != -1) {
+        switch (opt) {
+            case 'r':
+                s_runs = atoi(optarg);
+                s_runs = s_runs < 1 ? 1 : (s_runs > MAX_RUNS ? MAX_RUNS : s_runs);
+                break;
+            case 'b':
+                s_opts.format = img_format_from_bpp(atoi(optarg));
+                break;
+            case 's':
+                s_opts.streaming = true;
+                break;
+            case 'm':
+                psram = (size_t)atoi(optarg) * 1024 * 1024;
+                break;
+            case 'o':
+                report = optarg;
+                break;
+            case 'v':
+                esp_log_level_set("*", ESP_LOG_INFO);
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+    host_heap_set_psram(psram);
+
+    bench_image_t *images = calloc(MAX_FILES, sizeof(bench_image_t));
+    int count = 0;
+    for (int i = optind; i < argc; i++) {
+        add_path(images, &count, argv[i]);
+    }
+
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        if (!probe(&images[i])) {
+            fprintf(stderr, "%s: not a JPEG, PNG or BMP\n", images[i].path);
+            failed++;
+            continue;
+        }
+        bench_image(&images[i]);
+        if (images[i].stages[ST_PROCESS].status != ESP_OK) {
+            failed++;
+        }
+    }
+
+    FILE *out = report ? fopen(report, "w") : stdout;
+    if (!out) {
+        perror(report);
+        return 1;
+    }
+    write_report(out, images, count, psram);
+    if (report) {
+        fclose(out);
+    }
+    free(images);
+    return failed ? 1 : 0;
+}
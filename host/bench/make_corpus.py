@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""
+Generates the benchmark corpus for bench_pipeline: synthetic photo-like
+images from VGA to 48 MP as baseline JPEG, progressive JPEG, PNG and BMP.
+
+The content is seeded, so a corpus made twice with the same Pillow version
+is identical and benchmark checksums can be compared across builds.
+
+Usage: python3 make_corpus.py OUT_DIR [--max-mp 48] [--formats jpg,pjpg,png,bmp]
+Requires Pillow.
+"""
+
+import argparse
+import os
+import random
+
+from PIL import Image, ImageDraw, ImageFilter
+
+SIZES = [
+    ("vga", 640, 480),
+    ("2mp", 1920, 1080),
+    ("12mp", 4000, 3000),
+    ("48mp", 8000, 6000),
+]
+
+FORMATS = {
+    "jpg": ("JPEG", ".jpg", {"quality": 90}),
+    "pjpg": ("JPEG", "_prog.jpg", {"quality": 90, "progressive": True}),
+    "png": ("PNG", ".png", {"compress_level": 6}),
+    "bmp": ("BMP", ".bmp", {}),
+}
+
+
+def noise(rng, w, h):
+    return Image.frombytes("L", (w, h), bytes(rng.getrandbits(8) for _ in range(w * h)))
+
+
+def make_image(w, h, seed):
+    rng = random.Random(seed)
+
+    # Soft colour blobs: low-resolution noise blown up to full size
+    bands = [noise(rng, 12, 9).resize((w, h), Image.BICUBIC) for _ in range(3)]
+    img = Image.merge("RGB", bands)
+
+    # Sky-to-ground gradient, like most photos
+    grad = Image.linear_gradient("L").resize((w, h))
+    img = Image.blend(img, Image.merge("RGB", [grad] * 3), 0.4)
+
+    # Hard edges and fine lines for the scaler and the dither
+    draw = ImageDraw.Draw(img)
+    unit = max(w, h) // 64
+    for _ in range(40):
+        x, y = rng.randrange(w), rng.randrange(h)
+        r = rng.randrange(unit, unit * 8)
+        colour = tuple(rng.randrange(256) for _ in range(3))
+        if rng.random() < 0.5:
+            draw.ellipse((x - r, y - r, x + r, y + r), fill=colour)
+        else:
+            draw.rectangle((x - r, y - r // 2, x + r, y + r // 2), fill=colour)
+    for i in range(0, w, max(unit // 2, 2)):
+        draw.line((i, h * 3 // 4, i + unit, h), fill=(20, 20, 20), width=1)
+    img = img.filter(ImageFilter.GaussianBlur(max(unit // 16, 1)))
+
+    # Sensor-like grain, tiled to keep generation fast
+    tile = noise(rng, 256, 256)
+    grain = Image.new("L", (w, h))
+    for ty in range(0, h, 256):
+        for tx in range(0, w, 256):
+            grain.paste(tile, (tx, ty))
+    return Image.blend(img, Image.merge("RGB", [grain] * 3), 0.08)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("out_dir")
+    parser.add_argument("--max-mp", type=float, default=48, help="largest image, megapixels")
+    parser.add_argument("--formats", default=",".join(FORMATS), help="comma-separated: " + ",".join(FORMATS))
+    args = parser.parse_args()
+
+    os.makedirs(args.out_dir, exist_ok=True)
+    formats = [f for f in args.formats.split(",") if f]
+    for seed, (name, w, h) in enumerate(SIZES):
+        if w * h > args.max_mp * 1e6 * 1.01:
+            continue
+        img = make_image(w, h, seed)
+        for fmt in formats:
+            pil_format, suffix, params = FORMATS[fmt]
+            path = os.path.join(args.out_dir, name + suffix)
+            img.save(path, pil_format, **params)
+            print(f"{path}: {w}x{h}, {os.path.getsize(path) // 1024} KB")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,18 @@
+/*
+ * Host Utilities - Timing and checksums shared by the host tools
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Monotonic time in milliseconds
+ */
+double host_now_ms(void);
+
+/**
+ * @brief CRC32 (IEEE 802.3) of a buffer
+ */
+uint32_t host_crc32(const uint8_t *data, size_t len);
@@ -0,0 +1,113 @@
+/*
+ * Host Heap Implementation
+ *
+ * Sizes come from malloc_usable_size, so no header is added to the blocks
+ * and memory from the wrapped and unwrapped allocators can be mixed. The
+ * dither workers run on threads, hence the atomics.
+ */
+
+#include "host_heap.h"
+#include "esp_heap_caps.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <malloc.h>
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static atomic_size_t s_in_use;
+static atomic_size_t s_peak;
+static size_t s_psram = HOST_PSRAM_SIZE;
+
+static void count_alloc(void *p) {
+    if (!p) {
+        return;
+    }
+    size_t now = atomic_fetch_add(&s_in_use, malloc_usable_size(p)) + malloc_usable_size(p);
+    size_t peak = atomic_load(&s_peak);
+    while (now > peak && !atomic_compare_exchange_weak(&s_peak, &peak, now)) {
+    }
+}
+
+static void count_free(void *p) {
+    if (p) {
+        atomic_fetch_sub(&s_in_use, malloc_usable_size(p));
+    }
+}
+
+void *__wrap_malloc(size_t size) {
+    void *p = __real_malloc(size);
+    count_alloc(p);
+    return p;
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    void *p = __real_calloc(n, size);
+    count_alloc(p);
+    return p;
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    size_t old = ptr ? malloc_usable_size(ptr) : 0;
+    void *p = __real_realloc(ptr, size);
+    if (p) {
+        atomic_fetch_sub(&s_in_use, old);
+        count_alloc(p);
+    } else if (size == 0) {
+        atomic_fetch_sub(&s_in_use, old);
+    }
+    return p;
+}
+
+void __wrap_free(void *ptr) {
+    count_free(ptr);
+    __real_free(ptr);
+}
+
+size_t host_heap_in_use(void) {
+    return atomic_load(&s_in_use);
+}
+
+size_t host_heap_peak(void) {
+    return atomic_load(&s_peak);
+}
+
+void host_heap_reset_peak(void) {
+    atomic_store(&s_peak, atomic_load(&s_in_use));
+}
+
+void host_heap_set_psram(size_t size) {
+    s_psram = size;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps) {
+    (void)caps;
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    (void)caps;
+    return calloc(n, size);
+}
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps) {
+    (void)caps;
+    return realloc(ptr, size);
+}
+
+void heap_caps_free(void *ptr) {
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    (void)caps;
+    size_t used = host_heap_in_use();
+    return used < s_psram ? s_psram - used : 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return heap_caps_get_free_size(caps);
+}
@@ -0,0 +1,34 @@
+/*
+ * Host Heap - Allocation accounting for host builds
+ *
+ * The host targets link with malloc, calloc, realloc and free wrapped
+ * (-Wl,--wrap), so every allocation of the pipeline is counted, including
+ * the ones that bypass heap_caps.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#define HOST_PSRAM_SIZE     (8 * 1024 * 1024)   // Modelled PSRAM, as on the E1001
+
+/**
+ * @brief Bytes currently allocated
+ */
+size_t host_heap_in_use(void);
+
+/**
+ * @brief Most bytes allocated at once since the last host_heap_reset_peak
+ */
+size_t host_heap_peak(void);
+
+/**
+ * @brief Restart peak tracking from the current usage
+ */
+void host_heap_reset_peak(void);
+
+/**
+ * @brief Set the modelled PSRAM size reported to heap_caps_get_free_size
+ *        and heap_caps_get_largest_free_block
+ */
+void host_heap_set_psram(size_t size);
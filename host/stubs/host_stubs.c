@@ -0,0 +1,55 @@
+/*
+ * Host stand-ins for the ESP-IDF and application services the image
+ * pipeline calls: logging, error names and the saved settings (none, so
+ * uploads use the default render options).
+ */
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "storage_manager.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+static esp_log_level_t s_level = ESP_LOG_WARN;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    (void)tag;
+    s_level = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    static const char letters[] = "NEWIDV";
+    if (level > s_level) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%c (%s) ", letters[level], tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK:                    return "ESP_OK";
+        case ESP_FAIL:                  return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:            return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:       return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:     return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:      return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:         return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:     return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:           return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_RESPONSE:  return "ESP_ERR_INVALID_RESPONSE";
+        case ESP_ERR_INVALID_CRC:       return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_INVALID_VERSION:   return "ESP_ERR_INVALID_VERSION";
+        default:                        return "UNKNOWN ERROR";
+    }
+}
+
+esp_err_t storage_load_settings(app_settings_t *settings) {
+    (void)settings;
+    return ESP_ERR_NOT_FOUND;
+}
@@ -0,0 +1,153 @@
+/*
+ * Kernel Test - Vector kernels against their C versions
+ *
+ * Every kernel runs on the same pseudo-random rows with the vector set and
+ * with the C set forced, over all lengths up to a few vectors (to hit each
+ * tail) and a full 800-pixel row, and the outputs must be identical. The C
+ * luma is also checked against img_luma. Packed rows get a guard byte that
+ * must survive, so no kernel writes past x1.
+ *
+ * Usage: test_kernels
+ */
+
+#include "img_kernels.h"
+#include "img_tone.h"
+#include "blue_noise_64.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_N   800
+#define GUARD   0xA5
+
+static uint32_t s_seed = 12345;
+static int s_failures;
+
+static uint8_t rnd(void)
+{
+    s_seed = s_seed * 1103515245u + 12345u;
+    return (uint8_t)(s_seed >> 16);
+}
+
+static void check(bool ok, const char *kernel, int n, int arg)
+{
+    if (!ok) {
+        if (s_failures < 20) {
+            printf("FAIL %s n=%d arg=%d\n", kernel, n, arg);
+        }
+        s_failures++;
+    }
+}
+
+static void test_luma(int n)
+{
+    static uint8_t rgb[MAX_N * 3], a[MAX_N], b[MAX_N];
+    for (int i = 0; i < n * 3; i++) rgb[i] = rnd();
+
+    img_kernels_set_simd(true);
+    img_k_luma(rgb, a, n);
+    img_kernels_set_simd(false);
+    img_k_luma(rgb, b, n);
+    check(memcmp(a, b, n) == 0, "luma", n, 0);
+    for (int i = 0; i < n; i++) {
+        check(b[i] == img_luma(rgb + i * 3), "luma_ref", n, i);
+    }
+}
+
+static void test_lut(int n)
+{
+    static uint8_t lut[256], in[MAX_N], a[MAX_N], b[MAX_N];
+    for (int i = 0; i < 256; i++) lut[i] = rnd();
+    for (int i = 0; i < n; i++) in[i] = rnd();
+
+    img_kernels_set_simd(true);
+    img_k_lut(lut, in, a, n);
+    img_kernels_set_simd(false);
+    img_k_lut(lut, in, b, n);
+    check(memcmp(a, b, n) == 0, "lut", n, 0);
+
+    // In place, as the RGB row source uses it
+    memcpy(a, in, n);
+    img_kernels_set_simd(true);
+    img_k_lut(lut, a, a, n);
+    check(memcmp(a, b, n) == 0, "lut_inplace", n, 0);
+}
+
+static void pack_both(const uint8_t *gray, const uint8_t *map, int mask, int threshold,
+                      int x0, int x1, const char *name)
+{
+    static uint8_t a[MAX_N / 8 + 2], b[MAX_N / 8 + 2];
+    int bytes = (x1 + 7) / 8;
+    for (int pass = 0; pass < 2; pass++) {
+        uint8_t *out = pass ? b : a;
+        memset(out, GUARD, sizeof(a));
+        img_kernels_set_simd(pass == 0);
+        if (map) {
+            img_k_map_pack(gray, map, mask, out, x0, x1);
+        } else {
+            img_k_threshold_pack(gray, (uint8_t)threshold, out, x0, x1);
+        }
+    }
+    check(memcmp(a, b, sizeof(a)) == 0, name, x1 - x0, threshold);
+    check(a[bytes] == GUARD, name, x1 - x0, -1);
+}
+
+static void test_pack(int n)
+{
+    static uint8_t gray[MAX_N];
+    for (int i = 0; i < n; i++) gray[i] = rnd();
+
+    for (int t = 0; t < 256; t += (n > 64) ? 17 : 1) {
+        pack_both(gray, NULL, 0, t, 0, n, "threshold_pack");
+    }
+    pack_both(gray, NULL, 0, 128, (n / 16) * 8, n, "threshold_pack_x0");
+
+    // Bayer-like 8-wide row and a blue-noise row, from x0 = 0 and mid-row
+    static uint8_t map8[8];
+    for (int i = 0; i < 8; i++) map8[i] = rnd();
+    pack_both(gray, map8, 7, 0, 0, n, "map_pack_8");
+    pack_both(gray, blue_noise_64 + 3 * BLUE_NOISE_SIZE, BLUE_NOISE_SIZE - 1, 0, 0, n,
+              "map_pack_64");
+    pack_both(gray, blue_noise_64, BLUE_NOISE_SIZE - 1, 0, (n / 16) * 8, n, "map_pack_x0");
+}
+
+static void test_invert(int n)
+{
+    static uint8_t in[MAX_N], a[MAX_N + 1], b[MAX_N + 1];
+    for (int i = 0; i < n; i++) in[i] = rnd();
+
+    memcpy(a, in, n);
+    a[n] = GUARD;
+    img_kernels_set_simd(true);
+    img_k_invert(a, n);
+    memcpy(b, in, n);
+    img_kernels_set_simd(false);
+    img_k_invert(b, n);
+    check(memcmp(a, b, n) == 0 && a[n] == GUARD, "invert", n, 0);
+    for (int i = 0; i < n; i++) {
+        check((b[i] ^ in[i]) == 0xFF, "invert_ref", n, i);
+    }
+}
+
+int main(void)
+{
+    bool simd = img_kernels_set_simd(true);
+    printf("kernels: %s\n", img_kernels_name());
+    if (!simd) {
+        printf("no vector kernels on this target, checking the C versions only\n");
+    }
+
+    for (int n = 0; n <= 100; n++) {
+        test_luma(n);
+        test_lut(n);
+        test_pack(n);
+        test_invert(n);
+    }
+    test_luma(MAX_N);
+    test_lut(MAX_N);
+    test_pack(MAX_N);
+    test_invert(MAX_N);
+
+    printf("%s: %d failure(s)\n", s_failures ? "FAIL" : "PASS", s_failures);
+    return s_failures ? 1 : 0;
+}
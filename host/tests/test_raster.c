@@ -0,0 +1,264 @@
+/*
+ * Raster Test - 1bpp blits, fills and rotation against per-pixel versions
+ *
+ * Each operation runs on pseudo-random bitmaps with pseudo-random
+ * rectangles (partly or wholly outside the bitmap, at every bit phase) and
+ * clip rectangles, and must leave exactly the bytes a pixel-by-pixel
+ * version leaves, padding bits included. Partial-update windows are
+ * checked the same way: widened to whole bytes, clipped at the right edge,
+ * and packed band by band with the region at any bit phase. Rotation is
+ * checked for all four turns on a full frame and on a small glyph-sized
+ * bitmap.
+ *
+ * Usage: test_raster
+ */
+
+#include "img_raster.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DST_W       83
+#define DST_H       41
+#define SRC_W       61
+#define SRC_H       37
+#define ITERATIONS  20000
+
+static uint32_t s_seed = 4321;
+static int s_failures;
+
+static uint32_t rnd(void)
+{
+    s_seed = s_seed * 1103515245u + 12345u;
+    return s_seed >> 16;
+}
+
+static int rnd_range(int lo, int hi)
+{
+    return lo + (int)(rnd() % (uint32_t)(hi - lo + 1));
+}
+
+static void check(bool ok, const char *op, int iter)
+{
+    if (!ok) {
+        if (s_failures < 20) {
+            printf("FAIL %s iteration %d\n", op, iter);
+        }
+        s_failures++;
+    }
+}
+
+static void fill_random(uint8_t *buf, size_t n)
+{
+    for (size_t i = 0; i < n; i++) buf[i] = (uint8_t)rnd();
+}
+
+static int get_px(const img_bitmap_t *bm, int x, int y)
+{
+    return (bm->data[y * bm->stride + (x >> 3)] >> (7 - (x & 7))) & 1;
+}
+
+static void set_px(img_bitmap_t *bm, int x, int y, int v)
+{
+    uint8_t *p = &bm->data[y * bm->stride + (x >> 3)];
+    *p = v ? (*p | (0x80 >> (x & 7))) : (*p & ~(0x80 >> (x & 7)));
+}
+
+static bool in_clip(const img_bitmap_t *bm, int x, int y)
+{
+    return x >= bm->clip.x && x < bm->clip.x + bm->clip.w &&
+           y >= bm->clip.y && y < bm->clip.y + bm->clip.h;
+}
+
+static int ref_rop(int d, int s, img_rop_t rop)
+{
+    switch (rop) {
+        case IMG_ROP_AND:   return d & s;
+        case IMG_ROP_OR:    return d | s;
+        case IMG_ROP_XOR:   return d ^ s;
+        case IMG_ROP_CLEAR: return d & !s;
+        default:            return s;
+    }
+}
+
+static void random_clip(img_bitmap_t *a, img_bitmap_t *b)
+{
+    img_rect_t clip = {rnd_range(-10, DST_W), rnd_range(-10, DST_H),
+                       rnd_range(0, DST_W + 10), rnd_range(0, DST_H + 10)};
+    bool whole = rnd() & 1;
+    img_bitmap_set_clip(a, whole ? NULL : &clip);
+    img_bitmap_set_clip(b, whole ? NULL : &clip);
+}
+
+static void test_fill(int iter, bool invert)
+{
+    static uint8_t a[DST_H * ((DST_W + 7) / 8)], b[sizeof(a)];
+    img_bitmap_t da, db;
+    img_bitmap_init(&da, a, DST_W, DST_H);
+    img_bitmap_init(&db, b, DST_W, DST_H);
+    fill_random(a, sizeof(a));
+    memcpy(b, a, sizeof(a));
+    random_clip(&da, &db);
+
+    int x = rnd_range(-20, DST_W + 5), y = rnd_range(-20, DST_H + 5);
+    int w = rnd_range(-2, DST_W + 20), h = rnd_range(-2, DST_H + 20);
+    uint8_t color = rnd() & 1;
+    if (invert) {
+        img_raster_invert(&da, x, y, w, h);
+    } else {
+        img_raster_fill(&da, x, y, w, h, color);
+    }
+
+    for (int j = y; j < y + h; j++) {
+        for (int i = x; i < x + w; i++) {
+            if (i >= 0 && i < DST_W && j >= 0 && j < DST_H && in_clip(&db, i, j)) {
+                set_px(&db, i, j, invert ? !get_px(&db, i, j) : color);
+            }
+        }
+    }
+    check(memcmp(a, b, sizeof(a)) == 0, invert ? "invert" : "fill", iter);
+}
+
+static void test_blit(int iter, bool masked)
+{
+    static uint8_t a[DST_H * ((DST_W + 7) / 8)], b[sizeof(a)];
+    static uint8_t s[SRC_H * ((SRC_W + 7) / 8)], m[sizeof(s)];
+    img_bitmap_t da, db, sb, mb;
+    img_bitmap_init(&da, a, DST_W, DST_H);
+    img_bitmap_init(&db, b, DST_W, DST_H);
+    img_bitmap_init(&sb, s, SRC_W, SRC_H);
+    img_bitmap_init(&mb, m, SRC_W, SRC_H);
+    fill_random(a, sizeof(a));
+    memcpy(b, a, sizeof(a));
+    fill_random(s, sizeof(s));
+    fill_random(m, sizeof(m));
+    random_clip(&da, &db);
+
+    int dx = rnd_range(-20, DST_W + 5), dy = rnd_range(-20, DST_H + 5);
+    int sx = rnd_range(-10, SRC_W + 5), sy = rnd_range(-10, SRC_H + 5);
+    int w = rnd_range(-2, SRC_W + 20), h = rnd_range(-2, SRC_H + 20);
+    img_rop_t rop = (img_rop_t)(rnd() % 5);
+    if (masked) {
+        img_raster_blit_masked(&da, dx, dy, &sb, &mb, sx, sy, w, h);
+    } else {
+        img_raster_blit(&da, dx, dy, &sb, sx, sy, w, h, rop);
+    }
+
+    for (int j = 0; j < h; j++) {
+        for (int i = 0; i < w; i++) {
+            int x = dx + i, y = dy + j, u = sx + i, v = sy + j;
+            if (x < 0 || x >= DST_W || y < 0 || y >= DST_H || !in_clip(&db, x, y) ||
+                u < 0 || u >= SRC_W || v < 0 || v >= SRC_H) {
+                continue;
+            }
+            int d = get_px(&db, x, y), sv = get_px(&sb, u, v);
+            if (masked) {
+                set_px(&db, x, y, get_px(&mb, u, v) ? sv : d);
+            } else {
+                set_px(&db, x, y, ref_rop(d, sv, rop));
+            }
+        }
+    }
+    check(memcmp(a, b, sizeof(a)) == 0, masked ? "blit_masked" : "blit", iter);
+}
+
+static void test_window(int iter)
+{
+    static uint8_t fb[DST_H * ((DST_W + 7) / 8)], s[SRC_H * ((SRC_W + 7) / 8)];
+    static uint8_t a[DST_H * ((DST_W + 7) / 8 + 1)], b[sizeof(a)];
+    img_bitmap_t fbm, sb, bb;
+    img_bitmap_init(&fbm, fb, DST_W, DST_H);
+    fill_random(fb, sizeof(fb));
+
+    int w = rnd_range(1, SRC_W), h = rnd_range(1, SRC_H);
+    int x = rnd_range(-20, DST_W + 5), y = rnd_range(-20, DST_H + 5);
+    img_bitmap_init(&sb, s, w, h);
+    fill_random(s, sizeof(s));
+
+    img_rect_t win = {x, y, w, h};
+    bool inside = x < DST_W && y < DST_H && x + w > 0 && y + h > 0;
+    if (!img_raster_window(&win, &(img_rect_t){0, 0, DST_W, DST_H})) {
+        check(!inside, "window_empty", iter);
+        return;
+    }
+    int cx0 = x > 0 ? x : 0, cx1 = x + w < DST_W ? x + w : DST_W;
+    int cy0 = y > 0 ? y : 0, cy1 = y + h < DST_H ? y + h : DST_H;
+    check(inside && !(win.x & 7) && !(win.w & 7) && win.x == (cx0 & ~7) &&
+          win.x + win.w == ((cx1 + 7) & ~7) && win.y == cy0 && win.y + win.h == cy1,
+          "window", iter);
+
+    // Pack in bands of random height, as the driver does without memory
+    int stride = win.w / 8;
+    fill_random(a, sizeof(a));
+    memcpy(b, a, sizeof(a));
+    for (int r = 0; r < win.h;) {
+        int rows = rnd_range(1, win.h - r);
+        img_raster_pack_window(a + (size_t)r * stride, &fbm, &win, r, rows, &sb, x, y);
+        r += rows;
+    }
+
+    img_bitmap_init(&bb, b, win.w, win.h);
+    for (int j = 0; j < win.h; j++) {
+        for (int i = 0; i < win.w; i++) {
+            int px = win.x + i, py = win.y + j;
+            if (px >= x && px < x + w && py >= y && py < y + h) {
+                set_px(&bb, i, j, get_px(&sb, px - x, py - y));
+            } else if (px < DST_W) {
+                set_px(&bb, i, j, get_px(&fbm, px, py));
+            }
+        }
+    }
+    check(memcmp(a, b, sizeof(a)) == 0, "pack_window", iter);
+}
+
+static void test_rotate(int w, int h)
+{
+    size_t n = (size_t)w * h / 8;
+    uint8_t *s = malloc(n), *d = malloc(n);
+    img_bitmap_t sb, db;
+    img_bitmap_init(&sb, s, w, h);
+    fill_random(s, n);
+
+    for (int t = 0; t < 4; t++) {
+        int dw = (t & 1) ? h : w, dh = (t & 1) ? w : h;
+        img_bitmap_init(&db, d, dw, dh);
+        check(img_raster_rotate(&db, &sb, t) == ESP_OK, "rotate_args", t);
+
+        bool ok = true;
+        for (int y = 0; y < h && ok; y++) {
+            for (int x = 0; x < w && ok; x++) {
+                static const int map[4][4] = {
+                    {1, 0, 0, 1}, {0, -1, 1, 0}, {-1, 0, 0, -1}, {0, 1, -1, 0},
+                };
+                // Clockwise quarter turn: (x, y) goes to (h - 1 - y, x)
+                int rx = map[t][0] * x + map[t][1] * y + (t == 1 ? h - 1 : t == 2 ? w - 1 : 0);
+                int ry = map[t][2] * x + map[t][3] * y + (t == 2 ? h - 1 : t == 3 ? w - 1 : 0);
+                ok = get_px(&db, rx, ry) == get_px(&sb, x, y);
+            }
+        }
+        check(ok, "rotate", w * 10 + t);
+    }
+
+    img_bitmap_init(&db, d, w + 8, h);
+    check(img_raster_rotate(&db, &sb, 0) == ESP_ERR_INVALID_ARG, "rotate_size", 0);
+    free(s);
+    free(d);
+}
+
+int main(void)
+{
+    for (int i = 0; i < ITERATIONS; i++) {
+        test_fill(i, false);
+        test_fill(i, true);
+        test_blit(i, false);
+        test_blit(i, true);
+        test_window(i);
+    }
+    test_rotate(800, 480);
+    test_rotate(48, 72);
+    test_rotate(8, 8);
+
+    printf("%s: %d failure(s)\n", s_failures ? "FAIL" : "PASS", s_failures);
+    return s_failures ? 1 : 0;
+}
@@ -0,0 +1,550 @@
+/*
+ * Render Regression Test - Golden frames and performance of the pipeline
+ *
+ * The first image of the corpus (by name) goes through every bit depth
+ * with every dither algorithm, buffered and streamed. The dither stage does
+ * not depend on the decoder, so the other images, one per decoder, only get
+ * the default options, streamed, and each remaining switch (fill, invert,
+ * serpentine, no tone map, CLAHE, EXIF orientation, auto-rotate) on its
+ * own. That covers each option against each decoder without storing
+ * hundreds of full-screen goldens. One more JPEG is stored on its side with
+ * an orientation tag, so the orientation switches have something to turn.
+ *
+ * Frame mode (default) compares each frame with its golden .bin (written
+ * with img_binfile_write, so the header also records the options hash).
+ * Frames must match exactly; with -t they only have to look alike: both
+ * are blurred to hide dither patterns, then compared by PSNR and SSIM.
+ *
+ * Perf mode (-p) compares time and peak memory with the baseline in
+ * perf.txt. Memory is the peak of the image's arena job, PSRAM and the
+ * internal SRAM block apart (the heap only shows the arena reservation);
+ * each case runs once untimed first, so the reservation and the decode
+ * plan it steers come from the case itself, not from the one before.
+ * Times are stored relative to a fixed calibration loop so a baseline
+ * taken on one machine carries over to another. Single cases take
+ * a few milliseconds and jitter accordingly, so the time limit (-T) holds
+ * for the whole run and a single case may exceed it CASE_TIME_FACTOR times;
+ * peak memory is deterministic and checked per case (-M).
+ *
+ * -u writes the goldens (or the perf baseline) instead of checking them.
+ *
+ * Usage: test_render -c corpus_dir -g golden_dir [-o report.json] [-u] [-t] [-p]
+ *                    [-r runs] [-T time_tolerance] [-M mem_tolerance]
+ */
+
+#include "image_processor.h"
+#include "img_binfile.h"
+#include "img_arena.h"
+#include "host_util.h"
+#include "esp_log.h"
+
+#include <dirent.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#define MAX_FILES       32
+#define MAX_CASES       64
+#define MAX_RUNS        15
+#define NAME_LEN        96
+
+// Tolerant mode: a 9x9 box blur leaves the tone of a dithered frame and
+// hides its pattern. A new diffusion order passes, a tone curve change fails.
+#define BLUR_RADIUS     4
+#define SSIM_WINDOW     8
+#define MIN_PSNR        30.0    // dB
+#define MIN_SSIM        0.85
+#define CASE_TIME_FACTOR 4      // Time tolerance of one case, in -T units
+#define MIN_SLOWDOWN_MS 1.0     // Smaller slowdowns are noise
+#define MIN_GROWTH_KB   16      // Smaller memory growth is noise
+#define MIN_FAST_GROWTH 256     // Same for the internal SRAM block, bytes
+#define CALIB_SIZE      (1024 * 1024)
+
+typedef struct {
+    char name[NAME_LEN];
+    img_process_opts_t opts;
+    bool matrix_only;           // Only for the first image
+} render_case_t;
+
+typedef struct {
+    char name[2 * NAME_LEN];
+    double units;               // Time / calibration time
+    size_t peak_kb;
+    size_t fast_peak;
+} perf_entry_t;
+
+static const char *dither_names[] = { "none", "floyd", "atkinson", "ordered", "bluenoise" };
+
+static render_case_t s_cases[MAX_CASES];
+static int s_case_count;
+
+static int s_runs;
+static bool s_update;
+static bool s_tolerant;
+static bool s_perf;
+static double s_time_tol = 0.25;
+static double s_mem_tol = 0.1;
+static double s_calib_ms;
+
+static perf_entry_t *s_baseline;
+static int s_baseline_count;
+
+// Fixed integer workload: the time unit of the perf baseline
+static double calibrate(void) {
+    uint8_t *buf = malloc(CALIB_SIZE);
+    for (int i = 0; i < CALIB_SIZE; i++) {
+        buf[i] = (uint8_t)(i * 131);
+    }
+    double best = 1e9;
+    for (int r = 0; r < 5; r++) {
+        double t0 = host_now_ms();
+        volatile uint32_t crc = host_crc32(buf, CALIB_SIZE);
+        (void)crc;
+        double ms = host_now_ms() - t0;
+        best = ms < best ? ms : best;
+    }
+    free(buf);
+    return best;
+}
+
+/* ---- Cases ---- */
+
+static void add_case(const img_process_opts_t *opts, const char *suffix, bool matrix_only) {
+    render_case_t *c = &s_cases[s_case_count++];
+    c->opts = *opts;
+    c->matrix_only = matrix_only;
+    snprintf(c->name, sizeof(c->name), "%dbpp-%s%s%s", img_format_bpp(opts->format),
+             dither_names[opts->dither], opts->streaming ? "-stream" : "", suffix);
+}
+
+static void build_cases(void) {
+    static const img_format_t formats[] = { IMG_FORMAT_1BPP, IMG_FORMAT_2BPP, IMG_FORMAT_4BPP };
+    img_process_opts_t base;
+    img_get_default_opts(&base);
+
+    for (int f = 0; f < 3; f++) {
+        for (int d = DITHER_NONE; d <= DITHER_BLUE_NOISE; d++) {
+            for (int s = 0; s < 2; s++) {
+                img_process_opts_t opts = base;
+                opts.format = formats[f];
+                opts.dither = d;
+                opts.streaming = s;
+                add_case(&opts, "", opts.format != base.format || opts.dither != base.dither);
+            }
+        }
+    }
+
+    img_process_opts_t opts = base;
+    opts.fit_mode = false;
+    add_case(&opts, "-fill", false);
+    opts = base;
+    opts.invert = true;
+    add_case(&opts, "-invert", false);
+    opts = base;
+    opts.serpentine = true;
+    add_case(&opts, "-serpentine", false);
+    opts = base;
+    opts.tone_map = false;
+    add_case(&opts, "-flat", false);
+    opts = base;
+    opts.clahe = true;
+    add_case(&opts, "-clahe", false);
+    opts = base;
+    opts.orient = IMG_ORIENT_EXIF;
+    add_case(&opts, "-exif", false);
+    opts = base;
+    opts.orient = IMG_ORIENT_AUTO;
+    add_case(&opts, "-auto", false);
+}
+
+/* ---- Frame comparison ---- */
+
+// Frame to one gray byte per pixel (packed MSB first)
+static uint8_t *unpack(const uint8_t *frame, const img_process_opts_t *opts) {
+    int w = opts->target_width;
+    int h = opts->target_height;
+    int bpp = img_format_bpp(opts->format);
+    int max = (1 << bpp) - 1;
+    uint8_t *gray = malloc((size_t)w * h);
+    for (size_t i = 0; i < (size_t)w * h; i++) {
+        size_t bit = i * bpp;
+        int v = (frame[bit >> 3] >> (8 - bpp - (bit & 7))) & max;
+        gray[i] = v * 255 / max;
+    }
+    return gray;
+}
+
+// Separable box blur in place
+static void blur(uint8_t *img, int w, int h) {
+    int n = 2 * BLUR_RADIUS + 1;
+    uint8_t *tmp = malloc((size_t)w * h);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int sum = 0;
+            for (int k = -BLUR_RADIUS; k <= BLUR_RADIUS; k++) {
+                int xx = x + k < 0 ? 0 : (x + k >= w ? w - 1 : x + k);
+                sum += img[(size_t)y * w + xx];
+            }
+            tmp[(size_t)y * w + x] = sum / n;
+        }
+    }
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int sum = 0;
+            for (int k = -BLUR_RADIUS; k <= BLUR_RADIUS; k++) {
+                int yy = y + k < 0 ? 0 : (y + k >= h ? h - 1 : y + k);
+                sum += tmp[(size_t)yy * w + x];
+            }
+            img[(size_t)y * w + x] = sum / n;
+        }
+    }
+    free(tmp);
+}
+
+static double psnr(const uint8_t *a, const uint8_t *b, size_t n) {
+    double mse = 0;
+    for (size_t i = 0; i < n; i++) {
+        double d = (double)a[i] - b[i];
+        mse += d * d;
+    }
+    mse /= n;
+    return mse == 0 ? 99.0 : 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+// Mean SSIM over windows overlapping by half
+static double ssim(const uint8_t *a, const uint8_t *b, int w, int h) {
+    const double c1 = (0.01 * 255) * (0.01 * 255);
+    const double c2 = (0.03 * 255) * (0.03 * 255);
+    const int n = SSIM_WINDOW * SSIM_WINDOW;
+    double total = 0;
+    int windows = 0;
+    for (int y0 = 0; y0 + SSIM_WINDOW <= h; y0 += SSIM_WINDOW / 2) {
+        for (int x0 = 0; x0 + SSIM_WINDOW <= w; x0 += SSIM_WINDOW / 2) {
+            double sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+            for (int y = y0; y < y0 + SSIM_WINDOW; y++) {
+                for (int x = x0; x < x0 + SSIM_WINDOW; x++) {
+                    double va = a[(size_t)y * w + x];
+                    double vb = b[(size_t)y * w + x];
+                    sa += va;
+                    sb += vb;
+                    saa += va * va;
+                    sbb += vb * vb;
+                    sab += va * vb;
+                }
+            }
+            double ma = sa / n, mb = sb / n;
+            double va = saa / n - ma * ma, vb = sbb / n - mb * mb, cov = sab / n - ma * mb;
+            total += ((2 * ma * mb + c1) * (2 * cov + c2)) /
+                     ((ma * ma + mb * mb + c1) * (va + vb + c2));
+            windows++;
+        }
+    }
+    return windows ? total / windows : 1.0;
+}
+
+/* ---- Perf baseline ---- */
+
+static const perf_entry_t *find_baseline(const char *name) {
+    for (int i = 0; i < s_baseline_count; i++) {
+        if (strcmp(s_baseline[i].name, name) == 0) {
+            return &s_baseline[i];
+        }
+    }
+    return NULL;
+}
+
+// perf.txt: one "case units peak_kb fast_peak" line per case, # comments
+static void load_baseline(const char *path) {
+    s_baseline = calloc(MAX_FILES * MAX_CASES, sizeof(perf_entry_t));
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f) && s_baseline_count < MAX_FILES * MAX_CASES) {
+        perf_entry_t *e = &s_baseline[s_baseline_count];
+        if (line[0] != '#' && sscanf(line, "%191s %lf %zu %zu", e->name, &e->units, &e->peak_kb,
+                                     &e->fast_peak) == 4) {
+            s_baseline_count++;
+        }
+    }
+    fclose(f);
+}
+
+/* ---- Running ---- */
+
+static int cmp_name(const void *a, const void *b) {
+    return strcmp((const char *)a, (const char *)b);
+}
+
+static int list_corpus(const char *dir_path, char names[][NAME_LEN]) {
+    DIR *dir = opendir(dir_path);
+    if (!dir) {
+        return -1;
+    }
+    int count = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL && count < MAX_FILES) {
+        const char *ext = strrchr(de->d_name, '.');
+        if (de->d_name[0] != '.' && ext && strlen(de->d_name) < NAME_LEN &&
+            (strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0 ||
+             strcasecmp(ext, ".png") == 0 || strcasecmp(ext, ".bmp") == 0)) {
+            memcpy(names[count++], de->d_name, strlen(de->d_name) + 1);
+        }
+    }
+    closedir(dir);
+    qsort(names, count, NAME_LEN, cmp_name);
+    return count;
+}
+
+// "photo.jpg" -> "photo_jpg"
+static void image_key(char *key, size_t size, const char *filename) {
+    snprintf(key, size, "%s", filename);
+    char *dot = strrchr(key, '.');
+    if (dot) {
+        *dot = '_';
+    }
+}
+
+// Check a frame against its golden; returns a short verdict, NULL if it passes
+static const char *check_frame(const char *golden, const uint8_t *frame, size_t size,
+                               const img_process_opts_t *opts, double *p, double *s) {
+    img_binfile_t bf;
+    if (img_binfile_open(&bf, golden) != ESP_OK) {
+        return "missing golden";
+    }
+    uint8_t *expected = malloc(size);
+    esp_err_t ret = bf.frame_size == size ? img_binfile_read(&bf, expected, size) : ESP_ERR_INVALID_SIZE;
+    uint32_t hash = bf.params_hash;
+    img_binfile_close(&bf);
+    if (ret != ESP_OK) {
+        free(expected);
+        return "unreadable golden";
+    }
+
+    const char *verdict = NULL;
+    if (memcmp(expected, frame, size) == 0) {
+        *p = 99.0;
+        *s = 1.0;
+        if (hash != img_opts_hash(opts) && !s_tolerant) {
+            verdict = "golden has another options hash";
+        }
+    } else {
+        int w = opts->target_width;
+        int h = opts->target_height;
+        uint8_t *a = unpack(expected, opts);
+        uint8_t *b = unpack(frame, opts);
+        blur(a, w, h);
+        blur(b, w, h);
+        *p = psnr(a, b, (size_t)w * h);
+        *s = ssim(a, b, w, h);
+        free(a);
+        free(b);
+        if (!s_tolerant) {
+            verdict = "differs";
+        } else if (*p < MIN_PSNR || *s < MIN_SSIM) {
+            verdict = "looks different";
+        }
+    }
+    free(expected);
+    return verdict;
+}
+
+int main(int argc, char **argv) {
+    const char *corpus = NULL;
+    const char *golden = NULL;
+    const char *report = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:g:o:utpr:T:M:v")) != -1) {
+        switch (opt) {
+            case 'c': corpus = optarg; break;
+            case 'g': golden = optarg; break;
+            case 'o': report = optarg; break;
+            case 'u': s_update = true; break;
+            case 't': s_tolerant = true; break;
+            case 'p': s_perf = true; break;
+            case 'r': s_runs = atoi(optarg); break;
+            case 'T': s_time_tol = atof(optarg); break;
+            case 'M': s_mem_tol = atof(optarg); break;
+            case 'v': esp_log_level_set("*", ESP_LOG_INFO); break;
+            default:
+                corpus = NULL;
+                optind = argc;
+                break;
+        }
+    }
+    if (!corpus || !golden) {
+        fprintf(stderr, "Usage: %s -c corpus_dir -g golden_dir [-o report.json] [-u] [-t] [-p] "
+                        "[-r runs] [-T time_tolerance] [-M mem_tolerance] [-v]\n", argv[0]);
+        return 2;
+    }
+    if (s_runs <= 0) {
+        s_runs = s_perf ? 5 : 1;
+    }
+    s_runs = s_runs > MAX_RUNS ? MAX_RUNS : s_runs;
+
+    char files[MAX_FILES][NAME_LEN];
+    int file_count = list_corpus(corpus, files);
+    if (file_count <= 0) {
+        fprintf(stderr, "No images in %s\n", corpus);
+        return 2;
+    }
+    build_cases();
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/perf.txt", golden);
+    FILE *perf_out = NULL;
+    if (s_perf) {
+        s_calib_ms = calibrate();
+        if (s_update) {
+            perf_out = fopen(path, "w");
+            if (!perf_out) {
+                perror(path);
+                return 2;
+            }
+            fprintf(perf_out, "# case  time (x calibration loop)  arena peak KB  internal SRAM peak B\n");
+        } else {
+            load_baseline(path);
+        }
+    }
+
+    FILE *rep = report ? fopen(report, "w") : NULL;
+    if (rep) {
+        fprintf(rep, "{\n  \"mode\": \"%s\",\n  \"runs\": %d,\n  \"calibration_ms\": %.3f,\n  \"cases\": [",
+                s_perf ? "perf" : (s_tolerant ? "tolerant" : "exact"), s_runs, s_calib_ms);
+    }
+
+    int failed = 0;
+    double run_units = 0;
+    double base_units = 0;
+    int total = 0;
+    for (int i = 0; i < file_count; i++) {
+        char src[512];
+        char key[NAME_LEN];
+        snprintf(src, sizeof(src), "%s/%s", corpus, files[i]);
+        image_key(key, sizeof(key), files[i]);
+
+        for (int c = 0; c < s_case_count; c++) {
+            const render_case_t *rc = &s_cases[c];
+            if (rc->matrix_only && i > 0) {
+                continue;
+            }
+            char name[2 * NAME_LEN];
+            snprintf(name, sizeof(name), "%s/%s", key, rc->name);
+
+            size_t size = img_frame_size(rc->opts.format, rc->opts.target_width, rc->opts.target_height);
+            uint8_t *frame = calloc(1, size);
+            esp_err_t ret = ESP_OK;
+            double best = 1e9;
+            size_t peak = 0, fast_peak = 0;
+            if (s_perf) {
+                // The arena reserve (and so the decode plan) follows the
+                // previous job: let this case be its own predecessor
+                img_process_file(src, frame, size, &rc->opts);
+            }
+            for (int r = 0; r < s_runs && ret == ESP_OK; r++) {
+                double t0 = host_now_ms();
+                ret = img_process_file(src, frame, size, &rc->opts);
+                double ms = host_now_ms() - t0;
+                best = ms < best ? ms : best;
+                img_arena_stats_t stats;
+                img_arena_get_stats(&stats);
+                peak = stats.peak > peak ? stats.peak : peak;
+                fast_peak = stats.fast_peak > fast_peak ? stats.fast_peak : fast_peak;
+            }
+            size_t peak_kb = peak / 1024;
+
+            const char *verdict = ret != ESP_OK ? esp_err_to_name(ret) : NULL;
+            double p = 0, s = 0;
+            const perf_entry_t *ref = NULL;
+            snprintf(path, sizeof(path), "%s/%s_%s.bin", golden, key, rc->name);
+            if (!verdict && !s_perf) {
+                if (s_update) {
+                    if (img_binfile_write(path, frame, size, img_opts_hash(&rc->opts)) != ESP_OK) {
+                        verdict = "cannot write golden";
+                    }
+                } else {
+                    verdict = check_frame(path, frame, size, &rc->opts, &p, &s);
+                }
+            }
+            if (!verdict && s_perf) {
+                double units = best / s_calib_ms;
+                if (s_update) {
+                    fprintf(perf_out, "%s %.3f %zu %zu\n", name, units, peak_kb, fast_peak);
+                } else if (!(ref = find_baseline(name))) {
+                    verdict = "no perf baseline";
+                } else {
+                    run_units += units;
+                    base_units += ref->units;
+                    if (units > ref->units * (1 + CASE_TIME_FACTOR * s_time_tol) &&
+                        (units - ref->units) * s_calib_ms > MIN_SLOWDOWN_MS) {
+                        verdict = "slower";
+                    } else if (peak_kb > ref->peak_kb * (1 + s_mem_tol) &&
+                               peak_kb - ref->peak_kb > MIN_GROWTH_KB) {
+                        verdict = "more memory";
+                    } else if (fast_peak > ref->fast_peak * (1 + s_mem_tol) &&
+                               fast_peak - ref->fast_peak > MIN_FAST_GROWTH) {
+                        verdict = "more internal memory";
+                    }
+                }
+            }
+
+            total++;
+            if (verdict) {
+                failed++;
+                fprintf(stderr, "FAIL %s: %s", name, verdict);
+                if (p > 0) {
+                    fprintf(stderr, " (PSNR %.1f dB, SSIM %.3f)", p, s);
+                }
+                if (ref) {
+                    fprintf(stderr, " (%.1f ms vs %.1f ms, %zu KB vs %zu KB, %zu B vs %zu B fast)",
+                            best, ref->units * s_calib_ms, peak_kb, ref->peak_kb, fast_peak,
+                            ref->fast_peak);
+                }
+                fputc('\n', stderr);
+            }
+            if (rep) {
+                fprintf(rep, "%s\n    {\"case\": \"%s\", \"result\": \"%s\", \"ms\": %.2f, \"peak_kb\": %zu, "
+                             "\"fast_peak\": %zu, \"crc32\": \"%08x\"",
+                        total > 1 ? "," : "", name, verdict ? verdict : "ok", best, peak_kb,
+                        fast_peak, (unsigned)host_crc32(frame, size));
+                if (p > 0) {
+                    fprintf(rep, ", \"psnr\": %.2f, \"ssim\": %.4f", p, s);
+                }
+                if (ref) {
+                    fprintf(rep, ", \"baseline_ms\": %.2f, \"baseline_peak_kb\": %zu, "
+                                 "\"baseline_fast_peak\": %zu",
+                            ref->units * s_calib_ms, ref->peak_kb, ref->fast_peak);
+                }
+                fprintf(rep, "}");
+            }
+            free(frame);
+        }
+    }
+
+    // Whole run against the baseline of the same cases
+    bool slower = base_units > 0 && run_units > base_units * (1 + s_time_tol) &&
+                  (run_units - base_units) * s_calib_ms > MIN_SLOWDOWN_MS;
+    if (s_perf && base_units > 0) {
+        fprintf(stderr, "%s: %.1f ms, baseline %.1f ms (%+.0f%%)\n", slower ? "FAIL run slower" : "Run time",
+                run_units * s_calib_ms, base_units * s_calib_ms, (run_units / base_units - 1) * 100);
+    }
+    if (rep) {
+        fprintf(rep, "\n  ],\n  \"total\": %d,\n  \"failed\": %d", total, failed);
+        if (s_perf && base_units > 0) {
+            fprintf(rep, ",\n  \"run_ms\": %.2f,\n  \"baseline_run_ms\": %.2f,\n  \"run_slower\": %s",
+                    run_units * s_calib_ms, base_units * s_calib_ms, slower ? "true" : "false");
+        }
+        fprintf(rep, "\n}\n");
+        fclose(rep);
+    }
+    if (perf_out) {
+        fclose(perf_out);
+    }
+    free(s_baseline);
+    fprintf(stderr, "%d of %d cases %s\n", total - failed, total, s_update ? "written" : "passed");
+    return (failed || slower) ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+#ifndef BLUE_NOISE_64_H
+#define BLUE_NOISE_64_H
+
+#include <stdint.h>
+
+// Blue-noise threshold map, void-and-cluster, sigma 1.5
+// Size: 64x64, generated by generate_blue_noise.py
+
+#define BLUE_NOISE_SIZE 64
+
+static const uint8_t blue_noise_64[64 * 64] = {
+    210,  49, 172, 132,  62,  94, 141,   3, 192, 152,  75, 170, 228,  86,   1,  76, 134,  56, 113, 238,  66, 172,  17, 110, 226, 185, 114,  21, 132,  44, 185, 230,  94,  46, 144,   1, 178, 158, 119,  65, 166, 102, 125,  73, 168,  14, 240, 149, 105, 159,  36, 194,   1, 179,  59, 112, 139, 193, 235, 150,  86, 110, 175, 145,
+    123,  77, 196, 231,  14, 183, 219,  70, 117,  24, 201, 129,  37, 147, 235, 198,  23, 206, 146,   7,  99, 157, 252, 138,  60, 149,  90, 221,  65, 236,   5, 136, 164, 218, 108, 252,  89, 203,  22, 224,  82,  38, 206,  25, 216, 130, 196,  63,   8, 221, 136, 239, 117, 226,  34, 246,   9,  71, 177,  55,   3, 215,  61, 234,
+     16, 158,  30,  98, 212, 121,  48, 252, 172, 225,  95,  17, 214, 103,  52, 123,  95, 250,  41, 178, 222,  51,  78, 189,  23, 242,  38, 191, 157, 108,  77, 200,  59,  18, 184,  65, 133,  43, 104, 184, 144, 240, 177, 149,  82,  43, 113, 176,  88, 189,  73,  47, 163,  86, 144, 171,  92, 212,  35, 127, 250, 162,  33, 100,
+    176, 253,  69, 149,  40, 167,  80, 148,  32,  57, 138, 248,  68, 181, 156,  33, 187, 160,  67, 110, 201,  26, 121, 206, 100, 172,  78, 127,  18, 209, 174,  37, 118, 240, 154,  28, 225, 167, 246,  11, 119,  54,  17, 105, 252, 164, 226,  29, 246, 122,  16, 104, 207,  24,  66, 198, 116, 230, 158,  88, 197,  70, 136, 204,
+     46, 128, 206, 110, 243,   9, 195, 105, 208,  84, 190, 163, 117,  12, 210, 242,  81,  10, 228, 135,  83, 151, 230,  44, 134,  13, 212, 238,  48,  92, 249, 146, 214,  97,  79, 208, 115,  55,  87, 213,  72, 231, 136, 203,  62,   3,  98, 137,  52, 202, 147, 180, 252, 125, 220,  15,  48, 137,  19, 183, 113,  14, 241,  83,
+    192,   4,  58, 180,  86, 136, 233,  20, 127, 242,   4,  43, 232,  89, 130,  55, 144, 105, 198,  36, 244,   4, 175,  67, 246, 155, 115,  63, 165, 132,  27,  68,   8, 170,  41, 142,   6, 188, 148,  34, 162, 181,  86,  36, 185, 146, 208,  74, 167, 231,  35,  79,  55, 157,  98, 184, 248,  81,  61, 237,  44, 219, 152, 107,
+    226, 161, 239,  27, 214,  49,  71, 160,  39, 176, 109, 146,  59, 200,  30, 172, 216,  24, 165,  61, 184, 114,  92, 216,  30,  85, 185,   2, 201, 223, 111, 186, 232, 129, 197, 250,  72, 232, 128, 201, 109,   6, 222, 125, 243, 111,  40, 223,  10, 114,  96, 195,   5, 235,  38, 148, 109, 166, 203, 145,  95, 171,  60,  30,
+     75, 118,  95, 146, 168, 114, 183, 225,  95, 211,  74, 224, 184, 100, 238,  71, 118, 253,  85, 128, 212,  46, 162, 140, 196,  53, 231, 100, 143,  77,  44, 155,  87,  55, 103,  24, 161,  99,  18,  64, 255,  49, 157,  70,  21, 173,  90, 187, 151,  64, 240, 164, 137,  89, 210,  66,   9, 221,  32, 123,   6, 211, 129, 185,
+    143,  41, 197,  65,   7, 255,  31, 132,  58, 150,  28, 124,   9, 163, 139,  15, 185,  47, 150, 233,  22,  78, 251,  12, 106, 130, 167,  36, 255,  19, 196, 242,  13, 214, 177, 124, 209,  45, 175, 215,  91, 130, 195, 102, 212,  55, 233,  24, 131, 206,  17, 120, 223,  27, 173, 131, 241,  91,  54, 192, 254,  84,  21, 243,
+    207,  13, 233, 129, 218, 100,  79, 191,  10, 244, 199,  51, 249,  84,  41, 227,  78, 207,   7, 103, 199, 121, 175,  62, 236,  25, 220,  65, 123, 173,  93, 118, 145,  37, 230,  60,  85, 245, 113, 144,  26, 172, 228,  12, 139, 160, 119,  68, 254,  39, 180,  51,  69, 199, 113,  49, 187, 153, 110, 173,  64, 147, 107,  51,
+     93, 159,  80, 178,  38, 202, 156, 228, 116, 167,  81, 138, 175, 115, 195, 157, 108, 135, 178,  58, 159,  37, 218,  94, 152, 202,  83, 147, 209,  51, 226,  64, 190,  80, 163,   2, 150, 187,  15,  74, 240,  39,  63,  86, 248,  31, 200, 100, 154,  82, 109, 244, 145,  86, 228,  23,  79, 217,  11, 230,  32, 165, 223, 179,
+    133, 251,  25, 108,  59, 138,  16,  69,  45,  97, 220,  33,  64, 213,  23,  54, 248,  32, 219,  89, 243, 137,   3, 190,  45, 118,  15, 183,  97,   5, 164,  30, 133, 252, 109, 203, 130,  39, 221, 198, 117, 152, 188, 112, 169,  51, 228,   5, 191, 221, 166,  30, 190,   2, 159, 246, 137,  40, 126,  75, 200, 121,   3,  68,
+     35, 117, 194, 223, 166, 246, 122, 177, 237, 148,   1, 187, 103, 236, 142,  98, 171,  70, 125,  17, 183,  74, 109, 238,  70, 169, 246,  40, 223, 125, 241, 102, 207,  21,  49, 236,  67, 104, 156,  51,  90, 234,   3, 206, 130,  78, 176, 141,  57,  19, 133,  98, 217, 121,  50, 105, 182, 209, 155, 239,  99,  48, 244, 189,
+    210,  56, 149,   5,  75,  34,  92, 206,  26, 196, 127, 253, 156,  17,  76, 205,   4, 193, 231, 148,  39, 209, 163,  29, 132, 216, 104, 140,  77, 195,  58, 147,  74, 179, 152,  89, 184,  11, 247, 174,  22, 134,  71,  42, 223,  23,  95, 243, 117,  75, 235,  41,  66, 169, 206,  69,  20,  91,  59,  25, 182, 141,  79, 154,
+     16,  86, 234, 101, 189, 219, 160,  56, 112,  74,  36,  87,  51, 180, 123, 229, 155, 114,  52,  96, 254, 122,  54, 192,  89,   8,  59, 160,  17, 171,  35, 216,  12, 124, 225,  31, 213, 142,  76, 122, 222, 191, 165, 253, 105, 155, 187,  38, 210, 171, 196, 151, 251,  12, 135, 225, 161, 252, 117, 167, 217,  12, 227, 107,
+    248, 127, 174,  47, 139, 118,  18, 243, 142, 231, 165, 223, 107, 211,  35,  59,  87,  28, 166, 199,  78,   9, 224, 148, 249, 173, 205, 233,  92, 251, 114, 183, 240,  99,  64, 167, 116,  47, 194,  32, 103,  57,  86, 142,  13, 200,  64, 132,   8,  93,  24, 113,  82, 179,  96,  39, 125,   7, 204,  44,  85, 129,  60, 165,
+     23,  66, 212,  27, 253,  64, 199,  90,   7, 184,  58, 131,   9, 144, 247, 191, 131, 240, 218,  19, 135, 179, 104,  67,  23, 121,  47, 112,  31, 136,  53,  83, 139,  43, 190,   8, 251,  97, 216, 160, 245,   8, 208, 118,  53, 219,  85, 249, 162, 218, 138,  54, 222,  29, 198, 237,  76, 189,  98, 147, 243, 184,  36, 199,
+    139, 185, 104, 153,  84, 171,  37, 157, 212, 103,  30, 199, 176,  63,  94,  21, 173,  43,  99,  63, 155, 239,  34, 216,  84, 143, 181,  72, 194, 218, 166,   5, 210, 154, 231, 127,  73, 150,  17,  66, 133, 180,  38, 241, 175, 147,  30, 121,  45,  73, 238, 187, 158, 119,  62, 144, 171,  51, 229,  22,  69, 112, 221,  96,
+    241,  45, 231,   4, 194, 110, 238, 133,  68, 124, 249,  81, 228, 112, 161, 214,  72, 145, 187, 113, 204,  50, 125, 158, 198, 240,   1, 227, 153,  20, 101, 245,  69,  28,  93, 203,  35, 234, 186,  88, 224, 109, 155,  79,  19, 101, 235, 180, 205, 111,  13,  39,  98, 245,   3, 213,  27, 112, 158, 212, 134,   1, 156,  74,
+     13, 116,  80, 134, 221,  20,  52, 218,  24, 168,  49, 149,  18,  45, 238,   2, 120, 249,  26, 220,   5,  82, 186,  15,  57, 107,  42,  90, 125,  60, 191, 130, 176, 115, 161,  56, 176, 135, 113,  48,  26, 204,  60, 229, 122, 195,  68,   2,  90, 148, 172, 208,  76, 139, 192,  91, 128, 247,  80,  41, 193, 254,  52, 178,
+    144, 210, 167,  57, 178,  77, 151,  89, 188, 229,  99, 208, 123, 188, 140,  83, 202,  53,  91, 162, 130, 252, 102, 225, 169, 129, 208, 175, 255,  35, 220,  81,  46, 238,  16, 217,  78,   2, 197, 241, 163,  96,   6, 138, 213,  49, 164, 132, 224,  58, 255, 128,  20, 162,  48, 234,  65, 183,  12, 107, 170,  88, 123, 202,
+     91,  21, 234,  33, 124, 251, 205, 111,   3, 138,  34, 172,  71, 223, 102,  27, 180, 153, 228,  44, 177,  64, 142,  33,  76, 244,  17, 142,  75, 111, 159,  10, 207, 188, 141, 110, 252,  98, 152,  64, 130, 188, 254, 169,  29,  94, 246,  38, 198,  18, 102,  44, 220, 182, 109,  16, 166, 222, 141, 208,  62,  26, 226,  39,
+    249, 106, 153, 196,  99,  14,  42, 164, 238,  57,  85, 255,   9,  55, 163, 245,  66, 132,  14, 105, 235,  20, 211, 193, 152,  97,  54, 201,  25, 180, 237, 133, 102,  64,  26, 168,  45, 205,  31, 221,  14,  80,  43, 113,  74, 182, 146, 112,  81, 183, 161, 233,  88,  59, 207, 135,  37,  94,  50, 121, 235, 146, 165,  70,
+    136, 182,  62,  82, 223, 141, 191,  70, 122, 202, 151, 190, 119, 145, 214,  41, 114, 209,  78, 192, 125,  88,  52, 118,  12, 230, 164, 120, 224,  59,  90,  33, 154, 244,  84, 227, 137,  73, 120, 167, 102, 236, 153, 199, 227,  11, 215,  25, 240, 136,  65, 124,  28, 149, 251,  76, 191, 156, 248,   5, 177, 101,  15, 200,
+     50,   3, 242,  26, 171,  55, 245,  95,  30, 222,  16, 101, 233,  23,  87, 194,   6, 239, 173,  32, 215, 164, 245, 182,  71, 207,  36,  81, 147,   4, 194, 217, 175,  49, 126, 194,  14, 182, 247,  53, 207, 124,  20,  59, 132, 103,  68, 156,  48, 211,   6, 202, 170,  98,   9, 122, 217,  22,  70, 195,  83,  41, 222, 114,
+    230, 148, 122, 213, 102, 128,   8, 180, 142, 168,  73,  44, 181,  64, 171, 137, 100, 156,  53, 142,  69,   2, 139,  39, 108, 135, 250, 190, 106, 242, 128,  68, 111,   9, 216,  99,  41, 156,  89,  18, 185,  70, 230, 172,  35, 250, 195, 117, 177,  89, 108, 244,  40, 195, 227,  52, 173,  96, 118, 151, 240, 128, 180,  79,
+     31, 197,  87,  42, 158, 205,  77, 231,  52, 108, 243, 136, 219, 115, 248,  47, 225,  21,  87, 254, 111, 224,  93, 201, 168,   8,  64,  27, 173,  46, 163,  24, 253, 186, 148,  66, 241, 114, 224, 139,  40, 151,  92, 205, 143,  85,   3, 233,  32, 222, 151,  56, 135,  73, 110, 153,  35, 233, 208,  55,  28, 215,  59, 159,
+    108, 173,  66, 239,  17, 186,  35, 119, 210,  19, 197,  90,   5, 160,  30,  78, 205, 119, 176, 200,  43, 158,  22, 242,  82, 222, 151,  93, 212,  76, 229,  94, 141,  81,  27, 166, 201,   5,  72, 196, 108, 245,   8, 117,  52, 186, 163,  60, 138,  77,  12, 187, 220,  21, 182, 246,  67, 133,  12, 167, 101, 145,   8, 248,
+    209,  14, 129, 217, 145,  94, 250, 156,  86, 172,  40, 151,  59, 211, 105, 188, 143,  62, 230,  14, 131, 192,  63, 123,  50, 180, 110, 236, 138,  14, 121, 205,  54, 222, 108, 234,  53, 127, 163,  24, 213, 173,  63, 220,  30, 240, 126, 104, 201, 172, 253, 116, 162,  94, 130,   1, 198,  86, 187, 253,  75, 201, 122,  90,
+    143,  54, 180, 102,  47,  68, 128,   1,  58, 226, 115, 253, 186, 129, 233,  10, 164,  34, 104,  80, 169,  98, 216, 146,  28, 203,  17,  56, 193,  40, 179, 155,   1, 193,  44, 137,  94, 189, 251, 100,  46,  83, 132, 191, 148,  73,  16, 228,  26,  93,  47,  70,  33, 234,  53, 218, 105, 149,  25, 117,  44, 181, 237,  38,
+    221,  78, 254,  24, 199, 234, 173, 215, 192, 139,  75,  20,  96,  37,  82,  57, 250, 126, 208, 244,  54,   6, 237, 177,  87, 253, 128, 165,  84, 247, 105,  67, 241, 119, 174,  12, 214,  29,  62, 145, 231, 160,  19, 255,  93, 178, 212,  54, 158, 237, 133, 213, 194, 144,  81, 169,  39, 207,  63, 227, 154,  16,  65, 166,
+      3, 193, 150, 116, 162,  15, 107,  45,  93,  29, 233, 159, 202, 143, 171, 214,  92, 186,  18, 151, 197, 137,  75,  38, 107, 154,  67, 222,   7, 143, 208,  23,  92, 146,  77, 247, 154,  85, 179, 121,   2, 207, 105,  56,  37, 114, 140,  84, 188, 109,   8, 168,  22, 111, 249,  17, 135, 242, 177,  95, 129, 216,  86, 115,
+    136,  95,  38,  62, 224,  81, 144, 247, 163, 124, 182,  63,   6, 240, 114,  22, 137,  49,  74, 112,  31, 227, 120, 199,  20, 215,  42,  99, 175, 120,  49, 229, 181,  36, 202,  54, 111, 232,  40, 202,  75, 181, 127, 232, 158, 198,   4, 219,  35, 151,  75, 227,  91, 182,  63, 196, 117,  83,   6,  52, 169,  33, 190, 231,
+     25, 244, 207, 174, 132,  33, 189,  66,   9, 210,  39, 102, 216,  73,  41, 197, 226, 159, 239, 179,  90, 165,  62, 245, 170, 116, 189, 242,  31, 196,  73, 162, 107, 218,  17, 127, 194,  21, 158,  98, 246,  31,  65, 216,  21,  71, 237, 119,  62, 251, 200,  47, 129,  33, 149, 224,  48, 157, 235, 204, 105, 251, 146,  54,
+    104, 159,  76,  10, 233,  97, 214, 118, 236,  85, 140, 251, 122, 150, 174,  82, 101,   1, 126,  43, 210,  10, 140,  46,  91,   3, 134,  62, 156,  92, 254,  10, 139,  64, 241, 148,  95,  70, 216, 132,  50, 149, 169,  96, 138, 183,  94, 169, 134,  15,  97, 164, 234, 207,  79,  13, 100, 188,  29, 140,  78,  11,  69, 176,
+    223,  45, 125, 187,  55, 164,  18, 148,  53, 194, 168,  13,  51, 191,  19, 247,  56, 215, 186,  68, 252, 100, 193, 218, 149, 236,  81, 223,  17, 211, 131,  41, 189,  88, 170,  42, 182, 252,   8, 175, 114, 238,  10, 201,  45, 249,  27,  50, 223, 185, 142,  67,   5, 106, 176, 254, 131, 220,  61, 114, 186, 217, 120, 201,
+      7, 141, 239,  84, 116, 253,  42, 180, 104,  30,  74, 204,  93, 236, 133, 110, 163, 141,  33, 112, 154,  24, 125,  73,  31, 174,  48, 184, 145, 111,  58, 204, 235, 115,   3, 222, 121,  57,  89, 203,  26,  85, 219, 124,  74, 111, 152, 202,  78, 108,  38, 246, 194, 125,  50, 162,  35,  88, 174, 245,  19, 154,  40,  89,
+    164,  67, 199,  15, 219, 138,  71, 206, 232, 132, 221, 117, 157,  36,  65, 206,  15, 234,  79, 197, 225,  53, 185, 243, 103, 210, 122,  94,  34, 232,  79, 158,  27, 143,  75, 200,  24, 165, 139, 230,  66, 185, 145,  32, 179, 227,   7, 126, 241,  18, 217, 152,  88,  25, 237,  71, 211,   2, 143,  50,  97, 227, 131, 248,
+    186, 108,  38, 169,  99,  28, 158,  87,   5, 164,  61,  23, 229, 175,  88, 182,  45,  97, 171,   7, 131,  90, 165,  15,  61, 157,   9, 249, 191, 169,   6, 102, 182,  55, 249, 153, 106, 238,  37, 109, 157,  48,  98, 235,  58, 161,  90, 192,  63, 171, 119,  53, 178, 136, 199, 104, 154, 120, 237, 201,  74, 170,  60,  29,
+     86, 234, 143, 212,  57, 186, 241, 127,  49, 250, 190, 105, 139,   4, 217, 119, 254, 135, 211,  65, 247,  34, 217, 113, 229, 195, 141,  74,  54, 134, 218, 245, 125, 210,  96,  44, 190,  68, 213,  15, 195, 246,   1, 204, 135,  23, 215,  45, 146,  95, 204,  28, 232,  79,  14, 225,  58, 185,  40, 106,  24, 194, 111, 215,
+     51,  22, 124,  75, 229, 112,  18, 198, 101, 147,  82,  39, 242,  68, 152,  29,  60, 160,  22, 117, 182, 149,  74, 137,  44,  85,  22, 215, 112,  29,  90,  67,  38,  12, 175, 134,  18,  91, 172, 136,  80, 126, 167, 115,  82, 253, 109, 178,  10, 247,  68, 156, 106, 188,  43, 170,  92,  18, 214, 159, 137, 244,   5, 150,
+    255, 161, 205,   1, 151,  43, 170,  70, 215,  11, 174, 207, 122, 197, 100, 225, 193,  83, 239,  40,  95, 207,   2, 189, 255, 121, 181, 239, 164, 205, 145, 192, 165, 239,  80, 226, 204, 119, 255,  49, 227,  31,  60, 184,  37, 154,  56, 224, 137,  38, 220, 126,   4, 243, 142, 117, 252, 131,  77, 234,  50,  88, 178, 118,
+    190,  65,  98, 182, 246,  92, 140, 231,  33, 133, 237,  58,  14, 168,  44, 134,   8, 108, 175, 140, 228,  54, 163, 101,  29, 159,  60,  96,  45,  17, 234,  50, 131, 103, 150,  58,  36, 159,   7, 102, 150, 203,  96, 232, 210,  12, 196,  72,  97, 170, 192,  85, 165,  57, 203,  71,  29, 196, 172,  11, 122, 206,  37,  76,
+     11, 226,  44, 120,  30, 203,  56, 115, 188,  76, 111, 161,  94, 249,  72, 184, 233,  50, 214,  72,  20, 128, 239,  69, 205, 224,   6, 152, 127, 183, 107,  82,   2, 214,  25, 181, 235,  77, 189, 218,  67, 177,   9, 142,  75, 111, 130, 240,  21, 118,  52,  29, 229, 101,  21, 221, 156,  51, 101, 225,  64, 153, 232, 136,
+    108, 171, 144, 220,  81, 177,   8, 253, 157,  47, 223,  22, 138, 217,  26,  92, 154, 126,  30, 160, 200,  88, 177,  42, 140, 110,  76, 200, 248,  63, 220, 170, 252, 196,  71, 123,  99, 140,  43, 128,  27, 249, 122,  48, 244, 168,  40, 181, 143, 208, 255, 151, 195, 129, 180,  87, 114, 241, 144,  32, 186,  91,  25, 199,
+     84, 247,  16,  61, 160, 127, 213, 100,  20,  89, 176, 198,  41, 116, 176, 211,  61, 240, 187, 103, 250,   9, 117, 196,  19, 236, 173,  34,  91,  14, 143,  32, 116,  47, 144, 245,  13, 198, 230, 168, 109,  82, 160, 189,  93,  24, 222,  60,  89,  13,  79, 109,  62,  10, 247,  43, 170,   1,  76, 215, 130, 250, 166,  58,
+     32, 128, 203,  97, 241,  26,  73, 140, 200, 232, 121,  67, 238,  80, 143,   1, 114,  21,  81,  43, 145,  60, 229, 155,  97,  57, 131, 216, 164, 124, 208,  76, 159,  97, 188,  34, 160,  61,  89,   3, 210,  57, 228,  16, 215, 149, 105, 194, 155, 227, 184,  35, 213, 142,  73, 205, 135, 223, 179, 106,  48,   7, 116, 212,
+    184, 159,  42, 118, 179,  48, 228, 171,  59,  34, 149,  10, 162, 206,  52, 254, 195, 150, 226, 124, 215, 170,  31,  80, 252, 181,  11, 103,  40, 235,  53, 192, 241,  19, 222,  86, 213, 115, 242, 148, 190,  32, 140, 113,  70,  45, 239,   4, 115,  47, 132, 169, 239,  93, 163,  20,  98,  58,  27, 152, 204,  69, 147, 236,
+     54,  78, 234,  12, 197, 151, 107,   4, 127, 248,  95, 189, 110,  31,  91, 168,  66,  99, 174,  25,  73, 104, 201, 127,  46, 205, 150, 244,  82, 175, 107,   6, 135,  58, 172, 130,  50, 181,  28,  69, 124, 238,  86, 169, 201, 129, 177,  78, 211, 245,  71,  25, 118,  50, 192, 233, 126, 252, 195,  83, 240, 176,  92,  16,
+    107, 206, 139,  91,  59, 250,  81, 211, 183,  78, 206,  48, 243, 138, 222, 123,  14, 212,  48, 248, 190,   4, 142, 221,  20,  75, 120,  59, 198,  25, 152, 227, 184, 118,  77, 253,  10, 142, 202,  99, 162,  46, 213,   7, 254,  26,  97, 141,  33, 160, 101, 203, 226,   4, 146,  65,  32, 161, 111,  12, 121,  34, 220, 130,
+    254,  25, 168, 221, 122,  28, 141,  43, 157,  15, 120, 165,  74,   6, 184,  43, 236, 140,  88, 132, 156, 237,  55, 177,  96, 161, 229,   1, 137, 219,  93,  68,  42, 209,  27, 156, 109, 225,  54, 248,  19, 180, 106,  65, 154,  52, 229, 200,  63, 182,  11, 137,  80, 167, 106, 208,  87, 187,  51, 215, 140,  61, 193, 155,
+     46, 183,  69,   6, 160, 193, 218, 104, 226,  63, 236,  26, 218, 153, 103,  80, 160, 202,  18,  64, 101,  36,  83, 118, 247,  39, 186, 106, 170,  36, 126, 244, 167,  90, 232, 188,  36,  87, 173, 121,  77, 230, 128, 198,  85, 189, 112,  20, 250, 119, 223,  53, 187, 249,  41, 231, 131,  23, 244,  76, 162, 237,   3,  77,
+    230, 127, 102, 242,  47,  93,  68,  20, 133, 174,  96, 131, 195,  55, 251, 191,  29, 110, 179, 231, 209, 168, 227, 198,  13, 133, 209,  71, 255,  56, 199,  22, 145,   8, 104,  56, 206, 133,   4, 219,  42, 148,  15, 242,  32, 134, 171,  75, 146,  37,  84, 152,  27, 123,  72,  14, 177, 148,  96, 196,  41, 106, 178,  95,
+    204,  34, 197, 139, 177, 236, 150, 190, 255,  51, 203,  35,  82, 115,  16, 134,  70, 240,  41, 120,  12, 129,  28,  69, 156,  55,  92,  25, 153, 101, 179,  77, 216, 125, 179, 147, 237,  66, 155, 191, 102, 209,  55, 167, 100, 213,   1, 220,  98, 174, 197, 242,  96, 216, 157, 202, 113,  61, 224,  11, 133, 214,  28, 144,
+     60, 162,  19,  78, 116,  13,  38, 110,  79,   2, 157, 243, 145, 176, 228,  48, 212, 147,  84, 161,  61, 193, 147, 111, 243, 176, 225, 119, 212,   9, 230, 113,  52, 251,  32,  79,  16, 112, 250,  29,  82, 178, 120,  73, 228,  49, 153,  61, 236,  15, 126,  65,   7, 178,  47,  85, 255,  37, 181, 116, 170,  67, 248, 115,
+    221,  88, 250, 208,  63, 224, 199, 170, 128, 213, 103,  62,  11, 202,  93, 158, 107,   3, 204, 254,  97, 219,  47,  85, 204,   5, 141,  43, 166,  84, 139,  34, 165, 193,  95, 225, 189, 168,  49, 131, 222,   7, 246, 144,  23, 123, 190, 107, 203,  46, 166, 231, 143, 106, 228, 136,   2, 152,  81, 241,  50,  89, 186,  13,
+    174, 124, 147,  42, 163, 135,  90,  56, 235,  24, 185, 226, 121,  72,  36, 247, 181,  56, 132,  30, 174,   9, 238, 161,  35, 103,  72, 248, 192,  60, 237, 203,  72,   2, 154, 130,  35,  99, 206,  69, 162, 108,  40, 203, 174,  85, 253,  28, 140,  83, 112,  26, 205,  69,  32, 188,  99, 219, 200,  22, 138, 232, 150,  44,
+     72, 236,  16, 107, 187,   7, 246,  31, 152,  70, 134,  44, 166, 218, 141,  22,  80, 235, 195,  72, 113, 137,  64, 185, 126, 229, 179,  19, 129, 110,  15, 150, 123, 243,  58, 217,  74, 233, 144,  23, 238, 192,  93,  66, 232,  10, 161,  72, 184, 244, 219,  55, 181, 122, 240, 161,  59, 124,  42, 163, 108,   7, 200, 101,
+     31, 183,  57, 230,  83, 214, 125, 105, 204, 175,  86, 252,  18, 102, 193, 123, 166, 109,  39, 155, 232, 192,  95,  16, 210,  48, 153,  91, 220,  39, 183,  87, 211, 104,  21, 180, 116,   6, 173,  87,  53, 135, 157,  29, 113, 136, 207,  42, 120,   4, 155,  94, 146,   9,  83, 202,  19, 247,  71, 192, 225,  61, 127, 214,
+    160, 112, 204, 133,  28,  67, 169,  41, 225,   5, 116, 200, 153,  60, 242,  47, 211,   8, 224,  88,  20,  46, 249, 149,  80, 115, 244,  62, 201, 159, 250,  52,  30, 164, 199, 136,  46, 255, 201, 125, 217,  11, 250, 186, 220,  57, 100, 237, 167,  65, 197,  34, 251, 211,  49, 142, 101, 175, 146,  90,  33, 179,  83, 254,
+    138,   1,  92, 171, 251, 149, 198,  94, 138,  63, 235,  37,  79, 178,  13,  89, 147,  67, 178, 134, 207, 167, 120, 219,  33, 174,  23, 141,   4,  73, 106, 135, 221,  69, 238,  88, 159,  66, 105,  37, 165,  71, 119,  46,  83, 154, 194,  18,  91, 214, 134, 106,  70, 166, 117, 229,  36, 218,   5, 113, 243, 155,  17,  51,
+    219,  71, 226,  46, 114,  11,  57, 243,  22, 158, 185,  97, 144, 232, 129, 221, 191, 116, 251,  53, 103,  77,   2,  61, 197,  99, 233, 190, 124, 227, 178,  11, 151, 100,  39,  13, 188, 224,  19, 183, 235,  94, 211, 176,   2, 245,  36, 143, 228,  51,  13, 234, 191,  23,  91, 185,  66, 128, 197,  53, 208, 134,  98, 194,
+    166,  33, 148, 191,  81, 209, 123, 176,  79, 212, 126,  11, 209,  32,  62, 103,  40,  16, 155,  27, 229, 183, 145, 242, 130, 157,  72,  50,  96,  31, 205,  61, 246, 172, 128, 210, 110, 146,  84, 131,  52, 150,  28, 141, 109, 188, 126,  77, 181, 115, 173, 147,  45, 129, 241,  14, 161, 253,  80, 168,  21,  68, 239, 119,
+     87, 247, 106,  21, 239, 162,  37, 230, 104,  42, 249,  56, 112, 187, 158, 245, 172, 217,  84, 193, 126,  38, 209,  87,  45,  10, 213, 169, 254, 153,  84, 120,  24, 196,  76, 231,  57,  34, 245, 209,   6, 193, 248,  56, 224,  92,  49, 209,  26, 255,  67,  96, 217,  80, 153, 208,  46, 100,  27, 123, 226, 189,  42,  10,
+};
+
+#endif // BLUE_NOISE_64_H
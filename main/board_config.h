@@ -47,6 +47,13 @@
 #define EPAPER_WIDTH            800
 #define EPAPER_HEIGHT           480
 #define EPAPER_BUFFER_SIZE      (EPAPER_WIDTH * EPAPER_HEIGHT / 8)
+#define EPAPER_BUFFER_SIZE_2BPP (EPAPER_WIDTH * EPAPER_HEIGHT / 4)     // 4 gray levels
+#define EPAPER_BUFFER_SIZE_4BPP (EPAPER_WIDTH * EPAPER_HEIGHT / 2)     // 16 gray levels
+
+// The 4-gray waveform (register LUTs in epaper_driver.c) is not verified on
+// this panel yet. Until it is, the gray display mode is not offered and
+// gray frames are shown with the mono waveform; 1 enables it for testing.
+#define EPD_GRAY_EXPERIMENTAL   0
 
 // ============================================================================
 // SD Card
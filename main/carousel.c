@@ -7,21 +7,27 @@
 #include "epaper_driver.h"
 #include "storage_manager.h"
 #include "image_processor.h"
+#include "img_binfile.h"
+#include "render_queue.h"
 #include "display_overlay.h"
 #include "power_manager.h"
 #include "wifi_manager.h"
 #include "sht40.h"
 
 #include <string.h>
+#include <stdlib.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 #include "esp_timer.h"
 #include "esp_random.h"
 
 static const char *TAG = "carousel";
 
+#define RENDER_WAIT_MS 30000    // Longest wait for the next image's render before deep sleep
+
 // State
 static carousel_state_t s_state = CAROUSEL_STATE_IDLE;
 static int s_current_index = 0;
@@ -49,6 +55,47 @@ esp_err_t carousel_init(void) {
     return ESP_OK;
 }
 
+// Load a pre-rendered frame: mono frames are expanded into the framebuffer,
+// gray ones into a new gray frame. With opts, the frame must have been
+// rendered with them; a stale one queues a re-render of source and is not used.
+static bool load_frame(const char *filename, const img_process_opts_t *opts, const char *source,
+                       uint8_t *fb, uint8_t **gray, int *gray_bpp) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s", IMAGES_DIR, filename);
+
+    img_binfile_t bf;
+    esp_err_t ret = opts ? img_binfile_open_render(&bf, path, opts) : img_binfile_open(&bf, path);
+    if (ret == ESP_ERR_INVALID_STATE && source) {
+        render_queue_add(source);
+    }
+    if (ret != ESP_OK) {
+        return false;
+    }
+
+    uint8_t *out = fb;
+    if (bf.format != IMG_FORMAT_1BPP) {
+        out = heap_caps_malloc(bf.frame_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!out) {
+            img_binfile_close(&bf);
+            return false;
+        }
+    }
+
+    ret = img_binfile_read(&bf, out, bf.frame_size);
+    img_binfile_close(&bf);
+    if (ret != ESP_OK) {
+        if (out != fb) {
+            free(out);
+        }
+        return false;
+    }
+    if (out != fb) {
+        *gray = out;
+        *gray_bpp = img_format_bpp(bf.format);
+    }
+    return true;
+}
+
 static void display_image(int index) {
     image_info_t info;
     
@@ -64,6 +111,10 @@ static void display_image(int index) {
     if (!fb) {
         return;
     }
+
+    // Gray frame (2bpp / 4bpp) when the image is shown in gray, else NULL
+    uint8_t *gray = NULL;
+    int gray_bpp = 1;
     
     // Check extension to decide how to process
     const char *ext = strrchr(info.filename, '.');
@@ -75,17 +126,9 @@ static void display_image(int index) {
     }
 
     if (is_raw) {
-        // For raw files, we still load them to memory first as they are small (48KB)
-        uint8_t *raw_data = NULL;
-        size_t raw_size = 0;
-        if (storage_load_image(info.filename, &raw_data, &raw_size) == ESP_OK) {
-            if (raw_size == EPAPER_BUFFER_SIZE) {
-                memcpy(fb, raw_data, EPAPER_BUFFER_SIZE);
-            } else {
-                ESP_LOGW(TAG, "Raw image size mismatch: %d vs %d", raw_size, EPAPER_BUFFER_SIZE);
-                memset(fb, 0xFF, EPAPER_BUFFER_SIZE);
-            }
-            free(raw_data);
+        if (!load_frame(info.filename, NULL, NULL, fb, &gray, &gray_bpp)) {
+            ESP_LOGW(TAG, "Not a frame file: %s", info.filename);
+            memset(fb, 0xFF, EPAPER_BUFFER_SIZE);
         }
     } else {
         // Try to load pre-generated .bin file first (much faster)
@@ -99,29 +142,36 @@ static void display_image(int index) {
             strncat(bin_filename, ".bin", sizeof(bin_filename) - strlen(bin_filename) - 1);
         }
         
-        uint8_t *bin_data = NULL;
-        size_t bin_size = 0;
-        if (storage_load_image(bin_filename, &bin_data, &bin_size) == ESP_OK && 
-            bin_size == EPAPER_BUFFER_SIZE) {
+        img_process_opts_t opts;
+        img_get_render_opts(&opts, &s_settings);
+
+        if (load_frame(bin_filename, &opts, info.filename, fb, &gray, &gray_bpp)) {
             // Use pre-generated binary
-            ESP_LOGI(TAG, "Using pre-generated %s", bin_filename);
-            memcpy(fb, bin_data, EPAPER_BUFFER_SIZE);
-            free(bin_data);
+            ESP_LOGI(TAG, "Using pre-generated %s (%dbpp)", bin_filename, gray ? gray_bpp : 1);
         } else {
             // Fallback: process the original image
-            if (bin_data) free(bin_data);
-            
-            img_process_opts_t opts;
-            img_get_default_opts(&opts);
-            opts.fit_mode = s_settings.fit_mode;
+            uint8_t *out = fb;
+            size_t out_size = EPAPER_BUFFER_SIZE;
+            if (opts.format != IMG_FORMAT_1BPP) {
+                out_size = img_frame_size(opts.format, opts.target_width, opts.target_height);
+                gray = heap_caps_malloc(out_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+                if (gray) {
+                    out = gray;
+                    gray_bpp = img_format_bpp(opts.format);
+                } else {
+                    ESP_LOGW(TAG, "No memory for gray frame, showing mono");
+                    opts.format = IMG_FORMAT_1BPP;
+                    out_size = EPAPER_BUFFER_SIZE;
+                }
+            }
             
             // Construct full path
             char full_path[128];
             snprintf(full_path, sizeof(full_path), "%s/%s", IMAGES_DIR, info.filename);
             
-            if (img_process_file(full_path, fb, EPAPER_BUFFER_SIZE, &opts) != ESP_OK) {
+            if (img_process_file(full_path, out, out_size, &opts) != ESP_OK) {
                 ESP_LOGE(TAG, "Image processing failed");
-                memset(fb, 0xFF, EPAPER_BUFFER_SIZE);
+                memset(out, 0xFF, out_size);
             }
         }
     }
@@ -142,15 +192,36 @@ static void display_image(int index) {
     float temp = -999;
     sht40_read_temp_humid(&temp, NULL);
 
-    overlay_draw(fb, &overlay_cfg, 
-                 power_get_battery_percent(),
-                 temp,
-                 wifi_info.status == WIFI_MGR_STATUS_CONNECTED);
-    
-    
-    // Display on e-paper
-    s_state = CAROUSEL_STATE_DISPLAYING;
-    epd_display(fb, EPD_UPDATE_FULL);
+    uint8_t battery = power_get_battery_percent();
+    bool connected = wifi_info.status == WIFI_MGR_STATUS_CONNECTED;
+
+    if (!gray) {
+        overlay_draw(fb, &overlay_cfg, battery, temp, connected);
+
+        // Display on e-paper
+        s_state = CAROUSEL_STATE_DISPLAYING;
+        epd_display(fb, EPD_UPDATE_FULL);
+    } else {
+        // Overlays are drawn in 1bpp over white and over black, then merged
+        bool any_overlay = overlay_cfg.show_datetime || overlay_cfg.show_temperature ||
+                           overlay_cfg.show_battery || overlay_cfg.show_wifi;
+        uint8_t *on_white = any_overlay ?
+            heap_caps_malloc(EPAPER_BUFFER_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT) : NULL;
+        if (on_white) {
+            memset(fb, 0xFF, EPAPER_BUFFER_SIZE);
+            overlay_draw(fb, &overlay_cfg, battery, temp, connected);
+            memcpy(on_white, fb, EPAPER_BUFFER_SIZE);
+            memset(fb, 0x00, EPAPER_BUFFER_SIZE);
+            overlay_draw(fb, &overlay_cfg, battery, temp, connected);
+            epd_merge_overlay_gray(gray, gray_bpp, on_white, fb);
+            free(on_white);
+        }
+        memset(fb, 0xFF, EPAPER_BUFFER_SIZE);
+
+        s_state = CAROUSEL_STATE_DISPLAYING;
+        epd_display_grayscale(gray, gray_bpp);
+        free(gray);
+    }
     
     // Update stored index
     s_current_index = index;
@@ -238,6 +309,17 @@ static void display_ap_config_screen(const char *ssid) {
     epd_display(fb, EPD_UPDATE_FULL);
 }
 
+// Index the interval timer shows next
+static int next_index(int image_count) {
+    if (image_count <= 0) {
+        return 0;
+    }
+    if (s_settings.random_order) {
+        return s_settings.next_image_index % image_count;
+    }
+    return (s_current_index + 1) % image_count;
+}
+
 void carousel_task(void *arg) {
     ESP_LOGI(TAG, "Carousel task started");
     
@@ -301,10 +383,10 @@ void carousel_task(void *arg) {
         
         if (!need_display && (now - last_display) >= interval_ticks) {
             need_display = true;
+            target_index = next_index(image_count);
             if (s_settings.random_order) {
-                target_index = esp_random() % (image_count > 0 ? image_count : 1);
-            } else {
-                target_index = (s_current_index + 1) % (image_count > 0 ? image_count : 1);
+                // Draw the one after now, so it can be rendered ahead of time
+                s_settings.next_image_index = esp_random() % (image_count > 0 ? image_count : 1);
             }
         }
         
@@ -326,6 +408,13 @@ void carousel_task(void *arg) {
             
             // Enter deep sleep if WiFi is off and carousel is running
             if (!wifi_mgr_is_active() && s_settings.carousel_interval_sec > 60) {
+                // The next wake should find its image pre-rendered
+                image_info_t next;
+                if (image_count > 0 &&
+                    storage_get_image_by_index(carousel_peek_next_index(image_count), &next) == ESP_OK &&
+                    !render_queue_wait_for(next.filename, RENDER_WAIT_MS)) {
+                    ESP_LOGW(TAG, "Next image not rendered yet, sleeping anyway");
+                }
                 ESP_LOGI(TAG, "Entering deep sleep until next image");
                 epd_sleep();
                 power_enter_deep_sleep(s_settings.carousel_interval_sec);
@@ -419,6 +508,13 @@ int carousel_get_current_index(void) {
     return s_current_index;
 }
 
+int carousel_peek_next_index(int image_count) {
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    int index = next_index(image_count);
+    xSemaphoreGive(s_mutex);
+    return index;
+}
+
 void carousel_handle_button(int button) {
     switch (button) {
         case 0:  // K0 - WiFi toggle
@@ -69,6 +69,13 @@ carousel_state_t carousel_get_state(void);
  */
 int carousel_get_current_index(void);
 
+/**
+ * @brief Get the image the carousel will show next on its own
+ * @param image_count Current number of images
+ * @return Index (0 if there are no images)
+ */
+int carousel_peek_next_index(int image_count);
+
 /**
  * @brief Handle button press
  * @param button Button number (0-2)
@@ -6,6 +6,8 @@
 #include "epaper_driver.h"
 #include "board_config.h"
 #include "font_16x24.h"
+#include "img_kernels.h"
+#include "img_raster.h"
 
 #include <string.h>
 #include "freertos/FreeRTOS.h"
@@ -20,6 +22,7 @@ static const char *TAG = "epaper";
 // SPI handle
 static spi_device_handle_t s_spi = NULL;
 static uint8_t *s_framebuffer = NULL;
+static img_bitmap_t s_fb_bitmap;
 static epd_rotation_t s_rotation = EPD_ROTATE_0;
 static bool s_initialized = false;
 
@@ -334,6 +337,7 @@ esp_err_t epd_init(void) {
     }
     
     memset(s_framebuffer, 0xFF, EPAPER_BUFFER_SIZE);  // White
+    img_bitmap_init(&s_fb_bitmap, s_framebuffer, EPD_WIDTH, EPD_HEIGHT);
     
     // Initialize panel
     epd_init_panel();
@@ -447,50 +451,262 @@ void epd_display(const uint8_t *buffer, epd_update_mode_t mode) {
     ESP_LOGI(TAG, "Display updated");
 }
 
-void epd_display_grayscale(const uint8_t *buffer) {
-    // 4-level grayscale implementation would go here
-    // For now, just convert to 1-bit and display
-    epd_display(buffer, EPD_UPDATE_FULL);
+// ============================================================================
+// 4-level grayscale
+//
+// The panel gets two bit planes and picks one of four LUTs per pixel from
+// the (old, new) bit pair: 00 -> W2W, 10 -> B2W, 01 -> W2B, 11 -> B2B.
+// Each LUT drives its pixels to one gray level, so the 2-bit level L is
+// sent as old = ~L.1, new = ~L.0 (white = 00, black = 11, as in mono mode).
+// Groups of 6 bytes: level select (4 x 2 bits), 4 phase frame counts, repeat.
+//
+// The LUTs follow the 4-gray sequence published for the IL0398 4.2" panel
+// and are not verified on this panel (ghosting, DC balance), so they are
+// only used with EPD_GRAY_EXPERIMENTAL; otherwise gray frames are shown in
+// mono through the OTP waveform.
+// ============================================================================
+
+#define GRAY_LUT_SIZE       60      // 10 groups on UC8179, unused ones zero
+#define GRAY_PLANE_CHUNK    4096
+
+static const uint8_t s_lut_gray_vcom[] = {
+    0x00, 0x0A, 0x00, 0x00, 0x00, 0x01,
+    0x60, 0x14, 0x14, 0x00, 0x00, 0x01,
+    0x00, 0x14, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x13, 0x0A, 0x01, 0x00, 0x01,
+};
+
+// 00: white
+static const uint8_t s_lut_gray_ww[] = {
+    0x40, 0x0A, 0x00, 0x00, 0x00, 0x01,
+    0x90, 0x14, 0x14, 0x00, 0x00, 0x01,
+    0x10, 0x14, 0x0A, 0x00, 0x00, 0x01,
+    0xA0, 0x13, 0x01, 0x00, 0x00, 0x01,
+};
+
+// 10: dark gray
+static const uint8_t s_lut_gray_bw[] = {
+    0x40, 0x0A, 0x00, 0x00, 0x00, 0x01,
+    0x90, 0x14, 0x14, 0x00, 0x00, 0x01,
+    0x00, 0x14, 0x0A, 0x00, 0x00, 0x01,
+    0x99, 0x0C, 0x01, 0x03, 0x04, 0x01,
+};
+
+// 01: light gray
+static const uint8_t s_lut_gray_wb[] = {
+    0x40, 0x0A, 0x00, 0x00, 0x00, 0x01,
+    0x90, 0x14, 0x14, 0x00, 0x00, 0x01,
+    0x00, 0x14, 0x0A, 0x00, 0x00, 0x01,
+    0x99, 0x0B, 0x04, 0x04, 0x01, 0x01,
+};
+
+// 11: black
+static const uint8_t s_lut_gray_bb[] = {
+    0x80, 0x0A, 0x00, 0x00, 0x00, 0x01,
+    0x90, 0x14, 0x14, 0x00, 0x00, 0x01,
+    0x20, 0x14, 0x0A, 0x00, 0x00, 0x01,
+    0x50, 0x13, 0x01, 0x00, 0x00, 0x01,
+};
+
+static void epd_write_lut(uint8_t cmd, const uint8_t *lut, size_t len) {
+    uint8_t buf[GRAY_LUT_SIZE] = {0};
+    memcpy(buf, lut, len);
+    epd_write_cmd(cmd);
+    epd_write_data(buf, sizeof(buf));
+}
+
+static inline uint32_t load_be32(const uint8_t *p) {
+    uint32_t w;
+    memcpy(&w, p, sizeof(w));
+    return __builtin_bswap32(w);
+}
+
+/*
+ * Extract one panel bit plane from packed gray pixels, inverted for the
+ * panel. Works on 32-bit words: 16 pixels (2bpp) or 8 pixels (4bpp) per
+ * load, gathered with shift/mask steps. A 4bpp pixel n is shown as the
+ * nearest of the four levels (0, 5, 10, 15): level bit 1 is n >= 8, bit 0
+ * is n >= 13 above that and n >= 3 below it.
+ * high selects the most significant level bit (DTM1) or the next one (DTM2).
+ */
+static void epd_gray_plane(const uint8_t *src, uint8_t *dst, size_t out_len,
+                           int bpp, bool high) {
+    if (bpp == 2) {
+        for (size_t i = 0; i + 2 <= out_len; i += 2, src += 4) {
+            uint32_t w = load_be32(src);
+            uint32_t v = (high ? (w >> 1) : w) & 0x55555555;
+            v = (v | (v >> 1)) & 0x33333333;
+            v = (v | (v >> 2)) & 0x0F0F0F0F;
+            v = (v | (v >> 4)) & 0x00FF00FF;
+            v = (v | (v >> 8)) & 0x0000FFFF;
+            dst[i] = ~(uint8_t)(v >> 8);
+            dst[i + 1] = ~(uint8_t)v;
+        }
+    } else {
+        for (size_t i = 0; i < out_len; i++, src += 4) {
+            uint32_t w = load_be32(src);
+            uint32_t b3 = w >> 3, b2 = w >> 2, b1 = w >> 1;
+            uint32_t v = high ? b3 : (b3 & b2 & (b1 | w)) | (~b3 & (b2 | (b1 & w)));
+            v &= 0x11111111;
+            v = (v | (v >> 3)) & 0x03030303;
+            v = (v | (v >> 6)) & 0x000F000F;
+            v = (v | (v >> 12)) & 0x000000FF;
+            dst[i] = ~(uint8_t)v;
+        }
+    }
+}
+
+static void epd_send_gray_plane(uint8_t cmd, const uint8_t *buffer, int bpp,
+                                bool high, uint8_t *chunk_buf) {
+    epd_write_cmd(cmd);
+
+    EPD_DC_DATA();
+    EPD_CS_LOW();
+    for (int i = 0; i < EPAPER_BUFFER_SIZE; i += GRAY_PLANE_CHUNK) {
+        size_t chunk = (EPAPER_BUFFER_SIZE - i > GRAY_PLANE_CHUNK) ? GRAY_PLANE_CHUNK : (EPAPER_BUFFER_SIZE - i);
+        epd_gray_plane(buffer + (size_t)i * bpp, chunk_buf, chunk, bpp, high);
+        epd_spi_write(chunk_buf, chunk);
+    }
+    EPD_CS_HIGH();
+}
+
+void epd_display_grayscale(const uint8_t *buffer, int bpp) {
+    if (!s_initialized || !buffer) return;
+
+    if (bpp != 2 && bpp != 4) {
+        epd_display(buffer, EPD_UPDATE_FULL);
+        return;
+    }
+
+    if (!EPD_GRAY_EXPERIMENTAL) {
+        // Light half of the levels white, through the framebuffer
+        epd_gray_plane(buffer, s_framebuffer, EPAPER_BUFFER_SIZE, bpp, true);
+        img_k_invert(s_framebuffer, EPAPER_BUFFER_SIZE);
+        epd_display(s_framebuffer, EPD_UPDATE_FULL);
+        return;
+    }
+
+    uint8_t *chunk_buf = heap_caps_malloc(GRAY_PLANE_CHUNK, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!chunk_buf) {
+        ESP_LOGE(TAG, "Gray plane buffer alloc failed");
+        return;
+    }
+
+    epd_wait_busy(10000);
+
+    // Panel setting - KW mode, LUT from registers
+    epd_write_cmd(CMD_PANEL_SETTING);
+    epd_write_data_byte(0x3F);
+
+    epd_write_lut(CMD_VCOM_LUT, s_lut_gray_vcom, sizeof(s_lut_gray_vcom));
+    epd_write_lut(CMD_W2W_LUT, s_lut_gray_ww, sizeof(s_lut_gray_ww));
+    epd_write_lut(CMD_B2W_LUT, s_lut_gray_bw, sizeof(s_lut_gray_bw));
+    epd_write_lut(CMD_W2B_LUT, s_lut_gray_wb, sizeof(s_lut_gray_wb));
+    epd_write_lut(CMD_B2B_LUT, s_lut_gray_bb, sizeof(s_lut_gray_bb));
+
+    epd_send_gray_plane(CMD_DATA_START_TRANS_1, buffer, bpp, true, chunk_buf);
+    epd_send_gray_plane(CMD_DATA_START_TRANS_2, buffer, bpp, false, chunk_buf);
+    free(chunk_buf);
+
+    // Refresh
+    epd_write_cmd(CMD_DISPLAY_REFRESH);
+    vTaskDelay(pdMS_TO_TICKS(100));
+    epd_wait_busy(30000);
+
+    // Back to the OTP waveform for mono updates
+    epd_write_cmd(CMD_PANEL_SETTING);
+    epd_write_data_byte(0x1F);
+
+    ESP_LOGI(TAG, "Display updated (4-gray, %dbpp source)", bpp);
+}
+
+void epd_merge_overlay_gray(uint8_t *gray, int bpp, const uint8_t *on_white,
+                            const uint8_t *on_black) {
+    if (!gray || !on_white || !on_black || (bpp != 2 && bpp != 4)) return;
+
+    // Ink is whatever differs from the clear color: black ink shows as 0
+    // bits on the white-cleared frame, white ink as 1 bits on the black one.
+    // Each 8-pixel mask byte is spread to 16 (2bpp) or 32 (4bpp) bits.
+    for (int i = 0; i < EPAPER_BUFFER_SIZE; i++) {
+        uint32_t bk = (uint8_t)~on_white[i];
+        uint32_t wh = on_black[i];
+        if (!(bk | wh)) {
+            continue;
+        }
+
+        if (bpp == 2) {
+            bk = (bk | (bk << 4)) & 0x0F0F;
+            bk = (bk | (bk << 2)) & 0x3333;
+            bk = ((bk | (bk << 1)) & 0x5555) * 3;
+            wh = (wh | (wh << 4)) & 0x0F0F;
+            wh = (wh | (wh << 2)) & 0x3333;
+            wh = ((wh | (wh << 1)) & 0x5555) * 3;
+
+            uint8_t *p = gray + i * 2;
+            uint32_t g = ((uint32_t)p[0] << 8) | p[1];
+            g = (g & ~(bk | wh)) | wh;
+            p[0] = g >> 8;
+            p[1] = g;
+        } else {
+            bk = (bk | (bk << 12)) & 0x000F000F;
+            bk = (bk | (bk << 6)) & 0x03030303;
+            bk = ((bk | (bk << 3)) & 0x11111111) * 0xF;
+            wh = (wh | (wh << 12)) & 0x000F000F;
+            wh = (wh | (wh << 6)) & 0x03030303;
+            wh = ((wh | (wh << 3)) & 0x11111111) * 0xF;
+
+            uint8_t *p = gray + i * 4;
+            uint32_t g = load_be32(p);
+            g = (g & ~(bk | wh)) | wh;
+            p[0] = g >> 24;
+            p[1] = g >> 16;
+            p[2] = g >> 8;
+            p[3] = g;
+        }
+    }
 }
 
 void epd_display_partial(const uint8_t *buffer, int x, int y, int w, int h) {
     if (!s_initialized || !buffer) return;
     
-    // Align to byte boundary
-    x = (x / 8) * 8;
-    w = ((w + 7) / 8) * 8;
+    img_rect_t win = {x, y, w, h};
+    if (!img_raster_window(&win, &(img_rect_t){0, 0, EPD_WIDTH, EPD_HEIGHT})) return;
+    
+    int x0 = win.x;
+    int x1 = win.x + win.w;
+    int stride = win.w / 8;
+    img_bitmap_t region;
+    img_bitmap_init(&region, (uint8_t *)buffer, w, h);
     
     epd_wait_busy(10000);
     
     // Set partial window
     epd_write_cmd(CMD_PARTIAL_IN);
     epd_write_cmd(CMD_PARTIAL_WINDOW);
-    epd_write_data_byte(x >> 8);
-    epd_write_data_byte(x & 0xFF);
-    epd_write_data_byte((x + w - 1) >> 8);
-    epd_write_data_byte((x + w - 1) & 0xFF);
-    epd_write_data_byte(y >> 8);
-    epd_write_data_byte(y & 0xFF);
-    epd_write_data_byte((y + h - 1) >> 8);
-    epd_write_data_byte((y + h - 1) & 0xFF);
+    epd_write_data_byte(x0 >> 8);
+    epd_write_data_byte(x0 & 0xFF);
+    epd_write_data_byte((x1 - 1) >> 8);
+    epd_write_data_byte((x1 - 1) & 0xFF);
+    epd_write_data_byte(win.y >> 8);
+    epd_write_data_byte(win.y & 0xFF);
+    epd_write_data_byte((win.y + win.h - 1) >> 8);
+    epd_write_data_byte((win.y + win.h - 1) & 0xFF);
     epd_write_data_byte(0x01);
     
-    // Send data
+    // Send data, all at once or a row at a time without memory
     epd_write_cmd(CMD_DATA_START_TRANS_2);
-    size_t size = (w / 8) * h;
-    
-    uint8_t *temp_buf = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
-    if (temp_buf) {
-        for (size_t i = 0; i < size; i++) {
-            temp_buf[i] = ~buffer[i];
-        }
-        epd_write_data(temp_buf, size);
-        free(temp_buf);
-    } else {
-        for (size_t i = 0; i < size; i++) {
-            epd_write_data_byte(~buffer[i]);
-        }
+    uint8_t row_buf[EPD_WIDTH / 8];
+    uint8_t *temp_buf = heap_caps_malloc((size_t)stride * win.h, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uint8_t *out = temp_buf ? temp_buf : row_buf;
+    int rows = temp_buf ? win.h : 1;
+    
+    for (int r = 0; r < win.h; r += rows) {
+        // The widened margin comes from the framebuffer, the rest from buffer
+        img_raster_pack_window(out, &s_fb_bitmap, &win, r, rows, &region, x, y);
+        img_k_invert(out, stride * rows);
+        epd_write_data(out, (size_t)stride * rows);
     }
+    free(temp_buf);
     
     // Refresh partial
     epd_write_cmd(CMD_DISPLAY_REFRESH);
@@ -560,16 +776,26 @@ void epd_set_pixel(int x, int y, uint8_t color) {
     }
 }
 
-void epd_draw_hline(int x, int y, int w, uint8_t color) {
-    for (int i = 0; i < w; i++) {
-        epd_set_pixel(x + i, y, color);
+// Logical rectangle to panel coordinates, as epd_set_pixel maps pixels
+static img_rect_t rotate_rect(int x, int y, int w, int h) {
+    switch (s_rotation) {
+        case EPD_ROTATE_90:
+            return (img_rect_t){EPD_WIDTH - y - h, x, h, w};
+        case EPD_ROTATE_180:
+            return (img_rect_t){EPD_WIDTH - x - w, EPD_HEIGHT - y - h, w, h};
+        case EPD_ROTATE_270:
+            return (img_rect_t){y, EPD_HEIGHT - x - w, h, w};
+        default:
+            return (img_rect_t){x, y, w, h};
     }
 }
 
+void epd_draw_hline(int x, int y, int w, uint8_t color) {
+    epd_fill_rect(x, y, w, 1, color);
+}
+
 void epd_draw_vline(int x, int y, int h, uint8_t color) {
-    for (int i = 0; i < h; i++) {
-        epd_set_pixel(x, y + i, color);
-    }
+    epd_fill_rect(x, y, 1, h, color);
 }
 
 void epd_draw_rect(int x, int y, int w, int h, uint8_t color) {
@@ -580,9 +806,78 @@ void epd_draw_rect(int x, int y, int w, int h, uint8_t color) {
 }
 
 void epd_fill_rect(int x, int y, int w, int h, uint8_t color) {
-    for (int j = 0; j < h; j++) {
-        epd_draw_hline(x, y + j, w, color);
+    if (!s_framebuffer || w <= 0 || h <= 0) return;
+    
+    // A rotated rectangle is still a rectangle: map it once, then fill
+    // whole bytes per row
+    img_rect_t r = rotate_rect(x, y, w, h);
+    img_raster_fill(&s_fb_bitmap, r.x, r.y, r.w, r.h, color);
+}
+
+// Glyph of gw x gh pixels (gw a multiple of 8, rows MSB first), scaled up
+// into a bitmap, turned to the panel rotation and blitted as ink
+#define GLYPH_MAX_SCALE     4
+#define GLYPH_BUF_SIZE      (16 * GLYPH_MAX_SCALE / 8 * 24 * GLYPH_MAX_SCALE)
+
+static void draw_glyph(int x, int y, const uint8_t *rows, int gw, int gh, int size,
+                       uint8_t color) {
+    static uint8_t s_glyph[GLYPH_BUF_SIZE];
+    static uint8_t s_turned[GLYPH_BUF_SIZE];
+    
+    if (!s_framebuffer || size < 1) return;
+    if (size > GLYPH_MAX_SCALE) {
+        for (int row = 0; row < gh; row++) {
+            for (int col = 0; col < gw; col++) {
+                if (rows[row * (gw / 8) + col / 8] & (0x80 >> (col % 8))) {
+                    for (int sy = 0; sy < size; sy++) {
+                        for (int sx = 0; sx < size; sx++) {
+                            epd_set_pixel(x + col * size + sx, y + row * size + sy, color);
+                        }
+                    }
+                }
+            }
+        }
+        return;
+    }
+    
+    // Each scaled row is at most 16 * GLYPH_MAX_SCALE = 64 pixels
+    img_bitmap_t glyph;
+    img_bitmap_init(&glyph, s_glyph, gw * size, gh * size);
+    if (size == 1) {
+        glyph.data = (uint8_t *)rows;
+    } else {
+        uint64_t ones = (1u << size) - 1;
+        for (int row = 0; row < gh; row++) {
+            uint64_t bits = 0;
+            for (int col = 0; col < gw; col++) {
+                bits <<= size;
+                if (rows[row * (gw / 8) + col / 8] & (0x80 >> (col % 8))) {
+                    bits |= ones;
+                }
+            }
+            uint8_t *line = s_glyph + (size_t)row * size * glyph.stride;
+            for (int b = 0; b < glyph.stride; b++) {
+                line[b] = bits >> (8 * (glyph.stride - 1 - b));
+            }
+            for (int sy = 1; sy < size; sy++) {
+                memcpy(line + sy * glyph.stride, line, glyph.stride);
+            }
+        }
+    }
+    
+    img_bitmap_t *ink = &glyph;
+    img_bitmap_t turned;
+    if (s_rotation != EPD_ROTATE_0) {
+        int odd = s_rotation == EPD_ROTATE_90 || s_rotation == EPD_ROTATE_270;
+        img_bitmap_init(&turned, s_turned, odd ? glyph.height : glyph.width,
+                        odd ? glyph.width : glyph.height);
+        img_raster_rotate(&turned, &glyph, s_rotation);
+        ink = &turned;
     }
+    
+    img_rect_t r = rotate_rect(x, y, glyph.width, glyph.height);
+    img_raster_blit(&s_fb_bitmap, r.x, r.y, ink, 0, 0, r.w, r.h,
+                    color ? IMG_ROP_OR : IMG_ROP_CLEAR);
 }
 
 void epd_draw_text(int x, int y, const char *text, int size, uint8_t color) {
@@ -599,23 +894,7 @@ void epd_draw_text(int x, int y, const char *text, int size, uint8_t color) {
             continue;
         }
         
-        int font_idx = (c - ' ') * 16;
-        
-        for (int row = 0; row < 16; row++) {
-            uint8_t line = font_8x16[font_idx + row];
-            
-            for (int col = 0; col < 8; col++) {
-                if (line & (0x80 >> col)) {
-                    for (int sy = 0; sy < size; sy++) {
-                        for (int sx = 0; sx < size; sx++) {
-                            epd_set_pixel(cursor_x + col * size + sx, 
-                                         y + row * size + sy, 
-                                         color);
-                        }
-                    }
-                }
-            }
-        }
+        draw_glyph(cursor_x, y, &font_8x16[(c - ' ') * 16], 8, 16, size, color);
         
         cursor_x += 8 * size;
     }
@@ -645,21 +924,13 @@ void epd_draw_text_large(int x, int y, const char *text, int size, uint8_t color
         }
         
         if (font_idx >= 0) {
+            uint8_t rows[24 * 2];
             for (int row = 0; row < 24; row++) {
                 uint16_t line = font_16x24[font_idx * 24 + row];
-                
-                for (int col = 0; col < 16; col++) {
-                    if (line & (0x8000 >> col)) {
-                        for (int sy = 0; sy < size; sy++) {
-                            for (int sx = 0; sx < size; sx++) {
-                                epd_set_pixel(cursor_x + col * size + sx, 
-                                             y + row * size + sy, 
-                                             color);
-                            }
-                        }
-                    }
-                }
+                rows[row * 2] = line >> 8;
+                rows[row * 2 + 1] = line & 0xFF;
             }
+            draw_glyph(cursor_x, y, rows, 16, 24, size, color);
         }
         
         cursor_x += 16 * size;
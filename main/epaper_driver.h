@@ -70,15 +70,42 @@ void epd_set_rotation(epd_rotation_t rotation);
 void epd_display(const uint8_t *buffer, epd_update_mode_t mode);
 
 /**
- * @brief Display grayscale image (4-level)
- * @param buffer 2 bits per pixel data
+ * @brief Display grayscale image (4-level waveform from register LUTs)
+ *
+ * Without EPD_GRAY_EXPERIMENTAL the frame is shown in mono instead: the
+ * two lighter levels white, the two darker black. The framebuffer then
+ * holds that mono frame.
+ * @param buffer Packed gray pixels, MSB first, higher values lighter
+ * @param bpp Bits per pixel of buffer: 2, or 4 (shown at the nearest of
+ *            the four levels). 1 falls back to epd_display.
  */
-void epd_display_grayscale(const uint8_t *buffer);
+void epd_display_grayscale(const uint8_t *buffer, int bpp);
+
+/**
+ * @brief Copy 1bpp overlay ink onto a gray frame
+ *
+ * The overlay is drawn twice, once over a white and once over a black
+ * framebuffer; pixels that are black in the first become black, pixels
+ * that are white in the second become white, the rest keep the image.
+ * @param gray Gray frame (EPD_WIDTH*EPD_HEIGHT*bpp/8 bytes), modified in place
+ * @param bpp 2 or 4
+ * @param on_white Overlay drawn on a white framebuffer
+ * @param on_black Overlay drawn on a black framebuffer
+ */
+void epd_merge_overlay_gray(uint8_t *gray, int bpp, const uint8_t *on_white,
+                            const uint8_t *on_black);
 
 /**
  * @brief Update a partial region
- * @param buffer Image data for region
- * @param x X position
+ *
+ * buffer holds only the region: 1bpp rows of (w + 7) / 8 bytes, pixel x
+ * at bit 7 of its first byte. The panel window must start and end on a
+ * byte, so it is widened to [x & ~7, (x + w + 7) & ~7); the pixels of the
+ * widened margin are taken from the framebuffer (which should hold what
+ * the panel shows), the region's pixels from buffer. The window is
+ * clipped to the panel. The framebuffer itself is not changed.
+ * @param buffer Region pixels, 1 = white
+ * @param x X position, any pixel
  * @param y Y position
  * @param w Width
  * @param h Height
@@ -139,6 +166,9 @@ void epd_draw_rect(int x, int y, int w, int h, uint8_t color);
 
 /**
  * @brief Fill a rectangle
+ *
+ * Clipped once, then filled a row span at a time: masked end bytes and a
+ * memset between them. Lines and rectangle outlines are thin fills.
  */
 void epd_fill_rect(int x, int y, int w, int h, uint8_t color);
 
@@ -3,6 +3,17 @@
  */
 
 #include "image_processor.h"
+#include "img_arena.h"
+#include "img_binfile.h"
+#include "img_bmp.h"
+#include "img_dither.h"
+#include "img_exif.h"
+#include "img_jpeg_enc.h"
+#include "img_jpeg_prog.h"
+#include "img_kernels.h"
+#include "img_png.h"
+#include "img_resample.h"
+#include "img_tone.h"
 #include "board_config.h"
 #include "storage_manager.h"
 
@@ -11,6 +22,8 @@
 #include <stdio.h>
 #include <assert.h>
 #include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "esp_log.h"
 #include "esp_heap_caps.h"
 #include "tjpgd.h"
@@ -18,41 +31,20 @@
 // #define STBI_NO_STDIO  <-- REMOVED THIS LINE
 #define STBI_ONLY_JPEG
 #define STBI_ONLY_PNG
-#define STBI_MALLOC(sz) heap_caps_malloc((sz), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
-#define STBI_REALLOC(p, sz) heap_caps_realloc((p), (sz), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
-#define STBI_FREE(p) free(p)
+#define STBI_MALLOC(sz) img_arena_alloc(sz)
+#define STBI_REALLOC(p, sz) img_arena_realloc((p), (sz))
+#define STBI_FREE(p) img_arena_free(p)
 #define STBI_ASSERT(x) assert(x)
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 static const char *TAG = "img_proc";
 
-// BMP header structures
-#pragma pack(push, 1)
-typedef struct
-{
-    uint16_t type;
-    uint32_t size;
-    uint16_t reserved1;
-    uint16_t reserved2;
-    uint32_t offset;
-} bmp_file_header_t;
-
-typedef struct
-{
-    uint32_t size;
-    int32_t width;
-    int32_t height;
-    uint16_t planes;
-    uint16_t bit_count;
-    uint32_t compression;
-    uint32_t image_size;
-    int32_t x_ppm;
-    int32_t y_ppm;
-    uint32_t colors_used;
-    uint32_t colors_important;
-} bmp_info_header_t;
-#pragma pack(pop)
+// Upload thumbnails: 1/5 of the panel, gray, framed like the panel image
+#define THUMB_WIDTH  (EPAPER_WIDTH / 5)
+#define THUMB_HEIGHT (EPAPER_HEIGHT / 5)
+#define THUMB_QUALITY 80        // JPEG quality of stored thumbnails
+#define THUMB_MAX_LEGACY 1024   // Largest BMP thumbnail converted to JPEG
 
 void img_get_default_opts(img_process_opts_t *opts)
 {
@@ -63,6 +55,92 @@ void img_get_default_opts(img_process_opts_t *opts)
     opts->threshold = 128;
     opts->invert = false;
     opts->fit_mode = true;
+    opts->streaming = false;
+    opts->serpentine = false;
+    opts->tone_map = true;
+    opts->clahe = false;
+    opts->orient = IMG_ORIENT_NONE;
+}
+
+// FNV-1a step over one parameter value
+static inline uint32_t hash_mix(uint32_t h, uint32_t v)
+{
+    for (int i = 0; i < 4; i++, v >>= 8)
+    {
+        h = (h ^ (v & 0xFF)) * 16777619u;
+    }
+    return h;
+}
+
+uint32_t img_opts_hash(const img_process_opts_t *opts)
+{
+    uint32_t h = 2166136261u;
+    h = hash_mix(h, IMG_PIPELINE_VERSION);
+    h = hash_mix(h, opts->target_width | ((uint32_t)opts->target_height << 16));
+    h = hash_mix(h, opts->format);
+    h = hash_mix(h, opts->dither);
+    h = hash_mix(h, opts->threshold);
+    h = hash_mix(h, opts->invert | (opts->fit_mode << 1) | (opts->streaming << 2) |
+                    (opts->serpentine << 3) | (opts->tone_map << 4) | (opts->clahe << 5));
+    // Only mixed in when set, so frames rendered before the option existed stay valid
+    if (opts->orient != IMG_ORIENT_NONE) {
+        h = hash_mix(h, opts->orient);
+    }
+    // 0 marks frames of unknown origin
+    return h ? h : 1;
+}
+
+void img_get_render_opts(img_process_opts_t *opts, const app_settings_t *settings)
+{
+    img_get_default_opts(opts);
+    opts->fit_mode = settings->fit_mode;
+    // The panel shows 4 gray levels: dither straight to them (older settings
+    // may still ask for 4bpp). Mono only while the gray waveform is unverified.
+    opts->format = (EPD_GRAY_EXPERIMENTAL && settings->display_bpp > 1) ? IMG_FORMAT_2BPP
+                                                                         : IMG_FORMAT_1BPP;
+    opts->orient = (settings->orientation <= IMG_ORIENT_AUTO) ? settings->orientation
+                                                              : IMG_ORIENT_NONE;
+}
+
+int img_format_bpp(img_format_t format)
+{
+    switch (format)
+    {
+    case IMG_FORMAT_2BPP:
+        return 2;
+    case IMG_FORMAT_4BPP:
+        return 4;
+    case IMG_FORMAT_1BPP:
+    default:
+        return 1;
+    }
+}
+
+img_format_t img_format_from_bpp(int bpp)
+{
+    if (bpp == 4)
+        return IMG_FORMAT_4BPP;
+    if (bpp == 2)
+        return IMG_FORMAT_2BPP;
+    return IMG_FORMAT_1BPP;
+}
+
+size_t img_frame_size(img_format_t format, uint16_t width, uint16_t height)
+{
+    return ((size_t)width * height * img_format_bpp(format) + 7) / 8;
+}
+
+bool img_format_from_size(size_t size, img_format_t *format)
+{
+    if (size == EPAPER_BUFFER_SIZE)
+        *format = IMG_FORMAT_1BPP;
+    else if (size == EPAPER_BUFFER_SIZE_2BPP)
+        *format = IMG_FORMAT_2BPP;
+    else if (size == EPAPER_BUFFER_SIZE_4BPP)
+        *format = IMG_FORMAT_4BPP;
+    else
+        return false;
+    return true;
 }
 
 const char *img_detect_format(const uint8_t *data, size_t size)
@@ -88,8 +166,9 @@ const char *img_detect_format(const uint8_t *data, size_t size)
         return "png";
     }
 
-    // Check if it's raw e-ink data
-    if (size == EPAPER_BUFFER_SIZE)
+    // Check if it's raw e-ink data (mono or gray)
+    img_format_t raw_format;
+    if (img_format_from_size(size, &raw_format))
     {
         return "raw";
     }
@@ -97,38 +176,41 @@ const char *img_detect_format(const uint8_t *data, size_t size)
     return "unknown";
 }
 
+// Collects decoded rows into a full image
+typedef struct {
+    uint8_t *pixels;
+    size_t row_bytes;
+} bmp_rows_ctx_t;
+
+static esp_err_t bmp_collect_row(void *ctx, const uint8_t *row, int y)
+{
+    bmp_rows_ctx_t *c = (bmp_rows_ctx_t *)ctx;
+    memcpy(c->pixels + (size_t)y * c->row_bytes, row, c->row_bytes);
+    return ESP_OK;
+}
+
 esp_err_t img_decode_bmp(const uint8_t *input, size_t input_size,
                          uint8_t **output, uint16_t *width, uint16_t *height)
 {
-    if (!input || input_size < sizeof(bmp_file_header_t) + sizeof(bmp_info_header_t))
+    if (!input || !output || !width || !height)
     {
         return ESP_ERR_INVALID_ARG;
     }
 
-    const bmp_file_header_t *file_hdr = (const bmp_file_header_t *)input;
-    const bmp_info_header_t *info_hdr = (const bmp_info_header_t *)(input + sizeof(bmp_file_header_t));
-
-    if (file_hdr->type != 0x4D42)
-    { // "BM"
-        ESP_LOGE(TAG, "Not a BMP file");
-        return ESP_ERR_INVALID_ARG;
+    bmp_dec_t dec;
+    esp_err_t ret = bmp_dec_init(&dec, NULL, input, input_size);
+    if (ret != ESP_OK)
+    {
+        return ret;
     }
-
-    int w = abs(info_hdr->width);
-    int h = abs(info_hdr->height);
-    bool bottom_up = info_hdr->height > 0;
-    int bpp = info_hdr->bit_count;
-
-    ESP_LOGI(TAG, "BMP: %dx%d, %d bpp", w, h, bpp);
-
-    if (bpp != 24 && bpp != 32 && bpp != 8)
+    if (dec.width > UINT16_MAX || dec.height > UINT16_MAX)
     {
-        ESP_LOGE(TAG, "Unsupported BMP format: %d bpp", bpp);
-        return ESP_ERR_NOT_SUPPORTED;
+        bmp_dec_deinit(&dec);
+        return ESP_ERR_INVALID_SIZE;
     }
 
     // Allocate output RGB buffer
-    size_t out_size = w * h * 3;
+    size_t out_size = (size_t)dec.width * dec.height * 3;
     *output = heap_caps_malloc(out_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
     if (!*output)
     {
@@ -136,382 +218,199 @@ esp_err_t img_decode_bmp(const uint8_t *input, size_t input_size,
     }
     if (!*output)
     {
-        ESP_LOGE(TAG, "Cannot allocate %d bytes for decoded image", out_size);
+        ESP_LOGE(TAG, "Cannot allocate %zu bytes for decoded image", out_size);
+        bmp_dec_deinit(&dec);
         return ESP_ERR_NO_MEM;
     }
 
-    const uint8_t *pixel_data = input + file_hdr->offset;
-    int row_stride = ((w * bpp + 31) / 32) * 4; // Rows are 4-byte aligned
-
-    for (int y = 0; y < h; y++)
+    bmp_rows_ctx_t ctx = {.pixels = *output, .row_bytes = (size_t)dec.width * 3};
+    ret = bmp_dec_decode(&dec, 3, bmp_collect_row, &ctx);
+    bmp_dec_deinit(&dec);
+    if (ret != ESP_OK)
     {
-        int src_y = bottom_up ? (h - 1 - y) : y;
-        const uint8_t *row = pixel_data + src_y * row_stride;
-        uint8_t *dst = *output + y * w * 3;
-
-        for (int x = 0; x < w; x++)
-        {
-            if (bpp == 24)
-            {
-                dst[x * 3 + 0] = row[x * 3 + 2]; // R (BMP is BGR)
-                dst[x * 3 + 1] = row[x * 3 + 1]; // G
-                dst[x * 3 + 2] = row[x * 3 + 0]; // B
-            }
-            else if (bpp == 32)
-            {
-                dst[x * 3 + 0] = row[x * 4 + 2];
-                dst[x * 3 + 1] = row[x * 4 + 1];
-                dst[x * 3 + 2] = row[x * 4 + 0];
-            }
-            else if (bpp == 8)
-            {
-                // Grayscale or palette - treat as grayscale
-                uint8_t gray = row[x];
-                dst[x * 3 + 0] = gray;
-                dst[x * 3 + 1] = gray;
-                dst[x * 3 + 2] = gray;
-            }
-        }
+        free(*output);
+        *output = NULL;
+        return ret;
     }
 
-    *width = w;
-    *height = h;
+    *width = dec.width;
+    *height = dec.height;
     return ESP_OK;
 }
 
-void img_scale(const uint8_t *input, uint16_t in_w, uint16_t in_h,
-               uint8_t *output, uint16_t out_w, uint16_t out_h, bool fit)
+// Shared body of img_scale / img_scale_gray
+static void scale_channels(const uint8_t *input, uint16_t in_w, uint16_t in_h,
+                           uint8_t *output, uint16_t out_w, uint16_t out_h,
+                           bool fit, int channels, uint32_t *hist)
 {
-    // Calculate scale
-    float scale_x = (float)out_w / in_w;
-    float scale_y = (float)out_h / in_h;
-    float scale;
-    
-    if (fit) {
-        scale = (scale_x < scale_y) ? scale_x : scale_y; // Use smaller scale to fit
-    } else {
-        scale = (scale_x > scale_y) ? scale_x : scale_y; // Use larger scale to cover
-    }
-
-    // Calculate source window size in input coordinates
-    float src_w = out_w / scale;
-    float src_h = out_h / scale;
-
-    // Center the source window
-    float src_x_offset = (in_w - src_w) / 2.0f;
-    float src_y_offset = (in_h - src_h) / 2.0f;
-
-    for (int y = 0; y < out_h; y++)
-    {
-        for (int x = 0; x < out_w; x++)
-        {
-            // Map output coordinate to source coordinate
-            float src_x = src_x_offset + (x / scale);
-            float src_y = src_y_offset + (y / scale);
-
-            int sx = (int)src_x;
-            int sy = (int)src_y;
-
-            // Check bounds
-            if (sx < 0 || sx >= in_w || sy < 0 || sy >= in_h) {
-                // Fill with white (background)
-                int dst_idx = (y * out_w + x) * 3;
-                output[dst_idx + 0] = 255;
-                output[dst_idx + 1] = 255;
-                output[dst_idx + 2] = 255;
-            } else {
-                int src_idx = (sy * in_w + sx) * 3;
-                int dst_idx = (y * out_w + x) * 3;
-
-                output[dst_idx + 0] = input[src_idx + 0];
-                output[dst_idx + 1] = input[src_idx + 1];
-                output[dst_idx + 2] = input[src_idx + 2];
-            }
-        }
-    }
-}
+    img_resample_cfg_t cfg = {
+        .in_w = in_w,
+        .in_h = in_h,
+        .out_w = out_w,
+        .out_h = out_h,
+        .channels = channels,
+        .fit = fit,
+        .upscale = IMG_FILTER_BICUBIC,
+        .hist = hist,
+    };
 
-// Floyd-Steinberg dithering
-static void dither_floyd_steinberg(int16_t *gray, int w, int h)
-{
-    for (int y = 0; y < h; y++)
-    {
-        for (int x = 0; x < w; x++)
-        {
-            int idx = y * w + x;
-            int old_val = gray[idx];
-            int new_val = (old_val < 128) ? 0 : 255;
-            gray[idx] = new_val;
-            int error = old_val - new_val;
-
-            if (x + 1 < w)
-                gray[idx + 1] += error * 7 / 16;
-            if (y + 1 < h)
-            {
-                if (x > 0)
-                {
-                    gray[idx + w - 1] += error * 3 / 16;
-                }
-                gray[idx + w] += error * 5 / 16;
-                if (x + 1 < w)
-                    gray[idx + w + 1] += error * 1 / 16;
-            }
+    esp_err_t ret = img_resample_buffer(&cfg, input, output);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Scale %dx%d -> %dx%d failed: %s", in_w, in_h, out_w, out_h,
+                 esp_err_to_name(ret));
+        memset(output, 255, (size_t)out_w * out_h * channels); // White background
+        if (hist) {
+            memset(hist, 0, 256 * sizeof(uint32_t));
         }
     }
 }
 
-// Atkinson dithering (better for e-ink)
-static void dither_atkinson(int16_t *gray, int w, int h)
+void img_scale(const uint8_t *input, uint16_t in_w, uint16_t in_h,
+               uint8_t *output, uint16_t out_w, uint16_t out_h, bool fit)
 {
-    for (int y = 0; y < h; y++)
-    {
-        for (int x = 0; x < w; x++)
-        {
-            int idx = y * w + x;
-            int old_val = gray[idx];
-            int new_val = (old_val < 128) ? 0 : 255;
-            gray[idx] = new_val;
-            int error = (old_val - new_val) / 8;
-
-            if (x + 1 < w)
-                gray[idx + 1] += error;
-            if (x + 2 < w)
-                gray[idx + 2] += error;
-            if (y + 1 < h)
-            {
-                if (x > 0)
-                {
-                    gray[idx + w - 1] += error;
-                }
-                gray[idx + w] += error;
-                if (x + 1 < w)
-                    gray[idx + w + 1] += error;
-            }
-            if (y + 2 < h)
-                gray[idx + w * 2] += error;
-        }
-    }
+    scale_channels(input, in_w, in_h, output, out_w, out_h, fit, 3, NULL);
 }
 
 void img_scale_gray(const uint8_t *input, uint16_t in_w, uint16_t in_h,
                     uint8_t *output, uint16_t out_w, uint16_t out_h, bool fit)
 {
-    // Calculate scale
-    float scale_x = (float)out_w / in_w;
-    float scale_y = (float)out_h / in_h;
-    float scale;
-    
-    if (fit) {
-        scale = (scale_x < scale_y) ? scale_x : scale_y;
-    } else {
-        scale = (scale_x > scale_y) ? scale_x : scale_y;
-    }
-
-    float src_w = out_w / scale;
-    float src_h = out_h / scale;
-
-    float src_x_offset = (in_w - src_w) / 2.0f;
-    float src_y_offset = (in_h - src_h) / 2.0f;
-
-    for (int y = 0; y < out_h; y++)
-    {
-        for (int x = 0; x < out_w; x++)
-        {
-            float src_x = src_x_offset + (x / scale);
-            float src_y = src_y_offset + (y / scale);
-
-            int sx = (int)src_x;
-            int sy = (int)src_y;
-
-            int dst_idx = y * out_w + x;
-
-            if (sx < 0 || sx >= in_w || sy < 0 || sy >= in_h) {
-                output[dst_idx] = 255; // White background
-            } else {
-                int src_idx = sy * in_w + sx;
-                output[dst_idx] = input[src_idx];
-            }
-        }
-    }
+    scale_channels(input, in_w, in_h, output, out_w, out_h, fit, 1, NULL);
 }
 
-void img_gray_to_1bpp(const uint8_t *gray_in, uint16_t width, uint16_t height,
-                      uint8_t *output, const img_process_opts_t *opts)
+static void log_dither(const img_process_opts_t *opts)
 {
-    size_t pixels = width * height;
-    int16_t *gray = malloc(pixels * sizeof(int16_t));
-    if (!gray)
-    {
-        ESP_LOGE(TAG, "Cannot allocate grayscale buffer");
-        return;
-    }
-
-    // First pass: find min/max for contrast stretching
-    int min_val = 255, max_val = 0;
-    for (size_t i = 0; i < pixels; i++)
-    {
-        int val = gray_in[i];
-        if (val < min_val) min_val = val;
-        if (val > max_val) max_val = val;
-    }
-
-    ESP_LOGI(TAG, "Grayscale range: %d - %d", min_val, max_val);
-
-    // Copy to int16 buffer with optional contrast stretching
-    int range = max_val - min_val;
-    if (range > 0 && range < 200) {
-        ESP_LOGI(TAG, "Applying contrast enhancement (range=%d)", range);
-        for (size_t i = 0; i < pixels; i++) {
-            int val = ((gray_in[i] - min_val) * 255) / range;
-            gray[i] = (val < 0) ? 0 : (val > 255) ? 255 : val;
-        }
-    } else {
-        for (size_t i = 0; i < pixels; i++) {
-            gray[i] = gray_in[i];
-        }
-    }
-
-    // Apply dithering
-    switch (opts->dither)
-    {
+    switch (opts->dither) {
     case DITHER_FLOYD:
-        ESP_LOGI(TAG, "Applying Floyd-Steinberg dithering");
-        dither_floyd_steinberg(gray, width, height);
+        ESP_LOGI(TAG, "Applying Floyd-Steinberg dithering%s", opts->serpentine ? " (serpentine)" : "");
         break;
     case DITHER_ATKINSON:
-        ESP_LOGI(TAG, "Applying Atkinson dithering");
-        dither_atkinson(gray, width, height);
+        ESP_LOGI(TAG, "Applying Atkinson dithering%s", opts->serpentine ? " (serpentine)" : "");
+        break;
+    case DITHER_ORDERED:
+        ESP_LOGI(TAG, "Applying ordered (Bayer) dithering");
+        break;
+    case DITHER_BLUE_NOISE:
+        ESP_LOGI(TAG, "Applying blue-noise dithering");
         break;
     case DITHER_NONE:
     default:
-        for (size_t i = 0; i < pixels; i++)
-        {
-            gray[i] = (gray[i] < opts->threshold) ? 0 : 255;
-        }
+        ESP_LOGI(TAG, "Applying simple threshold=%d", opts->threshold);
         break;
     }
+}
 
-    // Convert to 1-bit packed format
-    memset(output, 0, (width * height + 7) / 8);
-
-    for (size_t i = 0; i < pixels; i++)
-    {
-        int val = (gray[i] > 127) ? 1 : 0;
-        if (opts->invert)
-            val = 1 - val;
-
-        int byte_idx = i / 8;
-        int bit_idx = 7 - (i % 8);
+// Row source for img_dither_frame (read-only, shared by both workers).
+// The tone LUT is applied as each row is fetched, so it costs no extra pass.
+typedef struct {
+    const uint8_t *pixels;
+    int width;
+    uint8_t lut[256];
+} tone_src_t;
 
-        if (val)
-        {
-            output[byte_idx] |= (1 << bit_idx);
-        }
-    }
+static void gray_row_src(void *ctx, int y, uint8_t *row)
+{
+    const tone_src_t *src = (const tone_src_t *)ctx;
+    img_k_lut(src->lut, src->pixels + (size_t)y * src->width, row, src->width);
+}
 
-    free(gray);
+static void rgb_row_src(void *ctx, int y, uint8_t *row)
+{
+    const tone_src_t *src = (const tone_src_t *)ctx;
+    img_k_luma(src->pixels + (size_t)y * src->width * 3, row, src->width);
+    img_k_lut(src->lut, row, row, src->width);
 }
 
-void img_rgb_to_1bpp(const uint8_t *rgb, uint16_t width, uint16_t height,
-                     uint8_t *output, const img_process_opts_t *opts)
+// Build the tone LUT from a histogram (gathered here if the caller has none)
+static void tone_setup(tone_src_t *src, const uint8_t *pixels, int width, int height,
+                       int channels, const uint32_t *hist, const img_process_opts_t *opts)
 {
-    // Convert to grayscale with extended range for dithering
-    size_t pixels = width * height;
-    int16_t *gray = malloc(pixels * sizeof(int16_t));
-    if (!gray)
-    {
-        ESP_LOGE(TAG, "Cannot allocate grayscale buffer");
-        return;
-    }
+    src->pixels = pixels;
+    src->width = width;
 
-    // First pass: convert to grayscale and find min/max for contrast stretching
-    int min_val = 255, max_val = 0;
-    for (size_t i = 0; i < pixels; i++)
-    {
-        // Luminance formula: 0.299*R + 0.587*G + 0.114*B
-        int r = rgb[i * 3 + 0];
-        int g = rgb[i * 3 + 1];
-        int b = rgb[i * 3 + 2];
-        int val = (r * 77 + g * 150 + b * 29) >> 8;
-        gray[i] = val;
-        if (val < min_val) min_val = val;
-        if (val > max_val) max_val = val;
-    }
-
-    ESP_LOGI(TAG, "Image grayscale range: %d - %d", min_val, max_val);
-
-    // Apply contrast stretching if image has limited dynamic range
-    int range = max_val - min_val;
-    if (range > 0 && range < 200) {
-        ESP_LOGI(TAG, "Applying contrast enhancement (range=%d)", range);
-        for (size_t i = 0; i < pixels; i++) {
-            // Stretch to full 0-255 range
-            int val = ((gray[i] - min_val) * 255) / range;
-            gray[i] = (val < 0) ? 0 : (val > 255) ? 255 : val;
+    if (!opts->tone_map) {
+        for (int v = 0; v < 256; v++) {
+            src->lut[v] = v;
         }
+        return;
     }
 
-    // Apply dithering
-    switch (opts->dither)
-    {
-    case DITHER_FLOYD:
-        ESP_LOGI(TAG, "Applying Floyd-Steinberg dithering");
-        dither_floyd_steinberg(gray, width, height);
-        break;
-    case DITHER_ATKINSON:
-        ESP_LOGI(TAG, "Applying Atkinson dithering (best for e-ink)");
-        dither_atkinson(gray, width, height);
-        break;
-    case DITHER_NONE:
-    default:
-        ESP_LOGI(TAG, "Applying simple threshold=%d", opts->threshold);
-        // Simple threshold
-        for (size_t i = 0; i < pixels; i++)
-        {
-            gray[i] = (gray[i] < opts->threshold) ? 0 : 255;
-        }
-        break;
+    uint32_t local[256];
+    if (!hist) {
+        memset(local, 0, sizeof(local));
+        img_tone_hist_add(local, pixels, width * height, channels);
+        hist = local;
     }
 
-    // Convert to 1-bit packed format
-    memset(output, 0, (width * height + 7) / 8);
-
-    for (size_t i = 0; i < pixels; i++)
-    {
-        int val = (gray[i] > 127) ? 1 : 0;
-        if (opts->invert)
-            val = 1 - val;
+    img_tone_cfg_t cfg;
+    img_tone_default_cfg(&cfg, opts->clahe);
+    img_tone_build_lut(hist, &cfg, src->lut);
+}
 
-        int byte_idx = i / 8;
-        int bit_idx = 7 - (i % 8);
+// Tone map and dither a full frame; hist may be NULL
+static void gray_to_packed(const uint8_t *gray, uint16_t width, uint16_t height,
+                           uint8_t *output, const img_process_opts_t *opts,
+                           const uint32_t *hist)
+{
+    tone_src_t src;
+    tone_setup(&src, gray, width, height, 1, hist, opts);
 
-        if (val)
-        {
-            output[byte_idx] |= (1 << bit_idx);
-        }
+    log_dither(opts);
+    if (img_dither_frame(width, height, opts, gray_row_src, &src, output) != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot allocate dither buffers");
     }
-
-    free(gray);
-    ESP_LOGI(TAG, "RGB to 1BPP conversion complete");
 }
 
-static void free_image_buffer(uint8_t *buf, bool from_stbi)
+static void rgb_to_packed(const uint8_t *rgb, uint16_t width, uint16_t height,
+                          uint8_t *output, const img_process_opts_t *opts,
+                          const uint32_t *hist)
 {
-    if (!buf)
+    tone_src_t src;
+    tone_setup(&src, rgb, width, height, 3, hist, opts);
+
+    log_dither(opts);
+    if (img_dither_frame(width, height, opts, rgb_row_src, &src, output) != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot allocate dither buffers");
         return;
-    if (from_stbi)
-    {
-        stbi_image_free(buf);
-    }
-    else
-    {
-        free(buf);
     }
+
+    ESP_LOGI(TAG, "RGB to %dBPP conversion complete", img_format_bpp(opts->format));
 }
 
-esp_err_t img_process(const uint8_t *input, size_t input_size,
-                      uint8_t *output, size_t output_size,
-                      const img_process_opts_t *opts)
+void img_gray_to_1bpp(const uint8_t *gray_in, uint16_t width, uint16_t height,
+                      uint8_t *output, const img_process_opts_t *opts)
+{
+    gray_to_packed(gray_in, width, height, output, opts, NULL);
+}
+
+void img_rgb_to_1bpp(const uint8_t *rgb, uint16_t width, uint16_t height,
+                     uint8_t *output, const img_process_opts_t *opts)
+{
+    rgb_to_packed(rgb, width, height, output, opts, NULL);
+}
+
+static esp_err_t process_jpeg(FILE *fp, const uint8_t *data, size_t size, int exif,
+                              uint8_t *output, size_t output_size,
+                              const img_process_opts_t *opts,
+                              img_extra_outputs_t *extra);
+static int jpeg_orientation(FILE *fp, const uint8_t *data, size_t size,
+                            const img_process_opts_t *opts);
+static esp_err_t process_png(FILE *fp, const uint8_t *data, size_t size,
+                             uint8_t *output, size_t output_size,
+                             const img_process_opts_t *opts,
+                             img_extra_outputs_t *extra);
+static esp_err_t process_bmp(FILE *fp, const uint8_t *data, size_t size,
+                             uint8_t *output, size_t output_size,
+                             const img_process_opts_t *opts,
+                             img_extra_outputs_t *extra);
+static int render_orient(int exif, int w, int h, const img_process_opts_t *opts);
+static esp_err_t process_gray(const uint8_t *gray, int w, int h, int orient,
+                              uint8_t *output, size_t output_size,
+                              const img_process_opts_t *opts,
+                              img_extra_outputs_t *extra);
+
+static esp_err_t process_buffer(const uint8_t *input, size_t input_size,
+                                uint8_t *output, size_t output_size,
+                                const img_process_opts_t *opts)
 {
     if (!input || !output || !opts)
     {
@@ -519,7 +418,7 @@ esp_err_t img_process(const uint8_t *input, size_t input_size,
     }
 
     const char *format = img_detect_format(input, input_size);
-    ESP_LOGI(TAG, "Processing %s image (%d bytes)", format, input_size);
+    ESP_LOGI(TAG, "Processing %s image (%zu bytes)", format, input_size);
 
     // If already raw e-ink format, just copy
     if (strcmp(format, "raw") == 0 && input_size == output_size)
@@ -528,51 +427,35 @@ esp_err_t img_process(const uint8_t *input, size_t input_size,
         return ESP_OK;
     }
 
-    uint8_t *rgb = NULL;
-    uint16_t width = 0;
-    uint16_t height = 0;
-    bool rgb_from_stbi = false;
+    if (output_size < img_frame_size(opts->format, opts->target_width, opts->target_height))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
     esp_err_t ret = ESP_OK;
+    int exif = IMG_EXIF_ORIENT_NORMAL;
 
     if (strcmp(format, "bmp") == 0)
     {
-        ret = img_decode_bmp(input, input_size, &rgb, &width, &height);
-        if (ret != ESP_OK)
-        {
-            return ret;
-        }
+        return process_bmp(NULL, input, input_size, output, output_size, opts, NULL);
     }
     else if (strcmp(format, "jpg") == 0 || strcmp(format, "png") == 0)
     {
-        int w = 0, h = 0, comp = 0;
-
-        // Check dimensions first
-        if (!stbi_info_from_memory(input, (int)input_size, &w, &h, &comp))
+        // JPEGs and PNGs are decoded row by row (JPEGs with DCT-domain downscaling)
+        if (strcmp(format, "jpg") == 0)
         {
-            ESP_LOGE(TAG, "Failed to parse image info: %s", stbi_failure_reason());
-            return ESP_ERR_INVALID_ARG;
+            exif = jpeg_orientation(NULL, input, input_size, opts);
+            ret = process_jpeg(NULL, input, input_size, exif, output, output_size, opts, NULL);
         }
-
-        ESP_LOGI(TAG, "Image info: %dx%d, %d comp", w, h, comp);
-
-        if (w > 3200 || h > 3200 || (w * h) > 5000000)
+        else
         {
-            ESP_LOGE(TAG, "Image too large to process: %dx%d", w, h);
-            return ESP_ERR_INVALID_SIZE;
+            ret = process_png(NULL, input, input_size, output, output_size, opts, NULL);
         }
-
-        stbi_uc *decoded = stbi_load_from_memory(input, (int)input_size,
-                                                 &w, &h, &comp, 3);
-        if (!decoded)
+        if (ret != ESP_ERR_NOT_SUPPORTED)
         {
-            ESP_LOGE(TAG, "Decode failed for %s: %s", format, stbi_failure_reason());
-            return ESP_ERR_NOT_SUPPORTED;
+            return ret;
         }
-
-        rgb = decoded;
-        width = (uint16_t)w;
-        height = (uint16_t)h;
-        rgb_from_stbi = true;
+        // No streaming decoder handles it: fall back to a full decode
     }
     else
     {
@@ -580,37 +463,49 @@ esp_err_t img_process(const uint8_t *input, size_t input_size,
         return ESP_ERR_NOT_SUPPORTED;
     }
 
-    // Scale if needed
-    uint8_t *scaled = NULL;
-    if (width != opts->target_width || height != opts->target_height)
+    int w = 0, h = 0, comp = 0;
+
+    // Check dimensions first
+    if (!stbi_info_from_memory(input, (int)input_size, &w, &h, &comp))
+    {
+        ESP_LOGE(TAG, "Failed to parse image info: %s", stbi_failure_reason());
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ESP_LOGI(TAG, "Image info: %dx%d, %d comp", w, h, comp);
+
+    if (w > 3200 || h > 3200 || (w * h) > 5000000)
     {
-        size_t scaled_size = opts->target_width * opts->target_height * 3;
-        scaled = heap_caps_malloc(scaled_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-        if (!scaled)
-        {
-            scaled = malloc(scaled_size);
-        }
-        if (!scaled)
-        {
-            free_image_buffer(rgb, rgb_from_stbi);
-            return ESP_ERR_NO_MEM;
-        }
+        ESP_LOGE(TAG, "Image too large to process: %dx%d", w, h);
+        return ESP_ERR_INVALID_SIZE;
+    }
 
-        img_scale(rgb, width, height, scaled, opts->target_width, opts->target_height, opts->fit_mode);
-        free_image_buffer(rgb, rgb_from_stbi);
-        rgb = scaled;
-        rgb_from_stbi = false;
-        width = opts->target_width;
-        height = opts->target_height;
+    stbi_uc *gray = stbi_load_from_memory(input, (int)input_size, &w, &h, &comp, 1);
+    if (!gray)
+    {
+        ESP_LOGE(TAG, "Decode failed for %s: %s", format, stbi_failure_reason());
+        return ESP_ERR_NOT_SUPPORTED;
     }
 
-    // Convert to 1-bit
-    img_rgb_to_1bpp(rgb, width, height, output, opts);
+    ret = process_gray(gray, w, h, render_orient(exif, w, h, opts), output, output_size,
+                       opts, NULL);
+    stbi_image_free(gray);
 
-    free_image_buffer(rgb, rgb_from_stbi);
+    if (ret == ESP_OK)
+    {
+        ESP_LOGI(TAG, "Image processed successfully");
+    }
+    return ret;
+}
 
-    ESP_LOGI(TAG, "Image processed successfully");
-    return ESP_OK;
+esp_err_t img_process(const uint8_t *input, size_t input_size,
+                      uint8_t *output, size_t output_size,
+                      const img_process_opts_t *opts)
+{
+    img_arena_begin();
+    esp_err_t ret = process_buffer(input, input_size, output, output_size, opts);
+    img_arena_end();
+    return ret;
 }
 
 // Combined context for tjpgd input and output
@@ -622,9 +517,16 @@ typedef struct {
     size_t index;
     
     // Output fields
-    uint8_t *output;
     int width;
     int height;
+
+    // Band output fields (streaming mode)
+    uint8_t *band;          // One MCU row of decoded pixels
+    int band_top;           // Image row of band[0]
+    int band_rows;          // Valid rows in band
+    img_row_cb_t row_cb;
+    void *row_ctx;
+    esp_err_t row_err;
 } tjpgd_ctx_t;
 
 // Input callback
@@ -658,380 +560,1169 @@ static size_t tjpgd_input_func(JDEC *jd, uint8_t *buff, size_t ndata) {
     }
 }
 
-// Output callback
-static int tjpgd_output_func(JDEC *jd, void *bitmap, JRECT *rect) {
+// Pass the buffered MCU row on to the row callback
+static esp_err_t tjpgd_flush_band(tjpgd_ctx_t *ctx) {
+    for (int y = 0; y < ctx->band_rows && ctx->row_err == ESP_OK; y++) {
+        ctx->row_err = ctx->row_cb(ctx->row_ctx, ctx->band + y * ctx->width, ctx->band_top + y);
+    }
+    ctx->band_rows = 0;
+    return ctx->row_err;
+}
+
+// Band output callback: collects one MCU row, then streams it out row by row
+static int tjpgd_band_output_func(JDEC *jd, void *bitmap, JRECT *rect) {
     tjpgd_ctx_t *ctx = (tjpgd_ctx_t *)jd->device;
     uint8_t *src = (uint8_t *)bitmap;
-    
-    // Copy block to output buffer
-    // JD_FORMAT=2 means 1 byte per pixel (grayscale)
-    // TJpgDec outputs blocks (usually 8x8 or 16x16)
-    // We need to copy row by row
-    
-    int w = rect->right - rect->left + 1;
-    int h = rect->bottom - rect->top + 1;
-    
-    for (int y = 0; y < h; y++) {
-        // Calculate destination index in the full image buffer
-        // rect->top + y is the current row in the full image
-        // rect->left is the starting column
-        int dst_row = rect->top + y;
-        
-        // Safety check
-        if (dst_row >= ctx->height) continue;
-        
-        int dst_idx = dst_row * ctx->width + rect->left;
-        
-        // Copy one row of the block
-        // Ensure we don't write past the width
-        int copy_w = w;
-        if (rect->left + copy_w > ctx->width) {
-            copy_w = ctx->width - rect->left;
-        }
-        
-        if (copy_w > 0) {
-            // src is the block buffer, it has width 'w'
-            // We copy 'copy_w' bytes from src to ctx->output
-            memcpy(ctx->output + dst_idx, src + y * w, copy_w);
+
+    // MCUs arrive left to right; a new top means the previous MCU row is complete
+    if (rect->top != ctx->band_top) {
+        if (tjpgd_flush_band(ctx) != ESP_OK) {
+            return 0; // Abort decoding
         }
+        ctx->band_top = rect->top;
     }
-    
-    return 1; // Continue
-}
 
-esp_err_t img_process_file(const char *filename,
-                           uint8_t *output, size_t output_size,
-                           const img_process_opts_t *opts)
-{
-    if (!filename || !output || !opts)
-    {
-        return ESP_ERR_INVALID_ARG;
+    int w = rect->right - rect->left + 1;
+    int h = rect->bottom - rect->top + 1;
+
+    int copy_w = w;
+    if (rect->left + copy_w > ctx->width) {
+        copy_w = ctx->width - rect->left;
     }
 
-    // Check extension
-    const char *ext = strrchr(filename, '.');
-    if (!ext)
-        return ESP_ERR_NOT_SUPPORTED;
+    for (int y = 0; y < h && copy_w > 0; y++) {
+        memcpy(ctx->band + y * ctx->width + rect->left, src + y * w, copy_w);
+    }
 
-    // If raw/bin, we can just read directly
-    if (strcasecmp(ext, ".raw") == 0 || strcasecmp(ext, ".bin") == 0)
-    {
-        FILE *f = fopen(filename, "rb");
-        if (!f)
-            return ESP_ERR_NOT_FOUND;
-        size_t read = fread(output, 1, output_size, f);
-        fclose(f);
-        return (read == output_size) ? ESP_OK : ESP_ERR_INVALID_SIZE;
+    if (h > ctx->band_rows) {
+        ctx->band_rows = h;
     }
 
-    // For images, use STBI to load from file directly (saves memory)
-    int w = 0, h = 0, comp = 0;
+    return 1; // Continue
+}
 
-    // Check dimensions first
-    if (!stbi_info(filename, &w, &h, &comp))
-    {
-        ESP_LOGE(TAG, "Failed to parse image info: %s", stbi_failure_reason());
-        return ESP_ERR_INVALID_ARG;
+// Scaled row pipeline: source rows -> scaler -> ditherer -> packed output.
+// In buffered mode the scaled rows are kept instead, so the tone curve can be
+// built from the whole frame before it is dithered. Source rows also fan out
+// to the extra outputs (thumbnail scaler, histogram), if any. A turned image
+// is scaled in its stored orientation and its rows are turned on their way
+// into the frame and the thumbnail, so it is always buffered.
+typedef struct {
+    img_resampler_t rs;
+    img_dither_t dither;
+    uint8_t *output;
+    uint8_t *frame;             // Scaled gray frame (buffered mode only)
+    img_orienter_t frame_or;    // Writes scaled rows into frame, turned
+    uint32_t hist[256];         // Histogram of the scaled frame (buffered mode only)
+    const img_process_opts_t *opts;
+    int src_w;
+    int orient;                 // EXIF orientation 1-8 the image is turned by
+    img_extra_outputs_t *extra;
+    img_resampler_t thumb_rs;   // Thumbnail scaler (extra->thumb only)
+    img_orienter_t thumb_or;
+} img_stream_t;
+
+static esp_err_t stream_scaled_row(void *ctx, const uint8_t *row, int y) {
+    img_stream_t *st = (img_stream_t *)ctx;
+    if (st->frame) {
+        img_orienter_row(&st->frame_or, row, y);
+    } else {
+        img_dither_row(&st->dither, row, st->output);
     }
+    return ESP_OK;
+}
 
-    ESP_LOGI(TAG, "File Image info: %dx%d, %d comp", w, h, comp);
+static esp_err_t stream_thumb_row(void *ctx, const uint8_t *row, int y) {
+    img_stream_t *st = (img_stream_t *)ctx;
+    img_orienter_row(&st->thumb_or, row, y);
+    return ESP_OK;
+}
 
-    // Check if it's a JPEG and large
-    bool use_tjpgd = false;
-    if (strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0) {
-        size_t required_mem = w * h * 1;
-        size_t free_mem = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
-        if (required_mem + 512000 > free_mem) {
-            use_tjpgd = true;
+static esp_err_t stream_source_row(void *ctx, const uint8_t *row, int y) {
+    (void)y;
+    img_stream_t *st = (img_stream_t *)ctx;
+    esp_err_t ret = st->output ? img_resampler_push(&st->rs, row) : ESP_OK;
+    if (ret == ESP_OK && st->extra) {
+        if (st->extra->hist) {
+            img_tone_hist_add(st->extra->hist, row, st->src_w, 1);
+        }
+        if (st->extra->thumb) {
+            ret = img_resampler_push(&st->thumb_rs, row);
         }
     }
+    return ret;
+}
 
-    if (use_tjpgd) {
-        ESP_LOGI(TAG, "Using TJpgDec for large JPEG");
-        
-        // Determine scale factor
-        uint8_t scale = 0;
-        int sw = w, sh = h;
-        while (scale < 3) {
-            if ((sw >> 1) < opts->target_width && (sh >> 1) < opts->target_height) {
-                break;
-            }
-            sw >>= 1;
-            sh >>= 1;
-            scale++;
+// Orientation an image of w x h stored pixels is rendered with under the
+// policy: its EXIF tag, then a quarter turn if it still disagrees with the
+// frame on portrait vs landscape
+static int render_orient(int exif, int w, int h, const img_process_opts_t *opts) {
+    if (opts->orient == IMG_ORIENT_NONE) {
+        return IMG_EXIF_ORIENT_NORMAL;
+    }
+    int orient = exif;
+    if (opts->orient == IMG_ORIENT_AUTO) {
+        bool swapped = img_exif_orient_swaps(orient);
+        int dw = swapped ? h : w, dh = swapped ? w : h;
+        bool frame_portrait = opts->target_height > opts->target_width;
+        if (dw != dh && (dh > dw) != frame_portrait &&
+            opts->target_width != opts->target_height) {
+            orient = img_exif_orient_then(orient, IMG_EXIF_ORIENT_CW90);
         }
-        
-        ESP_LOGI(TAG, "Scaling by 1/%d -> %dx%d", 1 << scale, sw, sh);
-        
-        // Allocate buffer for scaled image
-        size_t buf_size = sw * sh;
-        uint8_t *gray = heap_caps_malloc(buf_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-        if (!gray) {
-            ESP_LOGE(TAG, "Failed to allocate %d bytes for scaled image", buf_size);
+    }
+    if (orient != IMG_EXIF_ORIENT_NORMAL) {
+        ESP_LOGI(TAG, "Orientation %d (EXIF %d)", orient, exif);
+    }
+    return orient;
+}
+
+// Scaler geometry of the frame and of the thumbnail (same fit/fill), in the
+// stored orientation: the axes of the target swap if the image is transposed
+static img_resample_cfg_t frame_cfg(int src_w, int src_h, const img_process_opts_t *opts,
+                                    int orient) {
+    bool swap = img_exif_orient_swaps(orient);
+    img_resample_cfg_t cfg = {
+        .in_w = src_w,
+        .in_h = src_h,
+        .out_w = swap ? opts->target_height : opts->target_width,
+        .out_h = swap ? opts->target_width : opts->target_height,
+        .channels = 1,
+        .fit = opts->fit_mode,
+        .upscale = IMG_FILTER_BICUBIC,
+        .hist = NULL,
+    };
+    return cfg;
+}
+
+static img_resample_cfg_t thumb_cfg(int src_w, int src_h, const img_extra_outputs_t *extra,
+                                    const img_process_opts_t *opts, int orient) {
+    img_resample_cfg_t cfg = frame_cfg(src_w, src_h, opts, orient);
+    bool swap = img_exif_orient_swaps(orient);
+    cfg.out_w = swap ? extra->thumb_h : extra->thumb_w;
+    cfg.out_h = swap ? extra->thumb_w : extra->thumb_h;
+    return cfg;
+}
+
+// Thumbnail scaler for the extra outputs
+static esp_err_t thumb_init(img_stream_t *st, int src_w, int src_h,
+                            img_extra_outputs_t *extra, const img_process_opts_t *opts) {
+    esp_err_t ret = img_orienter_init(&st->thumb_or, st->orient, extra->thumb,
+                                      extra->thumb_w, extra->thumb_h);
+    if (ret == ESP_OK) {
+        img_resample_cfg_t cfg = thumb_cfg(src_w, src_h, extra, opts, st->orient);
+        ret = img_resampler_init(&st->thumb_rs, &cfg, stream_thumb_row, st);
+    }
+    if (ret != ESP_OK) {
+        img_orienter_finish(&st->thumb_or);
+    }
+    return ret;
+}
+
+// Frame part of the pipeline: scaler into the gray frame or the ditherer
+static esp_err_t frame_begin(img_stream_t *st, int src_w, int src_h,
+                             uint8_t *output, size_t output_size,
+                             const img_process_opts_t *opts) {
+    if (output_size < img_frame_size(opts->format, opts->target_width, opts->target_height)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    st->output = output;
+
+    if (!opts->streaming || st->orient != IMG_EXIF_ORIENT_NORMAL) {
+        size_t frame_size = (size_t)opts->target_width * opts->target_height;
+        st->frame = img_arena_alloc(frame_size);
+        if (!st->frame) {
             return ESP_ERR_NO_MEM;
         }
-        
-        // Prepare tjpgd
-        JDEC jd;
-        char *work = malloc(TJPGD_WORKSPACE_SIZE);
-        if (!work) {
-            free(gray);
-            return ESP_ERR_NO_MEM;
+        esp_err_t ret = img_orienter_init(&st->frame_or, st->orient, st->frame,
+                                          opts->target_width, opts->target_height);
+        if (ret != ESP_OK) {
+            img_arena_free(st->frame);
+            return ret;
         }
-        
-        tjpgd_ctx_t ctx = {0};
-        ctx.fp = fopen(filename, "rb");
-        if (!ctx.fp) {
-            free(gray);
-            free(work);
-            return ESP_ERR_NOT_FOUND;
+    }
+
+    img_resample_cfg_t cfg = frame_cfg(src_w, src_h, opts, st->orient);
+    cfg.hist = st->frame ? st->hist : NULL;
+    esp_err_t ret = img_resampler_init(&st->rs, &cfg, stream_scaled_row, st);
+    if (ret != ESP_OK) {
+        img_orienter_finish(&st->frame_or);
+        img_arena_free(st->frame);
+        return ret;
+    }
+
+    if (!st->frame) {
+        ret = img_dither_init(&st->dither, opts->target_width, opts->target_height, opts);
+        if (ret != ESP_OK) {
+            img_resampler_deinit(&st->rs);
+            return ret;
         }
-        ctx.output = gray;
-        ctx.width = sw;
-        ctx.height = sh;
-        
-        JRESULT res = jd_prepare(&jd, tjpgd_input_func, work, TJPGD_WORKSPACE_SIZE, &ctx);
-        if (res == JDR_OK) {
-            res = jd_decomp(&jd, tjpgd_output_func, scale);
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t frame_end(img_stream_t *st, esp_err_t status) {
+    if (status == ESP_OK) {
+        status = img_resampler_finish(&st->rs);
+    }
+    img_resampler_deinit(&st->rs);
+    if (st->frame) {
+        img_orienter_finish(&st->frame_or);
+        if (status == ESP_OK) {
+            // A streamed image buffered only to be turned keeps the streamed look
+            img_process_opts_t opts = *st->opts;
+            opts.tone_map = opts.tone_map && !opts.streaming;
+            gray_to_packed(st->frame, opts.target_width, opts.target_height,
+                           st->output, &opts, st->hist);
         }
-        
-        fclose(ctx.fp);
-        free(work);
-        
-        if (res != JDR_OK) {
-            ESP_LOGE(TAG, "TJpgDec failed: %d", res);
-            free(gray);
-            return ESP_FAIL;
+        img_arena_free(st->frame);
+    } else {
+        img_dither_deinit(&st->dither);
+    }
+    return status;
+}
+
+// A NULL output runs the extra outputs only
+static esp_err_t stream_begin(img_stream_t *st, int src_w, int src_h, int orient,
+                              uint8_t *output, size_t output_size,
+                              const img_process_opts_t *opts,
+                              img_extra_outputs_t *extra) {
+    memset(st, 0, sizeof(*st));
+    st->opts = opts;
+    st->src_w = src_w;
+    st->orient = orient;
+
+    esp_err_t ret = output ? frame_begin(st, src_w, src_h, output, output_size, opts) : ESP_OK;
+    if (ret == ESP_OK && extra && extra->thumb) {
+        ret = thumb_init(st, src_w, src_h, extra, opts);
+        if (ret != ESP_OK && output) {
+            frame_end(st, ret);
+        }
+    }
+    if (ret == ESP_OK && extra) {
+        if (extra->hist) {
+            memset(extra->hist, 0, 256 * sizeof(uint32_t));
+        }
+        st->extra = extra;
+    }
+    return ret;
+}
+
+static esp_err_t stream_end(img_stream_t *st, esp_err_t status) {
+    if (st->extra && st->extra->thumb) {
+        if (status == ESP_OK) {
+            status = img_resampler_finish(&st->thumb_rs);
+        }
+        img_resampler_deinit(&st->thumb_rs);
+        img_orienter_finish(&st->thumb_or);
+    }
+    if (st->output) {
+        status = frame_end(st, status);
+    }
+    return status;
+}
+
+static const char *stream_mode(const uint8_t *output, const img_process_opts_t *opts) {
+    return !output ? "extra outputs only" : opts->streaming ? "streamed" : "buffered";
+}
+
+// Largest power-of-two reduction (0-3) that still leaves at least one source
+// pixel per output pixel on the axis the resampler scales by, so the box
+// filter only has to finish a reduction the decoder has mostly done already
+// (DCT scale for JPEGs, Adam7 pass subset for interlaced PNGs)
+static uint8_t decode_scale(int w, int h, const img_process_opts_t *opts, int orient) {
+    bool swap = img_exif_orient_swaps(orient);
+    int out_w = swap ? opts->target_height : opts->target_width;
+    int out_h = swap ? opts->target_width : opts->target_height;
+    bool use_x = (int64_t)out_w * h < (int64_t)out_h * w;
+    if (!opts->fit_mode) use_x = !use_x;
+
+    uint8_t scale = 0;
+    while (scale < 3) {
+        if (use_x ? (w >> (scale + 1)) < out_w : (h >> (scale + 1)) < out_h) {
+            break;
+        }
+        scale++;
+    }
+    return scale;
+}
+
+// ---- Memory planning ----
+//
+// Each decoder reports what it would allocate at a scale once its headers
+// are read; the pipeline behind it (scaler, gray frame or row ditherer,
+// thumbnail scaler) is added and the first plan that fits is used:
+//   1. natural scale, buffered frame (dual-core dither, whole-frame tone curve)
+//   2. natural scale, rows dithered as they arrive (no frame buffer)
+//   3. the same at each coarser scale the decoder offers
+// A plan fits when its peak fits in the job arena's room plus the largest
+// free PSRAM block and its biggest buffer fits in one of the two.
+
+#define PLAN_HEADROOM (64 * 1024)   // PSRAM left to the rest of the system
+
+// Decoder cost at one scale
+typedef struct {
+    int w;                      // Rows the decoder emits
+    int h;
+    size_t mem;                 // Bytes it allocates
+} decode_cost_t;
+
+// Cost of a scale; false if the decoder cannot decode at it
+typedef bool (*decode_cost_fn)(const void *dec, int scale, decode_cost_t *cost);
+
+typedef struct {
+    int scale;
+    bool streamed;
+    size_t peak;
+} decode_plan_t;
+
+// Memory available to the job: total, and for one buffer
+static size_t plan_budget(size_t *single) {
+    size_t room = img_arena_room();
+    size_t block = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    block = block > PLAN_HEADROOM ? block - PLAN_HEADROOM : 0;
+    *single = room > block ? room : block;
+    return room + block;
+}
+
+// Bytes the pipeline behind the decoder allocates; *largest gets its biggest buffer
+static size_t pipeline_mem(int w, int h, bool frame, bool streamed, int orient,
+                           const img_process_opts_t *opts, const img_extra_outputs_t *extra,
+                           size_t *largest) {
+    size_t mem = 0;
+    *largest = 0;
+    if (frame) {
+        img_resample_cfg_t cfg = frame_cfg(w, h, opts, orient);
+        mem += img_resampler_mem(&cfg) + img_dither_mem(opts->target_width, opts);
+        if (!streamed || orient != IMG_EXIF_ORIENT_NORMAL) {
+            *largest = (size_t)opts->target_width * opts->target_height;
+            mem += *largest + img_orienter_mem(orient, opts->target_height);
         }
-        
-        // Now scale to final size
-        uint8_t *final_gray = NULL;
-        if (sw != opts->target_width || sh != opts->target_height) {
-            final_gray = heap_caps_malloc(opts->target_width * opts->target_height, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-            if (!final_gray) {
-                free(gray);
-                return ESP_ERR_NO_MEM;
+    }
+    if (extra && extra->thumb) {
+        img_resample_cfg_t cfg = thumb_cfg(w, h, extra, opts, orient);
+        mem += img_resampler_mem(&cfg) + img_orienter_mem(orient, extra->thumb_h);
+    }
+    return mem;
+}
+
+static esp_err_t plan_decode(decode_plan_t *plan, const char *what,
+                             decode_cost_fn cost_fn, const void *dec, int scale, int orient,
+                             bool frame, const img_process_opts_t *opts,
+                             const img_extra_outputs_t *extra) {
+    size_t single;
+    size_t budget = plan_budget(&single);
+    // A turned image is buffered either way
+    int modes = (frame && !opts->streaming && orient == IMG_EXIF_ORIENT_NORMAL) ? 2 : 1;
+    size_t least = SIZE_MAX;
+    bool first = true;
+
+    for (int s = scale; s <= 3; s++) {
+        decode_cost_t cost;
+        if (!cost_fn(dec, s, &cost)) {
+            continue;
+        }
+        for (int m = 0; m < modes; m++) {
+            bool streamed = opts->streaming || m == 1;
+            size_t largest;
+            size_t peak = cost.mem + pipeline_mem(cost.w, cost.h, frame, streamed, orient,
+                                                  opts, extra, &largest);
+            if (cost.mem > largest) {
+                largest = cost.mem;
             }
-            img_scale_gray(gray, sw, sh, final_gray, opts->target_width, opts->target_height, opts->fit_mode);
-            free(gray);
-            gray = final_gray;
+            if (peak <= budget && largest <= single) {
+                plan->scale = s;
+                plan->streamed = streamed;
+                plan->peak = peak;
+                if (first) {
+                    ESP_LOGI(TAG, "Plan: %s at 1/%d, %s, %u KB of %u KB", what, 1 << s,
+                             !frame ? "extra outputs only" : streamed ? "streamed" : "buffered",
+                             (unsigned)(peak / 1024), (unsigned)(budget / 1024));
+                } else {
+                    ESP_LOGW(TAG, "Plan: %s at 1/%d, %s, %u KB of %u KB (low memory)", what,
+                             1 << s, streamed ? "streamed" : "buffered",
+                             (unsigned)(peak / 1024), (unsigned)(budget / 1024));
+                }
+                return ESP_OK;
+            }
+            if (peak < least) {
+                least = peak;
+            }
+            first = false;
         }
-        
-        // Convert to 1bpp
-        img_gray_to_1bpp(gray, opts->target_width, opts->target_height, output, opts);
-        free(gray);
-        
-        ESP_LOGI(TAG, "Large JPEG processed successfully");
-        return ESP_OK;
     }
 
-    // Calculate required memory for grayscale (1 byte per pixel)
-    size_t required_mem = w * h * 1;
-    size_t free_mem = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    ESP_LOGE(TAG, "Plan: %s needs %u KB, only %u KB available (largest block %u KB)", what,
+             (unsigned)(least / 1024), (unsigned)(budget / 1024), (unsigned)(single / 1024));
+    return ESP_ERR_NO_MEM;
+}
 
-    // Leave some headroom (e.g. 500KB)
-    if (required_mem + 512000 > free_mem)
-    {
-        ESP_LOGE(TAG, "Image too large for memory: %dx%d (req: %d KB, free: %d KB)",
-                 w, h, required_mem / 1024, free_mem / 1024);
+// Options the decode runs with under a plan
+static const img_process_opts_t *plan_opts(img_process_opts_t *copy, const img_process_opts_t *opts,
+                                           const decode_plan_t *plan) {
+    *copy = *opts;
+    copy->streaming = plan->streamed;
+    return copy;
+}
+
+// Peak of a gray stb_image decode and the scaling after it. stb_image keeps
+// every component (PNG: also the compressed and the inflated data) until it
+// converts to gray, and its JPEG path holds up to three buffers per sample.
+static size_t full_decode_mem(const char *filename, int w, int h, int comp, int orient,
+                              bool frame, const img_process_opts_t *opts,
+                              const img_extra_outputs_t *extra, size_t *largest) {
+    size_t pixels = (size_t)w * h;
+    size_t bytes = stbi_is_16_bit(filename) ? 2 : 1;
+    size_t planes = pixels * comp * bytes;
+    size_t decode;
+    const char *ext = strrchr(filename, '.');
+    if (ext && strcasecmp(ext, ".png") == 0) {
+        struct stat st;
+        size_t file = stat(filename, &st) == 0 ? (size_t)st.st_size : 0;
+        size_t raw = (size_t)h * ((size_t)w * comp * bytes + 1);
+        decode = raw + (file > planes ? file : planes);
+        *largest = raw > planes ? raw : planes;
+    } else {
+        decode = pixels * comp * 3;
+        *largest = planes;
+    }
+    if (decode < planes + pixels) {
+        decode = planes + pixels;   // Conversion to gray
+    }
+
+    // Then: the gray image and the buffered pipeline it is pushed through
+    size_t frame_largest;
+    size_t after = pixels + pipeline_mem(w, h, frame, false, orient, opts, extra, &frame_largest);
+    if (frame_largest > *largest) {
+        *largest = frame_largest;
+    }
+    return decode > after ? decode : after;
+}
+
+static bool tjpgd_cost(const void *dec, int scale, decode_cost_t *cost) {
+    const JDEC *jd = (const JDEC *)dec;
+    cost->w = jd->width >> scale;
+    cost->h = jd->height >> scale;
+    cost->mem = (size_t)cost->w * ((jd->msy * 8) >> scale);
+    return cost->w > 0 && cost->h > 0;
+}
+
+static bool jpeg_prog_cost(const void *dec, int scale, decode_cost_t *cost) {
+    const jpeg_prog_t *jp = (const jpeg_prog_t *)dec;
+    int k = 8 >> scale;
+    cost->w = (jp->width * k + 7) / 8;
+    cost->h = (jp->height * k + 7) / 8;
+    cost->mem = jpeg_prog_mem(jp, scale);
+    return true;
+}
+
+static bool png_cost(const void *dec, int scale, decode_cost_t *cost) {
+    const png_dec_t *png = (const png_dec_t *)dec;
+    int s = png_dec_scale(png, scale);
+    if (s != scale) {
+        return false;           // Only Adam7 images decode smaller
+    }
+    cost->w = (png->width + (1 << s) - 1) >> s;
+    cost->h = (png->height + (1 << s) - 1) >> s;
+    cost->mem = png_dec_mem(png, s);
+    return true;
+}
+
+static bool bmp_cost(const void *dec, int scale, decode_cost_t *cost) {
+    const bmp_dec_t *bmp = (const bmp_dec_t *)dec;
+    cost->w = bmp->width;
+    cost->h = bmp->height;
+    cost->mem = bmp_dec_mem(bmp, 1);
+    return scale == 0;
+}
+
+static esp_err_t process_jpeg_tjpgd(FILE *fp, const uint8_t *data, size_t size, int exif,
+                                    uint8_t *output, size_t output_size,
+                                    const img_process_opts_t *opts,
+                                    img_extra_outputs_t *extra) {
+    // The decoder's tables and MCU buffers live in its pool: keep it in SRAM
+    char *work = img_arena_alloc_fast(TJPGD_WORKSPACE_SIZE);
+    if (!work) {
         return ESP_ERR_NO_MEM;
     }
 
-    // Load as GRAYSCALE (req_comp=1) to save 3x memory!
-    stbi_uc *decoded = stbi_load(filename, &w, &h, &comp, 1);
-    if (!decoded)
-    {
-        ESP_LOGE(TAG, "Decode failed for %s: %s", filename, stbi_failure_reason());
+    tjpgd_ctx_t ctx = {0};
+    ctx.fp = fp;
+    ctx.data = data;
+    ctx.size = size;
+
+    JDEC jd;
+    JRESULT res = jd_prepare(&jd, tjpgd_input_func, work, TJPGD_WORKSPACE_SIZE, &ctx);
+    if (res != JDR_OK) {
+        img_arena_free(work);
+        ESP_LOGW(TAG, "TJpgDec cannot decode this JPEG: %d", res);
+        return (res == JDR_FMT3) ? ESP_ERR_NOT_SUPPORTED : ESP_FAIL;
+    }
+
+    int orient = render_orient(exif, jd.width, jd.height, opts);
+    decode_plan_t plan;
+    esp_err_t ret = plan_decode(&plan, "JPEG", tjpgd_cost, &jd,
+                                decode_scale(jd.width, jd.height, opts, orient), orient,
+                                output != NULL, opts, extra);
+    if (ret != ESP_OK) {
+        img_arena_free(work);
+        return ret;
+    }
+    img_process_opts_t popts;
+    opts = plan_opts(&popts, opts, &plan);
+
+    uint8_t scale = plan.scale;
+    int sw = jd.width >> scale;
+    int sh = jd.height >> scale;
+
+    int band_h = (jd.msy * 8) >> scale;
+    ESP_LOGI(TAG, "Decoding JPEG %dx%d at 1/%d -> %dx%d (band %dx%d, %s)",
+             jd.width, jd.height, 1 << scale, sw, sh, sw, band_h,
+             stream_mode(output, opts));
+
+    img_stream_t st;
+    ret = stream_begin(&st, sw, sh, orient, output, output_size, opts, extra);
+    if (ret != ESP_OK) {
+        img_arena_free(work);
+        return ret;
+    }
+
+    ctx.band = img_arena_alloc(sw * band_h);
+    if (!ctx.band) {
+        img_arena_free(work);
+        return stream_end(&st, ESP_ERR_NO_MEM);
+    }
+    ctx.width = sw;
+    ctx.height = sh;
+    ctx.row_cb = stream_source_row;
+    ctx.row_ctx = &st;
+    ctx.row_err = ESP_OK;
+
+    res = jd_decomp(&jd, tjpgd_band_output_func, scale);
+    if (res == JDR_OK) {
+        tjpgd_flush_band(&ctx);
+    }
+
+    img_arena_free(ctx.band);
+    img_arena_free(work);
+
+    if (ctx.row_err != ESP_OK) {
+        ret = ctx.row_err;
+    } else if (res != JDR_OK) {
+        ESP_LOGE(TAG, "TJpgDec failed: %d", res);
+        ret = ESP_FAIL;
+    }
+
+    ret = stream_end(&st, ret);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "JPEG decoded successfully");
+    }
+    return ret;
+}
+
+// Progressive JPEGs: all scans refine a store of the low-frequency
+// coefficients only, then rows come out already reduced
+static esp_err_t process_jpeg_progressive(FILE *fp, const uint8_t *data, size_t size, int exif,
+                                          uint8_t *output, size_t output_size,
+                                          const img_process_opts_t *opts,
+                                          img_extra_outputs_t *extra) {
+    jpeg_prog_t dec;
+    esp_err_t ret = jpeg_prog_init(&dec, fp, data, size);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    int orient = render_orient(exif, dec.width, dec.height, opts);
+    decode_plan_t plan;
+    ret = plan_decode(&plan, "progressive JPEG", jpeg_prog_cost, &dec,
+                      decode_scale(dec.width, dec.height, opts, orient), orient,
+                      output != NULL, opts, extra);
+    if (ret != ESP_OK) {
+        jpeg_prog_deinit(&dec);
+        return ret;
+    }
+    img_process_opts_t popts;
+    opts = plan_opts(&popts, opts, &plan);
+
+    uint8_t scale = plan.scale;
+    int k = 8 >> scale;
+    int sw = (dec.width * k + 7) / 8;
+    int sh = (dec.height * k + 7) / 8;
+    ESP_LOGI(TAG, "Decoding progressive JPEG %dx%d at 1/%d -> %dx%d (%s)",
+             dec.width, dec.height, 1 << scale, sw, sh,
+             stream_mode(output, opts));
+
+    img_stream_t st;
+    ret = stream_begin(&st, sw, sh, orient, output, output_size, opts, extra);
+    if (ret == ESP_OK) {
+        ret = jpeg_prog_decode(&dec, scale, stream_source_row, &st);
+        ret = stream_end(&st, ret);
+    }
+    jpeg_prog_deinit(&dec);
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "JPEG decoded successfully");
+    }
+    return ret;
+}
+
+// Baseline JPEGs go to TJpgDec, progressive ones to the reduced store decoder.
+// exif is the EXIF orientation of the photo (see jpeg_orientation).
+static esp_err_t process_jpeg(FILE *fp, const uint8_t *data, size_t size, int exif,
+                              uint8_t *output, size_t output_size,
+                              const img_process_opts_t *opts,
+                              img_extra_outputs_t *extra) {
+    esp_err_t ret = process_jpeg_tjpgd(fp, data, size, exif, output, output_size, opts, extra);
+    if (ret == ESP_ERR_NOT_SUPPORTED) {
+        if (fp) {
+            rewind(fp);
+        }
+        ret = process_jpeg_progressive(fp, data, size, exif, output, output_size, opts, extra);
+    }
+    return ret;
+}
+
+// PNGs: rows are inflated one at a time straight into the scaler
+static esp_err_t process_png(FILE *fp, const uint8_t *data, size_t size,
+                             uint8_t *output, size_t output_size,
+                             const img_process_opts_t *opts,
+                             img_extra_outputs_t *extra) {
+    png_dec_t dec;
+    esp_err_t ret = png_dec_init(&dec, fp, data, size);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    int orient = render_orient(dec.orient, dec.width, dec.height, opts);
+    decode_plan_t plan;
+    int natural = png_dec_scale(&dec, decode_scale(dec.width, dec.height, opts, orient));
+    ret = plan_decode(&plan, "PNG", png_cost, &dec, natural, orient, output != NULL, opts, extra);
+    if (ret != ESP_OK) {
+        png_dec_deinit(&dec);
+        return ret;
+    }
+    img_process_opts_t popts;
+    opts = plan_opts(&popts, opts, &plan);
+
+    int scale = plan.scale;
+    int sw = (dec.width + (1 << scale) - 1) >> scale;
+    int sh = (dec.height + (1 << scale) - 1) >> scale;
+    ESP_LOGI(TAG, "Decoding PNG %dx%d at 1/%d -> %dx%d (%s)",
+             dec.width, dec.height, 1 << scale, sw, sh,
+             stream_mode(output, opts));
+
+    img_stream_t st;
+    ret = stream_begin(&st, sw, sh, orient, output, output_size, opts, extra);
+    if (ret == ESP_OK) {
+        ret = png_dec_decode(&dec, scale, stream_source_row, &st);
+        ret = stream_end(&st, ret);
+    }
+    png_dec_deinit(&dec);
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "PNG decoded successfully");
+    }
+    return ret;
+}
+
+// BMPs: rows are read in display order straight into the scaler
+static esp_err_t process_bmp(FILE *fp, const uint8_t *data, size_t size,
+                             uint8_t *output, size_t output_size,
+                             const img_process_opts_t *opts,
+                             img_extra_outputs_t *extra) {
+    bmp_dec_t dec;
+    esp_err_t ret = bmp_dec_init(&dec, fp, data, size);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // BMP has no orientation tag
+    int orient = render_orient(IMG_EXIF_ORIENT_NORMAL, dec.width, dec.height, opts);
+    decode_plan_t plan;
+    ret = plan_decode(&plan, "BMP", bmp_cost, &dec, 0, orient, output != NULL, opts, extra);
+    if (ret != ESP_OK) {
+        bmp_dec_deinit(&dec);
+        return ret;
+    }
+    img_process_opts_t popts;
+    opts = plan_opts(&popts, opts, &plan);
+
+    ESP_LOGI(TAG, "Decoding BMP %dx%d (%s)", dec.width, dec.height,
+             stream_mode(output, opts));
+
+    img_stream_t st;
+    ret = stream_begin(&st, dec.width, dec.height, orient, output, output_size, opts, extra);
+    if (ret == ESP_OK) {
+        ret = bmp_dec_decode(&dec, 1, stream_source_row, &st);
+        ret = stream_end(&st, ret);
+    }
+    bmp_dec_deinit(&dec);
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "BMP decoded successfully");
+    }
+    return ret;
+}
+
+static bool jpeg_is_sof(int m) {
+    return m >= 0xC0 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC;
+}
+
+// Walk the JPEG segments up to the frame header: image size, EXIF orientation
+// (1 if none) and, unless thumb is NULL, the EXIF thumbnail (allocated, NULL
+// if none) if one is met on the way
+static esp_err_t jpeg_scan_exif(FILE *fp, int *width, int *height, int *orient,
+                                uint8_t **thumb, size_t *thumb_size) {
+    bool exif_seen = false;
+    *orient = IMG_EXIF_ORIENT_NORMAL;
+    if (thumb) {
+        *thumb = NULL;
+    }
+    if (getc(fp) != 0xFF || getc(fp) != 0xD8) {
         return ESP_ERR_NOT_SUPPORTED;
     }
 
-    uint8_t *gray = decoded;
-    uint16_t width = (uint16_t)w;
-    uint16_t height = (uint16_t)h;
-    bool gray_from_stbi = true;
+    for (;;) {
+        if (getc(fp) != 0xFF) return ESP_FAIL;
+        int m;
+        while ((m = getc(fp)) == 0xFF) ;
+        if (m < 0 || m == 0xD9 || m == 0xDA) return ESP_FAIL;
+        if (m == 0x01 || (m >= 0xD0 && m <= 0xD8)) continue;
+
+        int hi = getc(fp), lo = getc(fp);
+        int len = ((hi << 8) | lo) - 2;
+        if (lo < 0 || len < 0) return ESP_FAIL;
+
+        uint8_t sof[5];
+        if (jpeg_is_sof(m)) {
+            if (len < 5 || fread(sof, 1, 5, fp) != 5) return ESP_FAIL;
+            *height = (sof[1] << 8) | sof[2];
+            *width = (sof[3] << 8) | sof[4];
+            return ESP_OK;
+        }
 
-    // Scale if needed
-    uint8_t *scaled = NULL;
-    if (width != opts->target_width || height != opts->target_height)
-    {
-        size_t scaled_size = opts->target_width * opts->target_height * 1; // 1 byte per pixel
-        scaled = heap_caps_malloc(scaled_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-        if (!scaled)
-        {
-            scaled = malloc(scaled_size);
+        if (m == 0xE1 && !exif_seen && len > 6 + 8) {
+            uint8_t *app1 = img_arena_alloc(len);
+            if (!app1) return ESP_ERR_NO_MEM;
+            size_t off, size;
+            if (fread(app1, 1, len, fp) != (size_t)len) {
+                img_arena_free(app1);
+                return ESP_FAIL;
+            }
+            if (memcmp(app1, "Exif\0\0", 6) == 0) {
+                exif_seen = true;
+                *orient = img_exif_orientation(app1 + 6, len - 6);
+                if (thumb && img_exif_thumbnail(app1 + 6, len - 6, &off, &size)) {
+                    memmove(app1, app1 + 6 + off, size);
+                    *thumb = app1;
+                    *thumb_size = size;
+                    continue;
+                }
+            }
+            img_arena_free(app1);
+        } else if (fseek(fp, len, SEEK_CUR) != 0) {
+            return ESP_FAIL;
         }
-        if (!scaled)
-        {
-            free_image_buffer(gray, gray_from_stbi);
-            return ESP_ERR_NO_MEM;
+    }
+}
+
+// Frame size and, unless orient is NULL, EXIF orientation (1 if none) of an
+// in-memory JPEG
+static bool jpeg_mem_size(const uint8_t *data, size_t size, int *width, int *height,
+                          int *orient) {
+    size_t pos = 2;
+    if (orient) {
+        *orient = IMG_EXIF_ORIENT_NORMAL;
+    }
+    while (pos + 4 <= size && data[pos] == 0xFF) {
+        int m = data[pos + 1];
+        size_t len = (data[pos + 2] << 8) | data[pos + 3];
+        if (orient && m == 0xE1 && len > 2 + 6 && pos + 2 + len <= size &&
+            memcmp(data + pos + 4, "Exif\0\0", 6) == 0) {
+            *orient = img_exif_orientation(data + pos + 10, len - 8);
+        }
+        if (jpeg_is_sof(m)) {
+            if (pos + 9 > size) break;
+            *height = (data[pos + 5] << 8) | data[pos + 6];
+            *width = (data[pos + 7] << 8) | data[pos + 8];
+            return *width > 0 && *height > 0;
         }
+        if (m == 0xDA || len < 2) break;
+        pos += 2 + len;
+    }
+    return false;
+}
 
-        img_scale_gray(gray, width, height, scaled, opts->target_width, opts->target_height, opts->fit_mode);
-        free_image_buffer(gray, gray_from_stbi);
-        gray = scaled;
-        gray_from_stbi = false;
-        width = opts->target_width;
-        height = opts->target_height;
+// EXIF orientation of a JPEG file or buffer, 1 if the policy ignores it.
+// The file is left where it was.
+static int jpeg_orientation(FILE *fp, const uint8_t *data, size_t size,
+                            const img_process_opts_t *opts) {
+    int orient = IMG_EXIF_ORIENT_NORMAL;
+    if (opts->orient == IMG_ORIENT_NONE) {
+        return orient;
+    }
+    int w, h;
+    if (fp) {
+        long pos = ftell(fp);
+        if (jpeg_scan_exif(fp, &w, &h, &orient, NULL, NULL) != ESP_OK) {
+            orient = IMG_EXIF_ORIENT_NORMAL;
+        }
+        fseek(fp, pos, SEEK_SET);
+    } else if (!jpeg_mem_size(data, size, &w, &h, &orient)) {
+        orient = IMG_EXIF_ORIENT_NORMAL;
     }
+    return orient;
+}
 
-    // Convert to 1-bit
-    img_gray_to_1bpp(gray, width, height, output, opts);
+// Thumbnail from the JPEG's embedded EXIF thumbnail: used only when it is
+// framed like the photo (cameras pad or crop it to 4:3) and not tiny. It is
+// stored turned like the photo, so it takes the photo's orientation.
+static esp_err_t process_exif_thumbnail(FILE *fp, const img_process_opts_t *opts,
+                                        img_extra_outputs_t *extra) {
+    if (!extra->thumb) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
 
-    free_image_buffer(gray, gray_from_stbi);
+    int w = 0, h = 0, tw = 0, th = 0, orient;
+    uint8_t *thumb = NULL;
+    size_t size = 0;
+    esp_err_t ret = jpeg_scan_exif(fp, &w, &h, &orient, &thumb, &size);
+    if (ret != ESP_OK || !thumb) {
+        img_arena_free(thumb);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
 
-    ESP_LOGI(TAG, "Image processed successfully from file");
-    return ESP_OK;
+    ret = ESP_ERR_NOT_SUPPORTED;
+    if (jpeg_mem_size(thumb, size, &tw, &th, NULL) && w > 0 && h > 0) {
+        // Aspect ratios within ~3%
+        int64_t diff = (int64_t)tw * h - (int64_t)th * w;
+        bool framed = (diff < 0 ? -diff : diff) * 32 <= (int64_t)th * w;
+        if (framed && tw * 2 >= extra->thumb_w) {
+            ESP_LOGI(TAG, "Using EXIF thumbnail %dx%d of %dx%d", tw, th, w, h);
+            if (opts->orient == IMG_ORIENT_NONE) {
+                orient = IMG_EXIF_ORIENT_NORMAL;
+            }
+            ret = process_jpeg(NULL, thumb, size, orient, NULL, 0, opts, extra);
+        } else {
+            ESP_LOGI(TAG, "EXIF thumbnail %dx%d does not match %dx%d, decoding image", tw, th, w, h);
+        }
+    }
+    img_arena_free(thumb);
+    return ret;
 }
 
-bool img_is_valid_epd_buffer(const uint8_t *data, size_t size)
+static esp_err_t decode_file(const char *filename, const char *ext,
+                             uint8_t *output, size_t output_size,
+                             const img_process_opts_t *opts,
+                             img_extra_outputs_t *extra);
+
+// A fully decoded gray image, pushed through the buffered pipeline like
+// decoded rows: scaled (gathering the tone histogram), turned, tone mapped
+// and dithered
+static esp_err_t process_gray(const uint8_t *gray, int w, int h, int orient,
+                              uint8_t *output, size_t output_size,
+                              const img_process_opts_t *opts,
+                              img_extra_outputs_t *extra) {
+    img_process_opts_t popts = *opts;
+    popts.streaming = false;
+    img_stream_t st;
+    esp_err_t ret = stream_begin(&st, w, h, orient, output, output_size, &popts, extra);
+    if (ret == ESP_OK) {
+        for (int y = 0; y < h && ret == ESP_OK; y++) {
+            ret = stream_source_row(&st, gray + (size_t)y * w, y);
+        }
+        ret = stream_end(&st, ret);
+    }
+    return ret;
+}
+
+esp_err_t img_process_file(const char *filename,
+                           uint8_t *output, size_t output_size,
+                           const img_process_opts_t *opts)
 {
-    return data != NULL && size == EPAPER_BUFFER_SIZE;
+    return img_process_file_ex(filename, output, output_size, opts, NULL);
 }
 
-// Helper to save BMP
-static esp_err_t img_save_bmp(const char *filename, const uint8_t *data, int w, int h, int comp) {
-    FILE *f = fopen(filename, "wb");
-    if (!f) {
-        ESP_LOGE(TAG, "Failed to open %s for writing", filename);
-        return ESP_FAIL;
+esp_err_t img_process_file_ex(const char *filename,
+                              uint8_t *output, size_t output_size,
+                              const img_process_opts_t *opts,
+                              img_extra_outputs_t *extra)
+{
+    if (!filename || !opts || (!output && !extra))
+    {
+        return ESP_ERR_INVALID_ARG;
     }
 
-    int row_padded = (w * comp + 3) & (~3);
-    int size = 54 + row_padded * h;
-
-    uint8_t header[54] = {
-        'B','M',
-        size & 0xFF, (size >> 8) & 0xFF, (size >> 16) & 0xFF, (size >> 24) & 0xFF,
-        0,0, 0,0,
-        54,0,0,0,
-        40,0,0,0,
-        w & 0xFF, (w >> 8) & 0xFF, (w >> 16) & 0xFF, (w >> 24) & 0xFF,
-        h & 0xFF, (h >> 8) & 0xFF, (h >> 16) & 0xFF, (h >> 24) & 0xFF,
-        1,0,
-        comp * 8, 0,
-        0,0,0,0,
-        0,0,0,0,
-        0,0,0,0,
-        0,0,0,0,
-        0,0,0,0,
-        0,0,0,0
-    };
+    // Without a frame the decoders aim at the thumbnail size instead
+    img_process_opts_t extra_opts;
+    if (!output)
+    {
+        extra_opts = *opts;
+        if (extra->thumb)
+        {
+            extra_opts.target_width = extra->thumb_w;
+            extra_opts.target_height = extra->thumb_h;
+        }
+        opts = &extra_opts;
+    }
 
-    fwrite(header, 1, 54, f);
+    // Check extension
+    const char *ext = strrchr(filename, '.');
+    if (!ext)
+        return ESP_ERR_NOT_SUPPORTED;
 
-    uint8_t *pad = calloc(1, 4);
-    for (int y = h - 1; y >= 0; y--) {
-        fwrite(data + y * w * comp, 1, w * comp, f);
-        fwrite(pad, 1, row_padded - w * comp, f);
+    // If raw/bin, we can just read directly
+    if (strcasecmp(ext, ".raw") == 0 || strcasecmp(ext, ".bin") == 0)
+    {
+        if (!output)
+            return ESP_ERR_NOT_SUPPORTED;
+        img_binfile_t bf;
+        esp_err_t ret = img_binfile_open(&bf, filename);
+        if (ret != ESP_OK)
+            return ret;
+        // The file must hold one frame of this size: a gray .bin is not a mono one
+        ret = img_binfile_read(&bf, output, output_size);
+        img_binfile_close(&bf);
+        return ret;
     }
-    free(pad);
-    fclose(f);
-    return ESP_OK;
+
+    if (output && output_size < img_frame_size(opts->format, opts->target_width, opts->target_height))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Everything the decode allocates goes with the job
+    img_arena_begin();
+    esp_err_t ret = decode_file(filename, ext, output, output_size, opts, extra);
+    img_arena_end();
+    return ret;
 }
 
-// Helper function to generate thumbnail using TJpgDec for large JPEGs
-static esp_err_t generate_thumbnail_tjpgd(const char *filename, const char *thumb_path) {
-    // Get image dimensions using stbi_info
-    int w, h, comp;
-    if (!stbi_info(filename, &w, &h, &comp)) {
-        return ESP_ERR_INVALID_ARG;
+static esp_err_t decode_file(const char *filename, const char *ext,
+                             uint8_t *output, size_t output_size,
+                             const img_process_opts_t *opts,
+                             img_extra_outputs_t *extra)
+{
+    // BMPs, JPEGs and PNGs are decoded row by row (JPEGs with DCT-domain downscaling)
+    if (strcasecmp(ext, ".bmp") == 0) {
+        FILE *fp = fopen(filename, "rb");
+        if (!fp) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        esp_err_t ret = process_bmp(fp, NULL, 0, output, output_size, opts, extra);
+        fclose(fp);
+        return ret;
     }
-    
-    // Calculate scale factor to get ~160x120 thumbnail
-    // TJpgDec supports scales: 1/1, 1/2, 1/4, 1/8
-    uint8_t scale = 0;
-    int sw = w, sh = h;
-    while (scale < 3 && (sw > 320 || sh > 240)) {
-        sw >>= 1;
-        sh >>= 1;
-        scale++;
+    bool is_jpeg = strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0;
+    bool is_png = strcasecmp(ext, ".png") == 0;
+    int exif = IMG_EXIF_ORIENT_NORMAL;
+    if (is_jpeg || is_png) {
+        FILE *fp = fopen(filename, "rb");
+        if (!fp) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        // A thumbnail alone may come from the JPEG's embedded EXIF thumbnail
+        esp_err_t ret = ESP_ERR_NOT_SUPPORTED;
+        if (is_jpeg && !output) {
+            ret = process_exif_thumbnail(fp, opts, extra);
+            rewind(fp);
+        }
+        if (ret != ESP_OK) {
+            if (is_jpeg) {
+                exif = jpeg_orientation(fp, NULL, 0, opts);
+                ret = process_jpeg(fp, NULL, 0, exif, output, output_size, opts, extra);
+            } else {
+                ret = process_png(fp, NULL, 0, output, output_size, opts, extra);
+            }
+        }
+        fclose(fp);
+        if (ret != ESP_ERR_NOT_SUPPORTED) {
+            return ret;
+        }
+        // No streaming decoder handles it: fall back to a full decode if it fits
     }
-    
-    ESP_LOGI(TAG, "TJpgDec thumbnail: scale 1/%d -> %dx%d", 1 << scale, sw, sh);
-    
-    // Allocate grayscale buffer for scaled image
-    size_t buf_size = sw * sh;
-    uint8_t *gray = heap_caps_malloc(buf_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (!gray) {
-        gray = malloc(buf_size);
+
+    // For other images, use STBI to load from file directly (saves memory)
+    int w = 0, h = 0, comp = 0;
+
+    // Check dimensions first
+    if (!stbi_info(filename, &w, &h, &comp))
+    {
+        ESP_LOGE(TAG, "Failed to parse image info: %s", stbi_failure_reason());
+        return ESP_ERR_INVALID_ARG;
     }
-    if (!gray) {
+
+    ESP_LOGI(TAG, "File Image info: %dx%d, %d comp", w, h, comp);
+
+    // The only plan left: the whole image in memory, then pushed through the
+    // buffered pipeline like decoded rows
+    int orient = render_orient(exif, w, h, opts);
+    img_process_opts_t popts = *opts;
+    popts.streaming = false;
+    opts = &popts;
+
+    size_t largest;
+    size_t need = full_decode_mem(filename, w, h, comp, orient, output != NULL, opts, extra,
+                                  &largest);
+    size_t single;
+    size_t budget = plan_budget(&single);
+    if (need > budget || largest > single)
+    {
+        ESP_LOGE(TAG, "Plan: full decode of %dx%d needs %u KB, only %u KB available (largest block %u KB)",
+                 w, h, (unsigned)(need / 1024), (unsigned)(budget / 1024), (unsigned)(single / 1024));
         return ESP_ERR_NO_MEM;
     }
-    
-    // Prepare tjpgd workspace
-    char *work = malloc(TJPGD_WORKSPACE_SIZE);
-    if (!work) {
-        free(gray);
-        return ESP_ERR_NO_MEM;
+    ESP_LOGI(TAG, "Plan: full decode, %u KB of %u KB", (unsigned)(need / 1024), (unsigned)(budget / 1024));
+
+    // Load as GRAYSCALE (req_comp=1) to save 3x memory!
+    stbi_uc *gray = stbi_load(filename, &w, &h, &comp, 1);
+    if (!gray)
+    {
+        ESP_LOGE(TAG, "Decode failed for %s: %s", filename, stbi_failure_reason());
+        return ESP_ERR_NOT_SUPPORTED;
     }
-    
-    tjpgd_ctx_t ctx = {0};
-    ctx.fp = fopen(filename, "rb");
-    if (!ctx.fp) {
-        free(gray);
-        free(work);
-        return ESP_ERR_NOT_FOUND;
+
+    esp_err_t ret = process_gray(gray, w, h, orient, output, output_size, opts, extra);
+    stbi_image_free(gray);
+
+    if (ret == ESP_OK)
+    {
+        ESP_LOGI(TAG, "Image processed successfully from file");
     }
-    ctx.output = gray;
-    ctx.width = sw;
-    ctx.height = sh;
-    
-    JDEC jd;
-    JRESULT res = jd_prepare(&jd, tjpgd_input_func, work, TJPGD_WORKSPACE_SIZE, &ctx);
-    if (res != JDR_OK) {
-        ESP_LOGE(TAG, "jd_prepare failed: %d", res);
-        fclose(ctx.fp);
-        free(gray);
-        free(work);
-        return ESP_FAIL;
+    return ret;
+}
+
+bool img_is_valid_epd_buffer(const uint8_t *data, size_t size)
+{
+    img_format_t format;
+    return data != NULL && img_format_from_size(size, &format);
+}
+
+// Processing options for upload outputs, from the saved settings
+static void upload_opts(img_process_opts_t *opts) {
+    app_settings_t settings;
+    if (storage_load_settings(&settings) == ESP_OK) {
+        img_get_render_opts(opts, &settings);
+        ESP_LOGI(TAG, "Using fit_mode=%d, %dbpp from settings", opts->fit_mode, img_format_bpp(opts->format));
+    } else {
+        img_get_default_opts(opts);
     }
-    
-    res = jd_decomp(&jd, tjpgd_output_func, scale);
-    fclose(ctx.fp);
-    free(work);
-    
-    if (res != JDR_OK) {
-        ESP_LOGE(TAG, "jd_decomp failed: %d", res);
-        free(gray);
+}
+
+// Write a gray thumbnail as JPEG; a failed write leaves no file behind
+static esp_err_t write_thumbnail(const char *thumb_path, const uint8_t *gray, int w, int h) {
+    FILE *f = fopen(thumb_path, "wb");
+    if (!f) {
+        ESP_LOGE(TAG, "Failed to open %s for writing", thumb_path);
         return ESP_FAIL;
     }
-    
-    // Now resize grayscale to 160x120 and convert to RGB
-    int thumb_w = 160;
-    int thumb_h = 120;
-    uint8_t *thumb = malloc(thumb_w * thumb_h * 3);
-    if (!thumb) {
-        free(gray);
+    esp_err_t ret = img_jpeg_encode_gray(f, gray, w, h, THUMB_QUALITY);
+    if (fclose(f) != 0 && ret == ESP_OK) {
+        ret = ESP_FAIL;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write thumbnail %s: %s", thumb_path, esp_err_to_name(ret));
+        unlink(thumb_path);
+    }
+    return ret;
+}
+
+static esp_err_t save_thumbnail(const char *filename, const uint8_t *thumb) {
+    char thumb_path[256];
+    snprintf(thumb_path, sizeof(thumb_path), "%s.thumb", filename);
+    esp_err_t ret = write_thumbnail(thumb_path, thumb, THUMB_WIDTH, THUMB_HEIGHT);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Thumbnail saved: %s", thumb_path);
+    }
+    return ret;
+}
+
+// Decode an old BMP thumbnail (f at its start) and rewrite it as JPEG
+static esp_err_t convert_bmp_thumbnail(FILE *f, const char *thumb_path) {
+    bmp_dec_t dec;
+    esp_err_t ret = bmp_dec_init(&dec, f, NULL, 0);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (dec.width > THUMB_MAX_LEGACY || dec.height > THUMB_MAX_LEGACY) {
+        bmp_dec_deinit(&dec);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    int w = dec.width, h = dec.height;
+    uint8_t *gray = img_arena_alloc((size_t)w * h);
+    if (!gray) {
+        bmp_dec_deinit(&dec);
         return ESP_ERR_NO_MEM;
     }
-    
-    for (int y = 0; y < thumb_h; y++) {
-        for (int x = 0; x < thumb_w; x++) {
-            int sx = x * sw / thumb_w;
-            int sy = y * sh / thumb_h;
-            uint8_t g = gray[sy * sw + sx];
-            int dst_idx = (y * thumb_w + x) * 3;
-            // Convert grayscale to RGB
-            thumb[dst_idx] = g;
-            thumb[dst_idx+1] = g;
-            thumb[dst_idx+2] = g;
-        }
+    bmp_rows_ctx_t ctx = {.pixels = gray, .row_bytes = (size_t)w};
+    ret = bmp_dec_decode(&dec, 1, bmp_collect_row, &ctx);
+    bmp_dec_deinit(&dec);
+
+    if (ret == ESP_OK) {
+        ret = write_thumbnail(thumb_path, gray, w, h);
     }
-    
-    free(gray);
-    
-    // Save as BMP
-    esp_err_t ret = img_save_bmp(thumb_path, thumb, thumb_w, thumb_h, 3);
-    free(thumb);
-    
     if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "Thumbnail generated via TJpgDec: %s", thumb_path);
+        ESP_LOGI(TAG, "Converted BMP thumbnail to JPEG: %s", thumb_path);
     }
-    
+    img_arena_free(gray);
     return ret;
 }
 
+esp_err_t img_convert_thumbnail(const char *thumb_path) {
+    FILE *f = fopen(thumb_path, "rb");
+    if (!f) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint8_t magic[2] = {0};
+    if (fread(magic, 1, 2, f) != 2 || magic[0] != 'B' || magic[1] != 'M') {
+        fclose(f);
+        return ESP_OK;
+    }
+    rewind(f);
+
+    // Only a real conversion is a job (most calls stop at the magic)
+    img_arena_begin();
+    esp_err_t ret = convert_bmp_thumbnail(f, thumb_path);
+    img_arena_end();
+    fclose(f);
+    return ret;
+}
+
+esp_err_t img_generate_thumbnail(const char *filename) {
+    img_process_opts_t opts;
+    upload_opts(&opts);
+
+    img_arena_begin();
+    img_extra_outputs_t extra = {
+        .thumb = img_arena_alloc(THUMB_WIDTH * THUMB_HEIGHT),
+        .thumb_w = THUMB_WIDTH,
+        .thumb_h = THUMB_HEIGHT,
+    };
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    if (extra.thumb) {
+        ret = img_process_file_ex(filename, NULL, 0, &opts, &extra);
+    }
+    if (ret == ESP_OK) {
+        ret = save_thumbnail(filename, extra.thumb);
+    } else {
+        ESP_LOGW(TAG, "Could not generate thumbnail for %s: %s", filename, esp_err_to_name(ret));
+    }
+    img_arena_free(extra.thumb);
+    img_arena_end();
+    return ret;
+}
+
+// Mean of a 256-bin histogram (0 if empty)
+static int hist_mean(const uint32_t hist[256]) {
+    uint64_t sum = 0, count = 0;
+    for (int v = 0; v < 256; v++) {
+        sum += (uint64_t)hist[v] * v;
+        count += hist[v];
+    }
+    return count ? (int)(sum / count) : 0;
+}
+
 esp_err_t img_process_upload(const char *filename) {
     ESP_LOGI(TAG, "=== Processing upload: %s ===", filename);
     
@@ -1047,66 +1738,10 @@ esp_err_t img_process_upload(const char *filename) {
              is_bmp ? "BMP" : "",
              (!is_jpeg && !is_png && !is_bmp) ? "Unknown" : "");
     
-    // 1. Generate Thumbnail
-    char thumb_path[256];
-    snprintf(thumb_path, sizeof(thumb_path), "%s.thumb", filename);
-    
-    bool thumb_generated = false;
-    
-    ESP_LOGI(TAG, "Generating thumbnail...");
-    
-    // Try stbi_load first
-    int w, h, comp;
-    stbi_uc *img = stbi_load(filename, &w, &h, &comp, 3); 
-    if (img) {
-        ESP_LOGI(TAG, "Image loaded: %dx%d, %d components", w, h, comp);
-        int thumb_w = 160;
-        int thumb_h = 120;
-        uint8_t *thumb = malloc(thumb_w * thumb_h * 3);
-        if (thumb) {
-            // Simple nearest neighbor resize
-            for (int y = 0; y < thumb_h; y++) {
-                for (int x = 0; x < thumb_w; x++) {
-                    int sx = x * w / thumb_w;
-                    int sy = y * h / thumb_h;
-                    int src_idx = (sy * w + sx) * 3;
-                    int dst_idx = (y * thumb_w + x) * 3;
-                    thumb[dst_idx] = img[src_idx];
-                    thumb[dst_idx+1] = img[src_idx+1];
-                    thumb[dst_idx+2] = img[src_idx+2];
-                }
-            }
-            
-            if (img_save_bmp(thumb_path, thumb, thumb_w, thumb_h, 3) == ESP_OK) {
-                thumb_generated = true;
-                ESP_LOGI(TAG, "Thumbnail saved: %s", thumb_path);
-            } else {
-                ESP_LOGW(TAG, "Failed to save thumbnail");
-            }
-            free(thumb);
-        } else {
-            ESP_LOGW(TAG, "Failed to allocate thumbnail buffer");
-        }
-        stbi_image_free(img);
-    } else if (is_jpeg) {
-        // stbi failed - try TJpgDec for large JPEGs
-        ESP_LOGW(TAG, "stbi_load failed: %s, trying TJpgDec", stbi_failure_reason());
-        if (generate_thumbnail_tjpgd(filename, thumb_path) == ESP_OK) {
-            thumb_generated = true;
-        }
-    } else {
-        ESP_LOGW(TAG, "Failed to load image: %s", stbi_failure_reason());
-    }
-    
-    if (!thumb_generated) {
-        ESP_LOGW(TAG, "Could not generate thumbnail for %s", filename);
-    }
-
-    // 2. Generate Optimized Image (BIN)
     // Check if .bin already exists (maybe uploaded as .bin)
     char bin_path[256];
     // Replace extension with .bin
-    strncpy(bin_path, filename, sizeof(bin_path));
+    snprintf(bin_path, sizeof(bin_path), "%s", filename);
     char *bin_ext = strrchr(bin_path, '.');
     if (bin_ext) strcpy(bin_ext, ".bin");
     else strcat(bin_path, ".bin");
@@ -1117,47 +1752,51 @@ esp_err_t img_process_upload(const char *filename) {
         return ESP_OK;
     }
 
-    ESP_LOGI(TAG, "Generating optimized binary: %s", bin_path);
+    ESP_LOGI(TAG, "Generating optimized binary and thumbnail: %s", bin_path);
     
-    // Process to .bin
-    uint8_t *processed = heap_caps_malloc(EPAPER_BUFFER_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    img_process_opts_t opts;
+    upload_opts(&opts);
+
+    // One decode feeds the .bin (its header tells the carousel which depth
+    // it holds), the gray thumbnail and the luma histogram
+    img_arena_begin();
+    size_t bin_size = img_frame_size(opts.format, opts.target_width, opts.target_height);
+    uint8_t *processed = img_arena_alloc(bin_size);
     if (!processed) {
-        processed = malloc(EPAPER_BUFFER_SIZE);
+        ESP_LOGE(TAG, "Failed to allocate %d bytes for processing", (int)bin_size);
+        img_arena_end();
+        return ESP_OK;
     }
-    
-    if (processed) {
-        img_process_opts_t opts;
-        img_get_default_opts(&opts);
-        
-        // Load settings for fit mode
-        app_settings_t settings;
-        if (storage_load_settings(&settings) == ESP_OK) {
-            opts.fit_mode = settings.fit_mode;
-            ESP_LOGI(TAG, "Using fit_mode=%d from settings", opts.fit_mode);
-        }
 
-        esp_err_t ret = img_process_file(filename, processed, EPAPER_BUFFER_SIZE, &opts);
-        if (ret == ESP_OK) {
-            FILE *f = fopen(bin_path, "wb");
-            if (f) {
-                size_t written = fwrite(processed, 1, EPAPER_BUFFER_SIZE, f);
-                fclose(f);
-                if (written == EPAPER_BUFFER_SIZE) {
-                    ESP_LOGI(TAG, "Optimized binary saved: %s (%d bytes)", bin_path, EPAPER_BUFFER_SIZE);
-                } else {
-                    ESP_LOGE(TAG, "Failed to write full binary (wrote %d of %d)", (int)written, EPAPER_BUFFER_SIZE);
-                }
-            } else {
-                ESP_LOGE(TAG, "Failed to create binary file: %s", bin_path);
-            }
-        } else {
-            ESP_LOGE(TAG, "Image processing failed: %s", esp_err_to_name(ret));
+    img_extra_outputs_t extra = {
+        .thumb = img_arena_alloc(THUMB_WIDTH * THUMB_HEIGHT),
+        .thumb_w = THUMB_WIDTH,
+        .thumb_h = THUMB_HEIGHT,
+        .hist = img_arena_calloc(256, sizeof(uint32_t)),
+    };
+    if (!extra.thumb) {
+        ESP_LOGW(TAG, "Failed to allocate thumbnail buffer");
+    }
+
+    esp_err_t ret = img_process_file_ex(filename, processed, bin_size, &opts, &extra);
+    if (ret == ESP_OK) {
+        img_binfile_write(bin_path, processed, bin_size, img_opts_hash(&opts));
+
+        if (!extra.thumb || save_thumbnail(filename, extra.thumb) != ESP_OK) {
+            ESP_LOGW(TAG, "Could not generate thumbnail for %s", filename);
+        }
+        if (extra.hist) {
+            ESP_LOGI(TAG, "Source mean luma: %d", hist_mean(extra.hist));
         }
-        free(processed);
     } else {
-        ESP_LOGE(TAG, "Failed to allocate %d bytes for processing", EPAPER_BUFFER_SIZE);
+        ESP_LOGE(TAG, "Image processing failed: %s", esp_err_to_name(ret));
     }
 
+    img_arena_free(extra.hist);
+    img_arena_free(extra.thumb);
+    img_arena_free(processed);
+    img_arena_end();
+
     ESP_LOGI(TAG, "=== Upload processing complete ===");
     return ESP_OK;
 }
@@ -7,6 +7,11 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "esp_err.h"
+#include "storage_manager.h"
+
+// Version of the rendering pipeline; bump when the same options produce
+// different frames, so pre-rendered .bin files are redone
+#define IMG_PIPELINE_VERSION 1
 
 // Output format
 typedef enum {
@@ -20,9 +25,18 @@ typedef enum {
     DITHER_NONE,         // Simple threshold
     DITHER_FLOYD,        // Floyd-Steinberg
     DITHER_ATKINSON,     // Atkinson (better for e-ink)
-    DITHER_ORDERED       // Ordered dithering (Bayer)
+    DITHER_ORDERED,      // Ordered dithering (Bayer 8x8 threshold map)
+    DITHER_BLUE_NOISE    // Blue-noise threshold map (64x64 tile, fastest)
 } dither_algorithm_t;
 
+// How stored pixels are turned before they are fit to the frame
+typedef enum {
+    IMG_ORIENT_NONE,     // As stored
+    IMG_ORIENT_EXIF,     // As the EXIF orientation tag says (JPEG APP1, PNG eXIf)
+    IMG_ORIENT_AUTO      // EXIF, then a quarter turn clockwise if the image is
+                         // portrait and the frame landscape (or the reverse)
+} img_orient_policy_t;
+
 // Processing options
 typedef struct {
     uint16_t target_width;
@@ -32,13 +46,71 @@ typedef struct {
     uint8_t threshold;      // For simple threshold (0-255)
     bool invert;            // Invert colors
     bool fit_mode;          // true=fit, false=fill
+    bool streaming;         // Decode/scale/dither row by row (low memory, no tone mapping)
+    bool serpentine;        // Alternate error diffusion direction per row
+    bool tone_map;          // Histogram tone curve: percentile clip + auto gamma
+    bool clahe;             // Blend in contrast-limited equalization (needs tone_map)
+    img_orient_policy_t orient; // Orientation policy (turned images are always buffered)
 } img_process_opts_t;
 
+/**
+ * @brief Row callback used by the streaming pipeline
+ * @param ctx User context
+ * @param row Row pixels (one byte per pixel, grayscale)
+ * @param y Row index
+ * @return ESP_OK to continue, anything else aborts the stream
+ */
+typedef esp_err_t (*img_row_cb_t)(void *ctx, const uint8_t *row, int y);
+
+// Extra outputs filled from the same decode as the frame (img_process_file_ex)
+typedef struct {
+    uint8_t *thumb;         // thumb_w x thumb_h gray preview (frame fit/fill geometry), NULL = off
+    uint16_t thumb_w;
+    uint16_t thumb_h;
+    uint32_t *hist;         // 256-bin luma histogram of the decoded rows, NULL = off
+} img_extra_outputs_t;
+
 /**
  * @brief Get default processing options
  */
 void img_get_default_opts(img_process_opts_t *opts);
 
+/**
+ * @brief Options a stored image is rendered with under the given settings
+ * @param opts Filled from the defaults plus fit mode, display depth and orientation
+ * @param settings Current settings
+ */
+void img_get_render_opts(img_process_opts_t *opts, const app_settings_t *settings);
+
+/**
+ * @brief Hash of every option that affects a rendered frame, plus the
+ *        pipeline version (never 0)
+ */
+uint32_t img_opts_hash(const img_process_opts_t *opts);
+
+/**
+ * @brief Bits per pixel of an output format (1, 2 or 4)
+ */
+int img_format_bpp(img_format_t format);
+
+/**
+ * @brief Output format for a bits-per-pixel setting (anything but 2 or 4 is 1bpp)
+ */
+img_format_t img_format_from_bpp(int bpp);
+
+/**
+ * @brief Size in bytes of a packed frame in the given format
+ */
+size_t img_frame_size(img_format_t format, uint16_t width, uint16_t height);
+
+/**
+ * @brief Output format of a packed full-screen frame, from its size
+ * @param size Frame size in bytes
+ * @param format Set to the matching format
+ * @return true if size matches a 1bpp, 2bpp or 4bpp screen buffer
+ */
+bool img_format_from_size(size_t size, img_format_t *format);
+
 /**
  * @brief Detect image format from data
  * @param data Image data
@@ -72,6 +144,29 @@ esp_err_t img_process_file(const char *filename,
                            uint8_t *output, size_t output_size,
                            const img_process_opts_t *opts);
 
+/**
+ * @brief Process image file and fill extra outputs from the same decode
+ *
+ * Every decoded row goes to the frame scaler and to each enabled extra
+ * output, so a thumbnail costs one more scaler rather than a second decode.
+ * Raw/bin files have no decoded rows and leave the extra outputs untouched.
+ *
+ * With no output buffer only the extra outputs are produced, decoded at the
+ * smallest scale the thumbnail allows (1/8 DC-only for most JPEGs), or from
+ * a JPEG's EXIF thumbnail when it is framed like the photo.
+ *
+ * @param filename Full path to image file
+ * @param output Output buffer for e-ink format, or NULL for extra outputs only
+ * @param output_size Size of output buffer
+ * @param opts Processing options
+ * @param extra Extra outputs, or NULL (same as img_process_file)
+ * @return ESP_OK on success
+ */
+esp_err_t img_process_file_ex(const char *filename,
+                              uint8_t *output, size_t output_size,
+                              const img_process_opts_t *opts,
+                              img_extra_outputs_t *extra);
+
 /**
  * @brief Decode BMP file to raw RGB
  * @param input BMP data
@@ -85,16 +180,22 @@ esp_err_t img_decode_bmp(const uint8_t *input, size_t input_size,
                          uint8_t **output, uint16_t *width, uint16_t *height);
 
 /**
- * @brief Convert RGB to 1-bit e-ink format
+ * @brief Convert RGB to e-ink format (1, 2 or 4 bits per pixel per opts->format)
  * @param rgb RGB data (3 bytes per pixel)
  * @param width Image width
  * @param height Image height
- * @param output Output 1-bit buffer
+ * @param output Output packed buffer
  * @param opts Processing options
  */
 void img_rgb_to_1bpp(const uint8_t *rgb, uint16_t width, uint16_t height,
                      uint8_t *output, const img_process_opts_t *opts);
 
+/**
+ * @brief Convert grayscale image to e-ink format (same tone curve/dither as img_rgb_to_1bpp)
+ */
+void img_gray_to_1bpp(const uint8_t *gray_in, uint16_t width, uint16_t height,
+                      uint8_t *output, const img_process_opts_t *opts);
+
 /**
  * @brief Scale image to target size
  * @param input Input RGB data
@@ -108,11 +209,31 @@ void img_rgb_to_1bpp(const uint8_t *rgb, uint16_t width, uint16_t height,
 void img_scale(const uint8_t *input, uint16_t in_w, uint16_t in_h,
                uint8_t *output, uint16_t out_w, uint16_t out_h, bool fit);
 
+/**
+ * @brief Scale grayscale image to target size (same geometry as img_scale)
+ */
+void img_scale_gray(const uint8_t *input, uint16_t in_w, uint16_t in_h,
+                    uint8_t *output, uint16_t out_w, uint16_t out_h, bool fit);
+
 /**
  * @brief Check if raw buffer is valid e-ink format
  */
 bool img_is_valid_epd_buffer(const uint8_t *data, size_t size);
 
+/**
+ * @brief Generate only the thumbnail of an image (<filename>.thumb, gray JPEG)
+ * @param filename Full path to image file
+ * @return ESP_OK on success
+ */
+esp_err_t img_generate_thumbnail(const char *filename);
+
+/**
+ * @brief Rewrite an old BMP thumbnail as JPEG in place
+ * @param thumb_path Full path to the .thumb file
+ * @return ESP_OK if the file is (now) JPEG, ESP_ERR_NOT_FOUND, or a decode/write error
+ */
+esp_err_t img_convert_thumbnail(const char *thumb_path);
+
 /**
  * @brief Process uploaded image (generate thumbnail and optimized binary)
  * @param filename Full path to uploaded file
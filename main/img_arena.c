@@ -0,0 +1,346 @@
+/*
+ * Image Arena Implementation
+ *
+ * Every allocation carries a small header with its size, so the last
+ * allocation of a block can be popped or grown in place (stb_image's
+ * realloc pattern) and a pointer can always be told apart from heap memory
+ * by its address. When the current block is full another one is reserved;
+ * the older block's tail is simply left unused until the job ends.
+ */
+
+#include "img_arena.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#else
+#include <pthread.h>
+#endif
+
+static const char *TAG = "img_arena";
+
+#define ALIGN_UP(n)     (((n) + IMG_ARENA_ALIGN - 1) & ~(size_t)(IMG_ARENA_ALIGN - 1))
+#define HDR_SIZE        IMG_ARENA_ALIGN     // Allocation header: size in its last word
+#define BLOCK_HDR       ALIGN_UP(sizeof(arena_block_t))
+#define RESERVE_ROUND   (64 * 1024)
+
+typedef struct arena_block {
+    struct arena_block *next;   // Older block
+    uint8_t *data;
+    size_t size;
+    size_t used;
+} arena_block_t;
+
+// Open job
+static struct {
+    int depth;                  // Nested img_arena_begin calls, 0 = no job
+    arena_block_t *blocks;      // Newest first, allocations come from the head
+    arena_block_t fast;         // Internal SRAM block (data NULL if none)
+    uint8_t *fast_mem;
+    size_t in_use;              // PSRAM block bytes handed out
+    img_arena_stats_t stats;
+} s_job;
+
+static img_arena_stats_t s_last;
+
+#ifdef ESP_PLATFORM
+static SemaphoreHandle_t s_lock;
+static TaskHandle_t s_owner;
+
+static bool is_owner(void) {
+    return s_job.depth > 0 && s_owner == xTaskGetCurrentTaskHandle();
+}
+
+static void job_lock(void) {
+    if (s_lock) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+    }
+    s_owner = xTaskGetCurrentTaskHandle();
+}
+
+static void job_unlock(void) {
+    s_owner = NULL;
+    if (s_lock) {
+        xSemaphoreGive(s_lock);
+    }
+}
+#else
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t s_owner;
+
+static bool is_owner(void) {
+    return s_job.depth > 0 && pthread_equal(s_owner, pthread_self());
+}
+
+static void job_lock(void) {
+    pthread_mutex_lock(&s_lock);
+    s_owner = pthread_self();
+}
+
+static void job_unlock(void) {
+    pthread_mutex_unlock(&s_lock);
+}
+#endif
+
+static void *heap_alloc(size_t size) {
+    void *p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!p) {
+        p = malloc(size);
+    }
+    return p;
+}
+
+static arena_block_t *block_new(size_t size) {
+    uint8_t *mem = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!mem) {
+        mem = malloc(size);
+    }
+    if (!mem) {
+        return NULL;
+    }
+    arena_block_t *b = (arena_block_t *)mem;
+    b->data = mem + BLOCK_HDR;
+    b->size = size - BLOCK_HDR;
+    b->used = 0;
+    b->next = s_job.blocks;
+    s_job.blocks = b;
+    s_job.stats.reserved += size;
+    s_job.stats.blocks++;
+    return b;
+}
+
+static bool block_has(const arena_block_t *b, const void *p) {
+    return b->data && (const uint8_t *)p >= b->data && (const uint8_t *)p < b->data + b->size;
+}
+
+// Block holding an arena pointer, NULL for heap memory
+static arena_block_t *find_block(const void *p) {
+    if (block_has(&s_job.fast, p)) {
+        return &s_job.fast;
+    }
+    for (arena_block_t *b = s_job.blocks; b; b = b->next) {
+        if (block_has(b, p)) {
+            return b;
+        }
+    }
+    return NULL;
+}
+
+static size_t *size_of(void *p) {
+    return (size_t *)((uint8_t *)p - sizeof(size_t));
+}
+
+static void *block_take(arena_block_t *b, size_t size) {
+    size_t need = HDR_SIZE + ALIGN_UP(size);
+    if (b->size - b->used < need) {
+        return NULL;
+    }
+    uint8_t *p = b->data + b->used + HDR_SIZE;
+    *size_of(p) = size;
+    b->used += need;
+    return p;
+}
+
+static void note_use(arena_block_t *b, ptrdiff_t delta) {
+    if (b == &s_job.fast) {
+        if (b->used > s_job.stats.fast_peak) {
+            s_job.stats.fast_peak = b->used;
+        }
+        return;
+    }
+    s_job.in_use += delta;
+    if (s_job.in_use > s_job.stats.peak) {
+        s_job.stats.peak = s_job.in_use;
+    }
+}
+
+static void *arena_take(size_t size) {
+    size_t need = HDR_SIZE + ALIGN_UP(size);
+    arena_block_t *b = s_job.blocks;
+    void *p = b ? block_take(b, size) : NULL;
+    if (!p) {
+        size_t grow = BLOCK_HDR + need;
+        b = block_new(grow > IMG_ARENA_GROW ? grow : IMG_ARENA_GROW);
+        p = b ? block_take(b, size) : NULL;
+    }
+    if (!p) {
+        s_job.stats.heap_fallbacks++;
+        return heap_alloc(size);
+    }
+    s_job.stats.allocs++;
+    note_use(b, (ptrdiff_t)need);
+    return p;
+}
+
+esp_err_t img_arena_init(void) {
+#ifdef ESP_PLATFORM
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+    }
+    return s_lock ? ESP_OK : ESP_ERR_NO_MEM;
+#else
+    return ESP_OK;
+#endif
+}
+
+esp_err_t img_arena_begin(void) {
+    if (is_owner()) {
+        s_job.depth++;
+        return ESP_OK;
+    }
+    job_lock();
+    memset(&s_job, 0, sizeof(s_job));
+    s_job.depth = 1;
+
+    // Last job's peak is the best guess for this one
+    size_t reserve = (s_last.peak + RESERVE_ROUND - 1) / RESERVE_ROUND * RESERVE_ROUND;
+    if (reserve < IMG_ARENA_MIN_RESERVE) {
+        reserve = IMG_ARENA_MIN_RESERVE;
+    }
+    if (!block_new(reserve + BLOCK_HDR) && reserve > IMG_ARENA_MIN_RESERVE) {
+        block_new(IMG_ARENA_MIN_RESERVE + BLOCK_HDR);
+    }
+    if (!s_job.blocks) {
+        ESP_LOGW(TAG, "Cannot reserve %u KB, job runs on the heap", (unsigned)(reserve / 1024));
+    }
+
+    s_job.fast_mem = heap_caps_malloc(IMG_ARENA_FAST_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (s_job.fast_mem) {
+        s_job.fast.data = (uint8_t *)ALIGN_UP((uintptr_t)s_job.fast_mem);
+        s_job.fast.size = IMG_ARENA_FAST_SIZE - (s_job.fast.data - s_job.fast_mem);
+    }
+    return ESP_OK;
+}
+
+void img_arena_end(void) {
+    if (!is_owner()) {
+        return;
+    }
+    if (--s_job.depth > 0) {
+        return;
+    }
+
+    s_last = s_job.stats;
+    ESP_LOGI(TAG, "Job memory: peak %u KB of %u KB in %d block(s), %u B fast, %d allocations%s",
+             (unsigned)(s_last.peak / 1024), (unsigned)(s_last.reserved / 1024), s_last.blocks,
+             (unsigned)s_last.fast_peak, s_last.allocs,
+             s_last.heap_fallbacks ? ", some on the heap" : "");
+
+    arena_block_t *b = s_job.blocks;
+    while (b) {
+        arena_block_t *next = b->next;
+        free(b);
+        b = next;
+    }
+    free(s_job.fast_mem);
+    memset(&s_job, 0, sizeof(s_job));
+    job_unlock();
+}
+
+void *img_arena_alloc(size_t size) {
+    if (!is_owner()) {
+        return heap_alloc(size);
+    }
+    return arena_take(size);
+}
+
+void *img_arena_calloc(size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    void *p = img_arena_alloc(count * size);
+    if (p) {
+        memset(p, 0, count * size);
+    }
+    return p;
+}
+
+void *img_arena_alloc_fast(size_t size) {
+    void *p = NULL;
+    if (is_owner()) {
+        p = block_take(&s_job.fast, size);
+        if (p) {
+            s_job.stats.allocs++;
+            note_use(&s_job.fast, 0);
+        }
+    }
+    if (!p) {
+        p = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (!p) {
+        p = img_arena_alloc(size);
+    }
+    if (p) {
+        memset(p, 0, size);
+    }
+    return p;
+}
+
+// True if p is the newest allocation of its block
+static bool is_top(const arena_block_t *b, void *p) {
+    return (uint8_t *)p + ALIGN_UP(*size_of(p)) == b->data + b->used;
+}
+
+void *img_arena_realloc(void *ptr, size_t size) {
+    if (!ptr) {
+        return img_arena_alloc(size);
+    }
+    arena_block_t *b = is_owner() ? find_block(ptr) : NULL;
+    if (!b) {
+        return heap_caps_realloc(ptr, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    }
+
+    size_t old = *size_of(ptr);
+    if (is_top(b, ptr)) {
+        size_t old_end = ALIGN_UP(old);
+        size_t new_end = ALIGN_UP(size);
+        if (new_end <= old_end || b->size - b->used >= new_end - old_end) {
+            b->used = b->used - old_end + new_end;
+            *size_of(ptr) = size;
+            note_use(b, (ptrdiff_t)new_end - (ptrdiff_t)old_end);
+            return ptr;
+        }
+    }
+
+    void *p = img_arena_alloc(size);
+    if (p) {
+        memcpy(p, ptr, old < size ? old : size);
+        img_arena_free(ptr);
+    }
+    return p;
+}
+
+void img_arena_free(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    arena_block_t *b = is_owner() ? find_block(ptr) : NULL;
+    if (!b) {
+        free(ptr);
+        return;
+    }
+    if (is_top(b, ptr)) {
+        size_t need = HDR_SIZE + ALIGN_UP(*size_of(ptr));
+        b->used -= need;
+        note_use(b, -(ptrdiff_t)need);
+    }
+}
+
+size_t img_arena_room(void) {
+    if (!is_owner() || !s_job.blocks) {
+        return 0;
+    }
+    size_t room = s_job.blocks->size - s_job.blocks->used;
+    return room > HDR_SIZE ? room - HDR_SIZE : 0;
+}
+
+void img_arena_get_stats(img_arena_stats_t *stats) {
+    *stats = s_last;
+}
@@ -0,0 +1,97 @@
+/*
+ * Image Arena - Per-job bump allocator for the image pipeline
+ *
+ * Decoding one image takes dozens of buffers (decoder state, bands, scaler
+ * rings, error rows, stb_image internals) that all die together when the
+ * job ends. A job reserves one large PSRAM block up front (sized from the
+ * previous job's peak) plus a small internal SRAM block for the hot
+ * buffers, carves every pipeline allocation out of them and releases
+ * everything at once, so long uptime no longer fragments PSRAM into pieces
+ * too small for the next image. One job runs at a time.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define IMG_ARENA_MIN_RESERVE   (1024 * 1024)   // First PSRAM block, at least
+#define IMG_ARENA_GROW          (256 * 1024)    // Further PSRAM blocks, at least
+#define IMG_ARENA_FAST_SIZE     (16 * 1024)     // Internal SRAM block
+#define IMG_ARENA_ALIGN         16
+
+// Usage of one job
+typedef struct {
+    size_t peak;                // Most arena bytes in use at once
+    size_t reserved;            // PSRAM reserved, all blocks
+    size_t fast_peak;           // Most internal SRAM bytes in use at once
+    int blocks;                 // PSRAM blocks reserved
+    int allocs;                 // Allocations served
+    int heap_fallbacks;         // Allocations the arena could not serve
+} img_arena_stats_t;
+
+/**
+ * @brief Create the job lock (call once at startup)
+ * @return ESP_OK or ESP_ERR_NO_MEM
+ */
+esp_err_t img_arena_init(void);
+
+/**
+ * @brief Start a job: wait for any other task's job, then reserve the arena
+ *
+ * Nested calls from the job's own task join the open job.
+ *
+ * @return ESP_OK (a failed reservation leaves the job on the plain heap)
+ */
+esp_err_t img_arena_begin(void);
+
+/**
+ * @brief End the job and release all its memory
+ *
+ * Every arena allocation of the job becomes invalid; the outermost call
+ * logs the job's usage.
+ */
+void img_arena_end(void);
+
+/**
+ * @brief Allocate from the open job of this task, else from the heap
+ *        (PSRAM preferred)
+ * @return Memory aligned to IMG_ARENA_ALIGN, or NULL
+ */
+void *img_arena_alloc(size_t size);
+
+/**
+ * @brief Allocate zeroed memory, see img_arena_alloc
+ */
+void *img_arena_calloc(size_t count, size_t size);
+
+/**
+ * @brief Allocate zeroed memory for a hot buffer: the job's internal SRAM
+ *        block, else any internal SRAM, else as img_arena_alloc
+ */
+void *img_arena_alloc_fast(size_t size);
+
+/**
+ * @brief Resize an allocation (grows in place when it is the last one)
+ */
+void *img_arena_realloc(void *ptr, size_t size);
+
+/**
+ * @brief Free an allocation from img_arena_alloc* or the heap
+ *
+ * Arena memory is only reclaimed when it is the last allocation; the rest
+ * goes with the job.
+ */
+void img_arena_free(void *ptr);
+
+/**
+ * @brief Bytes the open job of this task can still allocate without
+ *        reserving another block (0 without a job)
+ */
+size_t img_arena_room(void);
+
+/**
+ * @brief Get the usage of the last finished job
+ */
+void img_arena_get_stats(img_arena_stats_t *stats);
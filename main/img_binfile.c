@@ -0,0 +1,366 @@
+/*
+ * Image Bin File Implementation
+ *
+ * The compressor is a greedy single-probe LZ4 matcher (one hash slot per
+ * 4-byte prefix), which is enough for dithered frames: their redundancy is
+ * long white or black runs and short periodic patterns, both found at a
+ * small distance. The block obeys the LZ4 end-of-block rules, so standard
+ * tools can inspect a payload. Expansion is bounds-checked and writes
+ * directly into the caller's frame.
+ */
+
+#include "img_binfile.h"
+#include "img_arena.h"
+#include "board_config.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "esp_log.h"
+
+static const char *TAG = "img_binfile";
+
+static const uint8_t s_magic[4] = {'E', 'F', 'R', 'M'};
+
+#define LZ_MIN_MATCH     4
+#define LZ_LAST_LITERALS 5      // A block ends with at least 5 literals
+#define LZ_MF_LIMIT      12     // No match starts in the last 12 bytes
+#define LZ_MAX_OFFSET    65535
+#define LZ_HASH_BITS     12
+
+static inline uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t lz_hash(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Extra length bytes after a saturated token nibble
+static inline uint8_t *put_length(uint8_t *op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+// Emit one sequence; match_len 0 means the final literal-only sequence
+static uint8_t *put_sequence(uint8_t *op, const uint8_t *oend, const uint8_t *lit, size_t lit_len,
+                             size_t offset, size_t match_len) {
+    size_t need = 1 + lit_len + lit_len / 255 + 1 + (match_len ? 2 + match_len / 255 + 1 : 0);
+    if (need > (size_t)(oend - op)) {
+        return NULL;
+    }
+
+    uint8_t *token = op++;
+    *token = (lit_len >= 15 ? 15 : lit_len) << 4;
+    if (lit_len >= 15) {
+        op = put_length(op, lit_len - 15);
+    }
+    memcpy(op, lit, lit_len);
+    op += lit_len;
+
+    if (match_len) {
+        *op++ = offset & 0xFF;
+        *op++ = offset >> 8;
+        size_t m = match_len - LZ_MIN_MATCH;
+        *token |= (m >= 15) ? 15 : m;
+        if (m >= 15) {
+            op = put_length(op, m - 15);
+        }
+    }
+    return op;
+}
+
+size_t img_binfile_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t dst_cap,
+                            uint32_t *table) {
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    const uint8_t *end = src + size;
+    uint8_t *op = dst;
+    const uint8_t *oend = dst + dst_cap;
+
+    if (size > LZ_MF_LIMIT) {
+        const uint8_t *mflimit = end - LZ_MF_LIMIT;
+        const uint8_t *matchlimit = end - LZ_LAST_LITERALS;
+        memset(table, 0, IMG_BINFILE_LZ_TABLE * sizeof(uint32_t));
+
+        ip++;
+        while (ip < mflimit) {
+            uint32_t seq = read32(ip);
+            uint32_t h = lz_hash(seq);
+            const uint8_t *ref = src + table[h];
+            table[h] = ip - src;
+            if (ref >= ip || ip - ref > LZ_MAX_OFFSET || read32(ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            // Extend backwards over pending literals, then forwards
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const uint8_t *mp = ip + LZ_MIN_MATCH;
+            const uint8_t *rp = ref + LZ_MIN_MATCH;
+            while (mp < matchlimit && *mp == *rp) {
+                mp++;
+                rp++;
+            }
+
+            op = put_sequence(op, oend, anchor, ip - anchor, ip - ref, mp - ip);
+            if (!op) {
+                return 0;
+            }
+            ip = anchor = mp;
+            if (ip < mflimit) {
+                table[lz_hash(read32(ip - 2))] = ip - 2 - src;
+            }
+        }
+    }
+
+    op = put_sequence(op, oend, anchor, end - anchor, 0, 0);
+    return op ? (size_t)(op - dst) : 0;
+}
+
+// Length continuation bytes; false if the input ends first
+static inline bool get_length(const uint8_t **ip, const uint8_t *iend, size_t *len) {
+    uint8_t b;
+    do {
+        if (*ip >= iend) {
+            return false;
+        }
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+esp_err_t img_binfile_decompress(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size) {
+    const uint8_t *ip = src;
+    const uint8_t *iend = src + src_size;
+    uint8_t *op = dst;
+    uint8_t *oend = dst + dst_size;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        size_t lit = token >> 4;
+        if (lit == 15 && !get_length(&ip, iend, &lit)) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        if (lit > (size_t)(iend - ip) || lit > (size_t)(oend - op)) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        memcpy(op, ip, lit);
+        ip += lit;
+        op += lit;
+        if (ip == iend) {
+            break;      // Last sequence has no match
+        }
+
+        if (iend - ip < 2) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t len = token & 15;
+        if (len == 15 && !get_length(&ip, iend, &len)) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        len += LZ_MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(op - dst) || len > (size_t)(oend - op)) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+
+        // Overlapping copies (offset < len) repeat the last offset bytes
+        const uint8_t *ref = op - offset;
+        if (offset >= len) {
+            memcpy(op, ref, len);
+            op += len;
+        } else {
+            while (len--) {
+                *op++ = *ref++;
+            }
+        }
+    }
+    return (op == oend) ? ESP_OK : ESP_ERR_INVALID_RESPONSE;
+}
+
+static inline uint16_t get_le16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t get_le32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+esp_err_t img_binfile_open(img_binfile_t *bf, const char *path) {
+    memset(bf, 0, sizeof(*bf));
+    bf->fp = fopen(path, "rb");
+    if (!bf->fp) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    fseek(bf->fp, 0, SEEK_END);
+    long file_size = ftell(bf->fp);
+    rewind(bf->fp);
+
+    // Header: magic, version, codec, bpp, reserved, width, height, payload
+    // size; version 2 adds the render parameters hash
+    uint8_t hdr[IMG_BINFILE_HEADER_SIZE];
+    if (file_size > IMG_BINFILE_HEADER_SIZE_V1 &&
+        fread(hdr, 1, IMG_BINFILE_HEADER_SIZE_V1, bf->fp) == IMG_BINFILE_HEADER_SIZE_V1 &&
+        memcmp(hdr, s_magic, sizeof(s_magic)) == 0) {
+        int version = hdr[4];
+        int bpp = hdr[6];
+        long hdr_size = (version == 1) ? IMG_BINFILE_HEADER_SIZE_V1 : IMG_BINFILE_HEADER_SIZE;
+        if (version >= 2 && fread(hdr + IMG_BINFILE_HEADER_SIZE_V1, 1,
+                                  IMG_BINFILE_HEADER_SIZE - IMG_BINFILE_HEADER_SIZE_V1, bf->fp) !=
+                            IMG_BINFILE_HEADER_SIZE - IMG_BINFILE_HEADER_SIZE_V1) {
+            img_binfile_close(bf);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (version < 1 || version > IMG_BINFILE_VERSION || hdr[5] > IMG_BINFILE_LZ ||
+            (bpp != 1 && bpp != 2 && bpp != 4) ||
+            get_le16(hdr + 8) != EPAPER_WIDTH || get_le16(hdr + 10) != EPAPER_HEIGHT ||
+            get_le32(hdr + 12) != (uint32_t)(file_size - hdr_size)) {
+            ESP_LOGW(TAG, "Unsupported frame file %s (v%d, codec %d, %dbpp)", path, version, hdr[5], bpp);
+            img_binfile_close(bf);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        bf->format = img_format_from_bpp(bpp);
+        bf->codec = hdr[5];
+        bf->frame_size = img_frame_size(bf->format, EPAPER_WIDTH, EPAPER_HEIGHT);
+        bf->payload_offset = hdr_size;
+        bf->payload_size = file_size - hdr_size;
+        bf->params_hash = (version >= 2) ? get_le32(hdr + 16) : 0;
+        return ESP_OK;
+    }
+
+    // Headerless: exactly one frame
+    if (file_size > 0 && img_format_from_size(file_size, &bf->format)) {
+        bf->codec = IMG_BINFILE_RAW;
+        bf->frame_size = file_size;
+        bf->payload_offset = 0;
+        bf->payload_size = file_size;
+        return ESP_OK;
+    }
+
+    img_binfile_close(bf);
+    return ESP_ERR_INVALID_SIZE;
+}
+
+esp_err_t img_binfile_open_render(img_binfile_t *bf, const char *path, const img_process_opts_t *opts) {
+    esp_err_t ret = img_binfile_open(bf, path);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    uint32_t expected = img_opts_hash(opts);
+    if (bf->params_hash != expected) {
+        ESP_LOGI(TAG, "Stale frame %s (hash %08lx, want %08lx)", path,
+                 (unsigned long)bf->params_hash, (unsigned long)expected);
+        img_binfile_close(bf);
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t img_binfile_read(img_binfile_t *bf, uint8_t *out, size_t out_size) {
+    if (!bf->fp || out_size != bf->frame_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (fseek(bf->fp, bf->payload_offset, SEEK_SET) != 0) {
+        return ESP_FAIL;
+    }
+
+    if (bf->codec == IMG_BINFILE_RAW) {
+        if (bf->payload_size != out_size) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        return (fread(out, 1, out_size, bf->fp) == out_size) ? ESP_OK : ESP_FAIL;
+    }
+
+    uint8_t *payload = img_arena_alloc(bf->payload_size);
+    if (!payload) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t ret = ESP_FAIL;
+    if (fread(payload, 1, bf->payload_size, bf->fp) == bf->payload_size) {
+        ret = img_binfile_decompress(payload, bf->payload_size, out, out_size);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Corrupt frame payload");
+        }
+    }
+    img_arena_free(payload);
+    return ret;
+}
+
+void img_binfile_close(img_binfile_t *bf) {
+    if (bf->fp) {
+        fclose(bf->fp);
+        bf->fp = NULL;
+    }
+}
+
+esp_err_t img_binfile_write(const char *path, const uint8_t *frame, size_t size, uint32_t params_hash) {
+    img_format_t format;
+    if (!img_format_from_size(size, &format)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Compress into a buffer one byte short of the frame: no gain, store raw
+    const uint8_t *payload = frame;
+    size_t payload_size = size;
+    img_binfile_codec_t codec = IMG_BINFILE_RAW;
+    uint8_t *packed = img_arena_alloc(size);
+    uint32_t *table = img_arena_alloc(IMG_BINFILE_LZ_TABLE * sizeof(uint32_t));
+    if (packed && table) {
+        size_t n = img_binfile_compress(frame, size, packed, size - 1, table);
+        if (n) {
+            payload = packed;
+            payload_size = n;
+            codec = IMG_BINFILE_LZ;
+        }
+    } else {
+        ESP_LOGW(TAG, "No memory to compress, storing raw frame");
+    }
+    img_arena_free(table);
+
+    int bpp = img_format_bpp(format);
+    uint8_t hdr[IMG_BINFILE_HEADER_SIZE] = {
+        s_magic[0], s_magic[1], s_magic[2], s_magic[3],
+        IMG_BINFILE_VERSION, codec, bpp, 0,
+        EPAPER_WIDTH & 0xFF, EPAPER_WIDTH >> 8,
+        EPAPER_HEIGHT & 0xFF, EPAPER_HEIGHT >> 8,
+        payload_size & 0xFF, (payload_size >> 8) & 0xFF,
+        (payload_size >> 16) & 0xFF, (payload_size >> 24) & 0xFF,
+        params_hash & 0xFF, (params_hash >> 8) & 0xFF,
+        (params_hash >> 16) & 0xFF, (params_hash >> 24) & 0xFF,
+    };
+
+    esp_err_t ret = ESP_FAIL;
+    FILE *f = fopen(path, "wb");
+    if (f) {
+        bool ok = fwrite(hdr, 1, sizeof(hdr), f) == sizeof(hdr) &&
+                  fwrite(payload, 1, payload_size, f) == payload_size;
+        if (fclose(f) == 0 && ok) {
+            ret = ESP_OK;
+        } else {
+            unlink(path);
+        }
+    }
+    img_arena_free(packed);
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Frame saved: %s (%dbpp, %d -> %d bytes)", path, bpp, (int)size,
+                 (int)(payload_size + IMG_BINFILE_HEADER_SIZE));
+    } else {
+        ESP_LOGE(TAG, "Failed to write frame file %s", path);
+    }
+    return ret;
+}
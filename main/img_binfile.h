@@ -0,0 +1,107 @@
+/*
+ * Image Bin File - Versioned container for pre-rendered frames (.bin)
+ *
+ * A 20-byte header (magic, version, codec, depth, size, hash of the
+ * processing parameters the frame was rendered with) followed by the
+ * packed frame, stored raw or LZ-compressed in the LZ4 block format: runs
+ * of paper white and repeating dither patterns become back-references, so a
+ * frame costs a fraction of the SD reads of a raw one. Headerless files of
+ * exactly one 1/2/4bpp frame (older firmware, uploaded .bin/.raw) are still
+ * read, by size.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include "esp_err.h"
+#include "image_processor.h"
+
+#define IMG_BINFILE_VERSION     2
+#define IMG_BINFILE_HEADER_SIZE 20
+#define IMG_BINFILE_HEADER_SIZE_V1 16   // Version 1: no parameters hash
+#define IMG_BINFILE_LZ_TABLE    4096    // Compressor hash table entries
+
+// Payload codecs
+typedef enum {
+    IMG_BINFILE_RAW = 0,        // Packed frame as is
+    IMG_BINFILE_LZ = 1,         // LZ4 block format
+} img_binfile_codec_t;
+
+// Open frame file
+typedef struct {
+    FILE *fp;
+    img_format_t format;
+    img_binfile_codec_t codec;
+    size_t frame_size;          // Unpacked frame bytes
+    long payload_offset;        // 0 for headerless files
+    size_t payload_size;
+    uint32_t params_hash;       // img_opts_hash of the render, 0 = unknown
+} img_binfile_t;
+
+/**
+ * @brief Open a frame file and read its header
+ * @param bf File state
+ * @param path Full path
+ * @return ESP_OK, ESP_ERR_NOT_FOUND, or ESP_ERR_INVALID_SIZE (neither a
+ *         frame container nor one raw frame)
+ */
+esp_err_t img_binfile_open(img_binfile_t *bf, const char *path);
+
+/**
+ * @brief Open the pre-rendered frame of a stored image, if it is current
+ *
+ * A frame is current when it was rendered with exactly these options by
+ * this pipeline version; anything else (other settings, older firmware, a
+ * headerless file) must be rendered again.
+ *
+ * @param bf File state
+ * @param path Full path of the .bin
+ * @param opts Options the image would be rendered with now
+ * @return ESP_OK, ESP_ERR_NOT_FOUND, ESP_ERR_INVALID_STATE (stale) or
+ *         ESP_ERR_INVALID_SIZE
+ */
+esp_err_t img_binfile_open_render(img_binfile_t *bf, const char *path, const img_process_opts_t *opts);
+
+/**
+ * @brief Read the frame, expanding it straight into the destination
+ * @param bf File state (after img_binfile_open)
+ * @param out Destination (bf->frame_size bytes, e.g. the framebuffer)
+ * @param out_size Destination size, must equal bf->frame_size
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE, ESP_ERR_INVALID_RESPONSE (corrupt
+ *         payload), ESP_ERR_NO_MEM or ESP_FAIL
+ */
+esp_err_t img_binfile_read(img_binfile_t *bf, uint8_t *out, size_t out_size);
+
+/**
+ * @brief Close the file
+ */
+void img_binfile_close(img_binfile_t *bf);
+
+/**
+ * @brief Write a full-screen frame, compressed when that makes it smaller
+ * @param path Full path
+ * @param frame Packed frame
+ * @param size Frame size (one 1/2/4bpp screen buffer)
+ * @param params_hash img_opts_hash of the options the frame was rendered with
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE or ESP_FAIL
+ */
+esp_err_t img_binfile_write(const char *path, const uint8_t *frame, size_t size, uint32_t params_hash);
+
+/**
+ * @brief Compress a buffer in the LZ4 block format
+ * @param src Source data
+ * @param size Source size
+ * @param dst Destination
+ * @param dst_cap Destination capacity
+ * @param table Hash table of IMG_BINFILE_LZ_TABLE entries (scratch)
+ * @return Compressed size, or 0 if it does not fit in dst_cap
+ */
+size_t img_binfile_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t dst_cap,
+                            uint32_t *table);
+
+/**
+ * @brief Expand an LZ4 block into exactly dst_size bytes
+ * @return ESP_OK or ESP_ERR_INVALID_RESPONSE (corrupt or wrong size)
+ */
+esp_err_t img_binfile_decompress(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size);
@@ -0,0 +1,521 @@
+/*
+ * Image BMP Implementation
+ *
+ * Bottom-up files are the common case, and reading them row by row from
+ * the end would mean one backward seek per row; a band of rows is read
+ * per seek instead and emitted in reverse. Bitfield channels of any width
+ * go through a small table to 8 bits, so 16 and 32-bit rows share one loop.
+ */
+
+#include "img_bmp.h"
+#include "img_arena.h"
+#include "img_tone.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include "esp_log.h"
+
+static const char *TAG = "img_bmp";
+
+#define READ_BUF_SIZE   4096
+#define BAND_SIZE       32768
+#define MAX_DIM         32767
+
+// Compression types
+#define BI_RGB              0
+#define BI_RLE8             1
+#define BI_RLE4             2
+#define BI_BITFIELDS        3
+#define BI_ALPHABITFIELDS   6
+
+// ---- Input ----
+
+static int read_byte(bmp_dec_t *dec)
+{
+    if (dec->fp) {
+        if (dec->buf_pos >= dec->buf_len) {
+            dec->buf_len = fread(dec->buf, 1, READ_BUF_SIZE, dec->fp);
+            dec->buf_pos = 0;
+            if (dec->buf_len == 0) return -1;
+        }
+        return dec->buf[dec->buf_pos++];
+    }
+    return (dec->pos < dec->size) ? dec->data[dec->pos++] : -1;
+}
+
+static size_t read_bytes(bmp_dec_t *dec, uint8_t *dst, size_t n)
+{
+    if (!dec->fp) {
+        size_t avail = (dec->pos < dec->size) ? dec->size - dec->pos : 0;
+        if (n > avail) n = avail;
+        memcpy(dst, dec->data + dec->pos, n);
+        dec->pos += n;
+        return n;
+    }
+    size_t got = dec->buf_len - dec->buf_pos;
+    if (got > n) got = n;
+    memcpy(dst, dec->buf + dec->buf_pos, got);
+    dec->buf_pos += got;
+    if (got < n) {
+        got += fread(dst + got, 1, n - got, dec->fp);
+    }
+    return got;
+}
+
+// Position the input at a byte offset into the pixel data
+static void seek_data(bmp_dec_t *dec, size_t off)
+{
+    if (dec->fp) {
+        fseek(dec->fp, dec->base + (long)(dec->offset + off), SEEK_SET);
+        dec->buf_len = 0;
+        dec->buf_pos = 0;
+    } else {
+        dec->pos = dec->offset + off;
+    }
+}
+
+static inline uint32_t le16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// ---- Header ----
+
+// Shift and 8-bit table for one bitfield (fields wider than 8 bits keep their top 8)
+static void setup_field(bmp_dec_t *dec, int c)
+{
+    uint32_t m = dec->mask[c];
+    int shift = 0, bits = 0;
+    if (m) {
+        while (!(m & 1)) {
+            m >>= 1;
+            shift++;
+        }
+        while (m & 1) {
+            m >>= 1;
+            bits++;
+        }
+    }
+    if (bits > 8) {
+        shift += bits - 8;
+        bits = 8;
+    }
+
+    int maxv = (1 << bits) - 1;
+    dec->shift[c] = shift;
+    dec->vmask[c] = maxv;
+    for (int v = 0; v < 256; v++) {
+        dec->lut[c][v] = maxv ? ((v > maxv) ? 255 : (v * 255 + maxv / 2) / maxv) : 0;
+    }
+}
+
+static bool valid_format(int bpp, int compression)
+{
+    switch (compression) {
+    case BI_RGB:
+        return bpp == 1 || bpp == 2 || bpp == 4 || bpp == 8 ||
+               bpp == 16 || bpp == 24 || bpp == 32;
+    case BI_RLE8:
+        return bpp == 8;
+    case BI_RLE4:
+        return bpp == 4;
+    case BI_BITFIELDS:
+    case BI_ALPHABITFIELDS:
+        return bpp == 16 || bpp == 32;
+    default:
+        return false;
+    }
+}
+
+static esp_err_t read_palette(bmp_dec_t *dec, uint32_t colors, int entry, size_t consumed)
+{
+    int n = colors ? ((colors > 256) ? 256 : (int)colors) : (1 << dec->bpp);
+    size_t avail = (dec->offset > consumed) ? (dec->offset - consumed) / entry : 0;
+    if ((size_t)n > avail) {
+        n = (int)avail;
+    }
+
+    uint8_t e[4];
+    for (int i = 0; i < n; i++) {
+        if (read_bytes(dec, e, entry) != (size_t)entry) {
+            return ESP_FAIL;
+        }
+        dec->palette[i][0] = e[2];
+        dec->palette[i][1] = e[1];
+        dec->palette[i][2] = e[0];
+    }
+
+    // No palette at all: treat the indices as gray levels
+    if (n == 0) {
+        int maxv = (1 << dec->bpp) - 1;
+        for (int i = 0; i <= maxv; i++) {
+            uint8_t v = i * 255 / maxv;
+            dec->palette[i][0] = dec->palette[i][1] = dec->palette[i][2] = v;
+        }
+        n = maxv + 1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        dec->palette_gray[i] = img_luma(dec->palette[i]);
+    }
+    return ESP_OK;
+}
+
+// ---- Rows ----
+
+// Unpack RLE8/RLE4 data into the index buffer (skipped pixels stay index 0)
+static esp_err_t expand_rle(bmp_dec_t *dec)
+{
+    int w = dec->width, h = dec->height;
+    dec->indices = img_arena_calloc(1, (size_t)w * h);
+    if (!dec->indices) {
+        ESP_LOGE(TAG, "Cannot allocate RLE buffer (%u KB)", (unsigned)((size_t)w * h / 1024));
+        return ESP_ERR_NO_MEM;
+    }
+
+    seek_data(dec, 0);
+    bool rle4 = dec->compression == BI_RLE4;
+    int x = 0, y = 0;           // y counts stored rows
+    uint8_t *row = dec->indices + (size_t)(dec->bottom_up ? h - 1 : 0) * w;
+
+    while (y < h) {
+        int n = read_byte(dec);
+        int v = read_byte(dec);
+        if (v < 0) {
+            dec->truncated = true;
+            break;
+        }
+
+        if (n > 0) {
+            // Run: one index, or two alternating nibbles
+            for (int i = 0; i < n && x < w; i++, x++) {
+                row[x] = rle4 ? ((i & 1) ? (v & 15) : (v >> 4)) : v;
+            }
+            continue;
+        }
+        if (v == 0 || v == 2) {
+            int dx = 0, dy = 1;
+            if (v == 2) {
+                dx = read_byte(dec);
+                dy = read_byte(dec);
+                if (dy < 0) {
+                    dec->truncated = true;
+                    break;
+                }
+            }
+            x = (v == 0) ? 0 : x + dx;
+            y += dy;
+            if (y < h) {
+                row = dec->indices + (size_t)(dec->bottom_up ? h - 1 - y : y) * w;
+            }
+            continue;
+        }
+        if (v == 1) {
+            break;
+        }
+
+        // Absolute run of v indices, padded to 16 bits
+        int bytes = rle4 ? (v + 1) / 2 : v;
+        int b = 0;
+        for (int i = 0; i < v; i++) {
+            if (!rle4 || !(i & 1)) {
+                b = read_byte(dec);
+                if (b < 0) break;
+            }
+            if (x < w) {
+                row[x] = rle4 ? ((i & 1) ? (b & 15) : (b >> 4)) : b;
+            }
+            x++;
+        }
+        if (b < 0 || ((bytes & 1) && read_byte(dec) < 0)) {
+            dec->truncated = true;
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+// Read the band of a bottom-up file holding output rows from y down
+static void load_band(bmp_dec_t *dec, int y)
+{
+    int n = dec->height - y;
+    if (n > dec->band_rows) {
+        n = dec->band_rows;
+    }
+    seek_data(dec, (size_t)(dec->height - y - n) * dec->stride);
+    size_t got = fread(dec->band, 1, (size_t)n * dec->stride, dec->fp);
+    dec->band_y = y;
+    dec->band_n = n;
+    dec->band_valid = (int)(got / dec->stride);
+}
+
+// Stored pixel data for output row y, NULL if the file ends before it
+static const uint8_t *fetch_row(bmp_dec_t *dec, int y)
+{
+    if (dec->indices) {
+        return dec->indices + (size_t)y * dec->width;
+    }
+
+    int stored = dec->bottom_up ? dec->height - 1 - y : y;
+    if (!dec->fp) {
+        size_t start = dec->offset + (size_t)stored * dec->stride;
+        bool inside = dec->offset <= dec->size && start <= dec->size &&
+                      dec->stride <= dec->size - start;
+        return inside ? dec->data + start : NULL;
+    }
+    if (!dec->bottom_up) {
+        return (read_bytes(dec, dec->row, dec->stride) == dec->stride) ? dec->row : NULL;
+    }
+
+    if (y >= dec->band_y + dec->band_n) {
+        load_band(dec, y);
+    }
+    int i = dec->band_y + dec->band_n - 1 - y;
+    return (i < dec->band_valid) ? dec->band + (size_t)i * dec->stride : NULL;
+}
+
+static inline void put_rgb(uint8_t *out, int x, int channels, const uint8_t *rgb)
+{
+    if (channels == 1) {
+        out[x] = img_luma(rgb);
+    } else {
+        out[x * 3 + 0] = rgb[0];
+        out[x * 3 + 1] = rgb[1];
+        out[x * 3 + 2] = rgb[2];
+    }
+}
+
+static void convert_row(const bmp_dec_t *dec, const uint8_t *src, int bpp,
+                        uint8_t *out, int channels)
+{
+    int w = dec->width;
+    uint8_t rgb[3];
+
+    if (bpp <= 8) {
+        int mask = (1 << bpp) - 1;
+        for (int x = 0; x < w; x++) {
+            int idx;
+            if (bpp == 8) {
+                idx = src[x];
+            } else {
+                int bit = x * bpp;
+                idx = (src[bit >> 3] >> (8 - bpp - (bit & 7))) & mask;
+            }
+            if (channels == 1) {
+                out[x] = dec->palette_gray[idx];
+            } else {
+                memcpy(out + x * 3, dec->palette[idx], 3);
+            }
+        }
+    } else if (bpp == 24) {
+        for (int x = 0; x < w; x++, src += 3) {
+            rgb[0] = src[2];
+            rgb[1] = src[1];
+            rgb[2] = src[0];
+            put_rgb(out, x, channels, rgb);
+        }
+    } else {
+        int step = bpp / 8;
+        for (int x = 0; x < w; x++, src += step) {
+            uint32_t p = (bpp == 16) ? le16(src) : le32(src);
+            for (int c = 0; c < 3; c++) {
+                rgb[c] = dec->lut[c][(p >> dec->shift[c]) & dec->vmask[c]];
+            }
+            put_rgb(out, x, channels, rgb);
+        }
+    }
+}
+
+// ---- API ----
+
+esp_err_t bmp_dec_init(bmp_dec_t *dec, FILE *fp, const uint8_t *data, size_t size)
+{
+    memset(dec, 0, sizeof(*dec));
+    dec->fp = fp;
+    dec->data = data;
+    dec->size = size;
+    if (fp) {
+        dec->base = ftell(fp);
+        dec->buf = img_arena_alloc(READ_BUF_SIZE);
+        if (!dec->buf) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // File header, then the info header (core, V1 up to V5)
+    uint8_t hdr[140];
+    esp_err_t ret = ESP_OK;
+    uint32_t info_size = 0;
+    if (read_bytes(dec, hdr, 18) != 18 || hdr[0] != 'B' || hdr[1] != 'M') {
+        ret = ESP_ERR_NOT_SUPPORTED;
+    } else {
+        dec->offset = le32(hdr + 10);
+        info_size = le32(hdr + 14);
+        if (info_size != 12 && (info_size < 40 || info_size > 0x10000)) {
+            ESP_LOGE(TAG, "Unknown BMP header size %u", (unsigned)info_size);
+            ret = ESP_ERR_NOT_SUPPORTED;
+        }
+    }
+
+    size_t consumed = 14 + info_size;
+    uint32_t colors = 0;
+    int32_t w = 0, h = 0;
+    if (ret == ESP_OK) {
+        uint8_t *info = hdr + 14;
+        size_t keep = (info_size > 124) ? 124 : info_size;
+        if (read_bytes(dec, info + 4, keep - 4) != keep - 4) {
+            ret = ESP_FAIL;
+        }
+        for (size_t i = keep; i < info_size && ret == ESP_OK; i++) {
+            if (read_byte(dec) < 0) ret = ESP_FAIL;
+        }
+
+        if (info_size == 12) {
+            w = (int32_t)le16(info + 4);
+            h = (int32_t)le16(info + 6);
+            dec->bpp = le16(info + 10);
+        } else {
+            w = (int32_t)le32(info + 4);
+            h = (int32_t)le32(info + 8);
+            dec->bpp = le16(info + 14);
+            dec->compression = le32(info + 16);
+            colors = le32(info + 32);
+        }
+
+        // Bitfield masks follow a V1 header, inside V2 and later ones
+        bool bitfields = dec->compression == BI_BITFIELDS ||
+                         dec->compression == BI_ALPHABITFIELDS;
+        if (ret == ESP_OK && bitfields && info_size < 52) {
+            size_t extra = (dec->compression == BI_ALPHABITFIELDS) ? 16 : 12;
+            if (read_bytes(dec, info + 40, extra) != extra) {
+                ret = ESP_FAIL;
+            }
+            consumed += extra;
+        }
+        if (bitfields) {
+            dec->mask[0] = le32(info + 40);
+            dec->mask[1] = le32(info + 44);
+            dec->mask[2] = le32(info + 48);
+        } else if (dec->bpp == 16) {
+            dec->mask[0] = 0x7C00;
+            dec->mask[1] = 0x03E0;
+            dec->mask[2] = 0x001F;
+        } else if (dec->bpp == 32) {
+            dec->mask[0] = 0xFF0000;
+            dec->mask[1] = 0x00FF00;
+            dec->mask[2] = 0x0000FF;
+        }
+    }
+
+    if (ret == ESP_OK && (w <= 0 || w > MAX_DIM || h == 0 || h < -MAX_DIM || h > MAX_DIM)) {
+        ESP_LOGE(TAG, "Bad BMP size %ldx%ld", (long)w, (long)h);
+        ret = ESP_FAIL;
+    }
+    if (ret == ESP_OK && !valid_format(dec->bpp, dec->compression)) {
+        ESP_LOGE(TAG, "Unsupported BMP: %d bpp, compression %d", dec->bpp, dec->compression);
+        ret = ESP_ERR_NOT_SUPPORTED;
+    }
+
+    if (ret == ESP_OK) {
+        dec->width = w;
+        dec->height = (h < 0) ? -h : h;
+        dec->bottom_up = h > 0;
+        dec->stride = (((size_t)w * dec->bpp + 31) / 32) * 4;
+        if (dec->bpp <= 8) {
+            ret = read_palette(dec, colors, (info_size == 12) ? 3 : 4, consumed);
+        } else if (dec->bpp != 24) {
+            for (int c = 0; c < 3; c++) {
+                setup_field(dec, c);
+            }
+        }
+    }
+
+    if (ret != ESP_OK) {
+        bmp_dec_deinit(dec);
+    }
+    return ret;
+}
+
+size_t bmp_dec_mem(const bmp_dec_t *dec, int channels)
+{
+    size_t mem = (size_t)dec->width * channels;
+    if (dec->compression == BI_RLE8 || dec->compression == BI_RLE4) {
+        mem += (size_t)dec->width * dec->height;
+    } else if (dec->fp && dec->bottom_up) {
+        int rows = BAND_SIZE / dec->stride;
+        if (rows < 1) rows = 1;
+        if (rows > dec->height) rows = dec->height;
+        mem += (size_t)rows * dec->stride;
+    } else if (dec->fp) {
+        mem += dec->stride;
+    }
+    return mem;
+}
+
+esp_err_t bmp_dec_decode(bmp_dec_t *dec, int channels, img_row_cb_t cb, void *cb_ctx)
+{
+    if (channels != 1 && channels != 3) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ESP_LOGI(TAG, "BMP %dx%d, %d bpp, compression %d, %s", dec->width, dec->height,
+             dec->bpp, dec->compression, dec->bottom_up ? "bottom-up" : "top-down");
+
+    dec->out = img_arena_alloc((size_t)dec->width * channels);
+    if (!dec->out) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    int row_bpp = dec->bpp;
+    esp_err_t ret = ESP_OK;
+    if (dec->compression == BI_RLE8 || dec->compression == BI_RLE4) {
+        ret = expand_rle(dec);
+        row_bpp = 8;
+    } else if (dec->fp && dec->bottom_up) {
+        dec->band_rows = BAND_SIZE / dec->stride;
+        if (dec->band_rows < 1) dec->band_rows = 1;
+        if (dec->band_rows > dec->height) dec->band_rows = dec->height;
+        dec->band = img_arena_alloc((size_t)dec->band_rows * dec->stride);
+        ret = dec->band ? ESP_OK : ESP_ERR_NO_MEM;
+    } else if (dec->fp) {
+        dec->row = img_arena_alloc(dec->stride);
+        ret = dec->row ? ESP_OK : ESP_ERR_NO_MEM;
+        seek_data(dec, 0);
+    }
+
+    for (int y = 0; y < dec->height && ret == ESP_OK; y++) {
+        const uint8_t *src = fetch_row(dec, y);
+        if (src) {
+            convert_row(dec, src, row_bpp, dec->out, channels);
+        } else {
+            memset(dec->out, 0xFF, (size_t)dec->width * channels);
+            dec->truncated = true;
+        }
+        ret = cb(cb_ctx, dec->out, y);
+    }
+
+    if (dec->truncated) {
+        ESP_LOGW(TAG, "Truncated BMP, missing rows left white");
+    }
+    return ret;
+}
+
+void bmp_dec_deinit(bmp_dec_t *dec)
+{
+    if (!dec) return;
+    img_arena_free(dec->buf);
+    img_arena_free(dec->band);
+    img_arena_free(dec->indices);
+    img_arena_free(dec->row);
+    img_arena_free(dec->out);
+    dec->buf = NULL;
+    dec->band = NULL;
+    dec->indices = NULL;
+    dec->row = NULL;
+    dec->out = NULL;
+}
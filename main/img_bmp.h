@@ -0,0 +1,93 @@
+/*
+ * Image BMP - Streaming BMP decoder (row callbacks, gray or RGB output)
+ *
+ * Uncompressed rows are read straight from the file in display order:
+ * top-down files sequentially, bottom-up ones in bands read from the end
+ * of the pixel data backwards, so memory is one band rather than the image.
+ * Handles 1/2/4/8-bit palettes, 16/32-bit bitfields, 24-bit BGR and
+ * RLE4/RLE8. RLE data can only be expanded in file order, so those images
+ * are unpacked into an index buffer of one byte per pixel first.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "esp_err.h"
+#include "image_processor.h"
+
+// Decoder state
+typedef struct {
+    // Input
+    FILE *fp;
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+    long base;                  // File offset of the BMP header
+    uint8_t *buf;               // File read buffer
+    size_t buf_len;
+    size_t buf_pos;
+
+    // Header
+    int width;
+    int height;
+    bool bottom_up;
+    int bpp;                    // Bits per pixel
+    int compression;            // BI_* value
+    uint32_t offset;            // Pixel data offset from the BMP header
+    size_t stride;              // Bytes per stored row (4-byte aligned)
+    uint8_t palette[256][3];    // RGB
+    uint8_t palette_gray[256];
+    uint32_t mask[3];           // R, G, B bitfields
+    uint8_t shift[3];           // Right shift to the top 8 bits of each field
+    uint8_t vmask[3];           // Field mask after the shift
+    uint8_t lut[3][256];        // Field value to 8 bits
+
+    // Rows
+    uint8_t *band;              // Rows of a bottom-up file, stored order
+    int band_rows;              // Band capacity in rows
+    int band_y;                 // First output row in the band
+    int band_n;                 // Rows in the band
+    int band_valid;             // Rows actually read (from the band's bottom)
+    uint8_t *indices;           // Expanded RLE image, one index per pixel
+    uint8_t *row;               // Top-down file row
+    uint8_t *out;               // Converted output row
+    bool truncated;
+} bmp_dec_t;
+
+/**
+ * @brief Read the BMP headers, palette and bitfields
+ * @param dec Decoder state
+ * @param fp Source file positioned at the start of the BMP, or NULL
+ * @param data Source data when fp is NULL
+ * @param size Source data size
+ * @return ESP_OK, ESP_ERR_NOT_SUPPORTED (not a BMP or unknown variant),
+ *         ESP_ERR_NO_MEM or ESP_FAIL
+ */
+esp_err_t bmp_dec_init(bmp_dec_t *dec, FILE *fp, const uint8_t *data, size_t size);
+
+/**
+ * @brief Bytes bmp_dec_decode allocates
+ * @param dec Decoder state (after bmp_dec_init)
+ * @param channels 1 for gray rows, 3 for RGB rows
+ */
+size_t bmp_dec_mem(const bmp_dec_t *dec, int channels);
+
+/**
+ * @brief Read the pixel data and emit rows top to bottom
+ *
+ * Rows missing from a truncated file are emitted white.
+ *
+ * @param dec Decoder state (after bmp_dec_init)
+ * @param channels 1 for gray rows, 3 for RGB rows
+ * @param cb Called once per output row, in order
+ * @param cb_ctx Passed to cb
+ * @return ESP_OK, the callback's error, ESP_ERR_NO_MEM or ESP_FAIL
+ */
+esp_err_t bmp_dec_decode(bmp_dec_t *dec, int channels, img_row_cb_t cb, void *cb_ctx);
+
+/**
+ * @brief Free the decoder buffers
+ */
+void bmp_dec_deinit(bmp_dec_t *dec);
@@ -0,0 +1,827 @@
+/*
+ * Image Dither Implementation
+ *
+ * Error diffusion that keeps only the error terms of the rows below the
+ * one being processed instead of a full-frame int16 copy of the image.
+ * The few error rows live in internal SRAM and pixels are packed straight
+ * into 1bpp bytes (or 2bpp / 4bpp gray levels). With serpentine off it
+ * produces exactly the same pixels as diffusing over the whole frame.
+ *
+ * img_dither_frame splits the rows of a frame between two workers, one per
+ * core. Even rows go to worker 0 and odd rows to worker 1; each row trails
+ * the row above it by a fixed number of pixels (wavefront), so every error
+ * term is complete before it is read and the result equals the serial one.
+ */
+
+#include "img_dither.h"
+#include "img_arena.h"
+#include "img_kernels.h"
+#include "blue_noise_64.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+static const char *TAG = "img_dither";
+
+// Error rows are padded so diffusion at the edges needs no bounds checks
+#define ERR_PAD 2
+
+// Bayer 8x8 index -> threshold in 1..255 (pixel on if gray >= threshold)
+#define BAYER(m) (1 + (m) * 255 / 64)
+
+static const uint8_t bayer_8x8[8 * 8] = {
+    BAYER(0),  BAYER(32), BAYER(8),  BAYER(40), BAYER(2),  BAYER(34), BAYER(10), BAYER(42),
+    BAYER(48), BAYER(16), BAYER(56), BAYER(24), BAYER(50), BAYER(18), BAYER(58), BAYER(26),
+    BAYER(12), BAYER(44), BAYER(4),  BAYER(36), BAYER(14), BAYER(46), BAYER(6),  BAYER(38),
+    BAYER(60), BAYER(28), BAYER(52), BAYER(20), BAYER(62), BAYER(30), BAYER(54), BAYER(22),
+    BAYER(3),  BAYER(35), BAYER(11), BAYER(43), BAYER(1),  BAYER(33), BAYER(9),  BAYER(41),
+    BAYER(51), BAYER(19), BAYER(59), BAYER(27), BAYER(49), BAYER(17), BAYER(57), BAYER(25),
+    BAYER(15), BAYER(47), BAYER(7),  BAYER(39), BAYER(13), BAYER(45), BAYER(5),  BAYER(37),
+    BAYER(63), BAYER(31), BAYER(55), BAYER(23), BAYER(61), BAYER(29), BAYER(53), BAYER(21),
+};
+
+// Nearest level for every gray value, and the gray value of every level
+static void build_quant_table(img_quant_t *q, int bpp)
+{
+    q->nlev = 1 << bpp;
+    for (int v = 0; v < 256; v++) {
+        q->level[v] = (v * (q->nlev - 1) + 127) / 255;
+    }
+    for (int l = 0; l < q->nlev; l++) {
+        q->value[l] = l * 255 / (q->nlev - 1);
+    }
+}
+
+esp_err_t img_dither_init(img_dither_t *d, int width, int height,
+                          const img_process_opts_t *opts)
+{
+    if (!d || !opts || width <= 0 || height <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(d, 0, sizeof(*d));
+    d->width = width;
+    d->height = height;
+    d->algo = opts->dither;
+    d->threshold = opts->threshold;
+    d->invert = opts->invert;
+    d->serpentine = opts->serpentine;
+    d->bpp = img_format_bpp(opts->format);
+    build_quant_table(&d->quant, d->bpp);
+
+    int rows = 0;
+    if (d->algo == DITHER_FLOYD) {
+        rows = 2;
+    } else if (d->algo == DITHER_ATKINSON) {
+        rows = 3;
+    }
+
+    size_t row_bytes = (width + ERR_PAD * 2) * sizeof(int16_t);
+    for (int i = 0; i < rows; i++) {
+        int16_t *buf = img_arena_alloc_fast(row_bytes);
+        if (!buf) {
+            ESP_LOGE(TAG, "Cannot allocate error row (%d bytes)", (int)row_bytes);
+            img_dither_deinit(d);
+            return ESP_ERR_NO_MEM;
+        }
+        d->err[i] = buf + ERR_PAD;
+    }
+
+    d->packed = img_arena_alloc_fast((width * d->bpp + 7) / 8);
+    if (d->bpp > 1) {
+        d->levels = img_arena_alloc_fast(width);
+    }
+    if (!d->packed || (d->bpp > 1 && !d->levels)) {
+        ESP_LOGE(TAG, "Cannot allocate row buffer");
+        img_dither_deinit(d);
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+void img_dither_deinit(img_dither_t *d)
+{
+    if (!d) return;
+    for (int i = 0; i < 3; i++) {
+        if (d->err[i]) {
+            img_arena_free(d->err[i] - ERR_PAD);
+            d->err[i] = NULL;
+        }
+    }
+    img_arena_free(d->packed);
+    img_arena_free(d->levels);
+    d->packed = NULL;
+    d->levels = NULL;
+}
+
+// Move the error window one row down and clear the newly exposed row
+static void rotate_err_rows(img_dither_t *d, int rows)
+{
+    int16_t *first = d->err[0];
+    for (int i = 0; i < rows - 1; i++) {
+        d->err[i] = d->err[i + 1];
+    }
+    d->err[rows - 1] = first;
+    memset(first - ERR_PAD, 0, (d->width + ERR_PAD * 2) * sizeof(int16_t));
+}
+
+// Copy one packed row to an arbitrary bit offset in the output frame
+static void put_row(uint8_t *output, size_t bit_pos, const uint8_t *packed, int count)
+{
+    uint8_t *dst = output + (bit_pos >> 3);
+    int shift = bit_pos & 7;
+    int full = count >> 3;
+    int tail = count & 7;
+
+    if (shift == 0) {
+        memcpy(dst, packed, full);
+        if (tail) {
+            uint8_t mask = 0xFF << (8 - tail);
+            dst[full] = (dst[full] & ~mask) | (packed[full] & mask);
+        }
+        return;
+    }
+
+    // Unaligned row (width not a multiple of 8): merge shifted bytes
+    uint8_t keep = 0xFF << (8 - shift);
+    for (int i = 0; i < full; i++) {
+        dst[i] = (dst[i] & keep) | (packed[i] >> shift);
+        dst[i + 1] = (dst[i + 1] & ~keep) | (uint8_t)(packed[i] << (8 - shift));
+    }
+    for (int x = 0; x < tail; x++) {
+        size_t pos = bit_pos + full * 8 + x;
+        uint8_t mask = 0x80 >> (pos & 7);
+        if (packed[full] & (0x80 >> x)) {
+            output[pos >> 3] |= mask;
+        } else {
+            output[pos >> 3] &= ~mask;
+        }
+    }
+}
+
+// Left to right over [x0, x1): accumulate bits MSB first and store whole
+// bytes. x0 must be a multiple of 8.
+static void floyd_span(int16_t *cur, int16_t *next, const uint8_t *gray,
+                       uint8_t *packed, int x0, int x1)
+{
+    uint8_t acc = 0;
+
+    for (int x = x0; x < x1; x++) {
+        int old_val = gray[x] + cur[x];
+        int bit = (old_val < 128) ? 0 : 1;
+        int error = old_val - (bit ? 255 : 0);
+
+        acc = (acc << 1) | bit;
+        if ((x & 7) == 7) {
+            packed[x >> 3] = acc;
+        }
+
+        cur[x + 1] += error * 7 / 16;
+        next[x - 1] += error * 3 / 16;
+        next[x] += error * 5 / 16;
+        next[x + 1] += error * 1 / 16;
+    }
+    if (x1 & 7) {
+        packed[x1 >> 3] = acc << (8 - (x1 & 7));
+    }
+}
+
+// Right to left with the kernel mirrored (serpentine odd rows)
+static void dither_row_floyd_rtl(img_dither_t *d, const uint8_t *gray, uint8_t *packed)
+{
+    int16_t *cur = d->err[0];
+    int16_t *next = d->err[1];
+
+    memset(packed, 0, (d->width + 7) / 8);
+    for (int x = d->width - 1; x >= 0; x--) {
+        int old_val = gray[x] + cur[x];
+        int bit = (old_val < 128) ? 0 : 1;
+        int error = old_val - (bit ? 255 : 0);
+
+        if (bit) {
+            packed[x >> 3] |= 0x80 >> (x & 7);
+        }
+
+        cur[x - 1] += error * 7 / 16;
+        next[x + 1] += error * 3 / 16;
+        next[x] += error * 5 / 16;
+        next[x - 1] += error * 1 / 16;
+    }
+}
+
+static void atkinson_span(int16_t *cur, int16_t *next, int16_t *next2,
+                          const uint8_t *gray, uint8_t *packed, int x0, int x1)
+{
+    uint8_t acc = 0;
+
+    for (int x = x0; x < x1; x++) {
+        int old_val = gray[x] + cur[x];
+        int bit = (old_val < 128) ? 0 : 1;
+        int error = (old_val - (bit ? 255 : 0)) / 8;
+
+        acc = (acc << 1) | bit;
+        if ((x & 7) == 7) {
+            packed[x >> 3] = acc;
+        }
+
+        cur[x + 1] += error;
+        cur[x + 2] += error;
+        next[x - 1] += error;
+        next[x] += error;
+        next[x + 1] += error;
+        next2[x] += error;
+    }
+    if (x1 & 7) {
+        packed[x1 >> 3] = acc << (8 - (x1 & 7));
+    }
+}
+
+static void dither_row_atkinson_rtl(img_dither_t *d, const uint8_t *gray, uint8_t *packed)
+{
+    int16_t *cur = d->err[0];
+    int16_t *next = d->err[1];
+    int16_t *next2 = d->err[2];
+
+    memset(packed, 0, (d->width + 7) / 8);
+    for (int x = d->width - 1; x >= 0; x--) {
+        int old_val = gray[x] + cur[x];
+        int bit = (old_val < 128) ? 0 : 1;
+        int error = (old_val - (bit ? 255 : 0)) / 8;
+
+        if (bit) {
+            packed[x >> 3] |= 0x80 >> (x & 7);
+        }
+
+        cur[x - 1] += error;
+        cur[x - 2] += error;
+        next[x + 1] += error;
+        next[x] += error;
+        next[x - 1] += error;
+        next2[x] += error;
+    }
+}
+
+// Threshold-map row for ordered and blue-noise dithering; *mask wraps x
+static const uint8_t *threshold_map_row(dither_algorithm_t algo, int y, int *mask)
+{
+    if (algo == DITHER_BLUE_NOISE) {
+        *mask = BLUE_NOISE_SIZE - 1;
+        return blue_noise_64 + (y & (BLUE_NOISE_SIZE - 1)) * BLUE_NOISE_SIZE;
+    }
+    *mask = 7;
+    return bayer_8x8 + (y & 7) * 8;
+}
+
+/* ---------------------------------------------------------------------------
+ * Multi-level (2bpp / 4bpp) kernels: same diffusion weights as the 1bpp
+ * ones, quantizing to the nearest of nlev evenly spaced gray levels through
+ * a table (no divisions per pixel). dir = 1 scans [x0, x1) left to right,
+ * dir = -1 right to left.
+ * ------------------------------------------------------------------------- */
+
+static inline int quant_level(const img_quant_t *q, int v)
+{
+    return q->level[(v < 0) ? 0 : (v > 255) ? 255 : v];
+}
+
+static void floyd_levels_span(const img_quant_t *q, int16_t *cur, int16_t *next,
+                              const uint8_t *gray, uint8_t *lv, int x0, int x1, int dir)
+{
+    int x = (dir > 0) ? x0 : x1 - 1;
+    for (int n = x1 - x0; n > 0; n--, x += dir) {
+        int old_val = gray[x] + cur[x];
+        int l = quant_level(q, old_val);
+        int error = old_val - q->value[l];
+        lv[x] = l;
+
+        cur[x + dir] += error * 7 / 16;
+        next[x - dir] += error * 3 / 16;
+        next[x] += error * 5 / 16;
+        next[x + dir] += error * 1 / 16;
+    }
+}
+
+static void atkinson_levels_span(const img_quant_t *q, int16_t *cur, int16_t *next,
+                                 int16_t *next2, const uint8_t *gray, uint8_t *lv,
+                                 int x0, int x1, int dir)
+{
+    int x = (dir > 0) ? x0 : x1 - 1;
+    for (int n = x1 - x0; n > 0; n--, x += dir) {
+        int old_val = gray[x] + cur[x];
+        int l = quant_level(q, old_val);
+        int error = (old_val - q->value[l]) / 8;
+        lv[x] = l;
+
+        cur[x + dir] += error;
+        cur[x + dir * 2] += error;
+        next[x - dir] += error;
+        next[x] += error;
+        next[x + dir] += error;
+        next2[x] += error;
+    }
+}
+
+// Threshold map between the two levels around each pixel
+static void map_levels_span(const img_quant_t *q, const uint8_t *map, int mask,
+                            const uint8_t *gray, uint8_t *lv, int x0, int x1)
+{
+    int steps = q->nlev - 1;
+    for (int x = x0; x < x1; x++) {
+        int v = gray[x] * steps;
+        int base = v / 255;
+        lv[x] = base + ((v - base * 255) >= map[x & mask]);
+    }
+}
+
+static void nearest_levels_span(const img_quant_t *q, const uint8_t *gray, uint8_t *lv,
+                                int x0, int x1)
+{
+    for (int x = x0; x < x1; x++) {
+        lv[x] = q->level[gray[x]];
+    }
+}
+
+// Pack levels of [x0, x1) MSB first, four levels per 32-bit load (little
+// endian). x0 must be a multiple of 8.
+static void pack_levels(const uint8_t *lv, uint8_t *packed, int x0, int x1, int bpp)
+{
+    int x = x0;
+    uint32_t w;
+
+    if (bpp == 2) {
+        // Byte i of w lands at bits 30 - 2i of the product, nothing carries
+        uint8_t *dst = packed + x0 / 4;
+        for (; x + 4 <= x1; x += 4) {
+            memcpy(&w, lv + x, sizeof(w));
+            *dst++ = (w * 0x40100401u) >> 24;
+        }
+        if (x < x1) {
+            uint8_t acc = 0;
+            for (int i = 0; x + i < x1; i++) {
+                acc |= lv[x + i] << (6 - i * 2);
+            }
+            *dst = acc;
+        }
+    } else {
+        uint8_t *dst = packed + x0 / 2;
+        for (; x + 4 <= x1; x += 4) {
+            memcpy(&w, lv + x, sizeof(w));
+            w = ((w << 4) | (w >> 8)) & 0x00FF00FF;
+            *dst++ = w;
+            *dst++ = w >> 16;
+        }
+        for (; x + 2 <= x1; x += 2) {
+            *dst++ = (lv[x] << 4) | lv[x + 1];
+        }
+        if (x < x1) {
+            *dst = lv[x] << 4;
+        }
+    }
+}
+
+// Dither [x0, x1) of a row into gray levels and pack them
+static void levels_span(dither_algorithm_t algo, const img_quant_t *q, int bpp,
+                        int16_t *cur, int16_t *next, int16_t *next2,
+                        const uint8_t *map, int map_mask, const uint8_t *gray,
+                        uint8_t *lv, uint8_t *packed, int x0, int x1, int dir)
+{
+    switch (algo) {
+    case DITHER_FLOYD:
+        floyd_levels_span(q, cur, next, gray, lv, x0, x1, dir);
+        break;
+    case DITHER_ATKINSON:
+        atkinson_levels_span(q, cur, next, next2, gray, lv, x0, x1, dir);
+        break;
+    case DITHER_ORDERED:
+    case DITHER_BLUE_NOISE:
+        map_levels_span(q, map, map_mask, gray, lv, x0, x1);
+        break;
+    case DITHER_NONE:
+    default:
+        nearest_levels_span(q, gray, lv, x0, x1);
+        break;
+    }
+
+    pack_levels(lv, packed, x0, x1, bpp);
+}
+
+// Invert if requested, store the row and clear the padding after the frame.
+// Inverting every bit maps level l to (nlev - 1 - l) at any depth.
+static void finish_row(uint8_t *output, uint8_t *packed, int width, int height,
+                       int y, bool invert, int bpp)
+{
+    int row_bits = width * bpp;
+    if (invert) {
+        img_k_invert(packed, (row_bits + 7) / 8);
+    }
+
+    put_row(output, (size_t)y * row_bits, packed, row_bits);
+
+    size_t total = (size_t)row_bits * height;
+    if (y == height - 1 && (total & 7)) {
+        output[total >> 3] &= 0xFF << (8 - (total & 7));
+    }
+}
+
+void img_dither_row(img_dither_t *d, const uint8_t *gray, uint8_t *output)
+{
+    if (!d || !gray || !output || d->row >= d->height) return;
+
+    bool rtl = d->serpentine && (d->row & 1);
+    uint8_t *packed = d->packed;
+
+    if (d->bpp > 1) {
+        int mask = 0;
+        const uint8_t *map = threshold_map_row(d->algo, d->row, &mask);
+        levels_span(d->algo, &d->quant, d->bpp, d->err[0], d->err[1], d->err[2],
+                    map, mask, gray, d->levels, packed, 0, d->width, rtl ? -1 : 1);
+        if (d->algo == DITHER_FLOYD) {
+            rotate_err_rows(d, 2);
+        } else if (d->algo == DITHER_ATKINSON) {
+            rotate_err_rows(d, 3);
+        }
+        finish_row(output, packed, d->width, d->height, d->row, d->invert, d->bpp);
+        d->row++;
+        return;
+    }
+
+    switch (d->algo) {
+    case DITHER_FLOYD:
+        if (rtl) {
+            dither_row_floyd_rtl(d, gray, packed);
+        } else {
+            floyd_span(d->err[0], d->err[1], gray, packed, 0, d->width);
+        }
+        rotate_err_rows(d, 2);
+        break;
+    case DITHER_ATKINSON:
+        if (rtl) {
+            dither_row_atkinson_rtl(d, gray, packed);
+        } else {
+            atkinson_span(d->err[0], d->err[1], d->err[2], gray, packed, 0, d->width);
+        }
+        rotate_err_rows(d, 3);
+        break;
+    case DITHER_ORDERED:
+    case DITHER_BLUE_NOISE: {
+        int mask;
+        const uint8_t *map = threshold_map_row(d->algo, d->row, &mask);
+        img_k_map_pack(gray, map, mask, packed, 0, d->width);
+        break;
+    }
+    case DITHER_NONE:
+    default:
+        img_k_threshold_pack(gray, d->threshold, packed, 0, d->width);
+        break;
+    }
+
+    finish_row(output, packed, d->width, d->height, d->row, d->invert, 1);
+    d->row++;
+}
+
+/* ---------------------------------------------------------------------------
+ * Wavefront-parallel frame dithering
+ * ------------------------------------------------------------------------- */
+
+#define WAVE_WORKERS    2
+#define WAVE_CHUNK      64      // Pixels between progress updates (multiple of 8)
+#define WAVE_LAG        4       // Pixels a row must stay behind the row above
+#define WAVE_STACK      4096
+#define WAVE_SPIN_LIMIT 1000    // Polls before a waiting worker sleeps a tick (ESP)
+
+typedef struct wave_s wave_t;
+
+typedef struct {
+    wave_t *wave;
+    int id;
+    uint8_t *row;               // Source row scratch
+    uint8_t *levels;            // Gray level scratch (bpp > 1)
+    uint8_t *packed;            // Packed output row
+} wave_worker_t;
+
+struct wave_s {
+    int width;
+    int height;
+    dither_algorithm_t algo;
+    uint8_t threshold;
+    bool invert;
+    int bpp;
+    img_quant_t quant;
+    int err_rows;               // Error rows a row writes into (incl. its own)
+    int ring;                   // Error ring slots (err_rows + 1)
+    int16_t *err[4];
+    img_dither_src_fn src;
+    void *src_ctx;
+    uint8_t *output;
+    atomic_int progress[WAVE_WORKERS];  // y * width + pixels done, per worker
+    wave_worker_t workers[WAVE_WORKERS];
+#ifdef ESP_PLATFORM
+    SemaphoreHandle_t done;
+#endif
+};
+
+// Wait until the row above (other worker) has finished at least 'target'
+static void wave_wait(wave_t *wv, int worker, int target)
+{
+    int spins = 0;
+    while (atomic_load_explicit(&wv->progress[worker], memory_order_acquire) < target) {
+#ifdef ESP_PLATFORM
+        // The other worker usually trails by a chunk, so spin briefly; if it
+        // is preempted or its row source waits on the card, sleep a tick so
+        // Wi-Fi and the idle task on this core still run
+        if (++spins >= WAVE_SPIN_LIMIT) {
+            vTaskDelay(1);
+            spins = 0;
+        }
+#else
+        (void)spins;
+        sched_yield();
+#endif
+    }
+}
+
+static void wave_run(wave_worker_t *wk)
+{
+    wave_t *wv = wk->wave;
+    const int w = wv->width;
+    const int other = wk->id ^ 1;
+
+    for (int y = wk->id; y < wv->height; y += WAVE_WORKERS) {
+        wv->src(wv->src_ctx, y, wk->row);
+
+        int map_mask = 0;
+        const uint8_t *map = threshold_map_row(wv->algo, y, &map_mask);
+        int16_t *cur = NULL, *next = NULL, *next2 = NULL;
+        if (wv->err_rows > 0) {
+            // Rows sharing this slot (y-1 .. y-3) are complete by now
+            int16_t *fresh = wv->err[(y + wv->err_rows - 1) % wv->ring];
+            memset(fresh - ERR_PAD, 0, (w + ERR_PAD * 2) * sizeof(int16_t));
+            cur = wv->err[y % wv->ring];
+            next = wv->err[(y + 1) % wv->ring];
+            next2 = wv->err[(y + 2) % wv->ring];
+        }
+
+        for (int x0 = 0; x0 < w; x0 += WAVE_CHUNK) {
+            int x1 = (x0 + WAVE_CHUNK < w) ? x0 + WAVE_CHUNK : w;
+
+            if (y > 0 && wv->err_rows > 0) {
+                int need = x1 + WAVE_LAG;
+                wave_wait(wv, other, (y - 1) * w + ((need < w) ? need : w));
+            }
+
+            if (wv->bpp > 1) {
+                levels_span(wv->algo, &wv->quant, wv->bpp, cur, next, next2, map, map_mask,
+                            wk->row, wk->levels, wk->packed, x0, x1, 1);
+                atomic_store_explicit(&wv->progress[wk->id], y * w + x1, memory_order_release);
+                continue;
+            }
+
+            switch (wv->algo) {
+            case DITHER_FLOYD:
+                floyd_span(cur, next, wk->row, wk->packed, x0, x1);
+                break;
+            case DITHER_ATKINSON:
+                atkinson_span(cur, next, next2, wk->row, wk->packed, x0, x1);
+                break;
+            case DITHER_ORDERED:
+            case DITHER_BLUE_NOISE:
+                img_k_map_pack(wk->row, map, map_mask, wk->packed, x0, x1);
+                break;
+            case DITHER_NONE:
+            default:
+                img_k_threshold_pack(wk->row, wv->threshold, wk->packed, x0, x1);
+                break;
+            }
+
+            atomic_store_explicit(&wv->progress[wk->id], y * w + x1, memory_order_release);
+        }
+
+        finish_row(wv->output, wk->packed, w, wv->height, y, wv->invert, wv->bpp);
+    }
+}
+
+#ifdef ESP_PLATFORM
+static void wave_task(void *arg)
+{
+    wave_worker_t *wk = (wave_worker_t *)arg;
+    wave_run(wk);
+    xSemaphoreGive(wk->wave->done);
+    vTaskDelete(NULL);
+}
+
+// Run the workers pinned to core 0 and core 1 and wait for them.
+// Returns false if no worker task could be started.
+static bool wave_start(wave_t *wv)
+{
+    static const char *names[WAVE_WORKERS] = { "dither0", "dither1" };
+    UBaseType_t prio = uxTaskPriorityGet(NULL);
+    int started = 0;
+    int inline_worker = -1;
+
+    wv->done = xSemaphoreCreateCounting(WAVE_WORKERS, 0);
+    if (!wv->done) {
+        return false;
+    }
+
+    for (int i = 0; i < WAVE_WORKERS; i++) {
+        if (xTaskCreatePinnedToCore(wave_task, names[i], WAVE_STACK, &wv->workers[i],
+                                    prio, NULL, i) == pdPASS) {
+            started++;
+        } else {
+            inline_worker = i;
+        }
+    }
+
+    if (started == 0) {
+        vSemaphoreDelete(wv->done);
+        return false;
+    }
+
+    // A worker without a task runs here, concurrently with the other one
+    if (inline_worker >= 0) {
+        wave_run(&wv->workers[inline_worker]);
+    }
+
+    for (int i = 0; i < started; i++) {
+        xSemaphoreTake(wv->done, portMAX_DELAY);
+    }
+    vSemaphoreDelete(wv->done);
+    return true;
+}
+#else
+static void *wave_thread(void *arg)
+{
+    wave_run((wave_worker_t *)arg);
+    return NULL;
+}
+
+static bool wave_start(wave_t *wv)
+{
+    pthread_t threads[WAVE_WORKERS];
+    bool started[WAVE_WORKERS] = { false };
+    int count = 0;
+    int inline_worker = -1;
+
+    for (int i = 0; i < WAVE_WORKERS; i++) {
+        if (pthread_create(&threads[i], NULL, wave_thread, &wv->workers[i]) == 0) {
+            started[i] = true;
+            count++;
+        } else {
+            inline_worker = i;
+        }
+    }
+
+    if (count == 0) {
+        return false;
+    }
+    if (inline_worker >= 0) {
+        wave_run(&wv->workers[inline_worker]);
+    }
+
+    for (int i = 0; i < WAVE_WORKERS; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+    return true;
+}
+#endif
+
+static void wave_free(wave_t *wv)
+{
+    for (int i = 0; i < 4; i++) {
+        if (wv->err[i]) {
+            img_arena_free(wv->err[i] - ERR_PAD);
+        }
+    }
+    for (int i = 0; i < WAVE_WORKERS; i++) {
+        img_arena_free(wv->workers[i].row);
+        img_arena_free(wv->workers[i].levels);
+        img_arena_free(wv->workers[i].packed);
+    }
+    img_arena_free(wv);
+}
+
+static esp_err_t dither_frame_serial(int width, int height, const img_process_opts_t *opts,
+                                     img_dither_src_fn src, void *src_ctx, uint8_t *output)
+{
+    img_dither_t d;
+    uint8_t *row = img_arena_alloc(width);
+    if (!row) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = img_dither_init(&d, width, height, opts);
+    if (ret == ESP_OK) {
+        for (int y = 0; y < height; y++) {
+            src(src_ctx, y, row);
+            img_dither_row(&d, row, output);
+        }
+        img_dither_deinit(&d);
+    }
+
+    img_arena_free(row);
+    return ret;
+}
+
+size_t img_dither_mem(int width, const img_process_opts_t *opts)
+{
+    int bpp = img_format_bpp(opts->format);
+    int err_rows = (opts->dither == DITHER_FLOYD) ? 2 : (opts->dither == DITHER_ATKINSON) ? 3 : 0;
+    size_t err_row = (width + ERR_PAD * 2) * sizeof(int16_t);
+    size_t levels = bpp > 1 ? width : 0;
+
+    // Serial: error rows, packed and level rows, source row
+    size_t serial = err_rows * err_row + (width * bpp + 7) / 8 + levels + width;
+    // Wavefront: one more error row, row buffers per worker
+    size_t wave = sizeof(wave_t) + (err_rows ? err_rows + 1 : 0) * err_row +
+                  WAVE_WORKERS * (width + width * bpp / 8 + levels);
+    return serial > wave ? serial : wave;
+}
+
+esp_err_t img_dither_frame(int width, int height, const img_process_opts_t *opts,
+                           img_dither_src_fn src, void *src_ctx, uint8_t *output)
+{
+    if (!opts || !src || !output || width <= 0 || height <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+#ifdef ESP_PLATFORM
+    bool multicore = portNUM_PROCESSORS >= WAVE_WORKERS;
+#else
+    bool multicore = sysconf(_SC_NPROCESSORS_ONLN) >= WAVE_WORKERS;
+#endif
+
+    // Serpentine rows depend on the whole row above, and rows that share
+    // output bytes would race: use the serial ditherer for those
+    if (!multicore || opts->serpentine || (width & 7) || height < WAVE_WORKERS) {
+        return dither_frame_serial(width, height, opts, src, src_ctx, output);
+    }
+
+    wave_t *wv = img_arena_calloc(1, sizeof(wave_t));
+    if (!wv) {
+        return dither_frame_serial(width, height, opts, src, src_ctx, output);
+    }
+
+    wv->width = width;
+    wv->height = height;
+    wv->algo = opts->dither;
+    wv->threshold = opts->threshold;
+    wv->invert = opts->invert;
+    wv->bpp = img_format_bpp(opts->format);
+    build_quant_table(&wv->quant, wv->bpp);
+    wv->src = src;
+    wv->src_ctx = src_ctx;
+    wv->output = output;
+    wv->err_rows = (wv->algo == DITHER_FLOYD) ? 2 : (wv->algo == DITHER_ATKINSON) ? 3 : 0;
+    wv->ring = wv->err_rows ? wv->err_rows + 1 : 0;
+
+    bool ok = true;
+    size_t row_bytes = (width + ERR_PAD * 2) * sizeof(int16_t);
+    for (int i = 0; i < wv->ring && ok; i++) {
+        int16_t *buf = img_arena_alloc_fast(row_bytes);
+        ok = buf != NULL;
+        wv->err[i] = buf ? buf + ERR_PAD : NULL;
+    }
+    for (int i = 0; i < WAVE_WORKERS && ok; i++) {
+        wv->workers[i].wave = wv;
+        wv->workers[i].id = i;
+        wv->workers[i].row = img_arena_alloc_fast(width);
+        wv->workers[i].packed = img_arena_alloc_fast(width * wv->bpp / 8);
+        if (wv->bpp > 1) {
+            wv->workers[i].levels = img_arena_alloc_fast(width);
+        }
+        ok = wv->workers[i].row && wv->workers[i].packed &&
+             (wv->bpp == 1 || wv->workers[i].levels);
+    }
+    if (!ok) {
+        ESP_LOGW(TAG, "Cannot allocate parallel dither buffers, running serially");
+        wave_free(wv);
+        return dither_frame_serial(width, height, opts, src, src_ctx, output);
+    }
+
+    for (int i = 0; i < WAVE_WORKERS; i++) {
+        atomic_init(&wv->progress[i], 0);
+    }
+
+    bool ran = wave_start(wv);
+    wave_free(wv);
+    if (!ran) {
+        ESP_LOGW(TAG, "Cannot start dither workers, running serially");
+        return dither_frame_serial(width, height, opts, src, src_ctx, output);
+    }
+    return ESP_OK;
+}
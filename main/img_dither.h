@@ -0,0 +1,91 @@
+/*
+ * Image Dither - Line-buffered error diffusion into packed 1bpp rows
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "image_processor.h"
+
+// Gray level quantizer for 2bpp / 4bpp output
+typedef struct {
+    int nlev;                   // Number of levels (4 or 16)
+    uint8_t level[256];         // Nearest level per gray value
+    uint8_t value[16];          // Gray value per level
+} img_quant_t;
+
+// Row ditherer state (error terms for the rows below the current one).
+// Output is packed MSB first at opts->format bits per pixel (1, 2 or 4);
+// higher values are lighter, so all ones is white at every depth.
+typedef struct {
+    int width;
+    int height;
+    int row;                    // Next row to be dithered
+    dither_algorithm_t algo;
+    uint8_t threshold;
+    bool invert;
+    bool serpentine;            // Alternate scan direction every row
+    int bpp;                    // Output bits per pixel
+    img_quant_t quant;          // Level tables (bpp > 1)
+    int16_t *err[3];            // err[0] = current row, err[1] = +1, err[2] = +2
+    uint8_t *packed;            // One packed output row
+    uint8_t *levels;            // Gray level per pixel (bpp > 1)
+} img_dither_t;
+
+/**
+ * @brief Initialize a row ditherer
+ * @param d Ditherer state
+ * @param width Row width in pixels
+ * @param height Number of rows that will be pushed
+ * @param opts Processing options (format, dither, threshold, invert, serpentine)
+ * @return ESP_OK on success
+ */
+esp_err_t img_dither_init(img_dither_t *d, int width, int height,
+                          const img_process_opts_t *opts);
+
+/**
+ * @brief Dither one grayscale row and write it packed
+ * @param d Ditherer state
+ * @param gray Input row (width bytes)
+ * @param output Packed output frame; the row is written at bit offset row * width * bpp
+ */
+void img_dither_row(img_dither_t *d, const uint8_t *gray, uint8_t *output);
+
+/**
+ * @brief Free ditherer buffers
+ */
+void img_dither_deinit(img_dither_t *d);
+
+/**
+ * @brief Source of grayscale rows for img_dither_frame
+ *
+ * Called from both worker tasks at once, so it must only read shared state.
+ * @param ctx User context
+ * @param y Row index
+ * @param row Output row (width bytes)
+ */
+typedef void (*img_dither_src_fn)(void *ctx, int y, uint8_t *row);
+
+/**
+ * @brief Most bytes img_dither_init or img_dither_frame allocate for a width
+ */
+size_t img_dither_mem(int width, const img_process_opts_t *opts);
+
+/**
+ * @brief Dither a whole frame on both cores (wavefront over rows)
+ *
+ * Output is identical to pushing every row through img_dither_row.
+ * Falls back to a serial pass for serpentine scanning, widths that are not
+ * a multiple of 8, or when the worker tasks cannot be created.
+ * @param width Frame width in pixels
+ * @param height Frame height in pixels
+ * @param opts Processing options (dither, threshold, invert, serpentine)
+ * @param src Row source
+ * @param src_ctx Context passed to src
+ * @param output Packed output frame (opts->format bits per pixel)
+ * @return ESP_OK on success
+ */
+esp_err_t img_dither_frame(int width, int height, const img_process_opts_t *opts,
+                           img_dither_src_fn src, void *src_ctx, uint8_t *output);
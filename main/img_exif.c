@@ -0,0 +1,115 @@
+/*
+ * Image EXIF Implementation
+ *
+ * Only IFD0 (orientation) and IFD1 (thumbnail) are walked; every offset is
+ * checked against the block size, so a truncated or hostile block yields
+ * "no tag" instead of a read past the buffer.
+ *
+ * Each orientation is kept as three steps on the stored pixels: swap the
+ * axes, then mirror x, then mirror y. Combining two orientations is then a
+ * matter of moving the second one's mirrors across the first one's swap.
+ */
+
+#include "img_exif.h"
+
+#include <string.h>
+
+#define TAG_ORIENTATION     0x0112
+#define TAG_THUMB_OFFSET    0x0201  // JPEGInterchangeFormat
+#define TAG_THUMB_LENGTH    0x0202  // JPEGInterchangeFormatLength
+
+#define STEP_SWAP   4
+#define STEP_FLIP_X 2
+#define STEP_FLIP_Y 1
+
+// Orientation 1-8 -> steps, and back
+static const uint8_t s_steps[9] = {
+    0, 0, STEP_FLIP_X, STEP_FLIP_X | STEP_FLIP_Y, STEP_FLIP_Y,
+    STEP_SWAP, STEP_SWAP | STEP_FLIP_X, STEP_SWAP | STEP_FLIP_X | STEP_FLIP_Y, STEP_SWAP | STEP_FLIP_Y,
+};
+static const uint8_t s_orient[8] = {1, 4, 2, 3, 5, 8, 6, 7};
+
+static uint32_t exif_get(const uint8_t *p, int bytes, bool big_endian)
+{
+    uint32_t v = 0;
+    for (int i = 0; i < bytes; i++) {
+        v |= (uint32_t)p[big_endian ? i : bytes - 1 - i] << (8 * (bytes - 1 - i));
+    }
+    return v;
+}
+
+// Offset of IFD0 and the byte order, false if there is no TIFF header
+static bool tiff_header(const uint8_t *tiff, size_t n, bool *be, size_t *ifd)
+{
+    if (n < 8 || (memcmp(tiff, "II*\0", 4) != 0 && memcmp(tiff, "MM\0*", 4) != 0)) {
+        return false;
+    }
+    *be = tiff[0] == 'M';
+    *ifd = exif_get(tiff + 4, 4, *be);
+    return *ifd <= n - 2;
+}
+
+int img_exif_orientation(const uint8_t *tiff, size_t n)
+{
+    bool be;
+    size_t ifd;
+    if (!tiff_header(tiff, n, &be, &ifd)) {
+        return IMG_EXIF_ORIENT_NORMAL;
+    }
+
+    size_t count = exif_get(tiff + ifd, 2, be);
+    for (size_t i = 0; i < count && ifd + 2 + (i + 1) * 12 <= n; i++) {
+        const uint8_t *e = tiff + ifd + 2 + i * 12;
+        if (exif_get(e, 2, be) == TAG_ORIENTATION && exif_get(e + 2, 2, be) == 3) {
+            uint32_t v = exif_get(e + 8, 2, be);
+            return (v >= 1 && v <= 8) ? (int)v : IMG_EXIF_ORIENT_NORMAL;
+        }
+    }
+    return IMG_EXIF_ORIENT_NORMAL;
+}
+
+bool img_exif_thumbnail(const uint8_t *tiff, size_t n, size_t *offset, size_t *size)
+{
+    bool be;
+    size_t ifd;
+    if (!tiff_header(tiff, n, &be, &ifd)) {
+        return false;
+    }
+
+    // IFD0 only matters for the link to IFD1
+    size_t link = ifd + 2 + (size_t)exif_get(tiff + ifd, 2, be) * 12;
+    if (link > n - 4) return false;
+    ifd = exif_get(tiff + link, 4, be);
+    if (ifd == 0 || ifd > n - 2) return false;
+
+    size_t count = exif_get(tiff + ifd, 2, be);
+    uint32_t off = 0, len = 0;
+    for (size_t i = 0; i < count && ifd + 2 + (i + 1) * 12 <= n; i++) {
+        const uint8_t *e = tiff + ifd + 2 + i * 12;
+        uint16_t tag = exif_get(e, 2, be);
+        uint16_t type = exif_get(e + 2, 2, be);
+        uint32_t val = (type == 3) ? exif_get(e + 8, 2, be) : exif_get(e + 8, 4, be);
+        if (tag == TAG_THUMB_OFFSET) off = val;
+        if (tag == TAG_THUMB_LENGTH) len = val;
+    }
+    if (off == 0 || len < 4 || off > n || len > n - off ||
+        tiff[off] != 0xFF || tiff[off + 1] != 0xD8) {
+        return false;
+    }
+    *offset = off;
+    *size = len;
+    return true;
+}
+
+int img_exif_orient_then(int first, int second)
+{
+    int a = s_steps[(first >= 1 && first <= 8) ? first : 1];
+    int b = s_steps[(second >= 1 && second <= 8) ? second : 1];
+
+    // Mirroring x before a swap is mirroring y after it
+    if (b & STEP_SWAP) {
+        a = (a & STEP_SWAP) | ((a & STEP_FLIP_X) ? STEP_FLIP_Y : 0) |
+            ((a & STEP_FLIP_Y) ? STEP_FLIP_X : 0);
+    }
+    return s_orient[(a ^ b) & 7];
+}
@@ -0,0 +1,50 @@
+/*
+ * Image EXIF - Orientation and thumbnail from a TIFF-structured EXIF block
+ *
+ * The block is the payload of a JPEG APP1 "Exif" segment (after its 6-byte
+ * prefix) or of a PNG eXIf chunk. Orientations are the TIFF tag values:
+ * 1 = as stored, 2-4 = mirrored or turned half way, 5-8 = axes swapped.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define IMG_EXIF_ORIENT_NORMAL  1   // Stored upright
+#define IMG_EXIF_ORIENT_CW90    6   // Stored turned 90 degrees counter-clockwise
+
+/**
+ * @brief Orientation tag of IFD0
+ * @param tiff EXIF block, starting with the TIFF header
+ * @param n Block size (may be cut short: the tag is near the start)
+ * @return 1-8, 1 if the tag is missing or the block is invalid
+ */
+int img_exif_orientation(const uint8_t *tiff, size_t n);
+
+/**
+ * @brief Offset and size of the JPEG thumbnail in IFD1
+ * @param tiff EXIF block, starting with the TIFF header
+ * @param n Block size
+ * @param offset Thumbnail offset from tiff
+ * @param size Thumbnail size
+ * @return true if there is a JPEG thumbnail inside the block
+ */
+bool img_exif_thumbnail(const uint8_t *tiff, size_t n, size_t *offset, size_t *size);
+
+/**
+ * @brief True if the orientation swaps width and height
+ */
+static inline bool img_exif_orient_swaps(int orient)
+{
+    return orient >= 5 && orient <= 8;
+}
+
+/**
+ * @brief Orientation that applies first, then second
+ * @param first Orientation applied to the stored pixels
+ * @param second Orientation applied to the result
+ * @return Combined orientation, 1-8
+ */
+int img_exif_orient_then(int first, int second);
@@ -0,0 +1,283 @@
+/*
+ * Image JPEG Enc Implementation
+ *
+ * The forward DCT is the AAN float factorization; its output scale factors
+ * are folded into the quantization divisors, so quantizing a coefficient is
+ * one multiply. Edge blocks repeat the last column and row.
+ */
+
+#include "img_jpeg_enc.h"
+
+#include <string.h>
+#include <math.h>
+
+// Natural (raster) index of each zigzag position
+static const uint8_t zigzag[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+// Annex K luminance quantization table (raster order)
+static const uint8_t std_qt[64] = {
+    16, 11, 10, 16, 24, 40, 51, 61,
+    12, 12, 14, 19, 26, 58, 60, 55,
+    14, 13, 16, 24, 40, 57, 69, 56,
+    14, 17, 22, 29, 51, 87, 80, 62,
+    18, 22, 37, 56, 68, 109, 103, 77,
+    24, 35, 55, 64, 81, 104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103, 99,
+};
+
+// Annex K luminance Huffman tables: code counts per length, then symbols
+static const uint8_t dc_bits[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+static const uint8_t dc_vals[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+static const uint8_t ac_bits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+static const uint8_t ac_vals[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa,
+};
+
+// Code and length per symbol
+typedef struct {
+    uint16_t code[256];
+    uint8_t size[256];
+} huff_enc_t;
+
+// Bit writer
+typedef struct {
+    FILE *fp;
+    uint32_t acc;
+    int nbits;
+} bit_writer_t;
+
+static void build_huff(huff_enc_t *h, const uint8_t bits[16], const uint8_t *vals)
+{
+    memset(h, 0, sizeof(*h));
+    int code = 0, k = 0;
+    for (int len = 1; len <= 16; len++) {
+        for (int i = 0; i < bits[len - 1]; i++, k++) {
+            h->code[vals[k]] = code++;
+            h->size[vals[k]] = len;
+        }
+        code <<= 1;
+    }
+}
+
+static void put_bits(bit_writer_t *bw, uint32_t value, int n)
+{
+    bw->acc = (bw->acc << n) | (value & ((1u << n) - 1));
+    bw->nbits += n;
+    while (bw->nbits >= 8) {
+        int byte = (bw->acc >> (bw->nbits - 8)) & 0xFF;
+        putc(byte, bw->fp);
+        if (byte == 0xFF) {
+            putc(0, bw->fp);    // Byte stuffing
+        }
+        bw->nbits -= 8;
+    }
+}
+
+// Category (bit length) of a coefficient and its extra bits
+static inline int category(int v, uint32_t *bits)
+{
+    int a = (v < 0) ? -v : v;
+    int n = 0;
+    while (a) {
+        n++;
+        a >>= 1;
+    }
+    *bits = (v < 0) ? (uint32_t)(v - 1) : (uint32_t)v;
+    return n;
+}
+
+// AAN forward DCT on 8 values with the given stride (unscaled output)
+static void fdct_1d(float *d, int s)
+{
+    float tmp0 = d[0] + d[7 * s], tmp7 = d[0] - d[7 * s];
+    float tmp1 = d[s] + d[6 * s], tmp6 = d[s] - d[6 * s];
+    float tmp2 = d[2 * s] + d[5 * s], tmp5 = d[2 * s] - d[5 * s];
+    float tmp3 = d[3 * s] + d[4 * s], tmp4 = d[3 * s] - d[4 * s];
+
+    // Even part
+    float tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3;
+    float tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+    d[0] = tmp10 + tmp11;
+    d[4 * s] = tmp10 - tmp11;
+    float z1 = (tmp12 + tmp13) * 0.707106781f;
+    d[2 * s] = tmp13 + z1;
+    d[6 * s] = tmp13 - z1;
+
+    // Odd part
+    tmp10 = tmp4 + tmp5;
+    tmp11 = tmp5 + tmp6;
+    tmp12 = tmp6 + tmp7;
+    float z5 = (tmp10 - tmp12) * 0.382683433f;
+    float z2 = 0.541196100f * tmp10 + z5;
+    float z4 = 1.306562965f * tmp12 + z5;
+    float z3 = tmp11 * 0.707106781f;
+    float z11 = tmp7 + z3, z13 = tmp7 - z3;
+    d[5 * s] = z13 + z2;
+    d[3 * s] = z13 - z2;
+    d[s] = z11 + z4;
+    d[7 * s] = z11 - z4;
+}
+
+static void encode_block(bit_writer_t *bw, float blk[64], const float fdtbl[64], int *dc_pred,
+                         const huff_enc_t *dc, const huff_enc_t *ac)
+{
+    for (int i = 0; i < 8; i++) {
+        fdct_1d(blk + i * 8, 1);
+    }
+    for (int i = 0; i < 8; i++) {
+        fdct_1d(blk + i, 8);
+    }
+
+    int q[64];
+    for (int k = 0; k < 64; k++) {
+        int n = zigzag[k];
+        q[k] = (int)lroundf(blk[n] * fdtbl[n]);
+    }
+
+    uint32_t bits;
+    int diff = q[0] - *dc_pred;
+    *dc_pred = q[0];
+    int cat = category(diff, &bits);
+    put_bits(bw, dc->code[cat], dc->size[cat]);
+    if (cat) {
+        put_bits(bw, bits, cat);
+    }
+
+    int run = 0;
+    for (int k = 1; k < 64; k++) {
+        if (q[k] == 0) {
+            run++;
+            continue;
+        }
+        while (run > 15) {
+            put_bits(bw, ac->code[0xF0], ac->size[0xF0]);   // ZRL
+            run -= 16;
+        }
+        cat = category(q[k], &bits);
+        int sym = (run << 4) | cat;
+        put_bits(bw, ac->code[sym], ac->size[sym]);
+        put_bits(bw, bits, cat);
+        run = 0;
+    }
+    if (run) {
+        put_bits(bw, ac->code[0x00], ac->size[0x00]);       // EOB
+    }
+}
+
+static void put_u16(FILE *fp, int v)
+{
+    putc(v >> 8, fp);
+    putc(v & 0xFF, fp);
+}
+
+static void write_headers(FILE *fp, const uint8_t qt[64], int width, int height)
+{
+    static const uint8_t jfif[] = {
+        0xFF, 0xD8,                                     // SOI
+        0xFF, 0xE0, 0, 16, 'J', 'F', 'I', 'F', 0,       // APP0
+        1, 1, 0, 0, 1, 0, 1, 0, 0,
+    };
+    fwrite(jfif, 1, sizeof(jfif), fp);
+
+    // DQT, table 0, zigzag order
+    put_u16(fp, 0xFFDB);
+    put_u16(fp, 67);
+    putc(0, fp);
+    for (int k = 0; k < 64; k++) {
+        putc(qt[zigzag[k]], fp);
+    }
+
+    // SOF0: 8-bit, one component, 1x1 sampling, table 0
+    put_u16(fp, 0xFFC0);
+    put_u16(fp, 11);
+    putc(8, fp);
+    put_u16(fp, height);
+    put_u16(fp, width);
+    putc(1, fp);
+    putc(1, fp);
+    putc(0x11, fp);
+    putc(0, fp);
+
+    // DHT: DC table 0 and AC table 0
+    put_u16(fp, 0xFFC4);
+    put_u16(fp, 2 + 2 * 17 + sizeof(dc_vals) + sizeof(ac_vals));
+    putc(0x00, fp);
+    fwrite(dc_bits, 1, 16, fp);
+    fwrite(dc_vals, 1, sizeof(dc_vals), fp);
+    putc(0x10, fp);
+    fwrite(ac_bits, 1, 16, fp);
+    fwrite(ac_vals, 1, sizeof(ac_vals), fp);
+
+    // SOS: one component, tables 0/0, full spectrum
+    static const uint8_t sos[] = {0xFF, 0xDA, 0, 8, 1, 1, 0x00, 0, 63, 0};
+    fwrite(sos, 1, sizeof(sos), fp);
+}
+
+esp_err_t img_jpeg_encode_gray(FILE *fp, const uint8_t *gray, int width, int height, int quality)
+{
+    if (!fp || !gray || width <= 0 || height <= 0 || width > 65535 || height > 65535) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    quality = (quality < 1) ? 1 : (quality > 100) ? 100 : quality;
+    int scale = (quality < 50) ? 5000 / quality : 200 - quality * 2;
+
+    // Quantization table and the divisors with the AAN output scale folded in
+    static const float aan[8] = {
+        1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+        1.0f, 0.785694958f, 0.541196100f, 0.275899379f,
+    };
+    uint8_t qt[64];
+    float fdtbl[64];
+    for (int i = 0; i < 64; i++) {
+        int q = (std_qt[i] * scale + 50) / 100;
+        qt[i] = (q < 1) ? 1 : (q > 255) ? 255 : q;
+        fdtbl[i] = 1.0f / (qt[i] * aan[i >> 3] * aan[i & 7] * 8.0f);
+    }
+
+    huff_enc_t dc, ac;
+    build_huff(&dc, dc_bits, dc_vals);
+    build_huff(&ac, ac_bits, ac_vals);
+
+    write_headers(fp, qt, width, height);
+
+    bit_writer_t bw = {.fp = fp};
+    int dc_pred = 0;
+    float blk[64];
+    for (int by = 0; by < height; by += 8) {
+        for (int bx = 0; bx < width; bx += 8) {
+            for (int y = 0; y < 8; y++) {
+                int sy = (by + y < height) ? by + y : height - 1;
+                const uint8_t *row = gray + (size_t)sy * width;
+                for (int x = 0; x < 8; x++) {
+                    int sx = (bx + x < width) ? bx + x : width - 1;
+                    blk[y * 8 + x] = row[sx] - 128.0f;
+                }
+            }
+            encode_block(&bw, blk, fdtbl, &dc_pred, &dc, &ac);
+        }
+    }
+
+    // Pad the last byte with ones, then EOI
+    if (bw.nbits) {
+        put_bits(&bw, 0x7F, 8 - bw.nbits);
+    }
+    put_u16(fp, 0xFFD9);
+
+    return ferror(fp) ? ESP_FAIL : ESP_OK;
+}
@@ -0,0 +1,25 @@
+/*
+ * Image JPEG Enc - Baseline grayscale JPEG encoder (thumbnails)
+ *
+ * One component with the standard (Annex K) luminance tables, the
+ * quantization table scaled by a quality setting as libjpeg does. Meant
+ * for small images such as gallery thumbnails: the source is a gray buffer
+ * and the output goes straight to a file.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include "esp_err.h"
+
+/**
+ * @brief Encode a gray image as a baseline JPEG
+ * @param fp Destination file
+ * @param gray Source pixels (width * height bytes)
+ * @param width Image width (1-65535)
+ * @param height Image height (1-65535)
+ * @param quality 1-100
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_FAIL (write error)
+ */
+esp_err_t img_jpeg_encode_gray(FILE *fp, const uint8_t *gray, int width, int height, int quality);
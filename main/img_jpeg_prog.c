@@ -0,0 +1,796 @@
+/*
+ * Image JPEG Prog Implementation
+ *
+ * Scans are decoded as in ITU T.81 Annex G (spectral selection and
+ * successive approximation), but every coefficient write goes through the
+ * slot table: kept coefficients land in the k x k store, dropped ones only
+ * set their nonzero bit. After the last scan each block goes through a
+ * k-point IDCT, which yields the image at k/8 of its size.
+ */
+
+#include "img_jpeg_prog.h"
+#include "img_arena.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "esp_log.h"
+
+static const char *TAG = "img_jpeg_prog";
+
+#define READ_BUF_SIZE   4096
+#define FAST_BITS       9
+
+// Markers
+#define M_SOF0  0xC0
+#define M_SOF2  0xC2
+#define M_DHT   0xC4
+#define M_RST0  0xD0
+#define M_RST7  0xD7
+#define M_SOI   0xD8
+#define M_EOI   0xD9
+#define M_SOS   0xDA
+#define M_DQT   0xDB
+#define M_DRI   0xDD
+
+// Zigzag position -> natural (row * 8 + col) position
+static const uint8_t zigzag[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+// ---- Input ----
+
+static int read_byte(jpeg_prog_t *dec)
+{
+    if (dec->fp) {
+        if (dec->buf_pos >= dec->buf_len) {
+            dec->buf_len = fread(dec->buf, 1, READ_BUF_SIZE, dec->fp);
+            dec->buf_pos = 0;
+            if (dec->buf_len == 0) {
+                dec->eof = true;
+                return -1;
+            }
+        }
+        return dec->buf[dec->buf_pos++];
+    }
+    if (dec->pos >= dec->size) {
+        dec->eof = true;
+        return -1;
+    }
+    return dec->data[dec->pos++];
+}
+
+static int read_u16(jpeg_prog_t *dec)
+{
+    int hi = read_byte(dec);
+    int lo = read_byte(dec);
+    return (hi < 0 || lo < 0) ? -1 : (hi << 8) | lo;
+}
+
+static void skip_bytes(jpeg_prog_t *dec, size_t n)
+{
+    if (dec->fp) {
+        size_t avail = dec->buf_len - dec->buf_pos;
+        if (n <= avail) {
+            dec->buf_pos += n;
+            return;
+        }
+        dec->buf_pos = dec->buf_len;
+        fseek(dec->fp, (long)(n - avail), SEEK_CUR);
+    } else {
+        dec->pos = (n < dec->size - dec->pos) ? dec->pos + n : dec->size;
+    }
+}
+
+// Next marker code (skipping fill bytes and anything before it), -1 at end of data
+static int next_marker(jpeg_prog_t *dec)
+{
+    if (dec->marker >= 0) {
+        int m = dec->marker;
+        dec->marker = -1;
+        return m;
+    }
+
+    int c = read_byte(dec);
+    for (;;) {
+        while (c >= 0 && c != 0xFF) {
+            c = read_byte(dec);
+        }
+        while (c == 0xFF) {
+            c = read_byte(dec);
+        }
+        if (c != 0) {
+            return c;   // Marker code or -1
+        }
+        c = read_byte(dec); // FF 00 is a stuffed data byte
+    }
+}
+
+// ---- Entropy bit reader ----
+
+static void fill_bits(jpeg_prog_t *dec)
+{
+    while (dec->nbits <= 24) {
+        int b = 0;
+        if (dec->marker < 0) {
+            b = read_byte(dec);
+            if (b == 0xFF) {
+                int c = read_byte(dec);
+                while (c == 0xFF) {
+                    c = read_byte(dec);
+                }
+                if (c != 0) {
+                    // Marker ends the entropy data; the rest reads as zeros
+                    dec->marker = (c < 0) ? M_EOI : c;
+                    b = 0;
+                }
+            } else if (b < 0) {
+                dec->marker = M_EOI;
+                b = 0;
+            }
+        }
+        dec->bits |= (uint32_t)b << (24 - dec->nbits);
+        dec->nbits += 8;
+    }
+}
+
+static inline void consume_bits(jpeg_prog_t *dec, int n)
+{
+    dec->bits <<= n;
+    dec->nbits -= n;
+}
+
+static int get_bits(jpeg_prog_t *dec, int n)
+{
+    if (n == 0) return 0;
+    fill_bits(dec);
+    int v = (int)(dec->bits >> (32 - n));
+    consume_bits(dec, n);
+    return v;
+}
+
+static int get_bit(jpeg_prog_t *dec)
+{
+    return get_bits(dec, 1);
+}
+
+// n-bit magnitude category -> signed value
+static int receive_extend(jpeg_prog_t *dec, int n)
+{
+    if (n > 16) {
+        dec->error = true;
+        return 0;
+    }
+    int v = get_bits(dec, n);
+    return (v < (1 << (n - 1))) ? v - (1 << n) + 1 : v;
+}
+
+static int huff_decode(jpeg_prog_t *dec, const jpeg_huff_t *h)
+{
+    fill_bits(dec);
+    int s = h->fast[dec->bits >> (32 - FAST_BITS)];
+    if (s != 255) {
+        consume_bits(dec, h->size[s]);
+        return h->values[s];
+    }
+
+    uint32_t code16 = dec->bits >> 16;
+    for (int l = 1; l <= 16; l++) {
+        int32_t code = (int32_t)(code16 >> (16 - l));
+        if (code < h->maxcode[l]) {
+            consume_bits(dec, l);
+            return h->values[code + h->delta[l]];
+        }
+    }
+    dec->error = true;
+    return 0;
+}
+
+// ---- Headers ----
+
+static esp_err_t build_huff(jpeg_huff_t *h, const uint8_t counts[16], int total)
+{
+    int32_t code = 0;
+    int k = 0;
+    memset(h->fast, 255, sizeof(h->fast));
+    for (int l = 1; l <= 16; l++) {
+        h->delta[l] = k - code;
+        for (int i = 0; i < counts[l - 1]; i++) {
+            h->size[k] = l;
+            if (l <= FAST_BITS && k != 255) {
+                int first = code << (FAST_BITS - l);
+                for (int j = 0; j < (1 << (FAST_BITS - l)); j++) {
+                    h->fast[first + j] = k;
+                }
+            }
+            code++;
+            k++;
+        }
+        if (code > (1 << l)) {
+            return ESP_FAIL;    // Over-subscribed table
+        }
+        h->maxcode[l] = counts[l - 1] ? code : -1;
+        code <<= 1;
+    }
+    h->maxcode[17] = INT32_MAX;
+    return (k == total) ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t read_dht(jpeg_prog_t *dec)
+{
+    int len = read_u16(dec) - 2;
+    while (len > 17) {
+        int tcth = read_byte(dec);
+        int tc = tcth >> 4, th = tcth & 15;
+        if (tcth < 0 || tc > 1 || th > 3) {
+            return ESP_FAIL;
+        }
+        uint8_t counts[16];
+        int total = 0;
+        for (int i = 0; i < 16; i++) {
+            counts[i] = read_byte(dec);
+            total += counts[i];
+        }
+        len -= 17;
+        if (total > 256 || total > len) {
+            return ESP_FAIL;
+        }
+        jpeg_huff_t *h = &dec->huff[tc * 4 + th];
+        for (int i = 0; i < total; i++) {
+            h->values[i] = read_byte(dec);
+        }
+        len -= total;
+        if (build_huff(h, counts, total) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+    return (len == 0) ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t read_dqt(jpeg_prog_t *dec)
+{
+    int len = read_u16(dec) - 2;
+    while (len > 0) {
+        int pqtq = read_byte(dec);
+        int pq = pqtq >> 4, tq = pqtq & 15;
+        if (pqtq < 0 || pq > 1 || tq > 3) {
+            return ESP_FAIL;
+        }
+        for (int i = 0; i < 64; i++) {
+            dec->qt[tq][i] = pq ? read_u16(dec) : read_byte(dec);
+        }
+        len -= 1 + 64 * (pq + 1);
+    }
+    return (len == 0) ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t read_sof(jpeg_prog_t *dec)
+{
+    int len = read_u16(dec);
+    int precision = read_byte(dec);
+    dec->height = read_u16(dec);
+    dec->width = read_u16(dec);
+    dec->ncomp = read_byte(dec);
+    if (precision != 8 || dec->width <= 0 || dec->height <= 0 ||
+        (dec->ncomp != 1 && dec->ncomp != 3) || len != 8 + 3 * dec->ncomp) {
+        ESP_LOGW(TAG, "Unsupported frame: %d-bit, %d components", precision, dec->ncomp);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    dec->hmax = dec->vmax = 1;
+    for (int i = 0; i < dec->ncomp; i++) {
+        jpeg_comp_t *c = &dec->comp[i];
+        c->id = read_byte(dec);
+        int hv = read_byte(dec);
+        c->h = hv >> 4;
+        c->v = hv & 15;
+        c->tq = read_byte(dec) & 3;
+        if (c->h < 1 || c->h > 4 || c->v < 1 || c->v > 4) {
+            return ESP_FAIL;
+        }
+        if (c->h > dec->hmax) dec->hmax = c->h;
+        if (c->v > dec->vmax) dec->vmax = c->v;
+    }
+
+    // Gray comes from the first component at full resolution
+    if (dec->comp[0].h != dec->hmax || dec->comp[0].v != dec->vmax) {
+        ESP_LOGW(TAG, "Subsampled luma is not supported");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    dec->mcux = (dec->width + 8 * dec->hmax - 1) / (8 * dec->hmax);
+    dec->mcuy = (dec->height + 8 * dec->vmax - 1) / (8 * dec->vmax);
+    for (int i = 0; i < dec->ncomp; i++) {
+        jpeg_comp_t *c = &dec->comp[i];
+        int cw = (dec->width * c->h + dec->hmax - 1) / dec->hmax;
+        int ch = (dec->height * c->v + dec->vmax - 1) / dec->vmax;
+        c->bw = (cw + 7) / 8;
+        c->bh = (ch + 7) / 8;
+    }
+    return ESP_OK;
+}
+
+static void skip_segment(jpeg_prog_t *dec)
+{
+    int len = read_u16(dec);
+    if (len > 2) {
+        skip_bytes(dec, len - 2);
+    }
+}
+
+// ---- Coefficient access ----
+
+static inline bool coef_nonzero(const jpeg_prog_t *dec, const int16_t *blk,
+                                const uint64_t *nz, int z)
+{
+    int slot = dec->slot[z];
+    return (slot >= 0) ? blk[slot] != 0 : ((*nz >> z) & 1);
+}
+
+static inline void coef_set(const jpeg_prog_t *dec, int16_t *blk, uint64_t *nz, int z, int v)
+{
+    int slot = dec->slot[z];
+    if (slot >= 0) {
+        blk[slot] = (int16_t)v;
+    } else {
+        *nz |= 1ULL << z;
+    }
+}
+
+// Correction bit for a coefficient that is already nonzero
+static inline void coef_refine(jpeg_prog_t *dec, int16_t *blk, int z, int p1)
+{
+    int slot = dec->slot[z];
+    if (get_bit(dec) && slot >= 0 && (blk[slot] & p1) == 0) {
+        blk[slot] += (blk[slot] >= 0) ? p1 : -p1;
+    }
+}
+
+// ---- Block decoding (blk is NULL for components that are not kept) ----
+
+static void decode_dc_first(jpeg_prog_t *dec, jpeg_comp_t *c, int16_t *blk, int al)
+{
+    int t = huff_decode(dec, &dec->huff[c->td]);
+    c->dc_pred += t ? receive_extend(dec, t) : 0;
+    if (blk) {
+        blk[0] = (int16_t)(c->dc_pred * (1 << al));
+    }
+}
+
+static void decode_dc_refine(jpeg_prog_t *dec, int16_t *blk, int al)
+{
+    if (get_bit(dec) && blk) {
+        blk[0] |= 1 << al;
+    }
+}
+
+static void decode_ac_first(jpeg_prog_t *dec, const jpeg_comp_t *c, int16_t *blk,
+                            uint64_t *nz, int ss, int se, int al)
+{
+    if (dec->eobrun > 0) {
+        dec->eobrun--;
+        return;
+    }
+
+    const jpeg_huff_t *h = &dec->huff[4 + c->ta];
+    for (int z = ss; z <= se; z++) {
+        int rs = huff_decode(dec, h);
+        int r = rs >> 4, s = rs & 15;
+        if (s) {
+            z += r;
+            if (z > 63) {
+                dec->error = true;
+                return;
+            }
+            coef_set(dec, blk, nz, z, receive_extend(dec, s) * (1 << al));
+        } else if (r < 15) {
+            dec->eobrun = (1 << r) - 1 + get_bits(dec, r);
+            return;
+        } else {
+            z += 15;
+        }
+    }
+}
+
+static void decode_ac_refine(jpeg_prog_t *dec, const jpeg_comp_t *c, int16_t *blk,
+                             uint64_t *nz, int ss, int se, int al)
+{
+    const jpeg_huff_t *h = &dec->huff[4 + c->ta];
+    int p1 = 1 << al;
+    int z = ss;
+
+    if (dec->eobrun == 0) {
+        for (; z <= se; z++) {
+            int rs = huff_decode(dec, h);
+            int r = rs >> 4, s = rs & 15;
+            int v = 0;
+            if (s) {
+                v = get_bit(dec) ? p1 : -p1;
+            } else if (r != 15) {
+                dec->eobrun = (1 << r) + get_bits(dec, r);
+                break;
+            }
+
+            // Skip r zero coefficients, refining the nonzero ones on the way
+            for (; z <= se; z++) {
+                if (coef_nonzero(dec, blk, nz, z)) {
+                    coef_refine(dec, blk, z, p1);
+                } else if (--r < 0) {
+                    break;
+                }
+            }
+            if (v && z <= se) {
+                coef_set(dec, blk, nz, z, v);
+            }
+        }
+    }
+
+    if (dec->eobrun > 0) {
+        for (; z <= se; z++) {
+            if (coef_nonzero(dec, blk, nz, z)) {
+                coef_refine(dec, blk, z, p1);
+            }
+        }
+        dec->eobrun--;
+    }
+}
+
+static void decode_block(jpeg_prog_t *dec, int ci, int bx, int by,
+                         int ss, int se, int ah, int al)
+{
+    jpeg_comp_t *c = &dec->comp[ci];
+    int16_t *blk = NULL;
+    uint64_t *nz = NULL;
+    if (ci == 0) {
+        size_t bi = (size_t)by * dec->stride + bx;
+        blk = dec->coef + bi * dec->k * dec->k;
+        nz = dec->nz ? dec->nz + bi : NULL;
+    }
+
+    if (ss == 0) {
+        if (ah == 0) {
+            decode_dc_first(dec, c, blk, al);
+        } else {
+            decode_dc_refine(dec, blk, al);
+        }
+    } else if (ah == 0) {
+        decode_ac_first(dec, c, blk, nz, ss, se, al);
+    } else {
+        decode_ac_refine(dec, c, blk, nz, ss, se, al);
+    }
+}
+
+// Re-sync at a restart marker: bit buffer, DC predictions and EOB run start over
+static void restart(jpeg_prog_t *dec)
+{
+    dec->bits = 0;
+    dec->nbits = 0;
+    int m = next_marker(dec);
+    if (m < M_RST0 || m > M_RST7) {
+        dec->marker = m;    // Not a restart: leave it for the marker loop
+    }
+    for (int i = 0; i < dec->ncomp; i++) {
+        dec->comp[i].dc_pred = 0;
+    }
+    dec->eobrun = 0;
+}
+
+static esp_err_t decode_scan(jpeg_prog_t *dec)
+{
+    int len = read_u16(dec);
+    int ns = read_byte(dec);
+    if (ns < 1 || ns > dec->ncomp || len != 6 + 2 * ns) {
+        return ESP_FAIL;
+    }
+
+    int ci[JPEG_PROG_MAX_COMPS];
+    bool has_luma = false;
+    for (int i = 0; i < ns; i++) {
+        int id = read_byte(dec);
+        int tables = read_byte(dec);
+        ci[i] = -1;
+        for (int j = 0; j < dec->ncomp; j++) {
+            if (dec->comp[j].id == id) ci[i] = j;
+        }
+        if (ci[i] < 0) {
+            return ESP_FAIL;
+        }
+        dec->comp[ci[i]].td = (tables >> 4) & 3;
+        dec->comp[ci[i]].ta = tables & 3;
+        has_luma |= ci[i] == 0;
+    }
+    int ss = read_byte(dec);
+    int se = read_byte(dec);
+    int ahal = read_byte(dec);
+    int ah = ahal >> 4, al = ahal & 15;
+    if (ahal < 0 || se > 63 || ss > se || (ss == 0 && se != 0) || (ss > 0 && ns != 1) || al > 13) {
+        return ESP_FAIL;
+    }
+
+    // Chroma-only scans are stepped over without decoding
+    if (!has_luma) {
+        int m;
+        do {
+            m = next_marker(dec);
+        } while (m >= M_RST0 && m <= M_RST7);
+        dec->marker = m;
+        return ESP_OK;
+    }
+
+    dec->bits = 0;
+    dec->nbits = 0;
+    dec->eobrun = 0;
+    for (int i = 0; i < dec->ncomp; i++) {
+        dec->comp[i].dc_pred = 0;
+    }
+
+    int todo = dec->restart_interval;
+    if (ns == 1) {
+        // Non-interleaved: one block per MCU, only the blocks the component covers
+        const jpeg_comp_t *c = &dec->comp[ci[0]];
+        for (int by = 0; by < c->bh && !dec->error && !dec->eof; by++) {
+            for (int bx = 0; bx < c->bw; bx++) {
+                decode_block(dec, ci[0], bx, by, ss, se, ah, al);
+                if (dec->restart_interval && --todo == 0) {
+                    restart(dec);
+                    todo = dec->restart_interval;
+                }
+            }
+        }
+    } else {
+        for (int my = 0; my < dec->mcuy && !dec->error && !dec->eof; my++) {
+            for (int mx = 0; mx < dec->mcux; mx++) {
+                for (int i = 0; i < ns; i++) {
+                    const jpeg_comp_t *c = &dec->comp[ci[i]];
+                    for (int v = 0; v < c->v; v++) {
+                        for (int h = 0; h < c->h; h++) {
+                            decode_block(dec, ci[i], mx * c->h + h, my * c->v + v,
+                                         ss, se, ah, al);
+                        }
+                    }
+                }
+                if (dec->restart_interval && --todo == 0) {
+                    restart(dec);
+                    todo = dec->restart_interval;
+                }
+            }
+        }
+    }
+
+    dec->bits = 0;
+    dec->nbits = 0;
+    return dec->error ? ESP_FAIL : ESP_OK;
+}
+
+// ---- Output ----
+
+// k-point IDCT of every block in a block row into k output rows
+static void idct_block_row(const jpeg_prog_t *dec, int by, const int32_t *tab,
+                           const int32_t *q, uint8_t *band, int band_w)
+{
+    int k = dec->k;
+    int32_t tmp[64];
+
+    for (int bx = 0; bx < dec->stride && bx * k < band_w; bx++) {
+        const int16_t *blk = dec->coef + ((size_t)by * dec->stride + bx) * k * k;
+
+        // Rows: tmp[v][x] = sum_u tab[x][u] * F[v][u], Q11 -> Q4
+        for (int v = 0; v < k; v++) {
+            int32_t f[8];
+            for (int u = 0; u < k; u++) {
+                int32_t c = blk[v * k + u] * q[v * k + u];
+                f[u] = (c < -2048) ? -2048 : (c > 2047) ? 2047 : c;
+            }
+            for (int x = 0; x < k; x++) {
+                int32_t acc = 0;
+                for (int u = 0; u < k; u++) {
+                    acc += tab[x * k + u] * f[u];
+                }
+                tmp[v * k + x] = acc >> 7;
+            }
+        }
+
+        // Columns: out[y][x] = sum_v tab[y][v] * tmp[v][x], Q15, rounded
+        for (int y = 0; y < k; y++) {
+            uint8_t *out = band + (size_t)y * band_w + bx * k;
+            for (int x = 0; x < k && bx * k + x < band_w; x++) {
+                int32_t acc = (128 << 15) + (1 << 14);
+                for (int v = 0; v < k; v++) {
+                    acc += tab[y * k + v] * tmp[v * k + x];
+                }
+                acc >>= 15;
+                out[x] = (acc < 0) ? 0 : (acc > 255) ? 255 : acc;
+            }
+        }
+    }
+}
+
+static esp_err_t emit_rows(jpeg_prog_t *dec, img_row_cb_t cb, void *cb_ctx)
+{
+    int k = dec->k;
+    int out_w = (dec->width * k + 7) / 8;
+    int out_h = (dec->height * k + 7) / 8;
+
+    // IDCT basis for k points, same normalization as the 8-point one
+    int32_t tab[64];
+    for (int x = 0; x < k; x++) {
+        for (int u = 0; u < k; u++) {
+            float cu = (u == 0) ? (float)M_SQRT1_2 : 1.0f;
+            float w = 0.5f * cu * cosf((2 * x + 1) * u * (float)M_PI / (2 * k));
+            tab[x * k + u] = (int32_t)lroundf(w * 2048.0f);
+        }
+    }
+
+    // Dequantization factors per store slot
+    int32_t q[64];
+    const uint16_t *qt = dec->qt[dec->comp[0].tq];
+    for (int z = 0; z < 64; z++) {
+        if (dec->slot[z] >= 0) {
+            q[dec->slot[z]] = qt[z];
+        }
+    }
+
+    uint8_t *band = img_arena_alloc((size_t)k * out_w);
+    if (!band) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = ESP_OK;
+    for (int by = 0; by * k < out_h && ret == ESP_OK; by++) {
+        idct_block_row(dec, by, tab, q, band, out_w);
+        for (int y = 0; y < k && by * k + y < out_h && ret == ESP_OK; y++) {
+            ret = cb(cb_ctx, band + (size_t)y * out_w, by * k + y);
+        }
+    }
+
+    img_arena_free(band);
+    return ret;
+}
+
+// ---- Public API ----
+
+esp_err_t jpeg_prog_init(jpeg_prog_t *dec, FILE *fp, const uint8_t *data, size_t size)
+{
+    memset(dec, 0, sizeof(*dec));
+    dec->fp = fp;
+    dec->data = data;
+    dec->size = size;
+    dec->marker = -1;
+
+    dec->huff = img_arena_calloc(8, sizeof(jpeg_huff_t));
+    if (fp) {
+        dec->buf = img_arena_alloc(READ_BUF_SIZE);
+    }
+    if (!dec->huff || (fp && !dec->buf)) {
+        jpeg_prog_deinit(dec);
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = ESP_FAIL;
+    if (read_byte(dec) == 0xFF && read_byte(dec) == M_SOI) {
+        for (;;) {
+            int m = next_marker(dec);
+            if (m == M_DHT) {
+                ret = read_dht(dec);
+            } else if (m == M_DQT) {
+                ret = read_dqt(dec);
+            } else if (m == M_DRI) {
+                read_u16(dec);
+                dec->restart_interval = read_u16(dec);
+                ret = ESP_OK;
+            } else if (m == M_SOF2) {
+                ret = read_sof(dec);
+                break;
+            } else if (m >= M_SOF0 && m <= 0xCF && m != M_DHT && m != 0xC8 && m != 0xCC) {
+                ret = ESP_ERR_NOT_SUPPORTED;    // Baseline, lossless or arithmetic coded
+                break;
+            } else if (m < 0 || m == M_EOI || m == M_SOS) {
+                ret = ESP_FAIL;
+                break;
+            } else {
+                skip_segment(dec);
+                ret = ESP_OK;
+            }
+            if (ret != ESP_OK) break;
+        }
+    }
+
+    if (ret != ESP_OK) {
+        jpeg_prog_deinit(dec);
+    }
+    return ret;
+}
+
+size_t jpeg_prog_mem(const jpeg_prog_t *dec, int scale)
+{
+    int k = 8 >> scale;
+    size_t blocks = (size_t)dec->mcux * dec->comp[0].h * dec->mcuy * dec->comp[0].v;
+    size_t coef = blocks * k * k * sizeof(int16_t);
+    size_t nz = (k < 8) ? blocks * sizeof(uint64_t) : 0;
+    size_t band = (size_t)k * ((dec->width * k + 7) / 8);
+    return coef + nz + band;
+}
+
+esp_err_t jpeg_prog_decode(jpeg_prog_t *dec, int scale, img_row_cb_t cb, void *cb_ctx)
+{
+    if (scale < 0 || scale > 3) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int k = 8 >> scale;
+    dec->k = k;
+    for (int z = 0; z < 64; z++) {
+        int row = zigzag[z] >> 3, col = zigzag[z] & 7;
+        dec->slot[z] = (row < k && col < k) ? row * k + col : -1;
+    }
+
+    // Luma store covers whole MCUs so interleaved scans need no bounds checks
+    dec->stride = dec->mcux * dec->comp[0].h;
+    size_t blocks = (size_t)dec->stride * dec->mcuy * dec->comp[0].v;
+    size_t coef_size = blocks * k * k * sizeof(int16_t);
+    size_t nz_size = (k < 8) ? blocks * sizeof(uint64_t) : 0;
+
+    dec->coef = img_arena_calloc(1, coef_size);
+    if (nz_size) {
+        dec->nz = img_arena_calloc(1, nz_size);
+    }
+    if (!dec->coef || (nz_size && !dec->nz)) {
+        ESP_LOGE(TAG, "Cannot allocate coefficient store (%u KB)",
+                 (unsigned)((coef_size + nz_size) / 1024));
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Progressive JPEG %dx%d, %dx%d coefficients per block (%u KB)",
+             dec->width, dec->height, k, k, (unsigned)((coef_size + nz_size) / 1024));
+
+    // Scans until EOI; a truncated file shows whatever the scans so far refined
+    int scans = 0;
+    for (;;) {
+        int m = next_marker(dec);
+        esp_err_t ret = ESP_OK;
+        if (m == M_SOS) {
+            ret = decode_scan(dec);
+            scans++;
+        } else if (m == M_DHT) {
+            ret = read_dht(dec);
+        } else if (m == M_DQT) {
+            ret = read_dqt(dec);
+        } else if (m == M_DRI) {
+            read_u16(dec);
+            dec->restart_interval = read_u16(dec);
+        } else if (m == M_EOI) {
+            break;
+        } else if (m < 0) {
+            ESP_LOGW(TAG, "Data ends after %d scans", scans);
+            break;
+        } else if (m < M_RST0 || m > M_RST7) {
+            skip_segment(dec);
+        }
+        if (dec->eof) {
+            ESP_LOGW(TAG, "Data ends in scan %d", scans);
+            break;
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Corrupt data in scan %d", scans);
+            return ret;
+        }
+    }
+
+    return emit_rows(dec, cb, cb_ctx);
+}
+
+void jpeg_prog_deinit(jpeg_prog_t *dec)
+{
+    if (!dec) return;
+    img_arena_free(dec->huff);
+    img_arena_free(dec->buf);
+    img_arena_free(dec->coef);
+    img_arena_free(dec->nz);
+    dec->huff = NULL;
+    dec->buf = NULL;
+    dec->coef = NULL;
+    dec->nz = NULL;
+}
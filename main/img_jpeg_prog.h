@@ -0,0 +1,120 @@
+/*
+ * Image JPEG Prog - Progressive JPEG decoder with a reduced coefficient store
+ *
+ * Only the top-left k x k coefficients of each luma block are kept
+ * (k = 8 >> scale), so the scans of a large photo refine a store sized for
+ * the scaled image. Coefficients outside the store are reduced to one
+ * "nonzero" bit, which is all the refinement passes need from them.
+ * Chroma scans are skipped without Huffman decoding where they are not
+ * interleaved with luma. Output is grayscale (the Y channel).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "esp_err.h"
+#include "image_processor.h"
+
+#define JPEG_PROG_MAX_COMPS 4
+
+// Huffman table: fast lookup for short codes, canonical code ranges for the rest
+typedef struct {
+    uint8_t fast[512];          // Symbol index for 9-bit prefixes, 255 = slow path
+    uint8_t size[256];          // Code length per symbol index
+    uint8_t values[256];        // Symbols in code order
+    int32_t maxcode[18];        // Largest code + 1 per length (left aligned to 16 bits)
+    int32_t delta[17];          // Symbol index minus code per length
+} jpeg_huff_t;
+
+// Frame component
+typedef struct {
+    uint8_t id;
+    uint8_t h;                  // Horizontal sampling factor
+    uint8_t v;                  // Vertical sampling factor
+    uint8_t tq;                 // Quantization table
+    uint8_t td;                 // DC table of the current scan
+    uint8_t ta;                 // AC table of the current scan
+    int bw;                     // Blocks per row covering the component
+    int bh;                     // Block rows covering the component
+    int dc_pred;
+} jpeg_comp_t;
+
+// Decoder state
+typedef struct {
+    // Input
+    FILE *fp;
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+    uint8_t *buf;               // File read buffer
+    size_t buf_len;
+    size_t buf_pos;
+
+    // Entropy bit reader
+    uint32_t bits;
+    int nbits;
+    int marker;                 // Marker met inside entropy data, -1 = none
+    bool error;
+    bool eof;                   // Input exhausted
+
+    // Frame
+    int width;
+    int height;
+    int ncomp;
+    jpeg_comp_t comp[JPEG_PROG_MAX_COMPS];
+    int hmax;
+    int vmax;
+    int mcux;                   // MCUs per row (interleaved scans)
+    int mcuy;
+    int restart_interval;
+    uint16_t qt[4][64];         // Quantization tables, zigzag order
+    jpeg_huff_t *huff;          // 4 DC tables then 4 AC tables
+
+    // Reduced luma store
+    int k;                      // Coefficients kept per block side (1, 2, 4 or 8)
+    int8_t slot[64];            // Store index per zigzag position, -1 = dropped
+    int stride;                 // Luma blocks per store row
+    int16_t *coef;              // k x k coefficients per luma block
+    uint64_t *nz;               // Nonzero bits (zigzag order) of dropped coefficients
+    int eobrun;
+} jpeg_prog_t;
+
+/**
+ * @brief Read the JPEG headers up to the frame header
+ * @param dec Decoder state
+ * @param fp Source file positioned at the start of the JPEG, or NULL
+ * @param data Source data when fp is NULL
+ * @param size Source data size
+ * @return ESP_OK, ESP_ERR_NOT_SUPPORTED if the file is not a progressive
+ *         Huffman JPEG, ESP_ERR_NO_MEM or ESP_FAIL
+ */
+esp_err_t jpeg_prog_init(jpeg_prog_t *dec, FILE *fp, const uint8_t *data, size_t size);
+
+/**
+ * @brief Bytes jpeg_prog_decode allocates at a scale (coefficient store
+ *        and output band)
+ * @param dec Decoder state (after jpeg_prog_init)
+ * @param scale 0-3 (1/1, 1/2, 1/4, 1/8)
+ */
+size_t jpeg_prog_mem(const jpeg_prog_t *dec, int scale);
+
+/**
+ * @brief Decode all scans and emit the gray image at 1/2^scale size
+ *
+ * Rows are (width * k + 7) / 8 pixels wide, (height * k + 7) / 8 rows in
+ * total, k = 8 >> scale.
+ *
+ * @param dec Decoder state (after jpeg_prog_init)
+ * @param scale 0-3 (1/1, 1/2, 1/4, 1/8)
+ * @param cb Called once per output row, in order
+ * @param cb_ctx Passed to cb
+ * @return ESP_OK, the callback's error, ESP_ERR_NO_MEM or ESP_FAIL
+ */
+esp_err_t jpeg_prog_decode(jpeg_prog_t *dec, int scale, img_row_cb_t cb, void *cb_ctx);
+
+/**
+ * @brief Free the decoder buffers
+ */
+void jpeg_prog_deinit(jpeg_prog_t *dec);
@@ -0,0 +1,432 @@
+/*
+ * Image Kernels Implementation
+ *
+ * The C versions are the reference: the vector versions compute the same
+ * integer expressions (luma sums fit 16 bits, compares are unsigned) and
+ * fall back to the C loop for the last partial vector, so switching kernel
+ * sets never changes a frame. The set is chosen at compile time from the
+ * target (SSE2 on x86-64, NEON on ARM); the SSSE3 luma kernel is picked at
+ * run time since a generic x86-64 build cannot assume it.
+ *
+ * The vector sets speed up host builds only. The frame itself (Xtensa)
+ * builds the C versions, which keep the pixel loops branch-free: 8
+ * compares fused into each output byte, the LUT unrolled by 4, inversion a
+ * word at a time.
+ *
+ * Open: a set for the ESP32-S3's PIE vector unit, in assembly as esp-dsp
+ * does it, selected under CONFIG_IDF_TARGET_ESP32S3 next to the ones below
+ * and checked bit for bit against the C versions on the device, the way
+ * test_kernels checks the host sets.
+ */
+
+#include "img_kernels.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define KERNELS_SSE2 1
+#if defined(__GNUC__) && !defined(__SSSE3__)
+#include <tmmintrin.h>
+#define KERNELS_SSSE3_RUNTIME 1
+#define SSSE3_FN __attribute__((target("ssse3")))
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define SSSE3_FN
+#endif
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define KERNELS_NEON 1
+#endif
+
+static bool s_simd = true;
+
+/* ---------------------------------------------------------------------------
+ * Portable C versions
+ * ------------------------------------------------------------------------- */
+
+static void luma_c(const uint8_t *rgb, uint8_t *gray, int n)
+{
+    for (int i = 0; i < n; i++, rgb += 3) {
+        gray[i] = (rgb[0] * 77 + rgb[1] * 150 + rgb[2] * 29) >> 8;
+    }
+}
+
+static void lut_c(const uint8_t lut[256], const uint8_t *in, uint8_t *out, int n)
+{
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint8_t a = lut[in[i]], b = lut[in[i + 1]];
+        uint8_t c = lut[in[i + 2]], d = lut[in[i + 3]];
+        out[i] = a;
+        out[i + 1] = b;
+        out[i + 2] = c;
+        out[i + 3] = d;
+    }
+    for (; i < n; i++) {
+        out[i] = lut[in[i]];
+    }
+}
+
+// One output byte from 8 pixels and 8 thresholds
+static inline uint8_t pack8(const uint8_t *g, const uint8_t *t)
+{
+    return (uint8_t)(((g[0] >= t[0]) << 7) | ((g[1] >= t[1]) << 6) |
+                     ((g[2] >= t[2]) << 5) | ((g[3] >= t[3]) << 4) |
+                     ((g[4] >= t[4]) << 3) | ((g[5] >= t[5]) << 2) |
+                     ((g[6] >= t[6]) << 1) | (g[7] >= t[7]));
+}
+
+static void map_pack_c(const uint8_t *gray, const uint8_t *map, int mask, uint8_t *packed,
+                       int x0, int x1)
+{
+    int x = x0;
+    for (; x + 8 <= x1; x += 8) {
+        packed[x >> 3] = pack8(gray + x, map + (x & mask));
+    }
+    if (x < x1) {
+        uint8_t acc = 0;
+        for (int i = x; i < x1; i++) {
+            acc |= (gray[i] >= map[i & mask]) << (7 - (i & 7));
+        }
+        packed[x >> 3] = acc;
+    }
+}
+
+static void threshold_pack_c(const uint8_t *gray, uint8_t threshold, uint8_t *packed,
+                             int x0, int x1)
+{
+    uint8_t t[8];
+    memset(t, threshold, sizeof(t));
+    map_pack_c(gray, t, 7, packed, x0, x1);
+}
+
+static void invert_c(uint8_t *buf, int n)
+{
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t w;
+        memcpy(&w, buf + i, 4);
+        w = ~w;
+        memcpy(buf + i, &w, 4);
+    }
+    for (; i < n; i++) {
+        buf[i] = ~buf[i];
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * SSE2 / SSSE3
+ * ------------------------------------------------------------------------- */
+
+#ifdef KERNELS_SSE2
+
+// movemask puts pixel 0 in bit 0; packed rows want it in bit 7
+#define R2(n) n, n + 2 * 64, n + 1 * 64, n + 3 * 64
+#define R4(n) R2(n), R2(n + 2 * 16), R2(n + 1 * 16), R2(n + 3 * 16)
+#define R6(n) R4(n), R4(n + 2 * 4), R4(n + 1 * 4), R4(n + 3 * 4)
+static const uint8_t s_rev8[256] = {R6(0), R6(2), R6(1), R6(3)};
+
+// 16 pixels against 16 thresholds -> two packed bytes
+static inline void pack16_sse2(__m128i g, __m128i t, uint8_t *out)
+{
+    int m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(g, t), g));
+    out[0] = s_rev8[m & 0xFF];
+    out[1] = s_rev8[m >> 8];
+}
+
+static void threshold_pack_sse2(const uint8_t *gray, uint8_t threshold, uint8_t *packed,
+                                int x0, int x1)
+{
+    __m128i t = _mm_set1_epi8((char)threshold);
+    int x = x0;
+    for (; x + 16 <= x1; x += 16) {
+        pack16_sse2(_mm_loadu_si128((const __m128i *)(gray + x)), t, packed + (x >> 3));
+    }
+    threshold_pack_c(gray, threshold, packed, x, x1);
+}
+
+static void map_pack_sse2(const uint8_t *gray, const uint8_t *map, int mask, uint8_t *packed,
+                          int x0, int x1)
+{
+    int x = x0;
+    for (; x + 16 <= x1; x += 16) {
+        __m128i t = _mm_unpacklo_epi64(
+            _mm_loadl_epi64((const __m128i *)(map + (x & mask))),
+            _mm_loadl_epi64((const __m128i *)(map + ((x + 8) & mask))));
+        pack16_sse2(_mm_loadu_si128((const __m128i *)(gray + x)), t, packed + (x >> 3));
+    }
+    map_pack_c(gray, map, mask, packed, x, x1);
+}
+
+static void invert_sse2(uint8_t *buf, int n)
+{
+    const __m128i ones = _mm_set1_epi8(-1);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+        _mm_storeu_si128((__m128i *)(buf + i), _mm_xor_si128(v, ones));
+    }
+    invert_c(buf + i, n - i);
+}
+
+#if defined(KERNELS_SSSE3_RUNTIME) || defined(__SSSE3__)
+#define KERNELS_SSSE3 1
+
+// Weighted sum of 16 R, G, B bytes, >> 8
+SSSE3_FN static inline __m128i luma16_ssse3(__m128i r, __m128i g, __m128i b)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i wr = _mm_set1_epi16(77), wg = _mm_set1_epi16(150), wb = _mm_set1_epi16(29);
+    __m128i lo = _mm_add_epi16(_mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpacklo_epi8(r, zero), wr),
+        _mm_mullo_epi16(_mm_unpacklo_epi8(g, zero), wg)),
+        _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), wb));
+    __m128i hi = _mm_add_epi16(_mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpackhi_epi8(r, zero), wr),
+        _mm_mullo_epi16(_mm_unpackhi_epi8(g, zero), wg)),
+        _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), wb));
+    return _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+}
+
+// Gather one channel of 16 pixels from 48 interleaved bytes (-1 = zero)
+#define SHUF(v, ...) _mm_shuffle_epi8(v, _mm_setr_epi8(__VA_ARGS__))
+
+SSSE3_FN static void luma_ssse3(const uint8_t *rgb, uint8_t *gray, int n)
+{
+    int i = 0;
+    for (; i + 16 <= n; i += 16, rgb += 48) {
+        __m128i a = _mm_loadu_si128((const __m128i *)rgb);
+        __m128i b = _mm_loadu_si128((const __m128i *)(rgb + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(rgb + 32));
+        __m128i r = _mm_or_si128(_mm_or_si128(
+            SHUF(a, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1),
+            SHUF(b, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1)),
+            SHUF(c, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13));
+        __m128i g = _mm_or_si128(_mm_or_si128(
+            SHUF(a, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1),
+            SHUF(b, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1)),
+            SHUF(c, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14));
+        __m128i bl = _mm_or_si128(_mm_or_si128(
+            SHUF(a, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1),
+            SHUF(b, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1)),
+            SHUF(c, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15));
+        _mm_storeu_si128((__m128i *)(gray + i), luma16_ssse3(r, g, bl));
+    }
+    luma_c(rgb, gray + i, n - i);
+}
+
+static bool has_ssse3(void)
+{
+#ifdef KERNELS_SSSE3_RUNTIME
+    return __builtin_cpu_supports("ssse3");
+#else
+    return true;
+#endif
+}
+#endif  // SSSE3
+
+#endif  // KERNELS_SSE2
+
+/* ---------------------------------------------------------------------------
+ * NEON
+ * ------------------------------------------------------------------------- */
+
+#ifdef KERNELS_NEON
+
+static void luma_neon(const uint8_t *rgb, uint8_t *gray, int n)
+{
+    const uint8x8_t wr = vdup_n_u8(77), wg = vdup_n_u8(150), wb = vdup_n_u8(29);
+    int i = 0;
+    for (; i + 16 <= n; i += 16, rgb += 48) {
+        uint8x16x3_t p = vld3q_u8(rgb);
+        uint16x8_t lo = vmull_u8(vget_low_u8(p.val[0]), wr);
+        lo = vmlal_u8(lo, vget_low_u8(p.val[1]), wg);
+        lo = vmlal_u8(lo, vget_low_u8(p.val[2]), wb);
+        uint16x8_t hi = vmull_u8(vget_high_u8(p.val[0]), wr);
+        hi = vmlal_u8(hi, vget_high_u8(p.val[1]), wg);
+        hi = vmlal_u8(hi, vget_high_u8(p.val[2]), wb);
+        vst1q_u8(gray + i, vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8)));
+    }
+    luma_c(rgb, gray + i, n - i);
+}
+
+#ifdef __aarch64__
+// 256-entry lookup as four 64-entry table lookups: indices past a table
+// leave the lane alone, so each step only fills its own quarter
+static void lut_neon(const uint8_t lut[256], const uint8_t *in, uint8_t *out, int n)
+{
+    uint8x16x4_t t[4];
+    for (int k = 0; k < 4; k++) {
+        for (int j = 0; j < 4; j++) {
+            t[k].val[j] = vld1q_u8(lut + k * 64 + j * 16);
+        }
+    }
+    const uint8x16_t step = vdupq_n_u8(64);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t idx = vld1q_u8(in + i);
+        uint8x16_t v = vqtbl4q_u8(t[0], idx);
+        idx = vsubq_u8(idx, step);
+        v = vqtbx4q_u8(v, t[1], idx);
+        idx = vsubq_u8(idx, step);
+        v = vqtbx4q_u8(v, t[2], idx);
+        idx = vsubq_u8(idx, step);
+        v = vqtbx4q_u8(v, t[3], idx);
+        vst1q_u8(out + i, v);
+    }
+    lut_c(lut, in + i, out + i, n - i);
+}
+#endif
+
+// 16 pixels against 16 thresholds -> two packed bytes: weight each lane
+// by its bit and add up each half with pairwise adds
+static inline void pack16_neon(uint8x16_t g, uint8x16_t t, uint8_t *out)
+{
+    static const uint8_t bits[16] = {128, 64, 32, 16, 8, 4, 2, 1,
+                                     128, 64, 32, 16, 8, 4, 2, 1};
+    uint8x16_t m = vandq_u8(vcgeq_u8(g, t), vld1q_u8(bits));
+    uint8x8_t s = vpadd_u8(vget_low_u8(m), vget_high_u8(m));
+    s = vpadd_u8(s, s);
+    s = vpadd_u8(s, s);
+    out[0] = vget_lane_u8(s, 0);
+    out[1] = vget_lane_u8(s, 1);
+}
+
+static void threshold_pack_neon(const uint8_t *gray, uint8_t threshold, uint8_t *packed,
+                                int x0, int x1)
+{
+    uint8x16_t t = vdupq_n_u8(threshold);
+    int x = x0;
+    for (; x + 16 <= x1; x += 16) {
+        pack16_neon(vld1q_u8(gray + x), t, packed + (x >> 3));
+    }
+    threshold_pack_c(gray, threshold, packed, x, x1);
+}
+
+static void map_pack_neon(const uint8_t *gray, const uint8_t *map, int mask, uint8_t *packed,
+                          int x0, int x1)
+{
+    int x = x0;
+    for (; x + 16 <= x1; x += 16) {
+        uint8x16_t t = vcombine_u8(vld1_u8(map + (x & mask)), vld1_u8(map + ((x + 8) & mask)));
+        pack16_neon(vld1q_u8(gray + x), t, packed + (x >> 3));
+    }
+    map_pack_c(gray, map, mask, packed, x, x1);
+}
+
+static void invert_neon(uint8_t *buf, int n)
+{
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        vst1q_u8(buf + i, vmvnq_u8(vld1q_u8(buf + i)));
+    }
+    invert_c(buf + i, n - i);
+}
+
+#endif  // KERNELS_NEON
+
+/* ---------------------------------------------------------------------------
+ * Dispatch
+ * ------------------------------------------------------------------------- */
+
+const char *img_kernels_name(void)
+{
+    if (!s_simd) return "c";
+#if defined(KERNELS_SSSE3)
+    return has_ssse3() ? "ssse3" : "sse2";
+#elif defined(KERNELS_SSE2)
+    return "sse2";
+#elif defined(KERNELS_NEON)
+    return "neon";
+#else
+    return "c";
+#endif
+}
+
+bool img_kernels_set_simd(bool enable)
+{
+    s_simd = enable;
+#if defined(KERNELS_SSE2) || defined(KERNELS_NEON)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void img_k_luma(const uint8_t *rgb, uint8_t *gray, int n)
+{
+#if defined(KERNELS_SSSE3)
+    if (s_simd && has_ssse3()) {
+        luma_ssse3(rgb, gray, n);
+        return;
+    }
+#elif defined(KERNELS_NEON)
+    if (s_simd) {
+        luma_neon(rgb, gray, n);
+        return;
+    }
+#endif
+    luma_c(rgb, gray, n);
+}
+
+void img_k_lut(const uint8_t lut[256], const uint8_t *in, uint8_t *out, int n)
+{
+#if defined(KERNELS_NEON) && defined(__aarch64__)
+    if (s_simd) {
+        lut_neon(lut, in, out, n);
+        return;
+    }
+#endif
+    lut_c(lut, in, out, n);
+}
+
+void img_k_threshold_pack(const uint8_t *gray, uint8_t threshold, uint8_t *packed,
+                          int x0, int x1)
+{
+#if defined(KERNELS_SSE2)
+    if (s_simd) {
+        threshold_pack_sse2(gray, threshold, packed, x0, x1);
+        return;
+    }
+#elif defined(KERNELS_NEON)
+    if (s_simd) {
+        threshold_pack_neon(gray, threshold, packed, x0, x1);
+        return;
+    }
+#endif
+    threshold_pack_c(gray, threshold, packed, x0, x1);
+}
+
+void img_k_map_pack(const uint8_t *gray, const uint8_t *map, int mask, uint8_t *packed,
+                    int x0, int x1)
+{
+#if defined(KERNELS_SSE2)
+    if (s_simd) {
+        map_pack_sse2(gray, map, mask, packed, x0, x1);
+        return;
+    }
+#elif defined(KERNELS_NEON)
+    if (s_simd) {
+        map_pack_neon(gray, map, mask, packed, x0, x1);
+        return;
+    }
+#endif
+    map_pack_c(gray, map, mask, packed, x0, x1);
+}
+
+void img_k_invert(uint8_t *buf, int n)
+{
+#if defined(KERNELS_SSE2)
+    if (s_simd) {
+        invert_sse2(buf, n);
+        return;
+    }
+#elif defined(KERNELS_NEON)
+    if (s_simd) {
+        invert_neon(buf, n);
+        return;
+    }
+#endif
+    invert_c(buf, n);
+}
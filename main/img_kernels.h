@@ -0,0 +1,74 @@
+/*
+ * Image Kernels - Per-row pixel loops with SIMD versions
+ *
+ * RGB to luma, LUT application, compare-and-pack (8 pixels per output
+ * byte, MSB first) and bit inversion. Each kernel has a portable C version
+ * that defines the result; where a host build has vector instructions
+ * (SSE2 or SSSE3 on x86, NEON on ARM) a vector version is used instead,
+ * and it matches the C version bit for bit. The frame runs the C versions
+ * until a PIE set for the ESP32-S3 is added (see img_kernels.c).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Name of the kernel set in use ("c", "sse2", "ssse3", "neon")
+ */
+const char *img_kernels_name(void);
+
+/**
+ * @brief Enable or disable the vector kernels (tests and benchmarks)
+ * @param enable false forces the C versions
+ * @return true if vector kernels are available on this target
+ */
+bool img_kernels_set_simd(bool enable);
+
+/**
+ * @brief Convert RGB pixels to luma, same as img_luma
+ * @param rgb n RGB triplets
+ * @param gray Output, n bytes
+ * @param n Number of pixels
+ */
+void img_k_luma(const uint8_t *rgb, uint8_t *gray, int n);
+
+/**
+ * @brief Map bytes through a 256-entry table, out[i] = lut[in[i]]
+ * @param lut Table
+ * @param in Input, n bytes
+ * @param out Output, n bytes (may be in)
+ * @param n Number of bytes
+ */
+void img_k_lut(const uint8_t lut[256], const uint8_t *in, uint8_t *out, int n);
+
+/**
+ * @brief Pack gray[x0, x1) to 1bpp against a fixed threshold (on if gray >= threshold)
+ * @param gray Gray row
+ * @param threshold Threshold
+ * @param packed Packed row, pixel x at bit 7 - (x & 7) of byte x >> 3
+ * @param x0 First pixel, a multiple of 8
+ * @param x1 End pixel; a partial last byte is zero-padded
+ */
+void img_k_threshold_pack(const uint8_t *gray, uint8_t threshold, uint8_t *packed,
+                          int x0, int x1);
+
+/**
+ * @brief Pack gray[x0, x1) to 1bpp against a threshold map row
+ * @param gray Gray row
+ * @param map Threshold row, pixel x compared with map[x & mask]
+ * @param mask Map period - 1; the period is a multiple of 8
+ * @param packed Packed row, as for img_k_threshold_pack
+ * @param x0 First pixel, a multiple of 8
+ * @param x1 End pixel
+ */
+void img_k_map_pack(const uint8_t *gray, const uint8_t *map, int mask, uint8_t *packed,
+                    int x0, int x1);
+
+/**
+ * @brief Invert every bit of a buffer
+ * @param buf Buffer
+ * @param n Number of bytes
+ */
+void img_k_invert(uint8_t *buf, int n);
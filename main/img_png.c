@@ -0,0 +1,859 @@
+/*
+ * Image PNG Implementation
+ *
+ * The inflater is pull driven: the row loop asks for exactly one filtered
+ * scanline and inflation stops there, keeping any pending match or stored
+ * block length for the next call. Chunk CRCs and the zlib Adler-32 are not
+ * checked; corrupt data shows up as an inflate or filter error instead.
+ */
+
+#include "img_png.h"
+#include "img_arena.h"
+#include "img_exif.h"
+#include "img_kernels.h"
+#include "img_tone.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include "esp_log.h"
+
+static const char *TAG = "img_png";
+
+#define READ_BUF_SIZE   4096
+#define FAST_BITS       9
+#define WINDOW_MASK     32767
+
+#define CHUNK(a, b, c, d) (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((c) << 8) | (d))
+#define CHUNK_IHDR CHUNK('I', 'H', 'D', 'R')
+#define CHUNK_PLTE CHUNK('P', 'L', 'T', 'E')
+#define CHUNK_TRNS CHUNK('t', 'R', 'N', 'S')
+#define CHUNK_IDAT CHUNK('I', 'D', 'A', 'T')
+#define CHUNK_IEND CHUNK('I', 'E', 'N', 'D')
+#define CHUNK_EXIF CHUNK('e', 'X', 'I', 'f')
+
+#define EXIF_READ_MAX   1024    // eXIf bytes read: IFD0 (orientation) comes first
+
+// Inflate states
+enum {
+    INF_HEADER,     // Next block header
+    INF_STORED,     // Inside a stored block
+    INF_HUFF,       // Inside a Huffman block
+    INF_DONE,       // Final block finished
+};
+
+static const uint16_t len_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+static const uint8_t len_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+static const uint16_t dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+static const uint8_t dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+static const uint8_t clen_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+};
+
+// Adam7 passes: x0, y0, dx, dy
+static const uint8_t adam7[7][4] = {
+    {0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4},
+    {0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2},
+};
+
+// ---- Input ----
+
+static int read_byte(png_dec_t *dec)
+{
+    if (dec->fp) {
+        if (dec->buf_pos >= dec->buf_len) {
+            dec->buf_len = fread(dec->buf, 1, READ_BUF_SIZE, dec->fp);
+            dec->buf_pos = 0;
+            if (dec->buf_len == 0) return -1;
+        }
+        return dec->buf[dec->buf_pos++];
+    }
+    return (dec->pos < dec->size) ? dec->data[dec->pos++] : -1;
+}
+
+static bool read_u32(png_dec_t *dec, uint32_t *v)
+{
+    *v = 0;
+    for (int i = 0; i < 4; i++) {
+        int b = read_byte(dec);
+        if (b < 0) return false;
+        *v = (*v << 8) | b;
+    }
+    return true;
+}
+
+static void skip_bytes(png_dec_t *dec, size_t n)
+{
+    if (dec->fp) {
+        size_t avail = dec->buf_len - dec->buf_pos;
+        if (n <= avail) {
+            dec->buf_pos += n;
+            return;
+        }
+        dec->buf_pos = dec->buf_len;
+        fseek(dec->fp, (long)(n - avail), SEEK_CUR);
+    } else {
+        dec->pos = (n < dec->size - dec->pos) ? dec->pos + n : dec->size;
+    }
+}
+
+// Next byte of the zlib stream, stepping over chunk boundaries; -1 after the last IDAT
+static int idat_byte_slow(png_dec_t *dec)
+{
+    while (dec->idat_left == 0) {
+        uint32_t len, type;
+        if (dec->idat_end) {
+            return -1;
+        }
+        skip_bytes(dec, 4);     // CRC
+        if (!read_u32(dec, &len) || !read_u32(dec, &type) || type != CHUNK_IDAT) {
+            dec->idat_end = true;
+            return -1;
+        }
+        dec->idat_left = len;
+    }
+    dec->idat_left--;
+    return read_byte(dec);
+}
+
+static inline int idat_byte(png_dec_t *dec)
+{
+    // Common case: inside an IDAT chunk with the byte already buffered
+    if (dec->idat_left) {
+        if (dec->fp && dec->buf_pos < dec->buf_len) {
+            dec->idat_left--;
+            return dec->buf[dec->buf_pos++];
+        }
+        if (!dec->fp && dec->pos < dec->size) {
+            dec->idat_left--;
+            return dec->data[dec->pos++];
+        }
+    }
+    return idat_byte_slow(dec);
+}
+
+// ---- Bit reader ----
+
+static inline void need_bits(png_dec_t *dec, int n)
+{
+    while (dec->nbits < n) {
+        int b = idat_byte(dec);
+        if (b < 0) {
+            b = 0;
+            dec->phantom += 8;
+        }
+        dec->bits |= (uint32_t)b << dec->nbits;
+        dec->nbits += 8;
+    }
+}
+
+static inline void consume_bits(png_dec_t *dec, int n)
+{
+    dec->bits >>= n;
+    dec->nbits -= n;
+    if (dec->nbits < dec->phantom) {
+        dec->error = true;  // Read past the end of the data
+    }
+}
+
+static int get_bits(png_dec_t *dec, int n)
+{
+    if (n == 0) return 0;
+    need_bits(dec, n);
+    int v = dec->bits & ((1u << n) - 1);
+    consume_bits(dec, n);
+    return v;
+}
+
+// ---- Inflate ----
+
+static bool build_huff(png_huff_t *h, const uint8_t *lengths, int n)
+{
+    memset(h->count, 0, sizeof(h->count));
+    for (int i = 0; i < n; i++) {
+        h->count[lengths[i]]++;
+    }
+
+    int left = 1;
+    for (int len = 1; len < 16; len++) {
+        left = (left << 1) - h->count[len];
+        if (left < 0) {
+            return false;   // Over-subscribed
+        }
+    }
+
+    uint16_t offs[16];
+    uint16_t next[16];
+    int code = 0;
+    offs[1] = 0;
+    next[1] = 0;
+    for (int len = 1; len < 15; len++) {
+        offs[len + 1] = offs[len] + h->count[len];
+        code = (code + h->count[len]) << 1;
+        next[len + 1] = code;
+    }
+
+    memset(h->fast, 0, sizeof(h->fast));
+    for (int sym = 0; sym < n; sym++) {
+        int len = lengths[sym];
+        if (len == 0) continue;
+        h->symbol[offs[len]++] = sym;
+
+        // Codes are sent MSB first, the bit reader is LSB first
+        int c = next[len]++;
+        if (len <= FAST_BITS) {
+            int rev = 0;
+            for (int i = 0; i < len; i++) {
+                rev = (rev << 1) | ((c >> i) & 1);
+            }
+            for (int j = rev; j < (1 << FAST_BITS); j += 1 << len) {
+                h->fast[j] = (len << 9) | sym;
+            }
+        }
+    }
+    return true;
+}
+
+static inline int huff_decode(png_dec_t *dec, const png_huff_t *h)
+{
+    need_bits(dec, 16);
+    uint16_t e = h->fast[dec->bits & ((1 << FAST_BITS) - 1)];
+    if (e) {
+        consume_bits(dec, e >> 9);
+        return e & 511;
+    }
+
+    // Longer codes: canonical decode one bit at a time
+    uint32_t b = dec->bits;
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len < 16; len++) {
+        code |= b & 1;
+        b >>= 1;
+        int count = h->count[len];
+        if (code - count < first) {
+            consume_bits(dec, len);
+            return h->symbol[index + (code - first)];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    dec->error = true;
+    return -1;
+}
+
+static bool read_dynamic_tables(png_dec_t *dec)
+{
+    png_inflate_t *z = dec->inf;
+    int hlit = get_bits(dec, 5) + 257;
+    int hdist = get_bits(dec, 5) + 1;
+    int hclen = get_bits(dec, 4) + 4;
+    if (hlit > 286 || hdist > 30) {
+        return false;
+    }
+
+    uint8_t lengths[286 + 30];
+    memset(lengths, 0, 19);
+    for (int i = 0; i < hclen; i++) {
+        lengths[clen_order[i]] = get_bits(dec, 3);
+    }
+    if (!build_huff(&z->lit, lengths, 19)) {
+        return false;
+    }
+
+    int n = 0;
+    while (n < hlit + hdist && !dec->error) {
+        int sym = huff_decode(dec, &z->lit);
+        int val = 0, rep = 1;
+        if (sym < 0) {
+            return false;
+        } else if (sym < 16) {
+            val = sym;
+        } else if (sym == 16) {
+            if (n == 0) return false;
+            val = lengths[n - 1];
+            rep = 3 + get_bits(dec, 2);
+        } else if (sym == 17) {
+            rep = 3 + get_bits(dec, 3);
+        } else {
+            rep = 11 + get_bits(dec, 7);
+        }
+        if (n + rep > hlit + hdist) {
+            return false;
+        }
+        memset(lengths + n, val, rep);
+        n += rep;
+    }
+
+    return lengths[256] != 0 &&
+           build_huff(&z->lit, lengths, hlit) &&
+           build_huff(&z->dist, lengths + hlit, hdist);
+}
+
+static bool read_block_header(png_dec_t *dec)
+{
+    png_inflate_t *z = dec->inf;
+    z->last = get_bits(dec, 1);
+    int type = get_bits(dec, 2);
+
+    if (type == 0) {
+        consume_bits(dec, dec->nbits & 7);  // To a byte boundary
+        int len = get_bits(dec, 16);
+        int nlen = get_bits(dec, 16);
+        if (len != (~nlen & 0xFFFF)) {
+            return false;
+        }
+        z->stored_left = len;
+        z->state = INF_STORED;
+        return true;
+    }
+
+    if (type == 1) {
+        uint8_t lengths[288];
+        memset(lengths, 8, 144);
+        memset(lengths + 144, 9, 112);
+        memset(lengths + 256, 7, 24);
+        memset(lengths + 280, 8, 8);
+        build_huff(&z->lit, lengths, 288);
+        memset(lengths, 5, 30);
+        build_huff(&z->dist, lengths, 30);
+    } else if (type != 2 || !read_dynamic_tables(dec)) {
+        return false;
+    }
+    z->state = INF_HUFF;
+    return true;
+}
+
+// Inflate exactly n bytes into out; returns the count actually produced
+static int inflate_read(png_dec_t *dec, uint8_t *out, int n)
+{
+    png_inflate_t *z = dec->inf;
+    int done = 0;
+
+    while (done < n && !dec->error) {
+        if (z->copy_len > 0) {
+            int len = (z->copy_len < n - done) ? z->copy_len : n - done;
+            uint32_t from = z->wpos - z->copy_dist;
+            for (int i = 0; i < len; i++) {
+                uint8_t b = z->window[(from + i) & WINDOW_MASK];
+                z->window[(z->wpos + i) & WINDOW_MASK] = b;
+                out[done + i] = b;
+            }
+            z->wpos += len;
+            z->copy_len -= len;
+            done += len;
+        } else if (z->state == INF_HUFF) {
+            // Literal runs stay in this loop
+            int sym = huff_decode(dec, &z->lit);
+            while (sym >= 0 && sym < 256) {
+                z->window[z->wpos++ & WINDOW_MASK] = sym;
+                out[done++] = sym;
+                if (done == n) break;
+                sym = huff_decode(dec, &z->lit);
+            }
+            if (sym < 256) {
+                continue;   // Row full or decode error
+            } else if (sym == 256) {
+                z->state = z->last ? INF_DONE : INF_HEADER;
+            } else {
+                sym -= 257;
+                if (sym >= 29) {
+                    dec->error = true;
+                    break;
+                }
+                int len = len_base[sym] + get_bits(dec, len_extra[sym]);
+                int dsym = huff_decode(dec, &z->dist);
+                if (dsym < 0 || dsym >= 30) {
+                    dec->error = true;
+                    break;
+                }
+                int dist = dist_base[dsym] + get_bits(dec, dist_extra[dsym]);
+                if ((uint32_t)dist > z->wpos) {
+                    dec->error = true;
+                    break;
+                }
+                z->copy_len = len;
+                z->copy_dist = dist;
+            }
+        } else if (z->state == INF_STORED) {
+            if (z->stored_left == 0) {
+                z->state = z->last ? INF_DONE : INF_HEADER;
+                continue;
+            }
+            uint8_t b = get_bits(dec, 8);
+            z->window[z->wpos++ & WINDOW_MASK] = b;
+            out[done++] = b;
+            z->stored_left--;
+        } else if (z->state == INF_HEADER) {
+            if (!read_block_header(dec)) {
+                dec->error = true;
+            }
+        } else {
+            break;  // INF_DONE: stream shorter than the image
+        }
+    }
+    return done;
+}
+
+// ---- Rows ----
+
+static size_t row_bytes(const png_dec_t *dec, int pixels)
+{
+    return ((size_t)pixels * dec->channels * dec->depth + 7) / 8;
+}
+
+// Paeth predictor in compare/select form (same result as the spec's distances)
+static inline uint8_t paeth(int a, int b, int c)
+{
+    int thresh = c * 3 - (a + b);
+    int lo = (a < b) ? a : b;
+    int hi = (a < b) ? b : a;
+    int t = (hi <= thresh) ? lo : c;
+    return (thresh <= lo) ? hi : t;
+}
+
+// Undo the scanline filter in place; row[0] is the filter type.
+// The first pixel has no left neighbour, so it is handled before each loop.
+static bool unfilter(uint8_t *row, const uint8_t *prev, size_t len, int bpp)
+{
+    uint8_t *x = row + 1;
+    const uint8_t *b = prev + 1;
+    size_t first = ((size_t)bpp < len) ? (size_t)bpp : len;
+
+    switch (row[0]) {
+    case 0:
+        break;
+    case 1:
+        for (size_t i = bpp; i < len; i++) x[i] += x[i - bpp];
+        break;
+    case 2:
+        for (size_t i = 0; i < len; i++) x[i] += b[i];
+        break;
+    case 3:
+        for (size_t i = 0; i < first; i++) x[i] += b[i] >> 1;
+        for (size_t i = first; i < len; i++) x[i] += (x[i - bpp] + b[i]) >> 1;
+        break;
+    case 4:
+        for (size_t i = 0; i < first; i++) x[i] += b[i];
+        for (size_t i = first; i < len; i++) x[i] += paeth(x[i - bpp], b[i], b[i - bpp]);
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+static inline uint8_t over_white(int gray, int alpha)
+{
+    int v = gray * alpha + 255 * (255 - alpha) + 128;
+    return (v + (v >> 8)) >> 8;
+}
+
+static inline uint16_t sample16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+// Raw samples -> gray, alpha and tRNS composited onto white
+static void row_to_gray(const png_dec_t *dec, const uint8_t *raw, uint8_t *gray, int count)
+{
+    int depth = dec->depth;
+
+    if (depth < 8) {
+        static const uint8_t gray_scale[9] = {0, 255, 85, 0, 17, 0, 0, 0, 1};
+        int mask = (1 << depth) - 1;
+        int per_byte = 8 / depth;
+        for (int i = 0; i < count; i++) {
+            int shift = 8 - depth * (i % per_byte + 1);
+            int v = (raw[i / per_byte] >> shift) & mask;
+            if (dec->color == 3) {
+                gray[i] = dec->palette[v];
+            } else {
+                gray[i] = (dec->has_trns && v == dec->trns[0]) ? 255 : v * gray_scale[depth];
+            }
+        }
+        return;
+    }
+
+    int step = depth / 8;   // Bytes per sample
+    switch (dec->color) {
+    case 0:
+        for (int i = 0; i < count; i++, raw += step) {
+            int v = (step == 2) ? sample16(raw) : raw[0];
+            gray[i] = (dec->has_trns && v == dec->trns[0]) ? 255 : raw[0];
+        }
+        break;
+    case 2:
+        if (step == 1 && !dec->has_trns) {
+            img_k_luma(raw, gray, count);
+            break;
+        }
+        for (int i = 0; i < count; i++, raw += 3 * step) {
+            uint8_t rgb[3] = {raw[0], raw[step], raw[2 * step]};
+            gray[i] = img_luma(rgb);
+            if (dec->has_trns) {
+                bool key = (step == 2)
+                    ? sample16(raw) == dec->trns[0] && sample16(raw + 2) == dec->trns[1] &&
+                      sample16(raw + 4) == dec->trns[2]
+                    : raw[0] == dec->trns[0] && raw[1] == dec->trns[1] && raw[2] == dec->trns[2];
+                if (key) gray[i] = 255;
+            }
+        }
+        break;
+    case 3:
+        for (int i = 0; i < count; i++) {
+            gray[i] = dec->palette[raw[i]];
+        }
+        break;
+    case 4:
+        for (int i = 0; i < count; i++, raw += 2 * step) {
+            gray[i] = over_white(raw[0], raw[step]);
+        }
+        break;
+    case 6:
+        for (int i = 0; i < count; i++, raw += 4 * step) {
+            uint8_t rgb[3] = {raw[0], raw[step], raw[2 * step]};
+            gray[i] = over_white(img_luma(rgb), raw[3 * step]);
+        }
+        break;
+    }
+}
+
+// Inflate, unfilter and convert one scanline of pixels pixels
+static esp_err_t read_row(png_dec_t *dec, int pixels, uint8_t *gray)
+{
+    size_t len = row_bytes(dec, pixels);
+    if (inflate_read(dec, dec->cur, len + 1) != (int)(len + 1)) {
+        return ESP_FAIL;
+    }
+
+    int bpp = (dec->channels * dec->depth + 7) / 8;
+    if (!unfilter(dec->cur, dec->prev, len, bpp)) {
+        return ESP_FAIL;
+    }
+    row_to_gray(dec, dec->cur + 1, gray, pixels);
+
+    uint8_t *t = dec->cur;
+    dec->cur = dec->prev;
+    dec->prev = t;
+    return ESP_OK;
+}
+
+// Decode passes [0, passes) of an Adam7 image into the band.
+// scale > 0: band is the 1/2^scale image; scale 0: band holds the even rows.
+static esp_err_t read_passes(png_dec_t *dec, int passes, int scale, int band_w)
+{
+    for (int p = 0; p < passes; p++) {
+        int x0 = adam7[p][0], y0 = adam7[p][1], dx = adam7[p][2], dy = adam7[p][3];
+        int pw = (dec->width > x0) ? (dec->width - x0 + dx - 1) / dx : 0;
+        int ph = (dec->height > y0) ? (dec->height - y0 + dy - 1) / dy : 0;
+        if (pw == 0 || ph == 0) {
+            continue;   // Empty passes have no scanlines at all
+        }
+
+        memset(dec->prev, 0, row_bytes(dec, pw) + 1);
+        for (int r = 0; r < ph; r++) {
+            esp_err_t ret = read_row(dec, pw, dec->gray);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            int y = y0 + r * dy;
+            uint8_t *dst = dec->band + (size_t)(y >> (scale ? scale : 1)) * band_w;
+            for (int i = 0, x = x0; i < pw; i++, x += dx) {
+                dst[x >> scale] = dec->gray[i];
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t decode_interlaced(png_dec_t *dec, int scale, img_row_cb_t cb, void *cb_ctx)
+{
+    int w = dec->width, h = dec->height;
+    int band_w = (w + (1 << scale) - 1) >> scale;
+    int band_h = scale ? (h + (1 << scale) - 1) >> scale : (h + 1) / 2;
+
+    dec->band = img_arena_alloc((size_t)band_w * band_h);
+    if (!dec->band) {
+        ESP_LOGE(TAG, "Cannot allocate %dx%d band", band_w, band_h);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Passes 1-3 cover every 4th pixel, 1-5 every 2nd, 1-6 all even rows
+    static const uint8_t passes_for_scale[4] = {6, 5, 3, 1};
+    esp_err_t ret = read_passes(dec, passes_for_scale[scale], scale, band_w);
+
+    if (scale > 0) {
+        for (int y = 0; y < band_h && ret == ESP_OK; y++) {
+            ret = cb(cb_ctx, dec->band + (size_t)y * band_w, y);
+        }
+        return ret;
+    }
+
+    // Pass 7 is every odd row in full: interleave it with the buffered even rows
+    memset(dec->prev, 0, row_bytes(dec, w) + 1);
+    for (int y = 1; y < h && ret == ESP_OK; y += 2) {
+        ret = cb(cb_ctx, dec->band + (size_t)(y >> 1) * w, y - 1);
+        if (ret == ESP_OK) {
+            ret = read_row(dec, w, dec->gray);
+        }
+        if (ret == ESP_OK) {
+            ret = cb(cb_ctx, dec->gray, y);
+        }
+    }
+    if (ret == ESP_OK && (h & 1)) {
+        ret = cb(cb_ctx, dec->band + (size_t)(h >> 1) * w, h - 1);
+    }
+    return ret;
+}
+
+// ---- Public API ----
+
+static esp_err_t read_ihdr(png_dec_t *dec, uint32_t len)
+{
+    uint32_t w, h;
+    if (len != 13 || !read_u32(dec, &w) || !read_u32(dec, &h)) {
+        return ESP_FAIL;
+    }
+    dec->depth = read_byte(dec);
+    dec->color = read_byte(dec);
+    int compression = read_byte(dec);
+    int filter = read_byte(dec);
+    int interlace = read_byte(dec);
+    skip_bytes(dec, 4);
+
+    bool depth_ok;
+    switch (dec->color) {
+    case 0:
+        dec->channels = 1;
+        depth_ok = dec->depth == 1 || dec->depth == 2 || dec->depth == 4 ||
+                   dec->depth == 8 || dec->depth == 16;
+        break;
+    case 3:
+        dec->channels = 1;
+        depth_ok = dec->depth == 1 || dec->depth == 2 || dec->depth == 4 || dec->depth == 8;
+        break;
+    case 2:
+    case 4:
+    case 6:
+        dec->channels = (dec->color == 2) ? 3 : (dec->color == 4) ? 2 : 4;
+        depth_ok = dec->depth == 8 || dec->depth == 16;
+        break;
+    default:
+        depth_ok = false;
+        break;
+    }
+
+    if (!depth_ok || compression != 0 || filter != 0 || interlace > 1 ||
+        w == 0 || h == 0 || w > 0x7FFFFF || h > 0x7FFFFF) {
+        ESP_LOGW(TAG, "Unsupported PNG: color %d, depth %d", dec->color, dec->depth);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    dec->width = w;
+    dec->height = h;
+    dec->interlaced = interlace;
+    return ESP_OK;
+}
+
+static void read_plte(png_dec_t *dec, uint32_t len)
+{
+    int n = len / 3;
+    for (int i = 0; i < n; i++) {
+        uint8_t rgb[3];
+        rgb[0] = read_byte(dec);
+        rgb[1] = read_byte(dec);
+        rgb[2] = read_byte(dec);
+        if (i < 256) {
+            dec->palette[i] = img_luma(rgb);
+        }
+    }
+    skip_bytes(dec, len - n * 3 + 4);
+}
+
+static void read_trns(png_dec_t *dec, uint32_t len)
+{
+    uint32_t used = 0;
+    if (dec->color == 3) {
+        for (; used < len; used++) {
+            int a = read_byte(dec);
+            if (used < 256) {
+                dec->palette[used] = over_white(dec->palette[used], a);
+            }
+        }
+    } else if ((dec->color == 0 && len >= 2) || (dec->color == 2 && len >= 6)) {
+        for (int c = 0; c < dec->channels; c++, used += 2) {
+            int hi = read_byte(dec);
+            int lo = read_byte(dec);
+            dec->trns[c] = (hi << 8) | lo;
+        }
+        dec->has_trns = true;
+    }
+    skip_bytes(dec, len - used + 4);
+}
+
+// Orientation from an eXIf chunk (EXIF block without the JPEG APP1 prefix)
+static void read_exif(png_dec_t *dec, uint32_t len)
+{
+    uint32_t n = (len < EXIF_READ_MAX) ? len : EXIF_READ_MAX;
+    uint8_t *tiff = img_arena_alloc(n);
+    if (tiff) {
+        for (uint32_t i = 0; i < n; i++) {
+            tiff[i] = (uint8_t)read_byte(dec);
+        }
+        dec->orient = img_exif_orientation(tiff, n);
+        img_arena_free(tiff);
+    } else {
+        n = 0;
+    }
+    skip_bytes(dec, len - n + 4);
+}
+
+esp_err_t png_dec_init(png_dec_t *dec, FILE *fp, const uint8_t *data, size_t size)
+{
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    memset(dec, 0, sizeof(*dec));
+    dec->fp = fp;
+    dec->data = data;
+    dec->size = size;
+    dec->orient = IMG_EXIF_ORIENT_NORMAL;
+    if (fp) {
+        dec->buf = img_arena_alloc(READ_BUF_SIZE);
+        if (!dec->buf) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    esp_err_t ret = ESP_OK;
+    for (int i = 0; i < 8; i++) {
+        if (read_byte(dec) != signature[i]) {
+            ret = ESP_ERR_NOT_SUPPORTED;
+        }
+    }
+
+    // Chunks up to the first IDAT; IHDR must come first
+    bool have_header = false;
+    while (ret == ESP_OK) {
+        uint32_t len, type;
+        if (!read_u32(dec, &len) || !read_u32(dec, &type) || len > 0x7FFFFFFF) {
+            ret = ESP_FAIL;
+        } else if (!have_header) {
+            ret = (type == CHUNK_IHDR) ? read_ihdr(dec, len) : ESP_FAIL;
+            have_header = true;
+        } else if (type == CHUNK_PLTE) {
+            read_plte(dec, len);
+        } else if (type == CHUNK_TRNS) {
+            read_trns(dec, len);
+        } else if (type == CHUNK_EXIF) {
+            read_exif(dec, len);
+        } else if (type == CHUNK_IDAT) {
+            dec->idat_left = len;
+            break;
+        } else if (type == CHUNK_IEND) {
+            ret = ESP_FAIL;
+        } else {
+            skip_bytes(dec, (size_t)len + 4);
+        }
+    }
+
+    if (ret != ESP_OK) {
+        png_dec_deinit(dec);
+    }
+    return ret;
+}
+
+int png_dec_scale(const png_dec_t *dec, int scale)
+{
+    return dec->interlaced ? scale : 0;
+}
+
+size_t png_dec_mem(const png_dec_t *dec, int scale)
+{
+    scale = png_dec_scale(dec, scale);
+    int w = dec->width, h = dec->height;
+    size_t raw = row_bytes(dec, w) + 1;
+    size_t mem = sizeof(png_inflate_t) + raw * 2 + w;
+    if (dec->interlaced) {
+        size_t band_w = (w + (1 << scale) - 1) >> scale;
+        size_t band_h = scale ? (h + (1 << scale) - 1) >> scale : (h + 1) / 2;
+        mem += band_w * band_h;
+    }
+    return mem;
+}
+
+esp_err_t png_dec_decode(png_dec_t *dec, int scale, img_row_cb_t cb, void *cb_ctx)
+{
+    if (scale < 0 || scale > 3) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    scale = png_dec_scale(dec, scale);
+
+    size_t raw = row_bytes(dec, dec->width) + 1;
+    dec->inf = img_arena_alloc(sizeof(png_inflate_t));
+    dec->cur = img_arena_alloc(raw);
+    dec->prev = img_arena_calloc(1, raw);
+    dec->gray = img_arena_alloc(dec->width);
+    if (!dec->inf || !dec->cur || !dec->prev || !dec->gray) {
+        return ESP_ERR_NO_MEM;
+    }
+    dec->inf->state = INF_HEADER;
+    dec->inf->wpos = 0;
+    dec->inf->copy_len = 0;
+    dec->inf->last = false;
+
+    // zlib header: deflate, no preset dictionary
+    int cmf = get_bits(dec, 8);
+    int flg = get_bits(dec, 8);
+    if ((cmf & 15) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20)) {
+        ESP_LOGE(TAG, "Bad zlib header");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "PNG %dx%d, color %d, depth %d%s", dec->width, dec->height,
+             dec->color, dec->depth, dec->interlaced ? ", interlaced" : "");
+
+    esp_err_t ret = ESP_OK;
+    if (dec->interlaced) {
+        ret = decode_interlaced(dec, scale, cb, cb_ctx);
+    } else {
+        for (int y = 0; y < dec->height && ret == ESP_OK; y++) {
+            ret = read_row(dec, dec->width, dec->gray);
+            if (ret == ESP_OK) {
+                ret = cb(cb_ctx, dec->gray, y);
+            }
+        }
+    }
+
+    if (dec->error) {
+        ESP_LOGE(TAG, "Corrupt or truncated image data");
+    }
+    return ret;
+}
+
+void png_dec_deinit(png_dec_t *dec)
+{
+    if (!dec) return;
+    img_arena_free(dec->buf);
+    img_arena_free(dec->inf);
+    img_arena_free(dec->cur);
+    img_arena_free(dec->prev);
+    img_arena_free(dec->gray);
+    img_arena_free(dec->band);
+    dec->buf = NULL;
+    dec->inf = NULL;
+    dec->cur = NULL;
+    dec->prev = NULL;
+    dec->gray = NULL;
+    dec->band = NULL;
+}
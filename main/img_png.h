@@ -0,0 +1,122 @@
+/*
+ * Image PNG - Streaming PNG decoder (row callbacks, grayscale output)
+ *
+ * IDAT data is inflated straight out of the file through a 32 KB window,
+ * one scanline at a time, so memory is two raw rows plus the window.
+ * Adam7 images are collected into a band buffer holding only the passes
+ * the requested scale needs (passes 1-5 are a half-size image, passes 1-3
+ * a quarter-size one). Alpha and tRNS are composited onto white. The EXIF
+ * orientation of an eXIf chunk is reported, not applied.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "esp_err.h"
+#include "image_processor.h"
+
+// Inflate Huffman table: fast lookup for short codes, canonical counts for the rest
+typedef struct {
+    uint16_t fast[512];         // (length << 9) | symbol for 9-bit prefixes, 0 = slow path
+    uint16_t count[16];         // Codes per length
+    uint16_t symbol[288];       // Symbols in code order
+} png_huff_t;
+
+// Inflate state (heap allocated, see png_dec_t)
+typedef struct {
+    uint8_t window[32768];
+    uint32_t wpos;              // Bytes produced so far
+    int state;
+    bool last;                  // Final block started
+    uint32_t stored_left;       // Bytes left in a stored block
+    int copy_len;               // Pending match
+    int copy_dist;
+    png_huff_t lit;
+    png_huff_t dist;
+} png_inflate_t;
+
+// Decoder state
+typedef struct {
+    // Input
+    FILE *fp;
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+    uint8_t *buf;               // File read buffer
+    size_t buf_len;
+    size_t buf_pos;
+    uint32_t idat_left;         // Bytes left in the current IDAT chunk
+    bool idat_end;              // No more IDAT data
+    bool error;
+
+    // Entropy bit reader (LSB first)
+    uint32_t bits;
+    int nbits;
+    int phantom;                // Zero bits appended past the end of the data
+    png_inflate_t *inf;
+
+    // Header
+    int width;
+    int height;
+    int depth;                  // Bits per sample
+    int color;                  // PNG color type
+    bool interlaced;
+    int channels;
+    uint8_t palette[256];       // Palette as gray, composited onto white
+    bool has_trns;
+    uint16_t trns[3];           // Transparent gray or RGB sample
+    int orient;                 // EXIF orientation (eXIf chunk), 1 if none
+
+    // Rows
+    uint8_t *cur;               // Filter byte + raw row
+    uint8_t *prev;
+    uint8_t *gray;
+    uint8_t *band;              // Adam7 band buffer
+} png_dec_t;
+
+/**
+ * @brief Read the PNG signature and the chunks before the first IDAT
+ * @param dec Decoder state
+ * @param fp Source file positioned at the start of the PNG, or NULL
+ * @param data Source data when fp is NULL
+ * @param size Source data size
+ * @return ESP_OK, ESP_ERR_NOT_SUPPORTED (not a PNG or unknown format),
+ *         ESP_ERR_NO_MEM or ESP_FAIL
+ */
+esp_err_t png_dec_init(png_dec_t *dec, FILE *fp, const uint8_t *data, size_t size);
+
+/**
+ * @brief Output scale actually used for a requested one
+ *
+ * Only Adam7 images can skip data, so others always decode at full size.
+ * Rows are (width + 2^s - 1) >> s pixels wide, (height + 2^s - 1) >> s
+ * rows in total, s being the returned scale.
+ *
+ * @param dec Decoder state (after png_dec_init)
+ * @param scale Requested scale 0-3 (1/1, 1/2, 1/4, 1/8)
+ */
+int png_dec_scale(const png_dec_t *dec, int scale);
+
+/**
+ * @brief Bytes png_dec_decode allocates at a scale
+ * @param dec Decoder state (after png_dec_init)
+ * @param scale Requested scale 0-3, see png_dec_scale
+ */
+size_t png_dec_mem(const png_dec_t *dec, int scale);
+
+/**
+ * @brief Inflate the image data and emit gray rows
+ * @param dec Decoder state (after png_dec_init)
+ * @param scale Requested scale 0-3, see png_dec_scale
+ * @param cb Called once per output row, in order
+ * @param cb_ctx Passed to cb
+ * @return ESP_OK, the callback's error, ESP_ERR_NO_MEM or ESP_FAIL
+ */
+esp_err_t png_dec_decode(png_dec_t *dec, int scale, img_row_cb_t cb, void *cb_ctx);
+
+/**
+ * @brief Free the decoder buffers
+ */
+void png_dec_deinit(png_dec_t *dec);
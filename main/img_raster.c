@@ -0,0 +1,316 @@
+/*
+ * Image Raster Implementation
+ *
+ * A span is split into a masked first byte, whole middle bytes and a
+ * masked last byte. Middle bytes of a fill are a memset; those of a blit
+ * are a memcpy when source and destination share the same bit phase, and
+ * otherwise two neighbouring source bytes shifted into one. Only the end
+ * bytes check the source row bounds, since the masks drop whatever they
+ * read past the rectangle.
+ *
+ * Rotation reads an 8x8 block as eight row bytes packed into a 64-bit
+ * word, transposes it with three mask-and-shift steps, and writes the
+ * eight column bytes out; the turn direction only decides the order of
+ * rows going in and columns going out.
+ */
+
+#include "img_raster.h"
+#include "img_kernels.h"
+
+#include <string.h>
+
+void img_bitmap_init(img_bitmap_t *bm, uint8_t *data, int width, int height)
+{
+    bm->data = data;
+    bm->width = width;
+    bm->height = height;
+    bm->stride = (width + 7) / 8;
+    img_bitmap_set_clip(bm, NULL);
+}
+
+void img_bitmap_set_clip(img_bitmap_t *bm, const img_rect_t *clip)
+{
+    bm->clip = (img_rect_t){0, 0, bm->width, bm->height};
+    if (clip && !img_rect_intersect(&bm->clip, clip)) {
+        bm->clip.w = bm->clip.h = 0;
+    }
+}
+
+bool img_rect_intersect(img_rect_t *r, const img_rect_t *clip)
+{
+    int x0 = r->x > clip->x ? r->x : clip->x;
+    int y0 = r->y > clip->y ? r->y : clip->y;
+    int x1 = (r->x + r->w < clip->x + clip->w) ? r->x + r->w : clip->x + clip->w;
+    int y1 = (r->y + r->h < clip->y + clip->h) ? r->y + r->h : clip->y + clip->h;
+    if (x1 <= x0 || y1 <= y0) {
+        r->w = r->h = 0;
+        return false;
+    }
+    *r = (img_rect_t){x0, y0, x1 - x0, y1 - y0};
+    return true;
+}
+
+// Masks of the first and last byte of [x0, x1)
+static inline void span_masks(int x0, int x1, uint8_t *first, uint8_t *last)
+{
+    *first = 0xFF >> (x0 & 7);
+    *last = (uint8_t)(0xFF << (7 - ((x1 - 1) & 7)));
+}
+
+static inline uint8_t rop_apply(uint8_t d, uint8_t s, img_rop_t rop)
+{
+    switch (rop) {
+        case IMG_ROP_AND:   return d & s;
+        case IMG_ROP_OR:    return d | s;
+        case IMG_ROP_XOR:   return d ^ s;
+        case IMG_ROP_CLEAR: return d & ~s;
+        default:            return s;
+    }
+}
+
+static inline void put(uint8_t *d, uint8_t s, uint8_t mask, img_rop_t rop)
+{
+    *d = (*d & ~mask) | (rop_apply(*d, s, rop) & mask);
+}
+
+/* ---- Fills ---- */
+
+void img_raster_fill(img_bitmap_t *bm, int x, int y, int w, int h, uint8_t color)
+{
+    img_rect_t r = {x, y, w, h};
+    if (!img_rect_intersect(&r, &bm->clip)) return;
+
+    int b0 = r.x >> 3, b1 = (r.x + r.w - 1) >> 3;
+    uint8_t first, last;
+    span_masks(r.x, r.x + r.w, &first, &last);
+    uint8_t v = color ? 0xFF : 0x00;
+    if (b0 == b1) {
+        first &= last;
+    }
+
+    uint8_t *row = bm->data + (size_t)r.y * bm->stride;
+    for (int j = 0; j < r.h; j++, row += bm->stride) {
+        row[b0] = (row[b0] & ~first) | (v & first);
+        if (b1 > b0) {
+            memset(row + b0 + 1, v, b1 - b0 - 1);
+            row[b1] = (row[b1] & ~last) | (v & last);
+        }
+    }
+}
+
+void img_raster_invert(img_bitmap_t *bm, int x, int y, int w, int h)
+{
+    img_rect_t r = {x, y, w, h};
+    if (!img_rect_intersect(&r, &bm->clip)) return;
+
+    int b0 = r.x >> 3, b1 = (r.x + r.w - 1) >> 3;
+    uint8_t first, last;
+    span_masks(r.x, r.x + r.w, &first, &last);
+    if (b0 == b1) {
+        first &= last;
+    }
+
+    uint8_t *row = bm->data + (size_t)r.y * bm->stride;
+    for (int j = 0; j < r.h; j++, row += bm->stride) {
+        row[b0] ^= first;
+        if (b1 > b0) {
+            img_k_invert(row + b0 + 1, b1 - b0 - 1);
+            row[b1] ^= last;
+        }
+    }
+}
+
+/* ---- Blits ---- */
+
+// Eight source pixels starting at bit, pixels outside the row read as 0
+static inline uint8_t fetch_checked(const uint8_t *row, int stride, int bit)
+{
+    int i = bit >> 3, sh = bit & 7;
+    uint8_t hi = (i >= 0 && i < stride) ? row[i] : 0;
+    if (!sh) return hi;
+    uint8_t lo = (i + 1 >= 0 && i + 1 < stride) ? row[i + 1] : 0;
+    return (uint8_t)((hi << sh) | (lo >> (8 - sh)));
+}
+
+// Clip the destination rectangle and move the source origin along with it
+static bool blit_clip(const img_bitmap_t *dst, int *dx, int *dy, const img_bitmap_t *src,
+                      int *sx, int *sy, int *w, int *h)
+{
+    img_rect_t s = {*sx, *sy, *w, *h};
+    if (!img_rect_intersect(&s, &(img_rect_t){0, 0, src->width, src->height})) {
+        return false;
+    }
+    img_rect_t r = {*dx + s.x - *sx, *dy + s.y - *sy, s.w, s.h};
+    if (!img_rect_intersect(&r, &dst->clip)) {
+        return false;
+    }
+    *sx = s.x + r.x - (*dx + s.x - *sx);
+    *sy = s.y + r.y - (*dy + s.y - *sy);
+    *dx = r.x;
+    *dy = r.y;
+    *w = r.w;
+    *h = r.h;
+    return true;
+}
+
+static void blit_row(uint8_t *d, const uint8_t *s, int stride, int dx, int sx, int w,
+                     img_rop_t rop)
+{
+    int b0 = dx >> 3, b1 = (dx + w - 1) >> 3;
+    int bit = sx - (dx & 7);            // Source pixel under bit 7 of byte b0
+    uint8_t first, last;
+    span_masks(dx, dx + w, &first, &last);
+
+    if (b0 == b1) {
+        put(d + b0, fetch_checked(s, stride, bit), first & last, rop);
+        return;
+    }
+    put(d + b0, fetch_checked(s, stride, bit), first, rop);
+
+    int n = b1 - b0 - 1;
+    uint8_t *dm = d + b0 + 1;
+    int sh = (bit + 8) & 7;
+    const uint8_t *sm = s + ((bit + 8) >> 3);
+    if (sh == 0) {
+        if (rop == IMG_ROP_COPY) {
+            memcpy(dm, sm, n);
+        } else {
+            for (int i = 0; i < n; i++) dm[i] = rop_apply(dm[i], sm[i], rop);
+        }
+    } else {
+        for (int i = 0; i < n; i++) {
+            uint8_t v = (uint8_t)((sm[i] << sh) | (sm[i + 1] >> (8 - sh)));
+            dm[i] = rop_apply(dm[i], v, rop);
+        }
+    }
+
+    put(d + b1, fetch_checked(s, stride, bit + 8 * (b1 - b0)), last, rop);
+}
+
+void img_raster_blit(img_bitmap_t *dst, int dx, int dy, const img_bitmap_t *src,
+                     int sx, int sy, int w, int h, img_rop_t rop)
+{
+    if (!blit_clip(dst, &dx, &dy, src, &sx, &sy, &w, &h)) return;
+
+    uint8_t *d = dst->data + (size_t)dy * dst->stride;
+    const uint8_t *s = src->data + (size_t)sy * src->stride;
+    for (int j = 0; j < h; j++, d += dst->stride, s += src->stride) {
+        blit_row(d, s, src->stride, dx, sx, w, rop);
+    }
+}
+
+void img_raster_blit_masked(img_bitmap_t *dst, int dx, int dy, const img_bitmap_t *src,
+                            const img_bitmap_t *mask, int sx, int sy, int w, int h)
+{
+    if (!blit_clip(dst, &dx, &dy, src, &sx, &sy, &w, &h)) return;
+
+    int b0 = dx >> 3, b1 = (dx + w - 1) >> 3;
+    int bit = sx - (dx & 7);
+    uint8_t first, last;
+    span_masks(dx, dx + w, &first, &last);
+
+    uint8_t *d = dst->data + (size_t)dy * dst->stride;
+    const uint8_t *s = src->data + (size_t)sy * src->stride;
+    const uint8_t *m = mask->data + (size_t)sy * mask->stride;
+    for (int j = 0; j < h; j++, d += dst->stride, s += src->stride, m += mask->stride) {
+        for (int b = b0; b <= b1; b++) {
+            int sb = bit + 8 * (b - b0);
+            uint8_t em = (b == b0 ? first : 0xFF) & (b == b1 ? last : 0xFF);
+            uint8_t mk = fetch_checked(m, mask->stride, sb) & em;
+            d[b] = (d[b] & ~mk) | (fetch_checked(s, src->stride, sb) & mk);
+        }
+    }
+}
+
+/* ---- Windows ---- */
+
+bool img_raster_window(img_rect_t *r, const img_rect_t *bounds)
+{
+    if (!img_rect_intersect(r, bounds)) return false;
+    int x1 = (r->x + r->w + 7) & ~7;
+    r->x &= ~7;
+    r->w = x1 - r->x;
+    return true;
+}
+
+void img_raster_pack_window(uint8_t *out, const img_bitmap_t *bm, const img_rect_t *win,
+                            int row, int rows, const img_bitmap_t *region, int x, int y)
+{
+    img_bitmap_t band;
+    img_bitmap_init(&band, out, win->w, rows);
+    img_raster_blit(&band, 0, 0, bm, win->x, win->y + row, win->w, rows, IMG_ROP_COPY);
+    img_raster_blit(&band, x - win->x, y - win->y - row, region, 0, 0,
+                    region->width, region->height, IMG_ROP_COPY);
+}
+
+/* ---- Rotation ---- */
+
+// Transpose an 8x8 bit block: byte 7 - i holds row i, bit 7 - j column j
+static inline uint64_t transpose8(uint64_t x)
+{
+    uint64_t t;
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAull;
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCull;
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ull;
+    x ^= t ^ (t << 28);
+    return x;
+}
+
+static inline uint8_t reverse8(uint8_t b)
+{
+    b = (uint8_t)((b >> 4) | (b << 4));
+    b = (uint8_t)(((b >> 2) & 0x33) | ((b & 0x33) << 2));
+    return (uint8_t)(((b >> 1) & 0x55) | ((b & 0x55) << 1));
+}
+
+esp_err_t img_raster_rotate(img_bitmap_t *dst, const img_bitmap_t *src, int turns)
+{
+    int w = src->width, h = src->height;
+    turns &= 3;
+    int dw = (turns & 1) ? h : w;
+    int dh = (turns & 1) ? w : h;
+    if ((w & 7) || (h & 7) || dst->width != dw || dst->height != dh) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int bw = w / 8;
+    if (turns == 0) {
+        for (int y = 0; y < h; y++) {
+            memcpy(dst->data + (size_t)y * dst->stride, src->data + (size_t)y * src->stride, bw);
+        }
+        return ESP_OK;
+    }
+    if (turns == 2) {
+        for (int y = 0; y < h; y++) {
+            const uint8_t *s = src->data + (size_t)y * src->stride;
+            uint8_t *d = dst->data + (size_t)(h - 1 - y) * dst->stride;
+            for (int b = 0; b < bw; b++) {
+                d[bw - 1 - b] = reverse8(s[b]);
+            }
+        }
+        return ESP_OK;
+    }
+
+    // Clockwise: source column x becomes row x, read bottom row first.
+    // Counter-clockwise: column x becomes row w - 1 - x, top row first.
+    for (int by = 0; by < h; by += 8) {
+        const uint8_t *s = src->data + (size_t)by * src->stride;
+        int db = (turns == 1) ? (h - 8 - by) / 8 : by / 8;
+        for (int bx = 0; bx < bw; bx++) {
+            uint64_t x = 0;
+            for (int i = 0; i < 8; i++) {
+                int row = (turns == 1) ? 7 - i : i;
+                x = (x << 8) | s[(size_t)row * src->stride + bx];
+            }
+            x = transpose8(x);
+            for (int i = 0; i < 8; i++) {
+                int col = bx * 8 + i;
+                int dy = (turns == 1) ? col : w - 1 - col;
+                dst->data[(size_t)dy * dst->stride + db] = (uint8_t)(x >> (56 - 8 * i));
+            }
+        }
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,139 @@
+/*
+ * Image Raster - 1bpp bitmap blits, fills and rotation
+ *
+ * Bitmaps use the framebuffer layout: rows of packed pixels, MSB first,
+ * 1 = white. Every operation works on whole bytes with masks for the
+ * partial bytes at the ends of a span, and is clipped once, against the
+ * bitmap and its clip rectangle, before any pixel is touched.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef struct {
+    int x, y, w, h;
+} img_rect_t;
+
+// Bitmap view over caller-owned memory
+typedef struct {
+    uint8_t *data;
+    int width;
+    int height;
+    int stride;             // Bytes per row
+    img_rect_t clip;        // Writes outside are dropped; the whole bitmap by default
+} img_bitmap_t;
+
+// How source pixels combine with the destination
+typedef enum {
+    IMG_ROP_COPY,           // dst = src
+    IMG_ROP_AND,            // dst &= src
+    IMG_ROP_OR,             // dst |= src (src ink draws white)
+    IMG_ROP_XOR,            // dst ^= src
+    IMG_ROP_CLEAR,          // dst &= ~src (src ink draws black)
+} img_rop_t;
+
+/**
+ * @brief Set up a bitmap view with rows of (width + 7) / 8 bytes
+ * @param bm Bitmap
+ * @param data Pixels
+ * @param width Width in pixels
+ * @param height Height in pixels
+ */
+void img_bitmap_init(img_bitmap_t *bm, uint8_t *data, int width, int height);
+
+/**
+ * @brief Restrict writes to a rectangle (clipped to the bitmap)
+ * @param bm Bitmap
+ * @param clip Clip rectangle, NULL for the whole bitmap
+ */
+void img_bitmap_set_clip(img_bitmap_t *bm, const img_rect_t *clip);
+
+/**
+ * @brief Intersect a rectangle with another
+ * @param r Rectangle, replaced by the intersection
+ * @param clip Rectangle to intersect with
+ * @return false if the intersection is empty
+ */
+bool img_rect_intersect(img_rect_t *r, const img_rect_t *clip);
+
+/**
+ * @brief Fill a rectangle with black or white
+ * @param bm Bitmap
+ * @param x X position
+ * @param y Y position
+ * @param w Width
+ * @param h Height
+ * @param color 0 = black, otherwise white
+ */
+void img_raster_fill(img_bitmap_t *bm, int x, int y, int w, int h, uint8_t color);
+
+/**
+ * @brief Invert a rectangle
+ */
+void img_raster_invert(img_bitmap_t *bm, int x, int y, int w, int h);
+
+/**
+ * @brief Combine a rectangle of one bitmap into another
+ * @param dst Destination bitmap
+ * @param dx Destination X
+ * @param dy Destination Y
+ * @param src Source bitmap (must not overlap dst); its clip is ignored
+ * @param sx Source X
+ * @param sy Source Y
+ * @param w Width
+ * @param h Height
+ * @param rop Raster operation
+ */
+void img_raster_blit(img_bitmap_t *dst, int dx, int dy, const img_bitmap_t *src,
+                     int sx, int sy, int w, int h, img_rop_t rop);
+
+/**
+ * @brief Copy source pixels where the mask is set, keep dst elsewhere
+ *
+ * dst = (dst & ~mask) | (src & mask); mask pixels are read at the same
+ * offsets as the source.
+ * @param mask Mask bitmap, same size as src
+ */
+void img_raster_blit_masked(img_bitmap_t *dst, int dx, int dy, const img_bitmap_t *src,
+                            const img_bitmap_t *mask, int sx, int sy, int w, int h);
+
+/**
+ * @brief Clip a rectangle to bounds and widen it to whole bytes
+ *
+ * For panel windows, which must start and end on a byte: the result is
+ * the smallest rectangle of whole bytes covering r clipped to bounds.
+ * @param r Rectangle, replaced by the window
+ * @param bounds Rectangle to clip to
+ * @return false if nothing of r is inside bounds
+ */
+bool img_raster_window(img_rect_t *r, const img_rect_t *bounds);
+
+/**
+ * @brief Pack rows of a byte-aligned window of a bitmap with a region over it
+ *
+ * out gets rows of win->w / 8 bytes: the bitmap's pixels, except where the
+ * region, placed at (x, y) in bitmap coordinates, covers them. Window
+ * pixels outside the bitmap are left as they are in out.
+ * @param out Packed rows
+ * @param bm Bitmap under the region
+ * @param win Window, from img_raster_window
+ * @param row First window row to pack
+ * @param rows Rows to pack
+ * @param region Region pixels, any width
+ * @param x Region X, any pixel
+ * @param y Region Y
+ */
+void img_raster_pack_window(uint8_t *out, const img_bitmap_t *bm, const img_rect_t *win,
+                            int row, int rows, const img_bitmap_t *region, int x, int y);
+
+/**
+ * @brief Rotate a whole bitmap by quarter turns, 8x8 pixels at a time
+ * @param dst Destination, width and height swapped for odd turns
+ * @param src Source, width and height multiples of 8
+ * @param turns Quarter turns clockwise (0-3)
+ * @return ESP_ERR_INVALID_ARG if the sizes do not fit
+ */
+esp_err_t img_raster_rotate(img_bitmap_t *dst, const img_bitmap_t *src, int turns);
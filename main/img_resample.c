@@ -0,0 +1,546 @@
+/*
+ * Image Resample Implementation
+ *
+ * Source rows are pushed top to bottom. Each one is filtered horizontally
+ * into a small ring of Q4 rows, and an output row is produced by the
+ * vertical filter as soon as the last source row it needs has arrived.
+ * Only ring_rows filtered rows are ever buffered, so the same code serves
+ * full-buffer scaling and the streaming decode pipeline.
+ */
+
+#include "img_resample.h"
+#include "img_arena.h"
+#include "img_tone.h"
+#include "img_exif.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "esp_log.h"
+
+static const char *TAG = "img_resample";
+
+#define WEIGHT_ONE      (1 << 14)   // Q14 unity weight
+#define PHASES          64          // Sub-pixel phases of the upscale kernels
+#define START_BEFORE    (-1)        // Background before the image (top/left margin)
+#define START_AFTER     (-2)        // Background after the image (bottom/right margin)
+
+static float kernel_eval(img_resample_filter_t filter, float x)
+{
+    x = fabsf(x);
+    if (filter == IMG_FILTER_LANCZOS2) {
+        if (x < 1e-6f) return 1.0f;
+        if (x >= 2.0f) return 0.0f;
+        float px = (float)M_PI * x;
+        return 2.0f * sinf(px) * sinf(px / 2.0f) / (px * px);
+    }
+    // Catmull-Rom (a = -0.5)
+    if (x < 1.0f) return 1.5f * x * x * x - 2.5f * x * x + 1.0f;
+    if (x < 2.0f) return -0.5f * x * x * x + 2.5f * x * x - 4.0f * x + 2.0f;
+    return 0.0f;
+}
+
+// Normalized 4-tap Q14 weights for each sub-pixel phase
+static void build_bank(int16_t bank[PHASES][4], img_resample_filter_t filter)
+{
+    for (int p = 0; p < PHASES; p++) {
+        float t = (float)p / PHASES;
+        float k[4];
+        float sum = 0;
+        for (int i = 0; i < 4; i++) {
+            k[i] = kernel_eval(filter, (float)(i - 1) - t);
+            sum += k[i];
+        }
+        int total = 0;
+        for (int i = 0; i < 4; i++) {
+            bank[p][i] = (int16_t)lroundf(k[i] / sum * WEIGHT_ONE);
+            total += bank[p][i];
+        }
+        bank[p][t < 0.5f ? 1 : 2] += WEIGHT_ONE - total;
+    }
+}
+
+static void free_axis(img_resample_axis_t *ax)
+{
+    img_arena_free(ax->start);
+    img_arena_free(ax->count);
+    img_arena_free(ax->weights);
+    memset(ax, 0, sizeof(*ax));
+}
+
+// Precompute source span and weights for every output sample of one axis.
+// off/step are 16.16 source positions: output sample o covers
+// [off + o * step, off + (o + 1) * step).
+static esp_err_t build_axis(img_resample_axis_t *ax, int in, int out,
+                            int64_t off, int64_t step, img_resample_filter_t filter)
+{
+    bool box = step >= (1 << 16);
+    ax->taps = box ? (int)(step >> 16) + 2 : 4;
+    ax->start = img_arena_alloc(out * sizeof(int32_t));
+    ax->count = img_arena_alloc(out);
+    ax->weights = img_arena_calloc((size_t)out * ax->taps, sizeof(int16_t));
+    int32_t *idx = img_arena_alloc(ax->taps * sizeof(int32_t));
+    int64_t *wt = img_arena_alloc(ax->taps * sizeof(int64_t));
+    if (!ax->start || !ax->count || !ax->weights || !idx || !wt) {
+        img_arena_free(wt);
+        img_arena_free(idx);
+        free_axis(ax);
+        return ESP_ERR_NO_MEM;
+    }
+
+    int16_t bank[PHASES][4];
+    if (!box) {
+        build_bank(bank, filter);
+    }
+
+    const int64_t end = (int64_t)in << 16;
+    for (int o = 0; o < out; o++) {
+        int64_t a = off + step * o;
+        int64_t b = a + step;
+
+        if (b <= 0 || a >= end) {
+            ax->start[o] = (b <= 0) ? START_BEFORE : START_AFTER;
+            ax->count[o] = 0;
+            continue;
+        }
+
+        int n = 0;
+        int64_t sum = 0;
+        if (box) {
+            // Area average: weight = overlap of source pixel with [a, b)
+            int64_t i0 = (a < 0) ? 0 : (a >> 16);
+            int64_t i1 = (b >= end) ? in - 1 : ((b - 1) >> 16);
+            for (int64_t i = i0; i <= i1 && n < ax->taps; i++) {
+                int64_t lo = (i << 16) > a ? (i << 16) : a;
+                int64_t hi = ((i + 1) << 16) < b ? ((i + 1) << 16) : b;
+                if (hi <= lo) continue;
+                idx[n] = (int32_t)i;
+                wt[n] = hi - lo;
+                sum += wt[n];
+                n++;
+            }
+        } else {
+            // Polyphase kernel centered on the output sample (pixel centers at i + 0.5)
+            int64_t c = a + step / 2 - (1 << 15);
+            int64_t i0 = c >> 16;
+            int p = (int)(((c - i0 * 65536) * PHASES + (1 << 15)) >> 16);
+            if (p == PHASES) {
+                p = 0;
+                i0++;
+            }
+            for (int k = 0; k < 4; k++) {
+                int64_t i = i0 - 1 + k;
+                if (i < 0) i = 0;
+                if (i >= in) i = in - 1;
+                if (n > 0 && idx[n - 1] == i) {
+                    wt[n - 1] += bank[p][k];     // Edge replicate: merge clamped taps
+                } else {
+                    idx[n] = (int32_t)i;
+                    wt[n] = bank[p][k];
+                    n++;
+                }
+                sum += bank[p][k];
+            }
+        }
+
+        if (n == 0 || sum == 0) {
+            ax->start[o] = START_AFTER;
+            ax->count[o] = 0;
+            continue;
+        }
+
+        // Normalize to Q14 and put the rounding remainder on the largest tap
+        int16_t *w = ax->weights + (size_t)o * ax->taps;
+        int total = 0, big = 0;
+        for (int i = 0; i < n; i++) {
+            int v = (int)((wt[i] * WEIGHT_ONE + (sum >> 1)) / sum);
+            w[idx[i] - idx[0]] = (int16_t)v;
+            total += v;
+            if (v > w[idx[big] - idx[0]]) big = i;
+        }
+        w[idx[big] - idx[0]] += WEIGHT_ONE - total;
+
+        ax->start[o] = idx[0];
+        ax->count[o] = (uint8_t)(idx[n - 1] - idx[0] + 1);
+    }
+
+    // Scratch last in, first out: the arena takes both back
+    img_arena_free(wt);
+    img_arena_free(idx);
+    return ESP_OK;
+}
+
+// Source pixels per output pixel in 16.16 fixed point: the axis that limits
+// the scale (fit) or the one that overflows (fill) decides
+static int64_t scale_step(const img_resample_cfg_t *cfg)
+{
+    bool use_x = (int64_t)cfg->out_w * cfg->in_h < (int64_t)cfg->out_h * cfg->in_w;
+    if (!cfg->fit) use_x = !use_x;
+    int64_t step = use_x ? ((int64_t)cfg->in_w << 16) / cfg->out_w
+                         : ((int64_t)cfg->in_h << 16) / cfg->out_h;
+    return step < 1 ? 1 : step;
+}
+
+size_t img_resampler_mem(const img_resample_cfg_t *cfg)
+{
+    int64_t step = scale_step(cfg);
+    size_t taps = step >= (1 << 16) ? (size_t)(step >> 16) + 2 : 4;
+    size_t per_out = sizeof(int32_t) + 1 + taps * sizeof(int16_t);    // start, count, weights
+    size_t ch = cfg->channels;
+    return ((size_t)cfg->out_w + cfg->out_h) * per_out +
+           taps * (sizeof(int32_t) + sizeof(int64_t)) +                  // Axis scratch
+           taps * cfg->out_w * ch * sizeof(int16_t) + (size_t)cfg->out_w * ch;
+}
+
+esp_err_t img_resampler_init(img_resampler_t *rs, const img_resample_cfg_t *cfg,
+                             img_row_cb_t cb, void *cb_ctx)
+{
+    if (!rs || !cfg || !cb || cfg->in_w <= 0 || cfg->in_h <= 0 ||
+        cfg->out_w <= 0 || cfg->out_h <= 0 ||
+        (cfg->channels != 1 && cfg->channels != 3)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(rs, 0, sizeof(*rs));
+    rs->cfg = *cfg;
+    rs->cb = cb;
+    rs->cb_ctx = cb_ctx;
+
+    int in_w = cfg->in_w, in_h = cfg->in_h;
+    int out_w = cfg->out_w, out_h = cfg->out_h;
+
+    int64_t step = scale_step(cfg);
+
+    // Center the source window
+    int64_t x_off = (((int64_t)in_w << 16) - step * out_w) / 2;
+    int64_t y_off = (((int64_t)in_h << 16) - step * out_h) / 2;
+
+    esp_err_t ret = build_axis(&rs->x, in_w, out_w, x_off, step, cfg->upscale);
+    if (ret == ESP_OK) {
+        ret = build_axis(&rs->y, in_h, out_h, y_off, step, cfg->upscale);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot allocate weight tables");
+        img_resampler_deinit(rs);
+        return ret;
+    }
+
+    // Range of source rows that contribute to any output row
+    rs->first_row = in_h;
+    rs->last_row = -1;
+    for (int y = 0; y < out_h; y++) {
+        if (rs->y.count[y] == 0) continue;
+        int lo = rs->y.start[y];
+        int hi = lo + rs->y.count[y] - 1;
+        if (lo < rs->first_row) rs->first_row = lo;
+        if (hi > rs->last_row) rs->last_row = hi;
+    }
+
+    int ch = cfg->channels;
+    rs->ring_rows = rs->y.taps;
+    rs->ring = img_arena_alloc((size_t)rs->ring_rows * out_w * ch * sizeof(int16_t));
+    rs->line = img_arena_alloc((size_t)out_w * ch);
+    if (!rs->ring || !rs->line) {
+        ESP_LOGE(TAG, "Cannot allocate row buffers");
+        img_resampler_deinit(rs);
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+void img_resampler_deinit(img_resampler_t *rs)
+{
+    if (!rs) return;
+    free_axis(&rs->x);
+    free_axis(&rs->y);
+    img_arena_free(rs->ring);
+    img_arena_free(rs->line);
+    rs->ring = NULL;
+    rs->line = NULL;
+}
+
+// Horizontal pass: one source row -> out_w Q4 samples
+static void filter_row_h(const img_resampler_t *rs, const uint8_t *src, int16_t *dst)
+{
+    const img_resample_axis_t *ax = &rs->x;
+    const int out_w = rs->cfg.out_w;
+    const int taps = ax->taps;
+    const int16_t *w = ax->weights;
+
+    if (rs->cfg.channels == 1) {
+        for (int o = 0; o < out_w; o++, w += taps) {
+            int n = ax->count[o];
+            if (n == 0) {
+                dst[o] = 255 << 4;
+                continue;
+            }
+            const uint8_t *s = src + ax->start[o];
+            int32_t acc = 0;
+            for (int k = 0; k < n; k++) {
+                acc += w[k] * s[k];
+            }
+            dst[o] = (int16_t)((acc + (1 << 9)) >> 10);
+        }
+        return;
+    }
+
+    for (int o = 0; o < out_w; o++, w += taps) {
+        int n = ax->count[o];
+        int16_t *d = dst + o * 3;
+        if (n == 0) {
+            d[0] = d[1] = d[2] = 255 << 4;
+            continue;
+        }
+        const uint8_t *s = src + ax->start[o] * 3;
+        int32_t r = 0, g = 0, b = 0;
+        for (int k = 0; k < n; k++, s += 3) {
+            r += w[k] * s[0];
+            g += w[k] * s[1];
+            b += w[k] * s[2];
+        }
+        d[0] = (int16_t)((r + (1 << 9)) >> 10);
+        d[1] = (int16_t)((g + (1 << 9)) >> 10);
+        d[2] = (int16_t)((b + (1 << 9)) >> 10);
+    }
+}
+
+static inline uint8_t clamp_q18(int32_t acc)
+{
+    acc = (acc + (1 << 17)) >> 18;
+    return (acc < 0) ? 0 : (acc > 255) ? 255 : (uint8_t)acc;
+}
+
+// Vertical pass: combine buffered Q4 rows into output row y
+static esp_err_t emit_row(img_resampler_t *rs)
+{
+    const int y = rs->out_row++;
+    const int n_px = rs->cfg.out_w * rs->cfg.channels;
+    const int n = rs->y.count[y];
+
+    if (n == 0) {
+        memset(rs->line, 255, n_px);
+        return rs->cb(rs->cb_ctx, rs->line, y);
+    }
+
+    const int16_t *w = rs->y.weights + (size_t)y * rs->y.taps;
+    const int16_t *rows[n];
+    for (int k = 0; k < n; k++) {
+        int slot = (rs->y.start[y] + k) % rs->ring_rows;
+        rows[k] = rs->ring + (size_t)slot * n_px;
+    }
+
+    if (n == 1) {
+        // Exact source row: only rounding from Q4
+        for (int i = 0; i < n_px; i++) {
+            int v = (rows[0][i] + 8) >> 4;
+            rs->line[i] = (v < 0) ? 0 : (v > 255) ? 255 : (uint8_t)v;
+        }
+    } else {
+        for (int i = 0; i < n_px; i++) {
+            int32_t acc = 0;
+            for (int k = 0; k < n; k++) {
+                acc += w[k] * rows[k][i];
+            }
+            rs->line[i] = clamp_q18(acc);
+        }
+    }
+
+    if (rs->cfg.hist) {
+        // Count only the columns covered by the image, not the margins
+        int x0 = 0, x1 = rs->cfg.out_w;
+        while (x0 < x1 && rs->x.count[x0] == 0) x0++;
+        while (x1 > x0 && rs->x.count[x1 - 1] == 0) x1--;
+        img_tone_hist_add(rs->cfg.hist, rs->line + x0 * rs->cfg.channels, x1 - x0,
+                          rs->cfg.channels);
+    }
+
+    return rs->cb(rs->cb_ctx, rs->line, y);
+}
+
+// True once every source row needed by the next output row has arrived
+static bool next_row_ready(const img_resampler_t *rs, int last_pushed)
+{
+    int y = rs->out_row;
+    int32_t start = rs->y.start[y];
+    if (start == START_BEFORE) return true;
+    if (start == START_AFTER) return last_pushed >= rs->cfg.in_h - 1;
+    return start + rs->y.count[y] - 1 <= last_pushed;
+}
+
+esp_err_t img_resampler_push(img_resampler_t *rs, const uint8_t *row)
+{
+    if (!rs || !row) return ESP_ERR_INVALID_ARG;
+
+    int r = rs->in_row++;
+    if (r >= rs->first_row && r <= rs->last_row) {
+        int n_px = rs->cfg.out_w * rs->cfg.channels;
+        filter_row_h(rs, row, rs->ring + (size_t)(r % rs->ring_rows) * n_px);
+    }
+
+    esp_err_t ret = ESP_OK;
+    while (rs->out_row < rs->cfg.out_h && ret == ESP_OK && next_row_ready(rs, r)) {
+        ret = emit_row(rs);
+    }
+    return ret;
+}
+
+esp_err_t img_resampler_finish(img_resampler_t *rs)
+{
+    if (!rs) return ESP_ERR_INVALID_ARG;
+
+    // Rows whose source never arrived (truncated stream) become background
+    esp_err_t ret = ESP_OK;
+    while (rs->out_row < rs->cfg.out_h && ret == ESP_OK) {
+        if (!next_row_ready(rs, rs->in_row - 1)) {
+            rs->y.count[rs->out_row] = 0;
+        }
+        ret = emit_row(rs);
+    }
+    return ret;
+}
+
+typedef struct {
+    uint8_t *output;
+    size_t stride;
+} buffer_sink_t;
+
+static esp_err_t buffer_row_cb(void *ctx, const uint8_t *row, int y)
+{
+    buffer_sink_t *sink = (buffer_sink_t *)ctx;
+    memcpy(sink->output + (size_t)y * sink->stride, row, sink->stride);
+    return ESP_OK;
+}
+
+esp_err_t img_resample_buffer(const img_resample_cfg_t *cfg,
+                              const uint8_t *input, uint8_t *output)
+{
+    if (!cfg || !input || !output) return ESP_ERR_INVALID_ARG;
+
+    buffer_sink_t sink = {
+        .output = output,
+        .stride = (size_t)cfg->out_w * cfg->channels,
+    };
+
+    img_resampler_t rs;
+    esp_err_t ret = img_resampler_init(&rs, cfg, buffer_row_cb, &sink);
+    if (ret != ESP_OK) return ret;
+
+    size_t in_stride = (size_t)cfg->in_w * cfg->channels;
+    for (int y = 0; y < cfg->in_h && ret == ESP_OK; y++) {
+        ret = img_resampler_push(&rs, input + y * in_stride);
+    }
+    if (ret == ESP_OK) {
+        ret = img_resampler_finish(&rs);
+    }
+
+    img_resampler_deinit(&rs);
+    return ret;
+}
+
+/* ---------------------------------------------------------------------------
+ * Orientation
+ * ------------------------------------------------------------------------- */
+
+// Mirrors after the (optional) axis swap, see img_exif.c
+static inline bool orient_flip_x(int orient)
+{
+    return orient == 2 || orient == 3 || orient == 6 || orient == 7;
+}
+
+static inline bool orient_flip_y(int orient)
+{
+    return orient == 3 || orient == 4 || orient == 7 || orient == 8;
+}
+
+size_t img_orienter_mem(int orient, int out_h)
+{
+    return img_exif_orient_swaps(orient) ? (size_t)IMG_ORIENT_TILE * out_h : 0;
+}
+
+esp_err_t img_orienter_init(img_orienter_t *o, int orient, uint8_t *out, int out_w, int out_h)
+{
+    memset(o, 0, sizeof(*o));
+    o->out = out;
+    o->out_w = out_w;
+    o->out_h = out_h;
+    o->orient = (orient >= 1 && orient <= 8) ? orient : IMG_EXIF_ORIENT_NORMAL;
+    o->in_w = img_exif_orient_swaps(o->orient) ? out_h : out_w;
+
+    size_t band = img_orienter_mem(o->orient, out_h);
+    if (band) {
+        o->band = img_arena_alloc(band);
+        if (!o->band) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+// Band rows become output columns, one IMG_ORIENT_TILE square at a time:
+// the tile is read as short runs of the band rows into a local block,
+// transposed there, and its rows written as short runs into as many output
+// rows, so neither the band nor the output is walked with a wide stride
+static void orient_flush_band(img_orienter_t *o)
+{
+    const int n = o->band_n;
+    const bool fx = orient_flip_x(o->orient);
+    const bool fy = orient_flip_y(o->orient);
+    // Source row band_y + k lands in column x0 + k, or x0 - k when mirrored
+    const int x0 = fx ? o->out_w - 1 - o->band_y : o->band_y;
+    uint8_t tile[IMG_ORIENT_TILE][IMG_ORIENT_TILE];
+
+    for (int sx0 = 0; sx0 < o->in_w; sx0 += IMG_ORIENT_TILE) {
+        int tw = o->in_w - sx0 < IMG_ORIENT_TILE ? o->in_w - sx0 : IMG_ORIENT_TILE;
+        for (int k = 0; k < n; k++) {
+            const uint8_t *s = o->band + (size_t)k * o->in_w + sx0;
+            for (int i = 0; i < tw; i++) {
+                tile[i][k] = s[i];
+            }
+        }
+        for (int i = 0; i < tw; i++) {
+            int sx = sx0 + i;
+            uint8_t *d = o->out + (size_t)(fy ? o->out_h - 1 - sx : sx) * o->out_w;
+            if (fx) {
+                for (int k = 0; k < n; k++) {
+                    d[x0 - k] = tile[i][k];
+                }
+            } else {
+                memcpy(d + x0, tile[i], n);
+            }
+        }
+    }
+    o->band_y += n;
+    o->band_n = 0;
+}
+
+void img_orienter_row(img_orienter_t *o, const uint8_t *row, int y)
+{
+    if (o->band) {
+        memcpy(o->band + (size_t)o->band_n * o->in_w, row, o->in_w);
+        if (++o->band_n == IMG_ORIENT_TILE) {
+            orient_flush_band(o);
+        }
+        return;
+    }
+
+    uint8_t *d = o->out + (size_t)(orient_flip_y(o->orient) ? o->out_h - 1 - y : y) * o->out_w;
+    if (orient_flip_x(o->orient)) {
+        for (int x = 0; x < o->out_w; x++) {
+            d[x] = row[o->out_w - 1 - x];
+        }
+    } else {
+        memcpy(d, row, o->out_w);
+    }
+}
+
+void img_orienter_finish(img_orienter_t *o)
+{
+    if (o->band) {
+        if (o->band_n) {
+            orient_flush_band(o);
+        }
+        img_arena_free(o->band);
+        o->band = NULL;
+    }
+}
@@ -0,0 +1,155 @@
+/*
+ * Image Resample - Separable fixed-point scaler (full buffer or row streaming)
+ *
+ * Axes that shrink use an area-average (box) filter, axes that grow use a
+ * polyphase bicubic or Lanczos-2 kernel. Weights are precomputed once per
+ * axis; the per-pixel path is integer only.
+ *
+ * Scaled rows can be written turned by an EXIF orientation (img_orienter_t):
+ * the scaler works in the stored orientation and the rows are mirrored or
+ * transposed, in 16x16 tiles, into the final buffer, so the rotation costs
+ * no copy of the source image.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "image_processor.h"
+
+// Kernel used on axes that are enlarged
+typedef enum {
+    IMG_FILTER_BICUBIC,      // Catmull-Rom
+    IMG_FILTER_LANCZOS2      // Lanczos, 2 lobes
+} img_resample_filter_t;
+
+// Scaler configuration
+typedef struct {
+    int in_w;
+    int in_h;
+    int out_w;
+    int out_h;
+    int channels;                       // 1 = grayscale, 3 = RGB
+    bool fit;                           // true=fit (white margins), false=fill (crop)
+    img_resample_filter_t upscale;      // Kernel for enlarged axes
+    uint32_t *hist;                     // Optional 256-bin luma histogram of the image
+                                        // area (margins excluded), NULL = off
+} img_resample_cfg_t;
+
+// Precomputed weights for one axis
+typedef struct {
+    int taps;               // Weight slots per output sample
+    int32_t *start;         // First source index per output sample (< 0 = background)
+    uint8_t *count;         // Taps actually used per output sample
+    int16_t *weights;       // Q14 weights, taps per output sample
+} img_resample_axis_t;
+
+// Streaming scaler state
+typedef struct {
+    img_resample_cfg_t cfg;
+    img_resample_axis_t x;
+    img_resample_axis_t y;
+    int in_row;                 // Next source row expected
+    int out_row;                // Next output row to emit
+    int first_row;              // First source row any output row needs
+    int last_row;               // Last source row any output row needs
+    int ring_rows;              // Horizontally filtered rows kept
+    int16_t *ring;              // ring_rows x out_w x channels, Q4
+    uint8_t *line;              // Output row buffer
+    img_row_cb_t cb;
+    void *cb_ctx;
+} img_resampler_t;
+
+/**
+ * @brief Initialize a streaming scaler
+ * @param rs Scaler state
+ * @param cfg Geometry and filter configuration
+ * @param cb Called once per output row, in order
+ * @param cb_ctx Context passed to cb
+ * @return ESP_OK on success
+ */
+esp_err_t img_resampler_init(img_resampler_t *rs, const img_resample_cfg_t *cfg,
+                             img_row_cb_t cb, void *cb_ctx);
+
+/**
+ * @brief Bytes img_resampler_init allocates for a configuration
+ */
+size_t img_resampler_mem(const img_resample_cfg_t *cfg);
+
+/**
+ * @brief Push the next source row (rows must arrive top to bottom)
+ * @param rs Scaler state
+ * @param row Source row (in_w * channels bytes)
+ * @return ESP_OK, or the first error returned by the row callback
+ */
+esp_err_t img_resampler_push(img_resampler_t *rs, const uint8_t *row);
+
+/**
+ * @brief Emit any output rows not yet produced (background fill)
+ * @return ESP_OK, or the first error returned by the row callback
+ */
+esp_err_t img_resampler_finish(img_resampler_t *rs);
+
+/**
+ * @brief Free scaler buffers
+ */
+void img_resampler_deinit(img_resampler_t *rs);
+
+#define IMG_ORIENT_TILE 16       // Rows per transposed band, columns per tile
+
+// Writes scaled gray rows, in stored orientation, turned into a buffer
+typedef struct {
+    uint8_t *out;               // Turned image, out_w x out_h
+    int out_w;
+    int out_h;
+    int in_w;                   // Rows as they arrive (out_h wide if the axes swap)
+    int orient;                 // EXIF orientation 1-8
+    uint8_t *band;              // IMG_ORIENT_TILE rows (axis-swapping orientations only)
+    int band_y;                 // Source row of band[0]
+    int band_n;                 // Rows in band
+} img_orienter_t;
+
+/**
+ * @brief Initialize an orienter
+ * @param o Orienter state
+ * @param orient EXIF orientation 1-8 the rows are turned by
+ * @param out Destination buffer, out_w x out_h
+ * @param out_w Width after turning
+ * @param out_h Height after turning
+ * @return ESP_OK or ESP_ERR_NO_MEM
+ */
+esp_err_t img_orienter_init(img_orienter_t *o, int orient, uint8_t *out, int out_w, int out_h);
+
+/**
+ * @brief Bytes img_orienter_init allocates
+ *
+ * One band of IMG_ORIENT_TILE stored rows when the axes swap. A stored row
+ * is out_h pixels long, so the output width does not enter.
+ * @param orient EXIF orientation, 1-8
+ * @param out_h Height after turning
+ */
+size_t img_orienter_mem(int orient, int out_h);
+
+/**
+ * @brief Write the next source row (rows must arrive top to bottom)
+ * @param o Orienter state
+ * @param row Row in stored orientation (out_h wide if the axes swap, else out_w)
+ * @param y Row index
+ */
+void img_orienter_row(img_orienter_t *o, const uint8_t *row, int y);
+
+/**
+ * @brief Write any buffered rows and free the orienter
+ */
+void img_orienter_finish(img_orienter_t *o);
+
+/**
+ * @brief Scale a full buffer in one call
+ * @param cfg Geometry and filter configuration
+ * @param input Source pixels (in_w * in_h * channels bytes)
+ * @param output Destination pixels (out_w * out_h * channels bytes)
+ * @return ESP_OK on success
+ */
+esp_err_t img_resample_buffer(const img_resample_cfg_t *cfg,
+                              const uint8_t *input, uint8_t *output);
@@ -0,0 +1,153 @@
+/*
+ * Image Tone Implementation
+ *
+ * The curve is built once per frame from 256 bins, so the per-pixel cost of
+ * tone mapping is one table lookup folded into the row fetch.
+ */
+
+#include "img_tone.h"
+
+#include <math.h>
+#include "esp_log.h"
+
+static const char *TAG = "img_tone";
+
+void img_tone_default_cfg(img_tone_cfg_t *cfg, bool clahe)
+{
+    cfg->clip_low = 5;
+    cfg->clip_high = 5;
+    cfg->min_range = 64;
+    cfg->gamma = 0;
+    cfg->clahe_limit = clahe ? 3 : 0;
+    cfg->clahe_mix = clahe ? 128 : 0;
+}
+
+void img_tone_hist_add(uint32_t hist[256], const uint8_t *pixels, int count, int channels)
+{
+    if (channels == 3) {
+        for (int i = 0; i < count; i++, pixels += 3) {
+            hist[img_luma(pixels)]++;
+        }
+    } else {
+        for (int i = 0; i < count; i++) {
+            hist[pixels[i]]++;
+        }
+    }
+}
+
+// Contrast-limited equalization over the whole frame: bins above the limit
+// are cut and the excess spread evenly, then the CDF becomes the curve
+static void build_clahe_curve(const uint32_t hist[256], uint32_t total, int limit_mul,
+                              uint8_t eq[256])
+{
+    uint32_t limit = (uint32_t)(((uint64_t)total * limit_mul) / 256);
+    if (limit == 0) {
+        limit = 1;
+    }
+
+    uint32_t excess = 0;
+    for (int v = 0; v < 256; v++) {
+        if (hist[v] > limit) {
+            excess += hist[v] - limit;
+        }
+    }
+    uint32_t bonus = excess / 256;
+
+    uint64_t cdf = 0;
+    uint64_t cdf_min = 0;
+    uint64_t cdf_total = 0;
+    for (int v = 0; v < 256; v++) {
+        cdf_total += ((hist[v] > limit) ? limit : hist[v]) + bonus;
+    }
+
+    for (int v = 0; v < 256; v++) {
+        cdf += ((hist[v] > limit) ? limit : hist[v]) + bonus;
+        if (v == 0) {
+            cdf_min = cdf;
+        }
+        uint64_t span = cdf_total - cdf_min;
+        eq[v] = span ? (uint8_t)(((cdf - cdf_min) * 255 + span / 2) / span) : v;
+    }
+}
+
+void img_tone_build_lut(const uint32_t hist[256], const img_tone_cfg_t *cfg, uint8_t lut[256])
+{
+    uint32_t total = 0;
+    for (int v = 0; v < 256; v++) {
+        total += hist[v];
+    }
+    if (total == 0) {
+        for (int v = 0; v < 256; v++) {
+            lut[v] = v;
+        }
+        return;
+    }
+
+    // Percentile clip points
+    uint32_t low_count = (uint32_t)(((uint64_t)total * cfg->clip_low) / 1000);
+    uint32_t high_count = (uint32_t)(((uint64_t)total * cfg->clip_high) / 1000);
+    int lo = 0, hi = 255;
+    uint32_t cum = 0;
+    for (lo = 0; lo < 255; lo++) {
+        cum += hist[lo];
+        if (cum > low_count) break;
+    }
+    cum = 0;
+    for (hi = 255; hi > 0; hi--) {
+        cum += hist[hi];
+        if (cum > high_count) break;
+    }
+
+    // Near-flat frames are only stretched up to min_range
+    if (hi - lo < cfg->min_range) {
+        int mid = (lo + hi) / 2;
+        lo = mid - cfg->min_range / 2;
+        if (lo < 0) lo = 0;
+        hi = lo + cfg->min_range;
+        if (hi > 255) {
+            hi = 255;
+            lo = 255 - cfg->min_range;
+        }
+    }
+
+    // Auto gamma goes halfway (in log space) to putting the median at mid-gray
+    float gamma = cfg->gamma / 100.0f;
+    if (cfg->gamma == 0) {
+        int median = lo;
+        cum = 0;
+        for (int v = 0; v < 256; v++) {
+            cum += hist[v];
+            if (cum * 2 >= total) {
+                median = v;
+                break;
+            }
+        }
+        float t = (float)(median - lo) / (hi - lo);
+        t = (t < 0.05f) ? 0.05f : (t > 0.95f) ? 0.95f : t;
+        gamma = sqrtf(logf(0.5f) / logf(t));
+        gamma = (gamma < 0.8f) ? 0.8f : (gamma > 1.25f) ? 1.25f : gamma;
+    }
+
+    uint8_t eq[256];
+    if (cfg->clahe_limit) {
+        build_clahe_curve(hist, total, cfg->clahe_limit, eq);
+    }
+
+    for (int v = 0; v < 256; v++) {
+        int out;
+        if (v <= lo) {
+            out = 0;
+        } else if (v >= hi) {
+            out = 255;
+        } else {
+            out = (int)(255.0f * powf((float)(v - lo) / (hi - lo), gamma) + 0.5f);
+        }
+        if (cfg->clahe_limit) {
+            out = (out * (256 - cfg->clahe_mix) + eq[v] * cfg->clahe_mix + 128) >> 8;
+        }
+        lut[v] = (out > 255) ? 255 : out;
+    }
+
+    ESP_LOGI(TAG, "Tone curve: %d-%d, gamma %.2f%s", lo, hi, gamma,
+             cfg->clahe_limit ? ", CLAHE" : "");
+}
@@ -0,0 +1,52 @@
+/*
+ * Image Tone - Histogram-driven tone curve (percentile clip, gamma, CLAHE-lite)
+ *
+ * The histogram is gathered while rows are produced (scaler output or the
+ * first touch of an unscaled frame); the resulting curve is a single
+ * 256-entry LUT applied as rows are fed to the ditherer.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Tone curve parameters
+typedef struct {
+    uint16_t clip_low;          // Darkest pixels mapped to black, per mille
+    uint16_t clip_high;         // Brightest pixels mapped to white, per mille
+    uint16_t min_range;         // Smallest input span that is stretched to 0-255
+    uint16_t gamma;             // Gamma x100 (100 = linear), 0 = auto from the median
+    uint8_t clahe_limit;        // Equalization bin limit in mean bin counts, 0 = off
+    uint8_t clahe_mix;          // Weight of the equalized curve (0-256 scale)
+} img_tone_cfg_t;
+
+static inline uint8_t img_luma(const uint8_t *rgb)
+{
+    // Luminance formula: 0.299*R + 0.587*G + 0.114*B
+    return (rgb[0] * 77 + rgb[1] * 150 + rgb[2] * 29) >> 8;
+}
+
+/**
+ * @brief Get default tone parameters (0.5% clip each side, auto gamma, no CLAHE)
+ * @param cfg Parameters to fill
+ * @param clahe Enable the contrast-limited equalization blend
+ */
+void img_tone_default_cfg(img_tone_cfg_t *cfg, bool clahe);
+
+/**
+ * @brief Add pixels to a 256-bin histogram
+ * @param hist Histogram
+ * @param pixels Pixel data
+ * @param count Number of pixels
+ * @param channels 1 = grayscale, 3 = RGB (luma is counted)
+ */
+void img_tone_hist_add(uint32_t hist[256], const uint8_t *pixels, int count, int channels);
+
+/**
+ * @brief Build the tone LUT for a histogram
+ * @param hist Histogram of the frame (an empty one gives the identity)
+ * @param cfg Tone parameters
+ * @param lut Output table, lut[gray] = adjusted gray
+ */
+void img_tone_build_lut(const uint32_t hist[256], const img_tone_cfg_t *cfg, uint8_t lut[256]);
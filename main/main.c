@@ -28,9 +28,11 @@
 #include "wifi_manager.h"
 #include "epaper_driver.h"
 #include "storage_manager.h"
+#include "img_arena.h"
 #include "web_server.h"
 #include "power_manager.h"
 #include "carousel.h"
+#include "render_queue.h"
 #include "display_overlay.h"
 
 static const char *TAG = "main";
@@ -244,6 +246,9 @@ void app_main(void) {
     };
     ESP_ERROR_CHECK(spi_bus_initialize(SPI_HOST_USED, &buscfg, SPI_DMA_CHAN));
     
+    // One image pipeline job at a time, each with its own memory arena
+    ESP_ERROR_CHECK(img_arena_init());
+
     // Initialize storage (NVS and SD card)
     ESP_ERROR_CHECK(storage_init());
     
@@ -261,6 +266,9 @@ void app_main(void) {
     
     // Initialize carousel
     ESP_ERROR_CHECK(carousel_init());
+
+    // Resume pre-rendering; a fresh boot also looks for new or stale images
+    render_queue_init(wake_reason == WAKE_REASON_RESET || wake_reason == WAKE_REASON_UNKNOWN);
     
     // Create WiFi timeout timer
     s_wifi_timer = xTimerCreate("wifi_timer", pdMS_TO_TICKS(s_wifi_timeout_sec * 1000),
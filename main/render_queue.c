@@ -0,0 +1,447 @@
+/*
+ * Render Queue Implementation
+ *
+ * The queue file is rewritten after every state change; it is a few KB,
+ * far less than the render it records. A job found RUNNING when the file is
+ * loaded was cut off by a reset or deep sleep and counts as an attempt, so
+ * an image that takes the renderer down is eventually skipped instead of
+ * retried forever.
+ */
+
+#include "render_queue.h"
+#include "carousel.h"
+#include "image_processor.h"
+#include "img_binfile.h"
+#include "board_config.h"
+#include "sdkconfig.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "render_q";
+
+#define QUEUE_PATH          IMAGES_DIR "/.render_queue"     // Hidden: not listed as an image
+#define QUEUE_MAGIC         0x31515252                      // "RRQ1"
+#define RENDER_MAX_ATTEMPTS 3
+#define RENDER_STACK        32768       // Image processing (stb_image fallback)
+#define RENDER_PRIORITY     1
+
+// Wi-Fi and lwIP are pinned to one core; renders go to the other
+#if CONFIG_ESP_WIFI_TASK_PINNED_TO_CORE_1
+#define RENDER_CORE 0
+#else
+#define RENDER_CORE 1
+#endif
+
+// What a job still has to produce
+#define NEED_BIN    0x01
+#define NEED_THUMB  0x02
+
+// Job record, stored as is in the queue file
+typedef struct {
+    char filename[MAX_FILENAME_LEN];
+    uint8_t state;              // render_job_state_t
+    uint8_t attempts;
+    uint8_t needs;              // NEED_* bits
+    uint8_t reserved;
+} render_job_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t params_hash;       // Render options the jobs were queued for
+    uint16_t count;
+    uint16_t reserved;
+} queue_header_t;
+
+static render_job_t *s_jobs;    // MAX_IMAGES entries
+static int s_count;
+static uint32_t s_params_hash;
+static img_process_opts_t s_opts;
+static int s_running = -1;      // Job being rendered
+static SemaphoreHandle_t s_mutex;
+static TaskHandle_t s_task;
+
+static void load_render_opts(void) {
+    app_settings_t settings;
+    storage_load_settings(&settings);
+    img_get_render_opts(&s_opts, &settings);
+    s_params_hash = img_opts_hash(&s_opts);
+}
+
+// .bin and .raw images are frames already
+static bool is_source_image(const char *filename) {
+    const char *ext = strrchr(filename, '.');
+    return ext && strcasecmp(ext, ".bin") != 0 && strcasecmp(ext, ".raw") != 0;
+}
+
+static void image_path(char *path, size_t size, const char *filename) {
+    snprintf(path, size, "%s/%s", IMAGES_DIR, filename);
+}
+
+// Outputs of an image that are missing or stale
+static uint8_t image_needs(const char *filename, const img_process_opts_t *opts) {
+    char path[128];
+    char other[140];
+    uint8_t needs = 0;
+
+    image_path(path, sizeof(path), filename);
+    snprintf(other, sizeof(other), "%s.thumb", path);
+    struct stat st;
+    if (stat(other, &st) != 0) {
+        needs |= NEED_THUMB;
+    }
+
+    strcpy(other, path);
+    char *ext = strrchr(other, '.');
+    strcpy(ext ? ext : other + strlen(other), ".bin");
+    img_binfile_t bf;
+    if (img_binfile_open_render(&bf, other, opts) != ESP_OK) {
+        needs |= NEED_BIN;
+    }
+    img_binfile_close(&bf);
+    return needs;
+}
+
+static void queue_save(void) {
+    FILE *f = fopen(QUEUE_PATH, "wb");
+    if (!f) {
+        ESP_LOGW(TAG, "Cannot write %s", QUEUE_PATH);
+        return;
+    }
+    queue_header_t hdr = {
+        .magic = QUEUE_MAGIC,
+        .params_hash = s_params_hash,
+        .count = s_count,
+    };
+    fwrite(&hdr, sizeof(hdr), 1, f);
+    fwrite(s_jobs, sizeof(render_job_t), s_count, f);
+    fclose(f);
+}
+
+static bool queue_load(void) {
+    FILE *f = fopen(QUEUE_PATH, "rb");
+    if (!f) {
+        return false;
+    }
+    queue_header_t hdr;
+    bool ok = fread(&hdr, sizeof(hdr), 1, f) == 1 && hdr.magic == QUEUE_MAGIC &&
+              hdr.params_hash == s_params_hash && hdr.count <= MAX_IMAGES &&
+              fread(s_jobs, sizeof(render_job_t), hdr.count, f) == hdr.count;
+    fclose(f);
+    if (!ok) {
+        s_count = 0;
+        return false;
+    }
+
+    s_count = hdr.count;
+    for (int i = 0; i < s_count; i++) {
+        render_job_t *job = &s_jobs[i];
+        job->filename[MAX_FILENAME_LEN - 1] = '\0';
+        if (job->state == RENDER_JOB_RUNNING) {
+            job->state = (job->attempts >= RENDER_MAX_ATTEMPTS) ? RENDER_JOB_FAILED : RENDER_JOB_PENDING;
+            ESP_LOGW(TAG, "Render of %s was interrupted (attempt %d)", job->filename, job->attempts);
+        }
+    }
+    return true;
+}
+
+static int find_job(const char *filename) {
+    for (int i = 0; i < s_count; i++) {
+        if (strcmp(s_jobs[i].filename, filename) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Queue an image if it needs work; a failed job stays failed for these options
+static void queue_image(const char *filename, uint8_t needs) {
+    int i = find_job(filename);
+    if (i >= 0) {
+        if (s_jobs[i].state == RENDER_JOB_DONE || (!needs && s_jobs[i].state != RENDER_JOB_RUNNING)) {
+            s_jobs[i].state = needs ? RENDER_JOB_PENDING : RENDER_JOB_DONE;
+            s_jobs[i].attempts = 0;
+        }
+        s_jobs[i].needs = needs;
+        return;
+    }
+    if (!needs || s_count >= MAX_IMAGES) {
+        return;
+    }
+    render_job_t *job = &s_jobs[s_count++];
+    memset(job, 0, sizeof(*job));
+    strncpy(job->filename, filename, MAX_FILENAME_LEN - 1);
+    job->state = RENDER_JOB_PENDING;
+    job->needs = needs;
+}
+
+static image_info_t *list_images(int *count) {
+    image_info_t *images = heap_caps_malloc(MAX_IMAGES * sizeof(image_info_t),
+                                            MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!images) {
+        images = malloc(MAX_IMAGES * sizeof(image_info_t));
+    }
+    *count = images ? storage_get_images(images, MAX_IMAGES) : 0;
+    return images;
+}
+
+// Rebuild the queue from the images on the card (mutex held)
+static void queue_scan(void) {
+    int count;
+    image_info_t *images = list_images(&count);
+    if (!images) {
+        return;
+    }
+
+    // Drop finished jobs and jobs of deleted images, keep the rest in order
+    int kept = 0;
+    int running = s_running;
+    for (int i = 0; i < s_count; i++) {
+        bool listed = false;
+        for (int j = 0; j < count && !listed; j++) {
+            listed = strcmp(s_jobs[i].filename, images[j].filename) == 0;
+        }
+        bool keep = listed && (s_jobs[i].state != RENDER_JOB_DONE || i == running);
+        if (i == running) {
+            s_running = keep ? kept : -1;
+        }
+        if (keep) {
+            s_jobs[kept++] = s_jobs[i];
+        }
+    }
+    s_count = kept;
+
+    for (int j = 0; j < count; j++) {
+        if (is_source_image(images[j].filename)) {
+            queue_image(images[j].filename, image_needs(images[j].filename, &s_opts));
+        }
+    }
+    free(images);
+    queue_save();
+}
+
+// Pending job of the image shown soonest (mutex held)
+static int pick_job(void) {
+    int count;
+    image_info_t *images = list_images(&count);
+    if (!images) {
+        return -1;
+    }
+
+    int next = carousel_peek_next_index(count);
+    int best = -1;
+    int best_dist = count;
+    for (int j = 0; j < count; j++) {
+        int i = find_job(images[j].filename);
+        if (i < 0 || s_jobs[i].state != RENDER_JOB_PENDING) {
+            continue;
+        }
+        int dist = (j - next + count) % count;
+        if (dist < best_dist) {
+            best = i;
+            best_dist = dist;
+        }
+    }
+
+    // Images deleted since they were queued
+    for (int i = 0; i < s_count; i++) {
+        bool listed = false;
+        for (int j = 0; j < count && !listed; j++) {
+            listed = strcmp(s_jobs[i].filename, images[j].filename) == 0;
+        }
+        if (!listed && s_jobs[i].state == RENDER_JOB_PENDING) {
+            s_jobs[i].state = RENDER_JOB_DONE;
+        }
+    }
+    free(images);
+    return best;
+}
+
+static void render_task(void *arg) {
+    ESP_LOGI(TAG, "Render worker started on core %d", RENDER_CORE);
+
+    while (true) {
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        int i = pick_job();
+        if (i < 0) {
+            s_task = NULL;
+            queue_save();
+            xSemaphoreGive(s_mutex);
+            break;
+        }
+        render_job_t job = s_jobs[i];
+        s_jobs[i].state = RENDER_JOB_RUNNING;
+        s_jobs[i].attempts++;
+        s_running = i;
+        img_process_opts_t opts = s_opts;
+        queue_save();
+        xSemaphoreGive(s_mutex);
+
+        // A .bin render makes the thumbnail from the same decode
+        char path[128];
+        image_path(path, sizeof(path), job.filename);
+        ESP_LOGI(TAG, "Rendering %s (attempt %d)", job.filename, job.attempts + 1);
+        if (job.needs & NEED_BIN) {
+            img_process_upload(path);
+        } else {
+            img_generate_thumbnail(path);
+        }
+        uint8_t needs = image_needs(job.filename, &opts);
+
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        // A rescan during the render may have moved the job
+        i = s_running;
+        s_running = -1;
+        if (i >= 0 && s_jobs[i].state == RENDER_JOB_RUNNING) {
+            if (!needs) {
+                s_jobs[i].state = RENDER_JOB_DONE;
+            } else if (s_jobs[i].attempts >= RENDER_MAX_ATTEMPTS) {
+                s_jobs[i].state = RENDER_JOB_FAILED;
+                ESP_LOGW(TAG, "Giving up on %s", job.filename);
+            } else {
+                s_jobs[i].state = RENDER_JOB_PENDING;
+            }
+            // Options changed during the render: check it again
+            if (img_opts_hash(&opts) != s_params_hash) {
+                s_jobs[i].state = RENDER_JOB_PENDING;
+                s_jobs[i].attempts = 0;
+            }
+            s_jobs[i].needs = needs;
+        }
+        queue_save();
+        xSemaphoreGive(s_mutex);
+
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    ESP_LOGI(TAG, "Render queue empty");
+    vTaskDelete(NULL);
+}
+
+// Start the worker if there is pending work (mutex held)
+static void kick(void) {
+    if (s_task) {
+        return;
+    }
+    bool pending = false;
+    for (int i = 0; i < s_count && !pending; i++) {
+        pending = s_jobs[i].state == RENDER_JOB_PENDING;
+    }
+    if (pending && xTaskCreatePinnedToCore(render_task, "render_q", RENDER_STACK, NULL,
+                                           RENDER_PRIORITY, &s_task, RENDER_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start render worker");
+        s_task = NULL;
+    }
+}
+
+esp_err_t render_queue_init(bool rescan) {
+    if (!storage_sd_mounted()) {
+        return ESP_OK;
+    }
+    s_mutex = xSemaphoreCreateMutex();
+    s_jobs = heap_caps_calloc(MAX_IMAGES, sizeof(render_job_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!s_jobs) {
+        s_jobs = calloc(MAX_IMAGES, sizeof(render_job_t));
+    }
+    if (!s_mutex || !s_jobs) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    load_render_opts();
+    // A queue saved for other options is rebuilt
+    if (!queue_load() || rescan) {
+        queue_scan();
+    }
+    ESP_LOGI(TAG, "Render queue: %d jobs", s_count);
+    kick();
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+}
+
+void render_queue_rescan(void) {
+    if (!s_mutex) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    uint32_t old_hash = s_params_hash;
+    load_render_opts();
+    if (s_params_hash != old_hash) {
+        // New options: failed jobs get another chance too
+        for (int i = 0; i < s_count; i++) {
+            if (i != s_running) {
+                s_jobs[i].state = RENDER_JOB_DONE;
+            }
+        }
+    }
+    queue_scan();
+    kick();
+    xSemaphoreGive(s_mutex);
+}
+
+void render_queue_add(const char *filename) {
+    if (!s_mutex || !is_source_image(filename)) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    queue_image(filename, image_needs(filename, &s_opts));
+    queue_save();
+    kick();
+    xSemaphoreGive(s_mutex);
+}
+
+bool render_queue_wait_for(const char *filename, uint32_t timeout_ms) {
+    if (!s_mutex) {
+        return true;
+    }
+    TickType_t start = xTaskGetTickCount();
+    while (true) {
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        int i = find_job(filename);
+        bool busy = i >= 0 && s_task &&
+                    (s_jobs[i].state == RENDER_JOB_PENDING || s_jobs[i].state == RENDER_JOB_RUNNING);
+        xSemaphoreGive(s_mutex);
+        if (!busy) {
+            return true;
+        }
+        if (xTaskGetTickCount() - start >= pdMS_TO_TICKS(timeout_ms)) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+}
+
+void render_queue_get_status(render_queue_status_t *status) {
+    memset(status, 0, sizeof(*status));
+    if (!s_mutex) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    status->total = s_count;
+    for (int i = 0; i < s_count; i++) {
+        switch (s_jobs[i].state) {
+            case RENDER_JOB_PENDING:
+            case RENDER_JOB_RUNNING:
+                status->pending++;
+                break;
+            case RENDER_JOB_DONE:
+                status->done++;
+                break;
+            default:
+                status->failed++;
+                break;
+        }
+    }
+    status->active = s_task != NULL;
+    if (s_running >= 0) {
+        strncpy(status->current, s_jobs[s_running].filename, sizeof(status->current) - 1);
+    }
+    xSemaphoreGive(s_mutex);
+}
@@ -0,0 +1,68 @@
+/*
+ * Render Queue - Persistent background jobs that pre-render stored images
+ *
+ * One job per image whose .bin is missing or stale (see img_binfile) or
+ * whose thumbnail is missing. The queue lives on the SD card, so work
+ * interrupted by deep sleep or a reset resumes on the next boot. Jobs run
+ * on the core Wi-Fi is not pinned to, nearest the carousel's next image
+ * first.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "storage_manager.h"
+
+// Job states
+typedef enum {
+    RENDER_JOB_PENDING,
+    RENDER_JOB_RUNNING,         // In the file: interrupted, retried on resume
+    RENDER_JOB_DONE,
+    RENDER_JOB_FAILED,          // Gave up after RENDER_MAX_ATTEMPTS
+} render_job_state_t;
+
+// Progress of the current queue
+typedef struct {
+    int total;
+    int pending;                // Includes the running job
+    int done;
+    int failed;
+    bool active;                // Worker task running
+    char current[MAX_FILENAME_LEN];     // Image being rendered, "" if none
+} render_queue_status_t;
+
+/**
+ * @brief Load the saved queue and resume it
+ * @param rescan Also check every image (fresh boot: files may have been
+ *               copied to the card, settings may have changed)
+ * @return ESP_OK, or ESP_ERR_NO_MEM
+ */
+esp_err_t render_queue_init(bool rescan);
+
+/**
+ * @brief Check every image again and queue what is missing or stale
+ *
+ * Call after changing settings that affect rendering.
+ */
+void render_queue_rescan(void);
+
+/**
+ * @brief Queue one image (e.g. its .bin was found stale)
+ * @param filename Image file name in IMAGES_DIR
+ */
+void render_queue_add(const char *filename);
+
+/**
+ * @brief Wait until an image has no pending or running job
+ * @param filename Image file name in IMAGES_DIR
+ * @param timeout_ms Longest wait
+ * @return true if the image is rendered (or needs nothing)
+ */
+bool render_queue_wait_for(const char *filename, uint32_t timeout_ms);
+
+/**
+ * @brief Get queue progress
+ */
+void render_queue_get_status(render_queue_status_t *status);
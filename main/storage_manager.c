@@ -420,6 +420,9 @@ void storage_reset_settings(app_settings_t *settings) {
     strncpy(settings->ap_password, DEFAULT_AP_PASS, sizeof(settings->ap_password));
     settings->provisioned = false;
     settings->fit_mode = false;
+    settings->display_bpp = 1;
+    settings->next_image_index = 0;
+    settings->orientation = 0;
 }
 
 esp_err_t storage_load_settings(app_settings_t *settings) {
@@ -589,70 +592,3 @@ static void storage_check_samples(void) {
     esp_vfs_spiffs_unregister("storage");
 }
 
-static void process_optimizations_task(void *arg) {
-    if (!s_sd_mounted) {
-        vTaskDelete(NULL);
-        return;
-    }
-
-    DIR *d = opendir(IMAGES_DIR);
-    if (!d) {
-        vTaskDelete(NULL);
-        return;
-    }
-
-    struct dirent *de;
-    while ((de = readdir(d)) != NULL) {
-        if (de->d_type != DT_REG) continue;
-        
-        // Skip hidden files
-        if (de->d_name[0] == '.') continue;
-
-        // Check extension
-        char *ext = strrchr(de->d_name, '.');
-        if (!ext) continue;
-
-        // Skip .bin and .thumb files
-        if (strcasecmp(ext, ".bin") == 0 || strcasecmp(ext, ".thumb") == 0) continue;
-
-        // Construct full path
-        char filepath[PATH_MAX_LEN];
-        snprintf(filepath, sizeof(filepath), "%s/%s", IMAGES_DIR, de->d_name);
-
-        // Check if .thumb exists
-        char thumbpath[PATH_MAX_LEN + 8];
-        snprintf(thumbpath, sizeof(thumbpath), "%s.thumb", filepath);
-        struct stat st;
-        bool need_process = false;
-        if (stat(thumbpath, &st) != 0) {
-            need_process = true;
-        } else {
-            // Check if .bin exists
-            char binpath[PATH_MAX_LEN];
-            strncpy(binpath, filepath, sizeof(binpath));
-            char *binext = strrchr(binpath, '.');
-            if (binext) strcpy(binext, ".bin");
-            else strcat(binpath, ".bin");
-            
-            if (stat(binpath, &st) != 0) {
-                need_process = true;
-            }
-        }
-
-        if (need_process) {
-            ESP_LOGI(TAG, "Generating optimizations for %s", de->d_name);
-            img_process_upload(filepath);
-            // Yield to avoid watchdog
-            vTaskDelay(pdMS_TO_TICKS(10));
-        }
-    }
-    closedir(d);
-    ESP_LOGI(TAG, "Optimization scan complete");
-    vTaskDelete(NULL);
-}
-
-void storage_process_missing_optimizations(void) {
-    // Spawn a task with large stack to handle image processing
-    // 32KB stack to be safe with stbi_load
-    xTaskCreate(process_optimizations_task, "img_opt", 32768, NULL, 1, NULL);
-}
@@ -39,6 +39,9 @@ typedef struct {
     bool provisioned;                   // WiFi has been configured
     bool random_order;                  // Random image order
     bool fit_mode;                      // Fit image to screen (keep margins)
+    uint8_t display_bpp;                // Output bits per pixel: 1 = mono, 2 = 4 gray (4 = 4 gray, older settings)
+    uint8_t next_image_index;           // Next image in random order (drawn one image ahead)
+    uint8_t orientation;                // Photo orientation: 0 = as stored, 1 = EXIF, 2 = EXIF + auto-rotate
 } app_settings_t;
 
 /**
@@ -159,7 +162,3 @@ esp_err_t storage_format_sd(void);
  */
 esp_err_t storage_create_images_dir(void);
 
-/**
- * @brief Check for images missing optimizations and process them
- */
-void storage_process_missing_optimizations(void);
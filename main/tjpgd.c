@@ -704,7 +704,7 @@ static JRESULT mcu_load (
 )
 {
 	int32_t *tmp = (int32_t*)jd->workbuf;	/* Block working buffer for de-quantize and IDCT */
-	int d, e;
+	int d, e, dc_only;
 	unsigned int blk, nby, i, bc, z, id, cmp;
 	jd_yuv_t *bp;
 	const int32_t *dqf;
@@ -738,8 +738,11 @@ static JRESULT mcu_load (
 			dqf = jd->qttbl[jd->qtid[cmp]];			/* De-quantizer table ID for this component */
 			tmp[0] = d * dqf[0] >> 8;				/* De-quantize, apply scale factor of Arai algorithm and descale 8 bits */
 
+			/* AC values are not needed at 1/8 scale or for C blocks in grayscale output */
+			dc_only = (JD_USE_SCALE && jd->scale == 3) || (JD_FORMAT == 2 && cmp);
+
 			/* Extract following 63 AC elements from input stream */
-			memset(&tmp[1], 0, 63 * sizeof (int32_t));	/* Initialize all AC elements */
+			if (!dc_only) memset(&tmp[1], 0, 63 * sizeof (int32_t));	/* Initialize all AC elements */
 			z = 1;		/* Top of the AC elements (in zigzag-order) */
 			do {
 				d = huffext(jd, id, 1);				/* Extract a huffman coded value (zero runs and bit length) */
@@ -751,6 +754,7 @@ static JRESULT mcu_load (
 				if (bc &= 0x0F) {					/* Bit length? */
 					d = bitext(jd, bc);				/* Extract data bits */
 					if (d < 0) return (JRESULT)(0 - d);	/* Err: input device */
+					if (dc_only) continue;			/* Bits consumed, value unused */
 					bc = 1 << (bc - 1);				/* MSB position */
 					if (!(d & bc)) d -= (bc << 1) - 1;	/* Restore negative value if needed */
 					i = Zig[z];						/* Get raster-order index */
@@ -6,6 +6,7 @@
 #include "wifi_manager.h"
 #include "storage_manager.h"
 #include "image_processor.h"
+#include "render_queue.h"
 #include "power_manager.h"
 #include "board_config.h"
 
@@ -24,6 +25,8 @@ extern void app_reset_wifi_timer(void);
 #define MIN(a, b) (((a) < (b)) ? (a) : (b))
 #endif
 
+#define THUMB_CHUNK_SIZE 4096   // Thumbnail read/send chunk
+
 static const char *TAG = "webserver";
 
 static httpd_handle_t s_server = NULL;
@@ -177,6 +180,23 @@ static const char HTML_DASHBOARD_BODY[] =
     "<input type='checkbox' id='fit-mode'>"
     "<label for='fit-mode'>Keep Margins (Fit to Screen)</label>"
     "</div>"
+    "<div class='form-group'>"
+    "<label>Display Mode</label>"
+    "<select id='display-bpp'>"
+    "<option value='1'>Black &amp; White (fastest)</option>"
+#if EPD_GRAY_EXPERIMENTAL
+    "<option value='2'>4 Gray Levels (experimental)</option>"
+#endif
+    "</select>"
+    "</div>"
+    "<div class='form-group'>"
+    "<label>Photo Orientation</label>"
+    "<select id='orientation'>"
+    "<option value='0'>As stored</option>"
+    "<option value='1'>Follow camera (EXIF)</option>"
+    "<option value='2'>Follow camera, turn portraits to fit</option>"
+    "</select>"
+    "</div>"
     "<div class='btn-group'>"
     "<button type='submit'>💾 Save Settings</button>"
     "<button type='button' onclick='location.href=\"/wifi\"' class='secondary'>📶 Configure WiFi</button>"
@@ -284,7 +304,9 @@ static const char HTML_SCRIPT[] =
     "document.getElementById('show-battery').checked=d.show_battery!==false;"
     "document.getElementById('show-wifi').checked=d.show_wifi!==false;"
     "document.getElementById('random-order').checked=d.random_order===true;"
-    "document.getElementById('fit-mode').checked=d.fit_mode===true}}"
+    "document.getElementById('fit-mode').checked=d.fit_mode===true;"
+    "document.getElementById('display-bpp').value=d.display_bpp||1;"
+    "document.getElementById('orientation').value=d.orientation||0}}"
 
     "async function saveSettings(e){"
     "e.preventDefault();"
@@ -296,7 +318,9 @@ static const char HTML_SCRIPT[] =
     "show_battery:document.getElementById('show-battery').checked,"
     "show_wifi:document.getElementById('show-wifi').checked,"
     "random_order:document.getElementById('random-order').checked,"
-    "fit_mode:document.getElementById('fit-mode').checked};"
+    "fit_mode:document.getElementById('fit-mode').checked,"
+    "display_bpp:+document.getElementById('display-bpp').value,"
+    "orientation:+document.getElementById('orientation').value};"
     "const r=await fetchJSON(API+'/settings',{method:'POST',headers:{'Content-Type':'application/json'},body:JSON.stringify(data)});"
     "if(r&&r.success)showToast('Settings saved!','success')}"
 
@@ -499,6 +523,16 @@ static esp_err_t handle_status(httpd_req_t *req)
     cJSON_AddBoolToObject(root, "sd_mounted", storage_sd_mounted());
     cJSON_AddNumberToObject(root, "free_mb", storage_get_free_space() / (1024 * 1024));
 
+    render_queue_status_t render;
+    render_queue_get_status(&render);
+    cJSON *render_obj = cJSON_AddObjectToObject(root, "render");
+    cJSON_AddBoolToObject(render_obj, "active", render.active);
+    cJSON_AddNumberToObject(render_obj, "total", render.total);
+    cJSON_AddNumberToObject(render_obj, "pending", render.pending);
+    cJSON_AddNumberToObject(render_obj, "done", render.done);
+    cJSON_AddNumberToObject(render_obj, "failed", render.failed);
+    cJSON_AddStringToObject(render_obj, "current", render.current);
+
     char *json = cJSON_PrintUnformatted(root);
     httpd_resp_set_type(req, "application/json");
     httpd_resp_sendstr(req, json);
@@ -874,6 +908,8 @@ static esp_err_t handle_get_settings(httpd_req_t *req)
     cJSON_AddBoolToObject(root, "show_wifi", settings.show_wifi);
     cJSON_AddBoolToObject(root, "random_order", settings.random_order);
     cJSON_AddBoolToObject(root, "fit_mode", settings.fit_mode);
+    cJSON_AddNumberToObject(root, "display_bpp", EPD_GRAY_EXPERIMENTAL ? settings.display_bpp : 1);
+    cJSON_AddNumberToObject(root, "orientation", settings.orientation);
 
     char *json = cJSON_PrintUnformatted(root);
 
@@ -905,6 +941,8 @@ static esp_err_t handle_set_settings(httpd_req_t *req)
 
     app_settings_t settings;
     storage_load_settings(&settings);
+    img_process_opts_t old_opts;
+    img_get_render_opts(&old_opts, &settings);
 
     cJSON *val;
     if ((val = cJSON_GetObjectItem(json, "carousel_interval")))
@@ -925,6 +963,12 @@ static esp_err_t handle_set_settings(httpd_req_t *req)
         settings.random_order = cJSON_IsTrue(val);
     if ((val = cJSON_GetObjectItem(json, "fit_mode")))
         settings.fit_mode = cJSON_IsTrue(val);
+    if ((val = cJSON_GetObjectItem(json, "display_bpp")) && cJSON_IsNumber(val) &&
+        (val->valueint == 1 || (EPD_GRAY_EXPERIMENTAL && val->valueint == 2)))
+        settings.display_bpp = val->valueint;
+    if ((val = cJSON_GetObjectItem(json, "orientation")) && cJSON_IsNumber(val) &&
+        val->valueint >= 0 && val->valueint <= 2)
+        settings.orientation = val->valueint;
 
     cJSON_Delete(json);
 
@@ -945,6 +989,14 @@ static esp_err_t handle_set_settings(httpd_req_t *req)
         s_settings_cb(&settings, s_settings_ctx);
     }
 
+    // Pre-rendered frames of the old options are stale: re-render in the background
+    img_process_opts_t new_opts;
+    img_get_render_opts(&new_opts, &settings);
+    if (ret == ESP_OK && img_opts_hash(&new_opts) != img_opts_hash(&old_opts))
+    {
+        render_queue_rescan();
+    }
+
     return ESP_OK;
 }
 
@@ -1248,19 +1300,56 @@ static esp_err_t handle_get_thumbnail(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    uint8_t *data = NULL;
-    size_t size = 0;
-    // Try to load thumbnail
-    if (storage_load_image(thumb_path, &data, &size) != ESP_OK)
-    {
+    // Thumbnails written before the JPEG format are converted on first request
+    const char *mime = "image/jpeg";
+    if (img_convert_thumbnail(full_path) != ESP_OK) {
+        mime = "image/bmp";
+    }
+    if (stat(full_path, &st) != 0) {
         httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Thumbnail not found");
         return ESP_FAIL;
     }
 
-    httpd_resp_set_type(req, "image/bmp");
-    httpd_resp_send(req, (const char *)data, size);
-    free(data);
-    return ESP_OK;
+    // Revalidate with an ETag from mtime and size; an unchanged thumbnail costs a stat
+    char etag[32];
+    snprintf(etag, sizeof(etag), "\"%lx-%lx\"", (unsigned long)st.st_mtime, (unsigned long)st.st_size);
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    char if_none_match[32];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+        strcmp(if_none_match, etag) == 0)
+    {
+        httpd_resp_set_status(req, "304 Not Modified");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+
+    FILE *f = fopen(full_path, "rb");
+    char *chunk = malloc(THUMB_CHUNK_SIZE);
+    if (!f || !chunk)
+    {
+        if (f) fclose(f);
+        free(chunk);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to read thumbnail");
+        return ESP_FAIL;
+    }
+
+    // Stream from the card rather than loading the file
+    httpd_resp_set_type(req, mime);
+    esp_err_t ret = ESP_OK;
+    size_t n;
+    while (ret == ESP_OK && (n = fread(chunk, 1, THUMB_CHUNK_SIZE, f)) > 0)
+    {
+        ret = httpd_resp_send_chunk(req, chunk, n);
+    }
+    if (ret == ESP_OK)
+    {
+        ret = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    free(chunk);
+    fclose(f);
+    return ret;
 }
 
 static esp_err_t handle_captive_portal(httpd_req_t *req)